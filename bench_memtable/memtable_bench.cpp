@@ -33,6 +33,8 @@ DEFINE_uint32(value_size, 0, "");
 DEFINE_uint64(memtable_size_mb, 0, "");
 DEFINE_uint32(npartitions, 0, "");
 DEFINE_uint64(max_ops, 0, "");
+DEFINE_string(memtable_representations, "skiplist,inline",
+              "Comma separated memtable representations to compare, i.e., skiplist/inline");
 
 NovaConfig *NovaConfig::config;
 NovaGlobalVariables NovaGlobalVariables::global;
@@ -55,31 +57,46 @@ int main(int argc, char *argv[]) {
     }
 
     uint64_t memtable_size = FLAGS_memtable_size_mb * 1024 * 1024;
-    leveldb::PartitionedMemTableBench *memtable = new leveldb::PartitionedMemTableBench(
-            FLAGS_npartitions, memtable_size);
+    std::string representations_flag = FLAGS_memtable_representations;
+    std::vector<std::string> representations = SplitByDelimiter(&representations_flag, ",");
+    for (const auto &representation : representations) {
+        leveldb::MemTableRepresentation rep = leveldb::MemTableRepresentation::kMemTableSkipList;
+        if (representation == "inline") {
+            rep = leveldb::MemTableRepresentation::kMemTableInlineSkipList;
+        } else {
+            NOVA_ASSERT(representation == "skiplist") << representation;
+        }
+        leveldb::PartitionedMemTableBench *memtable = new leveldb::PartitionedMemTableBench(
+                FLAGS_npartitions, memtable_size, rep);
 
-    std::vector<std::thread> worker_threads;
-    std::vector<leveldb::MemTableWorker *> workers;
+        std::vector<std::thread> worker_threads;
+        std::vector<leveldb::MemTableWorker *> workers;
 
-    for (int i = 0; i < FLAGS_num_workers; i++) {
-        leveldb::MemTableWorker *worker = new leveldb::MemTableWorker(i,
-                                                                      memtable,
-                                                                      FLAGS_max_ops,
-                                                                      FLAGS_nkeys,
-                                                                      FLAGS_value_size,
-                                                                      memtable_size);
-        workers.push_back(worker);
-        worker_threads.emplace_back(&leveldb::MemTableWorker::Start, worker);
-    }
+        for (int i = 0; i < FLAGS_num_workers; i++) {
+            leveldb::MemTableWorker *worker = new leveldb::MemTableWorker(i,
+                                                                          memtable,
+                                                                          FLAGS_max_ops,
+                                                                          FLAGS_nkeys,
+                                                                          FLAGS_value_size,
+                                                                          memtable_size);
+            workers.push_back(worker);
+            worker_threads.emplace_back(&leveldb::MemTableWorker::Start, worker);
+        }
 
-    for (int i = 0; i < FLAGS_num_workers; i++) {
-        worker_threads[i].join();
-    }
-    double thpt = 0;
-    for (int i = 0; i < FLAGS_num_workers; i++) {
-        thpt += workers[i]->throughput_;
-    }
+        for (int i = 0; i < FLAGS_num_workers; i++) {
+            worker_threads[i].join();
+        }
+        double thpt = 0;
+        double read_thpt = 0;
+        uint64_t read_hits = 0;
+        for (int i = 0; i < FLAGS_num_workers; i++) {
+            thpt += workers[i]->throughput_;
+            read_thpt += workers[i]->read_throughput_;
+            read_hits += workers[i]->read_hits_;
+        }
 
-    NOVA_LOG(INFO) << fmt::format("throughput,{}", thpt);
+        NOVA_LOG(INFO) << fmt::format("throughput,{},put,{},get,{},get-hits,{}", representation, thpt, read_thpt,
+                                      read_hits);
+    }
     return 0;
 }
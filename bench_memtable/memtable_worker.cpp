@@ -7,6 +7,10 @@
 #include "memtable_worker.h"
 
 namespace {
+    int64_t time_diff(timeval t1, timeval t2) {
+        return (t2.tv_sec - t1.tv_sec) * 1000000 + (t2.tv_usec - t1.tv_usec);
+    }
+
     class YCSBKeyComparator : public leveldb::Comparator {
     public:
         //   if a < b: negative result
@@ -40,24 +44,31 @@ namespace {
 
 namespace leveldb {
     PartitionedMemTableBench::PartitionedMemTableBench(uint32_t partition,
-                                                       uint64_t memtable_size)
-            : memtable_size_(memtable_size) {
+                                                       uint64_t memtable_size,
+                                                       MemTableRepresentation representation)
+            : memtable_size_(memtable_size), representation_(representation) {
         for (int i = 0; i < partition; i++) {
             auto cmp = new YCSBKeyComparator();
             leveldb::InternalKeyComparator *comp = new leveldb::InternalKeyComparator(
                     cmp);
-            MemTable *table = new MemTable(*comp, 0, nullptr, true);
+            MemTable *table = new MemTable(*comp, 0, nullptr, true, representation_);
             table->Ref();
             active_memtables_.push_back(table);
             mutexs_.push_back(new std::mutex);
         }
     }
 
+    uint32_t PartitionedMemTableBench::PartitionId(const leveldb::Slice &key) {
+        uint64_t id = 0;
+        nova::str_to_int(key.data(), &id, key.size());
+        return id % active_memtables_.size();
+    }
+
     void PartitionedMemTableBench::Add(leveldb::SequenceNumber seq,
                                        leveldb::ValueType type,
                                        const leveldb::Slice &key,
                                        const leveldb::Slice &value) {
-        uint32_t partition_id = seq % active_memtables_.size();
+        uint32_t partition_id = PartitionId(key);
         mutexs_[partition_id]->lock();
         MemTable *table = active_memtables_[partition_id];
         if (table->ApproximateMemoryUsage() > memtable_size_) {
@@ -65,7 +76,7 @@ namespace leveldb {
             auto cmp = new YCSBKeyComparator();
             leveldb::InternalKeyComparator *comp = new leveldb::InternalKeyComparator(
                     cmp);
-            table = new MemTable(*comp, 0, nullptr, true);
+            table = new MemTable(*comp, 0, nullptr, true, representation_);
             table->Ref();
             active_memtables_[partition_id] = table;
         }
@@ -73,6 +84,24 @@ namespace leveldb {
         mutexs_[partition_id]->unlock();
     }
 
+    bool PartitionedMemTableBench::Get(const leveldb::Slice &key,
+                                       std::string *value) {
+        uint32_t partition_id = PartitionId(key);
+        mutexs_[partition_id]->lock();
+        MemTable *table = active_memtables_[partition_id];
+        table->Ref();
+        mutexs_[partition_id]->unlock();
+        LookupKey lkey(key, kMaxSequenceNumber);
+        Status s;
+        bool found = table->Get(lkey, value, &s);
+        mutexs_[partition_id]->lock();
+        if (table->Unref() == 0) {
+            delete table;
+        }
+        mutexs_[partition_id]->unlock();
+        return found;
+    }
+
     MemTableWorker::MemTableWorker(uint32_t thread_id,
                                    MemTableBenchWrapper *mem_table,
                                    uint64_t max_ops, uint32_t nkeys,
@@ -88,13 +117,13 @@ namespace leveldb {
         }
         uint32_t id = 0;
         char key_buf[1024];
+        unsigned int rand_seed = thread_id_;
 
         struct ::timeval start_timeval;
         ::gettimeofday(&start_timeval, nullptr);
-        int64_t start_unix_time = start_timeval.tv_sec;
 
         for (uint32_t i = 0; i < max_ops_; i++) {
-            id = rand() % nkeys_;
+            id = rand_r(&rand_seed) % nkeys_;
             uint32_t key_size = nova::int_to_str(key_buf, id);
 
             Slice key(key_buf, key_size);
@@ -106,7 +135,18 @@ namespace leveldb {
 
         struct ::timeval end_timeval;
         ::gettimeofday(&end_timeval, nullptr);
-        int64_t end_unix_time = end_timeval.tv_sec;
-        throughput_ = max_ops_ / (end_unix_time - start_unix_time);
+        throughput_ = max_ops_ * 1000000.0 / std::max((int64_t) 1, time_diff(start_timeval, end_timeval));
+
+        std::string result;
+        ::gettimeofday(&start_timeval, nullptr);
+        for (uint32_t i = 0; i < max_ops_; i++) {
+            id = rand_r(&rand_seed) % nkeys_;
+            uint32_t key_size = nova::int_to_str(key_buf, id);
+            if (memtable_->Get(Slice(key_buf, key_size), &result)) {
+                read_hits_++;
+            }
+        }
+        ::gettimeofday(&end_timeval, nullptr);
+        read_throughput_ = max_ops_ * 1000000.0 / std::max((int64_t) 1, time_diff(start_timeval, end_timeval));
     }
-}
\ No newline at end of file
+}
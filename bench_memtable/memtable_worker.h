@@ -1,4 +1,3 @@
-
 //
 // Created by Haoyu Huang on 2/29/20.
 // Copyright (c) 2020 University of Southern California. All rights reserved.
@@ -18,19 +17,27 @@ namespace leveldb {
     public:
         virtual void Add(SequenceNumber seq, ValueType type, const Slice &key,
                          const Slice &value) = 0;
+
+        virtual bool Get(const Slice &key, std::string *value) = 0;
     };
 
     class PartitionedMemTableBench : public MemTableBenchWrapper {
     public:
-        PartitionedMemTableBench(uint32_t partition, uint64_t memtable_size);
+        PartitionedMemTableBench(uint32_t partition, uint64_t memtable_size,
+                                 MemTableRepresentation representation);
 
         void Add(SequenceNumber seq, ValueType type, const Slice &key,
                  const Slice &value) override;
 
+        bool Get(const Slice &key, std::string *value) override;
+
     private:
+        uint32_t PartitionId(const Slice &key);
+
         std::vector<leveldb::MemTable *> active_memtables_;
         std::vector<std::mutex*> mutexs_;
         uint64_t memtable_size_;
+        MemTableRepresentation representation_;
     };
 
     class MemTableWorker {
@@ -39,9 +46,12 @@ namespace leveldb {
                        uint64_t max_ops, uint32_t nkeys,
                        uint32_t value_size, uint64_t memtable_size);
 
+        // Write max_ops keys and then read max_ops keys.
         void Start();
 
         double throughput_ = 0;
+        double read_throughput_ = 0;
+        uint64_t read_hits_ = 0;
 
     private:
         MemTableBenchWrapper *memtable_;
@@ -0,0 +1,106 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include <gflags/gflags.h>
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "common/nova_common.h"
+#include "leveldb/env.h"
+#include "leveldb/filter_policy.h"
+#include "util/coding.h"
+
+DEFINE_int32(num_filters, 64, "Number of filters probed per lookup.");
+DEFINE_int32(keys_per_filter, 50000, "Number of keys per filter.");
+DEFINE_int32(num_lookups, 100000, "Number of lookups.");
+DEFINE_int32(bits_per_key, 10, "Bits per key of the filters.");
+
+nova::NovaGlobalVariables nova::NovaGlobalVariables::global;
+
+namespace {
+    leveldb::Slice Key(int i, char *buffer) {
+        leveldb::EncodeFixed32(buffer, i);
+        return leveldb::Slice(buffer, sizeof(uint32_t));
+    }
+
+    // Filter i contains keys [i * keys_per_filter, (i + 1) * keys_per_filter).
+    void BuildFilters(const leveldb::FilterPolicy *policy,
+                      std::vector<std::string> *filters) {
+        char buffer[sizeof(int)];
+        for (int i = 0; i < FLAGS_num_filters; i++) {
+            std::vector<std::string> keys;
+            for (int j = 0; j < FLAGS_keys_per_filter; j++) {
+                keys.push_back(
+                        Key(i * FLAGS_keys_per_filter + j, buffer).ToString());
+            }
+            std::vector<leveldb::Slice> key_slices(keys.begin(), keys.end());
+            filters->emplace_back();
+            policy->CreateFilter(&key_slices[0], FLAGS_keys_per_filter,
+                                 &filters->back());
+        }
+    }
+
+    // Reports the false positive rate and the CPU cost per probe of a
+    // policy. The filters resemble the filters of many L0 SSTables and do not
+    // fit in the CPU caches. Every probe is a negative lookup, the common case
+    // of a GET that checks all L0 SSTables.
+    void BenchmarkPolicy(const char *name,
+                         const leveldb::FilterPolicy *policy) {
+        leveldb::Env *env = leveldb::Env::Default();
+        std::vector<std::string> filters;
+        BuildFilters(policy, &filters);
+        std::vector<leveldb::Slice> filter_slices(filters.begin(),
+                                                  filters.end());
+        const int first_absent_key =
+                FLAGS_num_filters * FLAGS_keys_per_filter;
+        char buffer[sizeof(int)];
+        std::unique_ptr<bool[]> results(new bool[FLAGS_num_filters]);
+
+        uint64_t false_positives = 0;
+        uint64_t start = env->NowMicros();
+        for (int k = 0; k < FLAGS_num_lookups; k++) {
+            leveldb::Slice key = Key(first_absent_key + k, buffer);
+            for (int i = 0; i < FLAGS_num_filters; i++) {
+                false_positives += policy->KeyMayMatch(key, filter_slices[i]);
+            }
+        }
+        uint64_t single_micros = env->NowMicros() - start;
+
+        uint64_t batch_false_positives = 0;
+        start = env->NowMicros();
+        for (int k = 0; k < FLAGS_num_lookups; k++) {
+            leveldb::Slice key = Key(first_absent_key + k, buffer);
+            policy->KeyMayMatchBatch(key, &filter_slices[0],
+                                     FLAGS_num_filters, results.get());
+            for (int i = 0; i < FLAGS_num_filters; i++) {
+                batch_false_positives += results[i];
+            }
+        }
+        uint64_t batch_micros = env->NowMicros() - start;
+        NOVA_ASSERT(false_positives == batch_false_positives)
+            << false_positives << ":" << batch_false_positives;
+
+        const double probes =
+                static_cast<double>(FLAGS_num_lookups) * FLAGS_num_filters;
+        printf("%-14s FPR %5.2f%% ; %6.1f ns/probe ; %6.1f ns/probe batched\n",
+               name, false_positives * 100.0 / probes,
+               single_micros * 1000.0 / probes,
+               batch_micros * 1000.0 / probes);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    gflags::ParseCommandLineFlags(&argc, &argv, true);
+    const leveldb::FilterPolicy *bloom = leveldb::NewBloomFilterPolicy(
+            FLAGS_bits_per_key);
+    BenchmarkPolicy("bloom", bloom);
+    delete bloom;
+    const leveldb::FilterPolicy *blocked =
+            leveldb::NewBlockedBloomFilterPolicy(FLAGS_bits_per_key);
+    BenchmarkPolicy("blocked_bloom", blocked);
+    delete blocked;
+    return 0;
+}
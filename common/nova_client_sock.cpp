@@ -34,11 +34,41 @@ namespace nova {
         }
     }
 
+    uint32_t EncodeBinaryMsgHeader(char *buf, const BinaryMsgHeader &header) {
+        buf[0] = NOVA_BINARY_MSG_MAGIC;
+        buf[1] = header.type;
+        leveldb::EncodeFixed32(buf + 2, header.req_id);
+        leveldb::EncodeFixed32(buf + 6, header.cfg_id);
+        leveldb::EncodeFixed32(buf + 10, header.body_size);
+        return NOVA_BINARY_MSG_HEADER_SIZE;
+    }
+
+    bool DecodeBinaryMsgHeader(const char *buf, uint32_t size,
+                               BinaryMsgHeader *header) {
+        if (size < NOVA_BINARY_MSG_HEADER_SIZE ||
+            buf[0] != NOVA_BINARY_MSG_MAGIC) {
+            return false;
+        }
+        header->type = buf[1];
+        header->req_id = leveldb::DecodeFixed32(buf + 2);
+        header->cfg_id = leveldb::DecodeFixed32(buf + 6);
+        header->body_size = leveldb::DecodeFixed32(buf + 10);
+        return true;
+    }
+
     NovaClientSock::NovaClientSock() {
         send_buf_ = new char[NovaConfig::config->max_msg_size];
         recv_buf_ = new char[NovaConfig::config->max_msg_size];
     }
 
+    NovaClientSock::~NovaClientSock() {
+        if (sockfd_ > 0) {
+            close(sockfd_);
+        }
+        delete[] send_buf_;
+        delete[] recv_buf_;
+    }
+
     void NovaClientSock::Connect(const Host &host) {
         while (true) {
             struct sockaddr_in serv_addr;
@@ -62,6 +92,30 @@ namespace nova {
                         << host.ip << ":" << host.port;
     }
 
+    bool NovaClientSock::ConnectNonBlocking(const Host &host) {
+        struct sockaddr_in serv_addr;
+        sockfd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        NOVA_ASSERT(sockfd_ >= 0) << "socket creation error";
+        memset(&serv_addr, 0, sizeof(serv_addr));
+        serv_addr.sin_family = AF_INET;
+        serv_addr.sin_port = htons(host.port);
+
+        auto ip = host_to_ip(host.ip);
+        NOVA_ASSERT(ip != "");
+        serv_addr.sin_addr.s_addr = inet_addr(ip.c_str());
+        if (connect(sockfd_, (struct sockaddr *) &serv_addr,
+                    sizeof(serv_addr)) == 0 || errno == EINPROGRESS) {
+            return true;
+        }
+        NOVA_LOG(rdmaio::WARNING) << "Socket " << sockfd_
+                                  << " failed to connect to host " << host.ip
+                                  << ":" << host.port << " "
+                                  << strerror(errno);
+        close(sockfd_);
+        sockfd_ = 0;
+        return false;
+    }
+
     void NovaClientSock::Send(char *send_buf, int size) {
         if (send_buf == nullptr) {
             send_buf = send_buf_;
@@ -106,4 +160,127 @@ namespace nova {
         return size;
     }
 
+    uint32_t
+    NovaClientSock::EncodeBinaryGet(uint32_t req_id, uint32_t cfg_id,
+                                    const leveldb::Slice &key) {
+        char *body = send_buf_ + NOVA_BINARY_MSG_HEADER_SIZE;
+        char *ptr = leveldb::EncodeVarint32(body, key.size());
+        memcpy(ptr, key.data(), key.size());
+        ptr += key.size();
+
+        BinaryMsgHeader header;
+        header.type = RequestType::GET;
+        header.req_id = req_id;
+        header.cfg_id = cfg_id;
+        header.body_size = ptr - body;
+        EncodeBinaryMsgHeader(send_buf_, header);
+        return NOVA_BINARY_MSG_HEADER_SIZE + header.body_size;
+    }
+
+    uint32_t
+    NovaClientSock::EncodeBinaryPut(uint32_t req_id, uint32_t cfg_id,
+                                    const leveldb::Slice &key,
+                                    const leveldb::Slice &value) {
+        char *body = send_buf_ + NOVA_BINARY_MSG_HEADER_SIZE;
+        char *ptr = leveldb::EncodeVarint32(body, key.size());
+        memcpy(ptr, key.data(), key.size());
+        ptr += key.size();
+        ptr = leveldb::EncodeVarint32(ptr, value.size());
+        memcpy(ptr, value.data(), value.size());
+        ptr += value.size();
+
+        BinaryMsgHeader header;
+        header.type = RequestType::PUT;
+        header.req_id = req_id;
+        header.cfg_id = cfg_id;
+        header.body_size = ptr - body;
+        EncodeBinaryMsgHeader(send_buf_, header);
+        return NOVA_BINARY_MSG_HEADER_SIZE + header.body_size;
+    }
+
+    uint32_t
+    NovaClientSock::EncodeBinaryMultiPut(uint32_t req_id, uint32_t cfg_id,
+                                         const std::vector<leveldb::Slice> &keys,
+                                         const std::vector<leveldb::Slice> &values) {
+        NOVA_ASSERT(keys.size() == values.size());
+        char *body = send_buf_ + NOVA_BINARY_MSG_HEADER_SIZE;
+        char *ptr = leveldb::EncodeVarint32(body, keys.size());
+        for (int i = 0; i < keys.size(); i++) {
+            ptr = leveldb::EncodeVarint32(ptr, keys[i].size());
+            memcpy(ptr, keys[i].data(), keys[i].size());
+            ptr += keys[i].size();
+            ptr = leveldb::EncodeVarint32(ptr, values[i].size());
+            memcpy(ptr, values[i].data(), values[i].size());
+            ptr += values[i].size();
+        }
+
+        BinaryMsgHeader header;
+        header.type = RequestType::MULTI_PUT;
+        header.req_id = req_id;
+        header.cfg_id = cfg_id;
+        header.body_size = ptr - body;
+        EncodeBinaryMsgHeader(send_buf_, header);
+        return NOVA_BINARY_MSG_HEADER_SIZE + header.body_size;
+    }
+
+    uint32_t
+    NovaClientSock::EncodeBinaryMultiGet(uint32_t req_id, uint32_t cfg_id,
+                                         const std::vector<leveldb::Slice> &keys) {
+        char *body = send_buf_ + NOVA_BINARY_MSG_HEADER_SIZE;
+        char *ptr = leveldb::EncodeVarint32(body, keys.size());
+        for (const auto &key : keys) {
+            ptr = leveldb::EncodeVarint32(ptr, key.size());
+            memcpy(ptr, key.data(), key.size());
+            ptr += key.size();
+        }
+
+        BinaryMsgHeader header;
+        header.type = RequestType::MULTI_GET;
+        header.req_id = req_id;
+        header.cfg_id = cfg_id;
+        header.body_size = ptr - body;
+        EncodeBinaryMsgHeader(send_buf_, header);
+        return NOVA_BINARY_MSG_HEADER_SIZE + header.body_size;
+    }
+
+    uint32_t
+    NovaClientSock::EncodeBinaryScan(uint32_t req_id, uint32_t cfg_id,
+                                     const leveldb::Slice &key,
+                                     uint32_t nrecords, uint64_t end) {
+        char *body = send_buf_ + NOVA_BINARY_MSG_HEADER_SIZE;
+        char *ptr = leveldb::EncodeVarint32(body, key.size());
+        memcpy(ptr, key.data(), key.size());
+        ptr += key.size();
+        ptr = leveldb::EncodeVarint32(ptr, nrecords);
+        if (end != 0) {
+            ptr = leveldb::EncodeVarint64(ptr, end);
+        }
+
+        BinaryMsgHeader header;
+        header.type = RequestType::REQ_SCAN;
+        header.req_id = req_id;
+        header.cfg_id = cfg_id;
+        header.body_size = ptr - body;
+        EncodeBinaryMsgHeader(send_buf_, header);
+        return NOVA_BINARY_MSG_HEADER_SIZE + header.body_size;
+    }
+
+    void NovaClientSock::ReceiveBinary(BinaryMsgHeader *header) {
+        uint32_t count = 0;
+        uint32_t size = NOVA_BINARY_MSG_HEADER_SIZE;
+        bool decoded = false;
+        while (count < size) {
+            int cnt = read(sockfd_, recv_buf_ + count, size - count);
+            if (cnt > 0) {
+                count += cnt;
+            }
+            if (!decoded && count >= NOVA_BINARY_MSG_HEADER_SIZE) {
+                NOVA_ASSERT(DecodeBinaryMsgHeader(recv_buf_, count, header));
+                size += header->body_size;
+                NOVA_ASSERT(size < NovaConfig::config->max_msg_size);
+                decoded = true;
+            }
+        }
+    }
+
 }
\ No newline at end of file
@@ -9,22 +9,123 @@
 
 
 #include "nova_common.h"
+#include "leveldb/slice.h"
 
 namespace nova {
+    // Binary client protocol. A binary message starts with
+    // NOVA_BINARY_MSG_MAGIC, which is not a valid ASCII request type, so the
+    // server serves both protocols on the same port. Once a connection
+    // sends a binary message, it may pipeline requests without waiting for
+    // their responses. A client matches a response to its request using
+    // the request id.
+    //
+    // Header: magic (1 byte), request/response type (1 byte),
+    // request id (fixed32), cfg id (fixed32), body size (fixed32).
+    //
+    // Request bodies:
+    // GET: varint32 key size, key.
+    // PUT: varint32 key size, key, varint32 value size, value.
+    // SCAN: varint32 key size, key, varint32 number of records, and an
+    // optional varint64 end. An LTC sets the end when it forwards a part of
+    // a scan to the LTC that owns the following fragments. The part only
+    // scans the consecutive local fragments before the end.
+    // MULTI_PUT: varint32 number of records, followed by the records. Each
+    // record is varint32 key size, key, varint32 value size, value.
+    // MULTI_GET: varint32 number of keys, followed by the keys. Each key is
+    // varint32 key size, key.
+    //
+    // Response bodies:
+    // GET: varint32 value size, value.
+    // PUT/MULTI_PUT: empty.
+    // SCAN: a sequence of records until the end of the body. Each record
+    // is varint32 key size, key, varint32 value size, value.
+    // MULTI_GET: one slot per key in the request order. Each slot is the
+    // key status (1 byte), varint32 value size, value.
+    // A response with BINARY_CFG_MISMATCH has an empty body and carries the
+    // server's cfg id. A SCAN response with BINARY_SCAN_TRUNCATED carries
+    // an ordered prefix of the records. The scan stopped early because
+    // another LTC did not serve its part in time. A forwarded part is
+    // truncated and empty if its first fragment is no longer local.
+#define NOVA_BINARY_MSG_MAGIC ((char) 0xFE)
+#define NOVA_BINARY_MSG_HEADER_SIZE 14
+
+    enum BinaryResponseType : char {
+        BINARY_OK = 'o',
+        BINARY_CFG_MISMATCH = 'c',
+        BINARY_SCAN_TRUNCATED = 't'
+    };
+
+    enum BinaryKeyStatus : char {
+        BINARY_KEY_FOUND = 'f',
+        BINARY_KEY_NOT_FOUND = 'n',
+        BINARY_KEY_ERROR = 'e'
+    };
+
+    struct BinaryMsgHeader {
+        char type = 0;
+        uint32_t req_id = 0;
+        uint32_t cfg_id = 0;
+        uint32_t body_size = 0;
+    };
+
+    uint32_t EncodeBinaryMsgHeader(char *buf, const BinaryMsgHeader &header);
+
+    // Returns false if "buf" does not start with a complete binary message
+    // header.
+    bool DecodeBinaryMsgHeader(const char *buf, uint32_t size,
+                               BinaryMsgHeader *header);
+
     class NovaClientSock {
     public:
         NovaClientSock();
 
+        ~NovaClientSock();
+
         void Connect(const Host &host);
 
+        // Starts connecting a non-blocking socket to "host" and returns
+        // without waiting. Returns false if the connect failed right away.
+        // The socket becomes writable once the connect completes. SO_ERROR
+        // then tells whether it succeeded.
+        bool ConnectNonBlocking(const Host &host);
+
         void Send(char *send, int size);
 
         int Receive();
 
+        // Encode a binary request into send_buf(). Return its size.
+        uint32_t
+        EncodeBinaryGet(uint32_t req_id, uint32_t cfg_id,
+                        const leveldb::Slice &key);
+
+        uint32_t
+        EncodeBinaryPut(uint32_t req_id, uint32_t cfg_id,
+                        const leveldb::Slice &key, const leveldb::Slice &value);
+
+        uint32_t
+        EncodeBinaryMultiPut(uint32_t req_id, uint32_t cfg_id,
+                             const std::vector<leveldb::Slice> &keys,
+                             const std::vector<leveldb::Slice> &values);
+
+        uint32_t
+        EncodeBinaryMultiGet(uint32_t req_id, uint32_t cfg_id,
+                             const std::vector<leveldb::Slice> &keys);
+
+        uint32_t
+        EncodeBinaryScan(uint32_t req_id, uint32_t cfg_id,
+                         const leveldb::Slice &key, uint32_t nrecords,
+                         uint64_t end = 0);
+
+        // Receive one binary response into recv_buf(). Its body starts at
+        // recv_buf() + NOVA_BINARY_MSG_HEADER_SIZE.
+        void ReceiveBinary(BinaryMsgHeader *header);
+
         char *send_buf() { return send_buf_; }
 
         char *recv_buf() { return recv_buf_; }
 
+        int sockfd() const { return sockfd_; }
+
     private:
         int sockfd_ = 0;
         char *send_buf_;
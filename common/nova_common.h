@@ -49,6 +49,8 @@ namespace nova {
             written_memtable_sizes = 0;
             total_disk_writes = 0;
             total_disk_reads = 0;
+            stoc_table_cache_lookups = 0;
+            stoc_table_cache_hits = 0;
             is_ready_to_process_requests = false;
         }
 
@@ -56,6 +58,8 @@ namespace nova {
         std::atomic_int_fast64_t stoc_pending_disk_writes;
         std::atomic_int_fast64_t stoc_pending_disk_reads;
         std::atomic_int_fast64_t stoc_queue_depth;
+        std::atomic_int_fast64_t stoc_table_cache_lookups;
+        std::atomic_int_fast64_t stoc_table_cache_hits;
 
         std::atomic_int_fast64_t generated_memtable_sizes;
         std::atomic_int_fast64_t written_memtable_sizes;
@@ -125,6 +129,8 @@ namespace nova {
         uint32_t response_size;
 //        char *request_buf;
         char *response_buf = nullptr; // A pointer points to the response buffer.
+        // Set if the connection uses the pipelined binary protocol.
+        void *pipeline = nullptr;
         ConnState state;
         void *worker;
         struct event event;
@@ -164,6 +170,8 @@ namespace nova {
         STATS = 's',
         CHANGE_CONFIG = 'b',
         QUERY_CONFIG_CHANGE = 'R',
+        MULTI_PUT = 'P',
+        MULTI_GET = 'M',
     };
 
     static RequestType char_to_req_type(char c) {
@@ -647,6 +655,24 @@ namespace nova {
         return size;
     }
 
+    // The last byte of a log record marks its completion and encodes its
+    // value type. kLogRecordBatchContinues is set if the next record belongs
+    // to the same write batch.
+    static const uint8_t kLogRecordBatchContinues = 0x40;
+
+    inline char LogRecordMarker(const leveldb::LevelDBLogRecord &record) {
+        uint8_t marker;
+        if (record.type == leveldb::kTypeValue) {
+            marker = 1;
+        } else {
+            marker = 0x80 | record.type;
+        }
+        if (record.batch_continues) {
+            marker |= kLogRecordBatchContinues;
+        }
+        return static_cast<char>(marker);
+    }
+
     inline uint32_t
     EncodeLogRecord(char *buf,
                     const leveldb::LevelDBLogRecord &record) {
@@ -656,8 +682,9 @@ namespace nova {
         size += leveldb::EncodeSlice(buf + size, record.key);
         size += leveldb::EncodeSlice(buf + size, record.value);
         size += leveldb::EncodeFixed64(buf + size, record.sequence_number);
-        // The last byte is 1.
-        buf[size] = 1;
+        // The last byte is non-zero. It is 1 for a put so that logs written
+        // before deletions existed remain readable.
+        buf[size] = LogRecordMarker(record);
         size++;
         return size;
     }
@@ -677,7 +704,19 @@ namespace nova {
         if (!leveldb::DecodeFixed64(buf, &log_record->sequence_number)) {
             return false;
         }
-        if ((*buf)[0] != 1) {
+        if (buf->empty()) {
+            return false;
+        }
+        uint8_t marker = static_cast<uint8_t>((*buf)[0]);
+        log_record->batch_continues =
+                (marker & kLogRecordBatchContinues) != 0;
+        marker &= ~kLogRecordBatchContinues;
+        if (marker == 1) {
+            log_record->type = leveldb::kTypeValue;
+        } else if (marker == (0x80 | leveldb::kTypeDeletion) ||
+                   marker == (0x80 | leveldb::kTypeRangeDeletion)) {
+            log_record->type = static_cast<leveldb::ValueType>(marker & 0x7f);
+        } else {
             return false;
         }
         if (record_size != LogRecordSize(*log_record)) {
@@ -686,5 +725,24 @@ namespace nova {
         *buf = leveldb::Slice(buf->data() + 1, buf->size() - 1);
         return true;
     }
+
+    // Decode the records of the next write batch into "batch". Returns false
+    // and decodes nothing if the log ends before the last record of the
+    // batch.
+    inline bool DecodeLogRecordBatch(leveldb::Slice *buf,
+                                     std::vector<leveldb::LevelDBLogRecord> *batch) {
+        batch->clear();
+        leveldb::Slice input = *buf;
+        leveldb::LevelDBLogRecord record = {};
+        while (DecodeLogRecord(&input, &record)) {
+            batch->push_back(record);
+            if (!record.batch_continues) {
+                *buf = input;
+                return true;
+            }
+        }
+        batch->clear();
+        return false;
+    }
 }
 #endif //NOVA_COMMON_H
@@ -183,6 +183,9 @@ namespace nova {
         uint64_t sstable_size = 0;
         uint64_t manifest_file_size = 0;
         std::string stoc_files_path;
+        uint32_t stoc_io_queue_depth = 0;
+        uint64_t stoc_table_cache_mb = 0;
+        bool enable_stoc_direct_io = false;
 
         bool use_local_disk = false;
         bool enable_subrange = false;
@@ -206,6 +209,7 @@ namespace nova {
         uint32_t number_of_sstable_data_replicas = 0;
         uint32_t number_of_manifest_replicas = 0;
         bool use_parity_for_sstable_data_blocks = false;
+        uint32_t number_of_parity_fragments = 0;
 
         double subrange_sampling_ratio = 0;
         std::string zipfian_dist_file_path;
@@ -223,8 +227,24 @@ namespace nova {
         int level = 0;
 
         int block_cache_mb = 0;
+        std::string block_cache_type;
+        uint64_t stoc_block_cache_mb = 0;
+        std::string filter_policy;
+        bool partition_index_and_filters = false;
+        uint32_t metadata_partition_size = 4096;
+        bool pin_l0_metadata_partitions = false;
+        bool data_block_hash_index = false;
+        uint32_t readahead_max_blocks = 0;
+        uint32_t compaction_readahead_blocks = 0;
+        uint32_t log_group_commit_max_bytes = 0;
+        uint64_t log_group_commit_max_delay_us = 0;
+        std::string compression_per_level;
+        int zstd_compression_level = 3;
+        std::string zstd_dictionary_path;
         bool enable_lookup_index = false;
         bool enable_range_index = false;
+        bool enable_parallel_l0_probe = false;
+        bool enable_memtable_hash_index = false;
         uint32_t num_memtables = 0;
         uint32_t num_memtable_partitions = 0;
         uint64_t memtable_size_mb = 0;
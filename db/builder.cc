@@ -101,7 +101,8 @@ namespace leveldb {
                     bg_thread->rand_seed(),
                     filename);
             WritableFile *file = new MemWritableFile(stoc_writable_file);
-            TableBuilder *builder = new TableBuilder(options, file);
+            // Memtables are flushed to level 0.
+            TableBuilder *builder = new TableBuilder(options, file, 0);
 
             Slice user_key;
             bool insert = true;
@@ -154,9 +155,9 @@ namespace leveldb {
             uint32_t new_file_size = stoc_writable_file->Finalize();
 
             meta->block_replica_handles = stoc_writable_file->replicas();
-            meta->parity_block_handle = stoc_writable_file->parity_block_handle();
+            meta->parity_block_handles = stoc_writable_file->parity_block_handles();
             meta->converted_file_size = new_file_size;
-            stoc_writable_file->Validate(meta->block_replica_handles, meta->parity_block_handle);
+            stoc_writable_file->Validate(meta->block_replica_handles, meta->parity_block_handles);
 
             delete stoc_writable_file;
             stoc_writable_file = nullptr;
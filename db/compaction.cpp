@@ -6,6 +6,7 @@
 
 #include "compaction.h"
 #include "filename.h"
+#include "range_tombstone.h"
 
 namespace leveldb {
     void
@@ -243,7 +244,12 @@ namespace leveldb {
                 bg_thread_->rand_seed(),
                 filename);
         compact->outfile = new MemWritableFile(stoc_writable_file);
-        compact->builder = new TableBuilder(options_, compact->outfile);
+        int output_level = -1;
+        if (compact->compaction) {
+            output_level = compact->compaction->target_level();
+        }
+        compact->builder = new TableBuilder(options_, compact->outfile,
+                                            output_level);
         return Status::OK();
     }
 
@@ -296,8 +302,8 @@ namespace leveldb {
             FileMetaData *output = compact->current_output();
             output->converted_file_size = mem_file->Finalize();
             output->block_replica_handles = mem_file->replicas();
-            output->parity_block_handle = mem_file->parity_block_handle();
-            mem_file->Validate(output->block_replica_handles, output->parity_block_handle);
+            output->parity_block_handles = mem_file->parity_block_handles();
+            mem_file->Validate(output->block_replica_handles, output->parity_block_handles);
             delete mem_file;
             mem_file = nullptr;
             delete compact->outfile;
@@ -346,6 +352,8 @@ namespace leveldb {
         SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
         std::vector<std::string> keys;
         uint64_t memtable_size = 0;
+        FragmentedRangeTombstones range_tombstones(user_comparator_,
+                                                   compact->range_tombstones);
         while (input->Valid()) {
             Slice key = input->key();
             NOVA_ASSERT(ParseInternalKey(key, &ikey));
@@ -362,22 +370,49 @@ namespace leveldb {
 
             // Handle key/value, add to state, etc.
             bool drop = false;
-            if (!has_current_user_key ||
-                user_comparator_->Compare(ikey.user_key,
-                                          Slice(current_user_key)) !=
-                0) {
-                // First occurrence of this user key
-                current_user_key.assign(ikey.user_key.data(),
-                                        ikey.user_key.size());
-                has_current_user_key = true;
-                last_sequence_for_key = kMaxSequenceNumber;
-            }
+            if (ikey.type == kTypeRangeDeletion) {
+                // A range tombstone does not hide the entries of its start
+                // key. It is kept until it is obsolete.
+                for (const auto &tombstone : compact->obsolete_range_tombstones) {
+                    if (tombstone.sequence == ikey.sequence) {
+                        drop = true;
+                        break;
+                    }
+                }
+            } else {
+                if (!has_current_user_key ||
+                    user_comparator_->Compare(ikey.user_key,
+                                              Slice(current_user_key)) !=
+                    0) {
+                    // First occurrence of this user key
+                    current_user_key.assign(ikey.user_key.data(),
+                                            ikey.user_key.size());
+                    has_current_user_key = true;
+                    last_sequence_for_key = kMaxSequenceNumber;
+                }
 
-            if (last_sequence_for_key <= compact->smallest_snapshot) {
-                // Hidden by an newer entry for same user key
-                drop = true;  // (A)
+                if (last_sequence_for_key <= compact->smallest_snapshot) {
+                    // Hidden by an newer entry for same user key
+                    drop = true;  // (A)
+                } else if (range_tombstones.IsDeleted(
+                        ikey.user_key, ikey.sequence,
+                        compact->smallest_snapshot)) {
+                    // Deleted by a range tombstone.
+                    drop = true;
+                } else if (ikey.type == kTypeDeletion &&
+                           ikey.sequence <= compact->smallest_snapshot &&
+                           compact->bottommost) {
+                    // For this user key:
+                    // (1) there is no data in higher levels
+                    // (2) data in lower levels will have larger sequence numbers
+                    // (3) data in layers that are being compacted here and have
+                    //     smaller sequence numbers will be dropped in the next
+                    //     few iterations of this loop (by rule (A) above).
+                    // Therefore this deletion marker is obsolete and can be dropped.
+                    drop = true;
+                }
+                last_sequence_for_key = ikey.sequence;
             }
-            last_sequence_for_key = ikey.sequence;
 #if 0
             Log(options_.info_log,
                 "  Compact: %s, seq %d, type: %d %d, drop: %d, is_base: %d, "
@@ -210,6 +210,15 @@ namespace leveldb {
         // we can drop all entries for the same key with sequence numbers < S.
         SequenceNumber smallest_snapshot = 0;
 
+        // No SSTable below the output level overlaps the inputs. A deletion
+        // visible to all snapshots is dropped.
+        bool bottommost = false;
+        // Range tombstones that overlap the inputs. The versions that they
+        // delete are dropped.
+        std::vector<RangeTombstone> range_tombstones;
+        // Range tombstones in the inputs that are dropped.
+        std::vector<RangeTombstone> obsolete_range_tombstones;
+
         std::vector<FileMetaData> outputs;
 
         // State kept for output being generated
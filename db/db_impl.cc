@@ -9,10 +9,12 @@
 
 #include <algorithm>
 #include <atomic>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
 #include <list>
+#include <thread>
 #include <fmt/core.h>
 
 #include "db/builder.h"
@@ -47,6 +49,15 @@ namespace leveldb {
             return (t2.tv_sec - t1.tv_sec) * 1000000 +
                    (t2.tv_usec - t1.tv_usec);
         }
+
+        // The sequence number of the newest versions that "options" reads.
+        SequenceNumber ReadSequence(const ReadOptions &options) {
+            if (options.snapshot != nullptr) {
+                return static_cast<const SnapshotImpl *>(
+                        options.snapshot)->sequence_number();
+            }
+            return kMaxSequenceNumber;
+        }
     }
 
     const int kNumNonTableCacheFiles = 10;
@@ -139,13 +150,19 @@ namespace leveldb {
         start_coordinated_compaction_ = false;
         terminate_coordinated_compaction_ = false;
         start_compaction_ = true;
+        wait_for_first_fast_get_ = false;
+        time_to_first_fast_get_ = 0;
         if (options_.enable_lookup_index) {
+            // Start at a fraction of the key range. The index grows with the number of distinct keys written.
             lookup_index_ = new LookupIndex(
-                    options_.upper_key - options_.lower_key);
-            for (int i = 0; i < options_.upper_key - options_.lower_key; i++) {
-                lookup_index_->Insert(Slice(), i, 0);
-            }
+                    (options_.upper_key - options_.lower_key) / 4);
+        }
+        if (options_.log_group_commit_max_bytes > 0) {
+            log_group_commit_ = new LogGroupCommit(
+                    options_.log_group_commit_max_bytes,
+                    options_.log_group_commit_max_delay_us);
         }
+        range_tombstones_ = new RangeTombstones(user_comparator_);
         nova::ParseDBIndexFromDBName(dbname_, &dbid_);
     }
 
@@ -157,6 +174,8 @@ namespace leveldb {
 
         delete versions_;
         delete table_cache_;
+        delete log_group_commit_;
+        delete range_tombstones_;
 
         if (owns_info_log_) {
             delete options_.info_log;
@@ -268,7 +287,7 @@ namespace leveldb {
             auto metadata = it.second;
             edit.AddFile(level, metadata.memtable_ids, metadata.number, metadata.file_size,
                          metadata.converted_file_size, metadata.flush_timestamp, metadata.smallest,
-                         metadata.largest, metadata.block_replica_handles, metadata.parity_block_handle);
+                         metadata.largest, metadata.block_replica_handles, metadata.parity_block_handles);
         }
 
         NOVA_LOG(rdmaio::INFO)
@@ -363,6 +382,7 @@ namespace leveldb {
     DBImpl::RecoverDBMetadata(const Slice &buf, uint32_t version_id, uint64_t last_sequence, uint64_t next_file_number,
                               uint64_t memtable_id_seq, nova::StoCInMemoryLogFileManager *log_manager,
                               std::unordered_map<uint32_t, leveldb::MemTableLogFilePair> *mid_table_map) {
+        gettimeofday(&recovery_start_, nullptr);
         Slice tmp = buf;
         uint32_t size = tmp.size();
         memtable_id_seq_ = memtable_id_seq;
@@ -388,7 +408,13 @@ namespace leveldb {
         NOVA_LOG(rdmaio::INFO) << fmt::format("Decoded {} bytes: db:{}, Log manager", size - tmp.size(), dbid_);
         size = tmp.size();
 
+        timeval decode_start{};
+        gettimeofday(&decode_start, nullptr);
         lookup_index_->Decode(&tmp);
+        timeval decode_end{};
+        gettimeofday(&decode_end, nullptr);
+        index_rebuild_duration_ = time_diff(decode_start, decode_end);
+        index_rebuild_threads_ = 1;
         NOVA_LOG(rdmaio::INFO) << fmt::format("Decoded {} bytes: db:{}, Lookup index", size - tmp.size(), dbid_);
         size = tmp.size();
 
@@ -442,6 +468,7 @@ namespace leveldb {
                 versions_->mid_table_mapping_[mid]->is_immutable_ = true;
             }
         }
+        wait_for_first_fast_get_ = true;
     }
 
     void
@@ -535,11 +562,11 @@ namespace leveldb {
             files_to_delete->push_back(
                     TableFileName(this->dbname_, meta.number, FileInternalType::kFileData, replica_id));
         }
-        // Delete parity file.
-        if (nova::NovaConfig::config->use_parity_for_sstable_data_blocks) {
-            auto handle = meta.parity_block_handle;
+        // Delete parity files.
+        for (int parity_id = 0; parity_id < meta.parity_block_handles.size(); parity_id++) {
+            auto handle = meta.parity_block_handles[parity_id];
             SSTableStoCFilePair pair = {};
-            pair.sstable_name = TableFileName(this->dbname_, meta.number, FileInternalType::kFileParity, 0);
+            pair.sstable_name = TableFileName(this->dbname_, meta.number, FileInternalType::kFileParity, parity_id);
             pair.stoc_file_id = handle.stoc_file_id;
             (*server_pairs)[handle.server_id].push_back(pair);
         }
@@ -573,13 +600,15 @@ namespace leveldb {
             char *buf = log_replicas_[i];
             leveldb::MemTable *memtable = memtables_[i];
             Slice slice(buf, nova::NovaConfig::config->max_stoc_file_size);
-            leveldb::LevelDBLogRecord record;
-            while (nova::DecodeLogRecord(&slice, &record)) {
-                memtable->Add(record.sequence_number,
-                              leveldb::ValueType::kTypeValue, record.key, record.value);
-                recovered_log_records += 1;
-                max_sequence_number = std::max(max_sequence_number,
-                                               record.sequence_number);
+            std::vector<leveldb::LevelDBLogRecord> batch;
+            while (nova::DecodeLogRecordBatch(&slice, &batch)) {
+                for (const auto &record : batch) {
+                    memtable->Add(record.sequence_number, record.type,
+                                  record.key, record.value);
+                    recovered_log_records += 1;
+                    max_sequence_number = std::max(max_sequence_number,
+                                                   record.sequence_number);
+                }
             }
         }
         NOVA_ASSERT(memtables_.size() == log_replicas_.size());
@@ -668,9 +697,11 @@ namespace leveldb {
                         }
                     }
                 }
-                if (meta->parity_block_handle.stoc_file_id != 0) {
-                    std::string filename = TableFileName(dbname_, meta->number, FileInternalType::kFileParity, 0);
-                    stoc_fn_stocfileid[meta->parity_block_handle.server_id][filename] = meta->parity_block_handle.stoc_file_id;
+                for (int parity_id = 0; parity_id < meta->parity_block_handles.size(); parity_id++) {
+                    const auto &parity = meta->parity_block_handles[parity_id];
+                    std::string filename = TableFileName(dbname_, meta->number, FileInternalType::kFileParity,
+                                                         parity_id);
+                    stoc_fn_stocfileid[parity.server_id][filename] = parity.stoc_file_id;
                 }
             }
         }
@@ -708,38 +739,57 @@ namespace leveldb {
             << fmt::format("Recover Start Fetching meta blocks size:{}",
                            meta_files.size());
         FetchMetadataFilesInParallel(meta_files, dbname_, options_, client, env_);
-        // Rebuild lookup index.
-        ReadOptions ro;
-        ro.mem_manager = options_.mem_manager;
-        ro.stoc_client = options_.stoc_client;
-        ro.thread_id = 0;
-        ro.hash = 0;
-        uint32_t memtableid = 0;
-        for (int i = 0; i < files[0].size(); i++) {
-            auto meta = files[0][i];
-            NOVA_LOG(rdmaio::INFO)
-                << fmt::format("Recover L0 data file {} ", meta->DebugString());
-            auto it = table_cache_->NewIterator(
-                    AccessCaller::kCompaction, ro, meta, meta->number,
-                    meta->SelectReplica(), 0, meta->converted_file_size);
-            it->SeekToFirst();
-            while (it->Valid()) {
-                uint64_t hash;
-                Slice user_key = ExtractUserKey(it->key());
-                nova::str_to_int(user_key.data(), &hash, user_key.size());
-                if (lookup_index_) {
-                    lookup_index_->Insert(user_key, hash, memtableid);
-                }
 
-                AtomicMemTable *mem = versions_->mid_table_mapping_[memtableid];
-                mem->l0_file_numbers_.insert(meta->number);
-                mem->is_immutable_ = true;
-                mem->is_flushed_ = true;
-                it->Next();
+        // Load the range tombstones of the SSTables.
+        {
+            ReadOptions ro;
+            ro.mem_manager = options_.mem_manager;
+            ro.stoc_client = client;
+            ro.thread_id = 0;
+            ro.hash = 0;
+            for (int level = 0; level < options_.level; level++) {
+                for (auto meta : files[level]) {
+                    Cache::Handle *handle = nullptr;
+                    Table *table = nullptr;
+                    NOVA_ASSERT(table_cache_->GetTable(ro, meta, meta->number,
+                                                       meta->SelectReplica(),
+                                                       meta->converted_file_size,
+                                                       level, &handle,
+                                                       &table).ok());
+                    for (const auto &tombstone : table->range_tombstones()) {
+                        range_tombstones_->Add(tombstone, memtable_id_seq_);
+                    }
+                    table_cache_->Release(handle);
+                }
             }
-            memtableid++;
-            delete it;
-            table_cache_->Evict(meta->number, true);
+            NOVA_LOG(rdmaio::INFO)
+                << fmt::format("Recovered {} range tombstones",
+                               range_tombstones_->size());
+        }
+
+        // Each L0 SSTable becomes a flushed memtable. Older SSTables get
+        // smaller memtable ids so that the lookup index points a key to its
+        // newest SSTable. Memtable id 0 is reserved for L1 and above.
+        std::vector<FileMetaData *> l0_files(files[0].begin(), files[0].end());
+        std::sort(l0_files.begin(), l0_files.end(),
+                  [](const FileMetaData *a, const FileMetaData *b) {
+                      if (a->flush_timestamp != b->flush_timestamp) {
+                          return a->flush_timestamp < b->flush_timestamp;
+                      }
+                      return a->number < b->number;
+                  });
+        NOVA_ASSERT(l0_files.size() + 1 < memtable_id_seq_)
+            << fmt::format("Too many L0 files to recover {}", l0_files.size());
+        for (int i = 0; i < l0_files.size(); i++) {
+            AtomicMemTable *mem = versions_->mid_table_mapping_[i + 1];
+            mem->l0_file_numbers_.insert(l0_files[i]->number);
+            mem->is_immutable_ = true;
+            mem->is_flushed_ = true;
+        }
+        // Rebuild the lookup index in the background while the range index is rebuilt below.
+        std::thread lookup_index_rebuild;
+        if (lookup_index_) {
+            lookup_index_rebuild = std::thread(&DBImpl::RebuildLookupIndex, this, l0_files);
         }
 
         if (options_.enable_subranges) {
@@ -798,9 +848,23 @@ namespace leveldb {
                 }
                 init->range_tables_.push_back(tables);
             }
+            // Scans must see the recovered L0 SSTables.
+            for (auto meta : l0_files) {
+                for (int i = 0; i < init->ranges_.size(); i++) {
+                    const Range &r = init->ranges_[i];
+                    if (r.IsSmallerThanLower(meta->largest.user_key(), user_comparator_) ||
+                        r.IsGreaterThanUpper(meta->smallest.user_key(), user_comparator_)) {
+                        continue;
+                    }
+                    init->range_tables_[i].l0_sstable_ids.insert(meta->number);
+                }
+            }
             range_index_manager_->Initialize(init);
             NOVA_LOG(rdmaio::INFO) << init->DebugString();
         }
+        if (lookup_index_rebuild.joinable()) {
+            lookup_index_rebuild.join();
+        }
 
         for (const auto &logfile : logfile_buf) {
             uint32_t index = logfile.first.find_last_of('-');
@@ -825,9 +889,85 @@ namespace leveldb {
                            time_diff(start, rdma_read_complete),
                            time_diff(rdma_read_complete, end),
                            time_diff(start, end));
+        recovery_start_ = start;
+        wait_for_first_fast_get_ = true;
         return Status::OK();
     }
 
+    void DBImpl::RebuildLookupIndex(const std::vector<FileMetaData *> &l0_files) {
+        timeval start{};
+        gettimeofday(&start, nullptr);
+        uint32_t nthreads = std::max(1u, std::min(options_.num_recovery_thread,
+                                                  (uint32_t) l0_files.size()));
+        auto client = reinterpret_cast<StoCBlockClient *> (options_.stoc_client);
+        std::vector<std::thread> threads;
+        for (uint32_t tid = 0; tid < nthreads; tid++) {
+            threads.emplace_back([&, tid]() {
+                // A StoC client waits on its own semaphore, so each thread needs one.
+                StoCBlockClient thread_client(tid, client->stoc_file_manager());
+                thread_client.rdma_msg_handlers_ = client->rdma_msg_handlers_;
+                ReadOptions ro;
+                ro.mem_manager = options_.mem_manager;
+                ro.stoc_client = &thread_client;
+                ro.thread_id = tid;
+                ro.hash = 0;
+                for (uint32_t i = tid; i < l0_files.size(); i += nthreads) {
+                    auto meta = l0_files[i];
+                    uint32_t memtableid = i + 1;
+                    NOVA_LOG(rdmaio::INFO)
+                        << fmt::format("t{}: Recover L0 data file {} to memtable {}", tid,
+                                       meta->DebugString(), memtableid);
+                    auto it = table_cache_->NewIterator(
+                            AccessCaller::kCompaction, ro, meta, meta->number,
+                            meta->SelectReplica(), 0, meta->converted_file_size);
+                    it->SeekToFirst();
+                    while (it->Valid()) {
+                        uint64_t hash;
+                        Slice user_key = ExtractUserKey(it->key());
+                        nova::str_to_int(user_key.data(), &hash, user_key.size());
+                        lookup_index_->InsertIfNewer(user_key, hash, memtableid);
+                        it->Next();
+                    }
+                    delete it;
+                    table_cache_->Evict(meta->number, true);
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        timeval end{};
+        gettimeofday(&end, nullptr);
+        index_rebuild_duration_ = time_diff(start, end);
+        index_rebuild_threads_ = nthreads;
+        NOVA_LOG(rdmaio::INFO)
+            << fmt::format("Rebuilt lookup index from {} L0 files with {} threads in {}: {}",
+                           l0_files.size(), nthreads, index_rebuild_duration_,
+                           lookup_index_->Stats().DebugString());
+    }
+
+    void DBImpl::RecoverLookupIndexEntry(const Slice &key, uint32_t memtable_id) {
+        if (!lookup_index_) {
+            return;
+        }
+        uint64_t hash;
+        nova::str_to_int(key.data(), &hash, key.size());
+        lookup_index_->InsertIfNewer(key, hash, memtable_id);
+    }
+
+    void DBImpl::RecordFirstFastGet() {
+        bool expected = true;
+        if (!wait_for_first_fast_get_.compare_exchange_strong(expected, false)) {
+            return;
+        }
+        timeval now{};
+        gettimeofday(&now, nullptr);
+        time_to_first_fast_get_ = time_diff(recovery_start_, now);
+        NOVA_LOG(rdmaio::INFO)
+            << fmt::format("db-{}: time to first fast GET after recovery: {}", dbid_,
+                           time_to_first_fast_get_);
+    }
+
     Status
     DBImpl::RecoverLogFile(
             const std::unordered_map<std::string, uint64_t> &logfile_buf,
@@ -1004,7 +1144,7 @@ namespace leveldb {
                              meta.flush_timestamp,
                              meta.smallest,
                              meta.largest,
-                             meta.block_replica_handles, meta.parity_block_handle);
+                             meta.block_replica_handles, meta.parity_block_handles);
             }
         }
         versions_->AppendChangesToManifest(&edit, manifest_file_,
@@ -1075,7 +1215,7 @@ namespace leveldb {
                           meta.flush_timestamp,
                           meta.smallest,
                           meta.largest,
-                          meta.block_replica_handles, meta.parity_block_handle);
+                          meta.block_replica_handles, meta.parity_block_handles);
             nova::NovaGlobalVariables::global.written_memtable_sizes += meta.file_size;
         }
     }
@@ -1103,20 +1243,23 @@ namespace leveldb {
             subranges = subrange_manager_->latest_subranges_;
         }
         CompactionState *state = new CompactionState(nullptr, subranges, versions_->last_sequence_);
+        // The merged memtable gets a new id. Drop the versions deleted by
+        // range tombstones so that their memtable id watermarks remain valid.
+        state->range_tombstones = range_tombstones_->tombstones();
         std::function<uint64_t(void)> fn_generator = std::bind(
                 &VersionSet::NewFileNumber, versions_);
         CompactionJob job(fn_generator, env_, dbname_, user_comparator_,
                           options_, bg_thread, table_cache_);
         uint32_t memtable_id = memtable_id_seq_.fetch_add(1);
         MemTable *output_memtable = new MemTable(internal_comparator_, memtable_id,
-                                                 db_profiler_, true);
+                                                 db_profiler_, true, options_.memtable_representation, MemTableHashIndexBuckets(options_));
         NOVA_ASSERT(memtable_id < MAX_LIVE_MEMTABLES);
         auto atomic_output_memtable = versions_->mid_table_mapping_[memtable_id];
         atomic_output_memtable->SetMemTable(flush_order_->latest_generation_id, output_memtable);
 
         std::vector<LevelDBLogRecord> log_records;
         auto fn_add_to_memtable = [&](const ParsedInternalKey &ikey, const Slice &value) {
-            output_memtable->Add(ikey.sequence, ValueType::kTypeValue, ikey.user_key, value);
+            output_memtable->Add(ikey.sequence, ikey.type, ikey.user_key, value);
             if (nova::NovaConfig::config->cfgs.size() == 1) {
                 uint64_t key;
                 nova::str_to_int(ikey.user_key.data(), &key, ikey.user_key.size());
@@ -1129,6 +1272,7 @@ namespace leveldb {
             log_record.sequence_number = ikey.sequence;
             log_record.key = ikey.user_key;
             log_record.value = value;
+            log_record.type = ikey.type;
             log_records.push_back(std::move(log_record));
         };
         job.CompactTables(state, it, &stats, true, kCompactInputMemTables, kCompactOutputMemTables, fn_add_to_memtable);
@@ -1271,7 +1415,7 @@ namespace leveldb {
                              meta.flush_timestamp,
                              meta.smallest,
                              meta.largest,
-                             meta.block_replica_handles, meta.parity_block_handle);
+                             meta.block_replica_handles, meta.parity_block_handles);
             }
             NOVA_LOG(rdmaio::DEBUG)
                 << fmt::format(
@@ -1628,7 +1772,7 @@ namespace leveldb {
                           f->flush_timestamp,
                           f->smallest,
                           f->largest,
-                          f->block_replica_handles, f->parity_block_handle);
+                          f->block_replica_handles, f->parity_block_handles);
             std::string output = fmt::format(
                     "Moved #{}@{} to level-{} {} bytes\n",
                     f->number, c->level(), c->target_level(), f->file_size);
@@ -1666,6 +1810,101 @@ namespace leveldb {
         mutex_.Unlock();
     }
 
+    void DBImpl::SetupRangeTombstones(Version *current, CompactionState *state) {
+        Compaction *c = state->compaction;
+        Slice smallest;
+        Slice largest;
+        bool first = true;
+        for (int which = 0; which < 2; which++) {
+            for (auto f : c->inputs_[which]) {
+                if (first || user_comparator_->Compare(f->smallest.user_key(),
+                                                       smallest) < 0) {
+                    smallest = f->smallest.user_key();
+                }
+                if (first || user_comparator_->Compare(f->largest.user_key(),
+                                                       largest) > 0) {
+                    largest = f->largest.user_key();
+                }
+                first = false;
+            }
+        }
+        // The outputs are bottommost if no deeper level overlaps them.
+        state->bottommost = c->target_level() >= 1;
+        for (int level = c->target_level() + 1;
+             level < options_.level && state->bottommost; level++) {
+            for (auto f : current->files_[level]) {
+                if (user_comparator_->Compare(f->largest.user_key(),
+                                              smallest) >= 0 &&
+                    user_comparator_->Compare(f->smallest.user_key(),
+                                              largest) <= 0) {
+                    state->bottommost = false;
+                    break;
+                }
+            }
+        }
+        std::vector<RangeTombstones::Entry> tombstones =
+                range_tombstones_->Overlapping(smallest, largest);
+        for (const auto &entry : tombstones) {
+            state->range_tombstones.push_back(entry.tombstone);
+        }
+        state->obsolete_range_tombstones = ObsoleteRangeTombstones(current,
+                                                                   state,
+                                                                   tombstones);
+    }
+
+    std::vector<RangeTombstone>
+    DBImpl::ObsoleteRangeTombstones(Version *current, CompactionState *state,
+                                    const std::vector<RangeTombstones::Entry> &tombstones) {
+        std::vector<RangeTombstone> obsolete;
+        if (!state->bottommost || tombstones.empty()) {
+            return obsolete;
+        }
+        std::set<uint64_t> inputs;
+        for (int which = 0; which < 2; which++) {
+            for (auto f : state->compaction->inputs_[which]) {
+                inputs.insert(f->number);
+            }
+        }
+        // Memtables with smaller ids than this are flushed.
+        uint32_t oldest_unflushed_memtable_id = memtable_id_seq_;
+        for (uint32_t id = 1; id < memtable_id_seq_; id++) {
+            AtomicMemTable *mem = versions_->mid_table_mapping_[id];
+            mem->mutex_.lock();
+            bool unflushed = mem->memtable_ != nullptr && !mem->is_flushed_;
+            mem->mutex_.unlock();
+            if (unflushed) {
+                oldest_unflushed_memtable_id = id;
+                break;
+            }
+        }
+        for (const auto &entry : tombstones) {
+            const RangeTombstone &tombstone = entry.tombstone;
+            if (tombstone.sequence > state->smallest_snapshot ||
+                entry.memtable_id_watermark > oldest_unflushed_memtable_id) {
+                continue;
+            }
+            bool overlaps = false;
+            for (int level = 0; level < options_.level && !overlaps; level++) {
+                for (auto f : current->files_[level]) {
+                    if (inputs.find(f->number) != inputs.end()) {
+                        continue;
+                    }
+                    if (user_comparator_->Compare(f->largest.user_key(),
+                                                  tombstone.start) >= 0 &&
+                        user_comparator_->Compare(f->smallest.user_key(),
+                                                  tombstone.end) < 0) {
+                        overlaps = true;
+                        break;
+                    }
+                }
+            }
+            if (!overlaps) {
+                obsolete.push_back(tombstone);
+            }
+        }
+        return obsolete;
+    }
+
     void DBImpl::CoordinateMajorCompaction() {
         while (options_.major_compaction_type == kMajorCoordinated ||
                options_.major_compaction_type == kMajorCoordinatedStoC) {
@@ -1733,6 +1972,7 @@ namespace leveldb {
                 uint64_t smallest_snapshot = versions_->LastSequence();
                 for (int i = 0; i < compactions.size(); i++) {
                     auto state = new CompactionState(compactions[i], subs, smallest_snapshot);
+                    SetupRangeTombstones(current, state);
                     states.push_back(state);
                 }
                 if (options_.major_compaction_type == kMajorCoordinated) {
@@ -1799,6 +2039,9 @@ namespace leveldb {
                         req->target_level = compaction->target_level();
                         req->dbname = dbname_;
                         req->smallest_snapshot = smallest_snapshot;
+                        req->bottommost = states[i]->bottommost;
+                        req->range_tombstones = states[i]->range_tombstones;
+                        req->obsolete_range_tombstones = states[i]->obsolete_range_tombstones;
                         if (subs) {
                             req->subranges = subs->subranges;
                         }
@@ -1983,6 +2226,10 @@ namespace leveldb {
             versions_->AddCompactedInputs(state->compaction, &compacted_tables_);
         }
         versions_->LogAndApply(&edit, v, true);
+        if (state) {
+            // The outputs no longer contain the versions that they delete.
+            range_tombstones_->Remove(state->obsolete_range_tombstones);
+        }
 
         uint32_t skip_compacting_version = compacting_version_id;
         if (!versions_->versions_[compacting_version_id]->SetCompaction()) {
@@ -1996,6 +2243,19 @@ namespace leveldb {
         }
         mutex_.Unlock();
         DeleteFiles(compaction_coordinator_thread_, files_to_delete, server_pairs);
+        if (lookup_index_ && !edits.empty()) {
+            // Entries of memtables whose L0 SSTables are all compacted into L1 are obsolete.
+            lookup_index_->MaybeGarbageCollect([&](uint32_t memtableid) {
+                if (memtableid >= MAX_LIVE_MEMTABLES) {
+                    return false;
+                }
+                AtomicMemTable *mem = versions_->mid_table_mapping_[memtableid];
+                mem->mutex_.lock();
+                bool obsolete = mem->is_flushed_ && mem->l0_file_numbers_.empty();
+                mem->mutex_.unlock();
+                return obsolete;
+            });
+        }
 
         for (int i = 0; i < partitioned_active_memtables_.size(); i++) {
             partitioned_active_memtables_[i]->background_work_finished_signal_.SignalAll();
@@ -2022,7 +2282,7 @@ namespace leveldb {
                           versions_->last_sequence_,
                           out.smallest, out.largest,
                           out.block_replica_handles,
-                          out.parity_block_handle);
+                          out.parity_block_handles);
         }
         return Status::OK();
     }
@@ -2067,23 +2327,141 @@ namespace leveldb {
 
     Status DBImpl::Get(const ReadOptions &options, const Slice &key,
                        std::string *value) {
+        if (options.deferred_block_reads != nullptr &&
+            options.deferred_block_reads->suspended != nullptr) {
+            return ResumeGet(options, key, value);
+        }
         number_of_gets_ += 1;
-        if (lookup_index_) {
-            if (GetWithLookupIndex(options, key, value).ok()) {
-                return Status::OK();
+        // The lookup index only locates the latest version of a key.
+        if (lookup_index_ &&
+            (options.snapshot == nullptr || range_index_manager_ == nullptr)) {
+            Status s = GetWithLookupIndex(options, key, value);
+            if (s.ok() || s.IsIncomplete() || range_index_manager_ == nullptr) {
+                return s;
             }
         }
         return GetWithRangeIndex(options, key, value);
     }
 
+    void DBImpl::MultiGet(const ReadOptions &options,
+                          const std::vector<Slice> &keys,
+                          std::vector<std::string> *values,
+                          std::vector<Status> *statuses) {
+        number_of_gets_ += keys.size();
+        values->clear();
+        values->resize(keys.size());
+        statuses->assign(keys.size(), Status::OK());
+        // The lookup index only locates the latest version of a key.
+        if (!lookup_index_ ||
+            (options.snapshot != nullptr && range_index_manager_ != nullptr)) {
+            for (uint32_t i = 0; i < keys.size(); i++) {
+                (*statuses)[i] = GetWithRangeIndex(options, keys[i],
+                                                   &(*values)[i]);
+            }
+            return;
+        }
+
+        // Sort the keys so that the keys in the same data block are
+        // searched together.
+        std::vector<uint32_t> order;
+        for (uint32_t i = 0; i < keys.size(); i++) {
+            order.push_back(i);
+        }
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return user_comparator_->Compare(keys[a], keys[b]) < 0;
+        });
+
+        SequenceNumber snapshot = ReadSequence(options);
+        // Search memtables.
+        std::vector<Version::MultiGetKey> sstable_keys;
+        std::vector<uint32_t> sstable_key_ids;
+        std::vector<uint32_t> memtable_ids;
+        for (uint32_t i : order) {
+            uint64_t hash;
+            nova::str_to_int(keys[i].data(), &hash, keys[i].size());
+            uint32_t memtableid = lookup_index_->Lookup(keys[i], hash);
+            AtomicMemTable *memtable = nullptr;
+            if (memtableid != 0) {
+                NOVA_ASSERT(memtableid < MAX_LIVE_MEMTABLES) << memtableid;
+                memtable = versions_->mid_table_mapping_[memtableid]->RefMemTable();
+            }
+            if (memtable != nullptr) {
+                LookupKey lkey(keys[i], snapshot);
+                Status s;
+                SequenceNumber seq = 0;
+                if (memtable->memtable_->Get(lkey, &(*values)[i], &s, &seq) &&
+                    s.ok() &&
+                    !range_tombstones_->IsDeleted(keys[i], seq, snapshot)) {
+                    number_of_memtable_hits_ += 1;
+                } else {
+                    (*statuses)[i] = Status::NotFound("");
+                }
+                versions_->mid_table_mapping_[memtableid]->Unref(dbname_);
+                continue;
+            }
+            Version::MultiGetKey key;
+            key.key = new LookupKey(keys[i], snapshot);
+            key.value = &(*values)[i];
+            sstable_keys.push_back(key);
+            sstable_key_ids.push_back(i);
+            memtable_ids.push_back(memtableid);
+        }
+        if (sstable_keys.empty()) {
+            return;
+        }
+
+        // Search SSTables. All keys use the same version.
+        Version *current = nullptr;
+        uint32_t vid = 0;
+        while (true) {
+            current = nullptr;
+            while (current == nullptr) {
+                vid = versions_->current_version_id();
+                NOVA_ASSERT(vid < MAX_LIVE_MEMTABLES) << vid;
+                current = versions_->versions_[vid]->Ref();
+            }
+            NOVA_ASSERT(current->version_id() == vid);
+            bool retry = false;
+            for (int i = 0; i < sstable_keys.size() && !retry; i++) {
+                auto atomic_memtable = versions_->mid_table_mapping_[memtable_ids[i]];
+                sstable_keys[i].l0fns.clear();
+                atomic_memtable->mutex_.lock();
+                if (vid >= atomic_memtable->last_version_id_) {
+                    sstable_keys[i].l0fns.insert(sstable_keys[i].l0fns.end(),
+                                                 atomic_memtable->l0_file_numbers_.begin(),
+                                                 atomic_memtable->l0_file_numbers_.end());
+                } else {
+                    retry = true;
+                }
+                atomic_memtable->mutex_.unlock();
+            }
+            if (!retry) {
+                break;
+            }
+            // A major compaction is installing a new version. Retry.
+            versions_->versions_[vid]->Unref(dbname_);
+        }
+        current->MultiGet(options, &sstable_keys,
+                          &number_of_files_to_search_for_get_);
+        versions_->versions_[vid]->Unref(dbname_);
+        for (int i = 0; i < sstable_keys.size(); i++) {
+            Status s = sstable_keys[i].status;
+            if (s.ok() &&
+                range_tombstones_->IsDeleted(keys[sstable_key_ids[i]],
+                                             sstable_keys[i].seq, snapshot)) {
+                s = Status::NotFound("");
+            }
+            (*statuses)[sstable_key_ids[i]] = s;
+            delete sstable_keys[i].key;
+        }
+    }
+
     Status
     DBImpl::GetWithRangeIndex(const ReadOptions &options, const Slice &key,
                               std::string *value) {
-        SequenceNumber snapshot = kMaxSequenceNumber;
+        SequenceNumber snapshot = ReadSequence(options);
         LookupKey lkey(key, snapshot);
-        Status s;
         NOVA_ASSERT(range_index_manager_);
-        std::vector<Iterator *> list;
         RangeIndex *range_index = range_index_manager_->current();
         NOVA_ASSERT(range_index);
         auto atomic_version = versions_->versions_[range_index->lsm_version_id_];
@@ -2092,36 +2470,114 @@ namespace leveldb {
         NOVA_ASSERT(BinarySearch(range_index->ranges_, key, &index,
                                  user_comparator_));
         const RangeTables &range_table = range_index->range_tables_[index];
-        // Search memtables.
+        // Search memtables. The newest value or deletion wins.
+        SequenceNumber latest_seq = 0;
+        bool found = false;
+        bool deleted = false;
         for (uint32_t memtableid : range_table.memtable_ids) {
-            versions_->mid_table_mapping_[memtableid]->memtable_->Get(lkey, value, &s);
+            std::string tmp;
+            Status mem_s;
+            SequenceNumber seq = 0;
+            if (versions_->mid_table_mapping_[memtableid]->memtable_->Get(
+                    lkey, &tmp, &mem_s, &seq) &&
+                (!found || seq > latest_seq)) {
+                found = true;
+                latest_seq = seq;
+                deleted = !mem_s.ok();
+                if (!deleted) {
+                    value->swap(tmp);
+                }
+            }
+        }
+        // Search SSTables if the memtables do not contain the key.
+        if (!found) {
+            SuspendedGet get;
+            get.version_id = range_index->lsm_version_id_;
+            get.range_index = range_index;
+            get.snapshot = snapshot;
+            get.l0fns.insert(get.l0fns.begin(),
+                             range_table.l0_sstable_ids.begin(),
+                             range_table.l0_sstable_ids.end());
+            return GetFromSSTables(options, key, &get, value);
         }
-        std::vector<uint64_t> l0fns;
-        l0fns.insert(l0fns.begin(), range_table.l0_sstable_ids.begin(),
-                     range_table.l0_sstable_ids.end());
-        // Search SSTables.
-        SequenceNumber latest_seq = 0;
-        atomic_version->version->Get(options, l0fns, lkey, &latest_seq,
-                                     value,
-                                     &number_of_files_to_search_for_get_);
-        Version::GetStats stats = {};
-        atomic_version->version->Get(options, lkey, &latest_seq, value,
-                                     &stats, GetSearchScope::kL1AndAbove,
-                                     &number_of_files_to_search_for_get_);
         range_index->UnRef();
         versions_->versions_[range_index->lsm_version_id_]->Unref(dbname_);
-        if (!value->empty()) {
+        if (!deleted &&
+            !range_tombstones_->IsDeleted(key, latest_seq, snapshot)) {
             return Status::OK();
         }
         return Status::NotFound("");
     }
 
+    Status
+    DBImpl::ResumeGet(const ReadOptions &options, const Slice &key,
+                      std::string *value) {
+        DeferredBlockReads *deferred = options.deferred_block_reads;
+        std::unique_ptr<SuspendedGet> get(deferred->suspended);
+        deferred->suspended = nullptr;
+        bool lookup_index = get->range_index == nullptr;
+        Status s = GetFromSSTables(options, key, get.get(), value);
+        // Same as Get.
+        if (s.ok() || s.IsIncomplete() || !lookup_index ||
+            range_index_manager_ == nullptr) {
+            return s;
+        }
+        return GetWithRangeIndex(options, key, value);
+    }
+
+    Status
+    DBImpl::GetFromSSTables(const ReadOptions &options, const Slice &key,
+                            SuspendedGet *get, std::string *value) {
+        Version *version = versions_->versions_[get->version_id]->version;
+        LookupKey lkey(key, get->snapshot);
+        SequenceNumber latest_seq = 0;
+        Status s = Status::NotFound(Slice());
+        if (!get->search_l1) {
+            if (!get->l0fns.empty()) {
+                s = version->Get(options, get->l0fns, lkey, &latest_seq, value,
+                                 &number_of_files_to_search_for_get_, get);
+            }
+            NOVA_ASSERT(!s.IsIOError() || get->range_index)
+                << fmt::format("v:{} status:{} version:{}", get->version_id,
+                               s.ToString(), version->DebugString());
+            get->search_l1 = !s.IsIncomplete() && !s.ok() && latest_seq == 0;
+        }
+        if (get->search_l1) {
+            // L0 files do not contain the key. Search L1 files.
+            Version::GetStats stats = {};
+            s = version->Get(options, lkey, &latest_seq, value, &stats,
+                             GetSearchScope::kL1AndAbove,
+                             &number_of_files_to_search_for_get_, get);
+        }
+        if (s.IsIncomplete()) {
+            options.deferred_block_reads->suspended =
+                    new SuspendedGet(std::move(*get));
+            return s;
+        }
+        if (s.ok() && range_tombstones_->IsDeleted(key, latest_seq,
+                                                   get->snapshot)) {
+            s = Status::NotFound("");
+        }
+        NOVA_ASSERT(s.ok() || s.IsNotFound() || get->range_index)
+            << fmt::format("key:{} val:{} seq:{} status:{} version:{}",
+                           key.ToString(), value->size(), latest_seq,
+                           s.ToString(), version->DebugString());
+        if (get->range_index != nullptr) {
+            get->range_index->UnRef();
+            if (!s.ok()) {
+                s = Status::NotFound("");
+            }
+        }
+        versions_->versions_[get->version_id]->Unref(dbname_);
+        return s;
+    }
+
     Status
     DBImpl::GetWithLookupIndex(const ReadOptions &options, const Slice &key,
                                std::string *value) {
         Status s = Status::NotFound(Slice());
         std::string tmp;
-        SequenceNumber snapshot = kMaxSequenceNumber;
+        SequenceNumber snapshot = ReadSequence(options);
         AtomicMemTable *memtable = nullptr;
         std::vector<uint64_t> l0fns;
 
@@ -2129,6 +2585,9 @@ namespace leveldb {
         uint32_t memtableid = lookup_index_->Lookup(key, options.hash);
         if (memtableid != 0) {
             NOVA_ASSERT(memtableid < MAX_LIVE_MEMTABLES) << memtableid;
+            if (wait_for_first_fast_get_) {
+                RecordFirstFastGet();
+            }
             memtable = versions_->mid_table_mapping_[memtableid]->RefMemTable();
         }
         LookupKey lkey(key, snapshot);
@@ -2140,9 +2599,12 @@ namespace leveldb {
 //                               memtable->memtable_->memtableid(),
 //                               s.ToString());
 
-            bool found = memtable->memtable_->Get(lkey, value, &s);
+            Status mem_s;
+            SequenceNumber seq = 0;
+            bool found = memtable->memtable_->Get(lkey, value, &mem_s, &seq);
             versions_->mid_table_mapping_[memtableid]->Unref(dbname_);
-            if (found) {
+            if (found && mem_s.ok() &&
+                !range_tombstones_->IsDeleted(key, seq, snapshot)) {
                 number_of_memtable_hits_ += 1;
                 return Status::OK();
             } else {
@@ -2152,7 +2614,6 @@ namespace leveldb {
 
         Version *current = nullptr;
         uint32_t vid = 0;
-        SequenceNumber latest_seq = 0;
         auto atomic_memtable = versions_->mid_table_mapping_[memtableid];
         while (true) {
             current = nullptr;
@@ -2176,28 +2637,11 @@ namespace leveldb {
             versions_->versions_[vid]->Unref(dbname_);
         }
 
-        if (!l0fns.empty()) {
-            s = current->Get(options, l0fns, lkey, &latest_seq, value, &number_of_files_to_search_for_get_);
-        }
-        NOVA_ASSERT(!s.IsIOError())
-            << fmt::format("v:{} status:{} mid:{} version:{}", vid, s.ToString(), memtableid, current->DebugString());
-        if (s.IsNotFound()) {
-            // Search L1 files.
-            Version::GetStats stats = {};
-            SequenceNumber l1seq;
-            s = current->Get(options, lkey, &l1seq, value, &stats, GetSearchScope::kL1AndAbove,
-                             &number_of_files_to_search_for_get_);
-//            if (l1seq > latest_seq) {
-//                value->assign(l1val);
-//            }
-        }
-        NOVA_ASSERT(s.ok())
-            << fmt::format("key:{} val:{} seq:{} status:{} version:{}",
-                           key.ToString(), value->size(), latest_seq,
-                           s.ToString(),
-                           current->DebugString());
-        versions_->versions_[vid]->Unref(dbname_);
-        return s;
+        SuspendedGet get;
+        get.version_id = vid;
+        get.snapshot = snapshot;
+        get.l0fns.swap(l0fns);
+        return GetFromSSTables(options, key, &get, value);
     }
 
     void DBImpl::StartTracing() {
@@ -2224,7 +2668,7 @@ namespace leveldb {
         SequenceNumber latest_snapshot;
         uint32_t seed;
         Iterator *iter = NewInternalIterator(options, &latest_snapshot, &seed);
-        return NewDBIterator(this, user_comparator(), iter, latest_snapshot, seed,
+        return NewDBIterator(range_tombstones_->fragments(), user_comparator(), iter, latest_snapshot, seed,
                              nova::NovaConfig::config->cfgs[options.cfg_id]->fragments[dbid_]->range);
     }
 
@@ -2241,18 +2685,47 @@ namespace leveldb {
 // Convenience methods
     Status
     DBImpl::Put(const WriteOptions &o, const Slice &key, const Slice &val) {
+        return WriteRecord(o, key, val, kTypeValue);
+    }
+
+    Status DBImpl::Delete(const WriteOptions &options, const Slice &key) {
+        return WriteRecord(options, key, Slice(), kTypeDeletion);
+    }
+
+    Status DBImpl::DeleteRange(const WriteOptions &options, const Slice &start,
+                               const Slice &end) {
+        if (user_comparator_->Compare(start, end) >= 0) {
+            return Status::InvalidArgument("DeleteRange", "start >= end");
+        }
+        // The tombstone is stored with the start key.
+        return WriteRecord(options, start, end, kTypeRangeDeletion);
+    }
+
+    Status DBImpl::WriteRecord(const WriteOptions &o, const Slice &key,
+                               const Slice &val, ValueType type) {
         processed_writes_ += 1;
         if (options_.memtable_type == MemTableType::kStaticPartition) {
             if (o.is_loading_db || !options_.enable_subranges) {
-                return WriteStaticPartition(o, key, val);
+                return WriteStaticPartition(o, key, val, type);
             }
-            return WriteSubrange(o, key, val);
+            return WriteSubrange(o, key, val, type);
         }
-        return WriteMemTablePool(o, key, val);
+        return WriteMemTablePool(o, key, val, type);
     }
 
-    Status DBImpl::Delete(const WriteOptions &options, const Slice &key) {
-        return DB::Delete(options, key);
+    void DBImpl::AddRangeTombstone(const Slice &start, const Slice &end,
+                                   SequenceNumber sequence) {
+        RangeTombstone tombstone;
+        tombstone.start = start.ToString();
+        tombstone.end = end.ToString();
+        tombstone.sequence = sequence;
+        // Memtables created from now on only contain newer versions.
+        range_tombstones_->Add(tombstone, memtable_id_seq_);
+    }
+
+    void DBImpl::RecoverRangeTombstone(const Slice &start, const Slice &end,
+                                       SequenceNumber sequence) {
+        AddRangeTombstone(start, end, sequence);
     }
 
     void DBImpl::StealMemTable(const leveldb::WriteOptions &options) {
@@ -2377,7 +2850,7 @@ namespace leveldb {
             if (memtableid != 0) {
                 if (nova::NovaConfig::config->ltc_migration_policy == nova::LTCMigrationPolicy::IMMEDIATE) {
                     // Mark this table as immutable.
-                    MemTable *table = new MemTable(internal_comparator_, memtableid, nullptr, false);
+                    MemTable *table = new MemTable(internal_comparator_, memtableid, nullptr, false, options_.memtable_representation, MemTableHashIndexBuckets(options_));
                     NOVA_ASSERT(!p->available_slots.empty());
                     uint32_t slotid = p->available_slots.front();
                     p->available_slots.pop();
@@ -2394,7 +2867,7 @@ namespace leveldb {
                     pair.imm_slot = slotid;
                     (*mid_table_map)[memtableid] = pair;
                 } else {
-                    p->active_memtable = new MemTable(internal_comparator_, memtableid, nullptr, false);
+                    p->active_memtable = new MemTable(internal_comparator_, memtableid, nullptr, false, options_.memtable_representation, MemTableHashIndexBuckets(options_));
                     versions_->mid_table_mapping_[memtableid]->SetMemTable(flush_order_->latest_generation_id,
                                                                            p->active_memtable);
                     MemTableLogFilePair pair = {};
@@ -2410,7 +2883,7 @@ namespace leveldb {
             for (int j = 0; j < size; j++) {
                 uint32_t imm_memtableid = 0;
                 NOVA_ASSERT(DecodeFixed32(buf, &imm_memtableid));
-                MemTable *table = new MemTable(internal_comparator_, imm_memtableid, nullptr, false);
+                MemTable *table = new MemTable(internal_comparator_, imm_memtableid, nullptr, false, options_.memtable_representation, MemTableHashIndexBuckets(options_));
                 NOVA_ASSERT(!p->available_slots.empty());
                 uint32_t slotid = p->available_slots.front();
                 p->available_slots.pop();
@@ -2432,7 +2905,7 @@ namespace leveldb {
                 !p->available_slots.empty()) {
                 // Create a new active memtable.
                 uint32_t new_memtable_id = memtable_id_seq_.fetch_add(1);
-                p->active_memtable = new MemTable(internal_comparator_, new_memtable_id, nullptr, true);
+                p->active_memtable = new MemTable(internal_comparator_, new_memtable_id, nullptr, true, options_.memtable_representation, MemTableHashIndexBuckets(options_));
                 versions_->mid_table_mapping_[new_memtable_id]->SetMemTable(flush_order_->latest_generation_id,
                                                                             p->active_memtable);
             }
@@ -2473,7 +2946,7 @@ namespace leveldb {
                     partition->immutable_memtable_ids.push_back(table->memtableid());
 
                     uint32_t new_memtable_id = memtable_id_seq_.fetch_add(1);
-                    MemTable *new_table = new MemTable(internal_comparator_, new_memtable_id, db_profiler_, true);
+                    MemTable *new_table = new MemTable(internal_comparator_, new_memtable_id, db_profiler_, true, options_.memtable_representation, MemTableHashIndexBuckets(options_));
                     NOVA_ASSERT(new_memtable_id < MAX_LIVE_MEMTABLES);
                     uint64_t gen_id = flush_order_->latest_generation_id;
                     versions_->mid_table_mapping_[new_memtable_id]->SetMemTable(gen_id, new_table);
@@ -2517,29 +2990,38 @@ namespace leveldb {
         return number_of_immutable_memtables_;
     }
 
-    bool DBImpl::WriteStaticPartition(const leveldb::WriteOptions &options,
-                                      const leveldb::Slice &key,
-                                      const leveldb::Slice &value,
-                                      uint32_t partition_id,
-                                      bool should_wait,
-                                      uint64_t last_sequence,
+    void DBImpl::ScheduleFlushImmSlot(const leveldb::WriteOptions &options,
+                                      uint32_t partition_id, int imm_slot,
                                       SubRange *subrange) {
-        MemTablePartition *partition = partitioned_active_memtables_[partition_id];
-        partition->mutex.Lock();
-        if (subrange != nullptr) {
-            int tinyrange_id;
-            NOVA_ASSERT(BinarySearch(subrange->tiny_ranges, key, &tinyrange_id, user_comparator_))
-                << fmt::format("key:{} range:{}", key.ToString(), subrange->DebugString());
-            subrange->tiny_ranges[tinyrange_id].ninserts++;
+        int thread_id = -1;
+        bool merge_memtables_without_flushing = false;
+        if (subrange) {
+            thread_id = subrange->GetCompactionThreadId(&EnvBGThread::bg_flush_memtable_thread_id_seq,
+                                                        &merge_memtables_without_flushing);
+        } else {
+            thread_id =
+                    EnvBGThread::bg_flush_memtable_thread_id_seq.fetch_add(1, std::memory_order_relaxed) %
+                    bg_flush_memtable_threads_.size();
         }
+        ScheduleFlushMemTableTask(thread_id,
+                                  partitioned_imms_[imm_slot],
+                                  versions_->mid_table_mapping_[partitioned_imms_[imm_slot]]->memtable_,
+                                  partition_id,
+                                  imm_slot, options.rand_seed,
+                                  merge_memtables_without_flushing);
+    }
 
+    MemTable *
+    DBImpl::SelectActiveMemTable(const leveldb::WriteOptions &options,
+                                 uint32_t partition_id, bool should_wait,
+                                 SubRange *subrange, int *imm_slot) {
+        MemTablePartition *partition = partitioned_active_memtables_[partition_id];
         MemTable *table = nullptr;
         bool wait = false;
-        int imm_slot;
         uint64_t start_wait = 0;
         while (true) {
             table = partition->active_memtable;
-            imm_slot = -1;
+            *imm_slot = -1;
             if (table) {
                 auto atomic_mem = versions_->mid_table_mapping_[table->memtableid()];
                 if (atomic_mem->memtable_size_ <= options_.write_buffer_size) {
@@ -2584,41 +3066,25 @@ namespace leveldb {
                 // The table is full.
                 NOVA_ASSERT(!partition->available_slots.empty());
                 // Mark the active memtable as immutable and schedule compaction.
-                imm_slot = partition->available_slots.front();
+                *imm_slot = partition->available_slots.front();
                 partition->available_slots.pop();
-                NOVA_ASSERT(partitioned_imms_[imm_slot] == 0);
-                partitioned_imms_[imm_slot] = table->memtableid();
-                partition->slot_imm_id[imm_slot] = table->memtableid();
+                NOVA_ASSERT(partitioned_imms_[*imm_slot] == 0);
+                partitioned_imms_[*imm_slot] = table->memtableid();
+                partition->slot_imm_id[*imm_slot] = table->memtableid();
                 partition->immutable_memtable_ids.push_back(table->memtableid());
                 number_of_immutable_memtables_.fetch_add(1);
                 partition->active_memtable = nullptr;
             }
             if (partition->available_slots.empty()) {
-                if (imm_slot != -1) {
-                    int thread_id = -1;
-                    bool merge_memtables_without_flushing = false;
-                    if (subrange) {
-                        thread_id = subrange->GetCompactionThreadId(
-                                &EnvBGThread::bg_flush_memtable_thread_id_seq,
-                                &merge_memtables_without_flushing);
-                    } else {
-                        thread_id =
-                                EnvBGThread::bg_flush_memtable_thread_id_seq.fetch_add(
-                                        1, std::memory_order_relaxed) %
-                                bg_flush_memtable_threads_.size();
-                    }
-                    ScheduleFlushMemTableTask(thread_id,
-                                              partitioned_imms_[imm_slot],
-                                              versions_->mid_table_mapping_[partitioned_imms_[imm_slot]]->memtable_,
-                                              partition_id, imm_slot,
-                                              options.rand_seed,
-                                              merge_memtables_without_flushing);
+                if (*imm_slot != -1) {
+                    ScheduleFlushImmSlot(options, partition_id, *imm_slot,
+                                         subrange);
                 }
                 // We have filled up all memtables, but the previous
                 // one is still being compacted, so we wait.
                 if (!should_wait) {
                     partition->mutex.Unlock();
-                    return false;
+                    return nullptr;
                 }
                 if (start_wait == 0) {
                     start_wait = env_->NowMicros();
@@ -2628,7 +3094,7 @@ namespace leveldb {
             } else {
                 // Create a new table.
                 uint32_t memtable_id = memtable_id_seq_.fetch_add(1);
-                table = new MemTable(internal_comparator_, memtable_id, db_profiler_, true);
+                table = new MemTable(internal_comparator_, memtable_id, db_profiler_, true, options_.memtable_representation, MemTableHashIndexBuckets(options_));
                 NOVA_ASSERT(memtable_id < MAX_LIVE_MEMTABLES);
                 uint64_t generation_id = flush_order_->latest_generation_id;
                 versions_->mid_table_mapping_[memtable_id]->SetMemTable(generation_id, table);
@@ -2652,6 +3118,33 @@ namespace leveldb {
         } else {
             number_of_puts_no_wait_ += 1;
         }
+        return table;
+    }
+
+    bool DBImpl::WriteStaticPartition(const leveldb::WriteOptions &options,
+                                      const leveldb::Slice &key,
+                                      const leveldb::Slice &value,
+                                      uint32_t partition_id,
+                                      bool should_wait,
+                                      uint64_t last_sequence,
+                                      SubRange *subrange,
+                                      ValueType type) {
+        MemTablePartition *partition = partitioned_active_memtables_[partition_id];
+        partition->mutex.Lock();
+        if (subrange != nullptr) {
+            int tinyrange_id;
+            NOVA_ASSERT(BinarySearch(subrange->tiny_ranges, key, &tinyrange_id, user_comparator_))
+                << fmt::format("key:{} range:{}", key.ToString(), subrange->DebugString());
+            subrange->tiny_ranges[tinyrange_id].ninserts++;
+        }
+
+        int imm_slot;
+        MemTable *table = SelectActiveMemTable(options, partition_id,
+                                               should_wait, subrange,
+                                               &imm_slot);
+        if (table == nullptr) {
+            return false;
+        }
         uint32_t memtable_id = table->memtableid();
         auto atomic_mem = versions_->mid_table_mapping_[memtable_id];
         atomic_mem->number_of_pending_writes_ += 1;
@@ -2659,10 +3152,14 @@ namespace leveldb {
         if (nova::NovaConfig::config->log_record_mode ==
             nova::NovaLogRecordMode::LOG_RDMA && !options.local_write) {
             partition->mutex.Unlock();
-            GenerateLogRecord(options, last_sequence, key, value, memtable_id);
+            GenerateLogRecord(options, last_sequence, key, value, memtable_id,
+                              type);
             partition->mutex.Lock();
         }
-        table->Add(last_sequence, ValueType::kTypeValue, key, value);
+        table->Add(last_sequence, type, key, value);
+        if (type == kTypeRangeDeletion) {
+            AddRangeTombstone(key, value, last_sequence);
+        }
         atomic_mem->number_of_pending_writes_ -= 1;
         versions_->mid_table_mapping_[memtable_id]->nentries_ += 1;
         if (lookup_index_) {
@@ -2679,31 +3176,163 @@ namespace leveldb {
         partition->mutex.Unlock();
         // Schedule.
         if (imm_slot != -1) {
-            int thread_id = -1;
-            bool merge_memtables_without_flushing = false;
-            if (subrange) {
-                thread_id = subrange->GetCompactionThreadId(&EnvBGThread::bg_flush_memtable_thread_id_seq,
-                                                            &merge_memtables_without_flushing);
-            } else {
-                thread_id =
-                        EnvBGThread::bg_flush_memtable_thread_id_seq.fetch_add(1, std::memory_order_relaxed) %
-                        bg_flush_memtable_threads_.size();
+            ScheduleFlushImmSlot(options, partition_id, imm_slot, subrange);
+        }
+        return true;
+    }
+
+    bool DBImpl::WriteStaticPartition(const leveldb::WriteOptions &options,
+                                      const std::vector<LevelDBLogRecord> &records,
+                                      uint32_t partition_id,
+                                      bool should_wait,
+                                      SubRange *subrange) {
+        MemTablePartition *partition = partitioned_active_memtables_[partition_id];
+        partition->mutex.Lock();
+        uint64_t size = 0;
+        for (const auto &record : records) {
+            if (subrange != nullptr) {
+                int tinyrange_id;
+                NOVA_ASSERT(BinarySearch(subrange->tiny_ranges, record.key, &tinyrange_id, user_comparator_))
+                    << fmt::format("key:{} range:{}", record.key.ToString(), subrange->DebugString());
+                subrange->tiny_ranges[tinyrange_id].ninserts++;
             }
-            ScheduleFlushMemTableTask(thread_id,
-                                      partitioned_imms_[imm_slot],
-                                      versions_->mid_table_mapping_[partitioned_imms_[imm_slot]]->memtable_,
-                                      partition_id,
-                                      imm_slot, options.rand_seed,
-                                      merge_memtables_without_flushing);
+            size += record.key.size() + record.value.size();
+        }
+
+        int imm_slot;
+        MemTable *table = SelectActiveMemTable(options, partition_id,
+                                               should_wait, subrange,
+                                               &imm_slot);
+        if (table == nullptr) {
+            return false;
+        }
+        uint32_t memtable_id = table->memtableid();
+        auto atomic_mem = versions_->mid_table_mapping_[memtable_id];
+        atomic_mem->number_of_pending_writes_ += 1;
+        atomic_mem->memtable_size_ += size;
+        if (nova::NovaConfig::config->log_record_mode ==
+            nova::NovaLogRecordMode::LOG_RDMA && !options.local_write) {
+            partition->mutex.Unlock();
+            // Replicate the log records of the group with one request so
+            // that recovery replays all or none of them.
+            GenerateLogRecord(options, records, memtable_id);
+            partition->mutex.Lock();
+        }
+        for (const auto &record : records) {
+            table->Add(record.sequence_number, record.type, record.key,
+                       record.value);
+            if (record.type == kTypeRangeDeletion) {
+                AddRangeTombstone(record.key, record.value,
+                                  record.sequence_number);
+            }
+            if (lookup_index_) {
+                uint64_t hash;
+                nova::str_to_int(record.key.data(), &hash, record.key.size());
+                lookup_index_->Insert(record.key, hash, memtable_id);
+            }
+        }
+        atomic_mem->number_of_pending_writes_ -= 1;
+        versions_->mid_table_mapping_[memtable_id]->nentries_ += records.size();
+        if (nova::NovaConfig::config->log_record_mode ==
+            nova::NovaLogRecordMode::LOG_RDMA && !options.local_write) {
+            if (atomic_mem->number_of_pending_writes_ == 0 &&
+                atomic_mem->memtable_size_ > options_.write_buffer_size) {
+                // Wake up other threads that are waiting on pending.
+                partition->background_work_finished_signal_.SignalAll();
+            }
+        }
+        partition->mutex.Unlock();
+        // Schedule.
+        if (imm_slot != -1) {
+            ScheduleFlushImmSlot(options, partition_id, imm_slot, subrange);
         }
         return true;
     }
 
+    Status DBImpl::Write(const WriteOptions &options, WriteBatch *updates) {
+        uint32_t n = WriteBatchInternal::Count(updates);
+        if (n == 0) {
+            return Status::OK();
+        }
+        // Assign a contiguous range of sequence numbers.
+        SequenceNumber first_sequence = versions_->last_sequence_.fetch_add(n);
+        std::vector<LevelDBLogRecord> records;
+        records.reserve(n);
+        Status s = WriteBatchInternal::CollectRecords(updates, first_sequence,
+                                                      &records);
+        if (!s.ok()) {
+            return s;
+        }
+        if (nova::NovaConfig::config->log_record_mode ==
+            nova::NovaLogRecordMode::LOG_RDMA && !options.local_write &&
+            nova::LogRecordsSize(records) > options.rdma_backing_mem_size) {
+            // The log records of a memtable are replicated with one request.
+            return Status::InvalidArgument("Write batch exceeds the log buffer");
+        }
+        processed_writes_ += n;
+
+        if (options_.memtable_type == MemTableType::kMemTablePool) {
+            return WriteMemTablePool(options, records);
+        }
+
+        if (options.is_loading_db || !options_.enable_subranges) {
+            if (options.is_loading_db) {
+                NOVA_ASSERT(WriteStaticPartition(options, records, 0, true, nullptr));
+                return Status::OK();
+            }
+            uint32_t partition_id = rand_r(options.rand_seed) % partitioned_active_memtables_.size();
+            if (options_.num_memtable_partitions > 1) {
+                int tries = 2;
+                int i = 0;
+                while (i < tries) {
+                    if (WriteStaticPartition(options, records, partition_id, false, nullptr)) {
+                        return Status::OK();
+                    }
+                    i++;
+                    partition_id = (partition_id + 1) % partitioned_active_memtables_.size();
+                }
+            }
+            partition_id = (partition_id + 1) % partitioned_active_memtables_.size();
+            NOVA_ASSERT(WriteStaticPartition(options, records, partition_id, true, nullptr));
+            return Status::OK();
+        }
+
+        if (processed_writes_ > SUBRANGE_WARMUP_NPUTS &&
+            processed_writes_ % SUBRANGE_REORG_INTERVAL < n &&
+            options_.enable_subrange_reorg) {
+            // wake up reorg thread.
+            EnvBGTask task = {};
+            task.db = this;
+            reorg_thread_->Schedule(task);
+        }
+        // Group the records by subrange. A key may fall into several
+        // duplicated subranges. All its records go to the first one found
+        // so that they land in the same memtable in batch order.
+        std::map<int, std::vector<LevelDBLogRecord>> groups;
+        std::map<int, SubRange *> subranges;
+        WriteBatchInternal::GroupRecords(
+                records, [&](const LevelDBLogRecord &record) {
+                    SubRange *subrange = nullptr;
+                    int subrange_id = subrange_manager_->SearchSubranges(
+                            options, record.key, record.value, &subrange);
+                    NOVA_ASSERT(subrange_id >= 0);
+                    subranges[subrange_id] = subrange;
+                    return subrange_id;
+                }, &groups);
+        for (const auto &group : groups) {
+            NOVA_ASSERT(WriteStaticPartition(options, group.second,
+                                             group.first, true,
+                                             subranges[group.first]));
+        }
+        return Status::OK();
+    }
+
     Status DBImpl::WriteStaticPartition(const WriteOptions &options,
-                                        const Slice &key, const Slice &val) {
+                                        const Slice &key, const Slice &val,
+                                        ValueType type) {
         uint64_t last_sequence = versions_->last_sequence_.fetch_add(1);
         if (options.is_loading_db) {
-            NOVA_ASSERT(WriteStaticPartition(options, key, val, 0, true, last_sequence, nullptr));
+            NOVA_ASSERT(WriteStaticPartition(options, key, val, 0, true, last_sequence, nullptr, type));
             return Status::OK();
         }
 
@@ -2712,7 +3341,7 @@ namespace leveldb {
             int tries = 2;
             int i = 0;
             while (i < tries) {
-                if (WriteStaticPartition(options, key, val, partition_id, false, last_sequence, nullptr)) {
+                if (WriteStaticPartition(options, key, val, partition_id, false, last_sequence, nullptr, type)) {
                     return Status::OK();
                 }
                 i++;
@@ -2720,7 +3349,7 @@ namespace leveldb {
             }
         }
         partition_id = (partition_id + 1) % partitioned_active_memtables_.size();
-        NOVA_ASSERT(WriteStaticPartition(options, key, val, partition_id, true, last_sequence, nullptr));
+        NOVA_ASSERT(WriteStaticPartition(options, key, val, partition_id, true, last_sequence, nullptr, type));
         return Status::OK();
     }
 
@@ -2732,7 +3361,8 @@ namespace leveldb {
 
     Status DBImpl::WriteSubrange(const leveldb::WriteOptions &options,
                                  const leveldb::Slice &key,
-                                 const leveldb::Slice &val) {
+                                 const leveldb::Slice &val,
+                                 ValueType type) {
         uint64_t last_sequence = versions_->last_sequence_.fetch_add(1);
         if (processed_writes_ > SUBRANGE_WARMUP_NPUTS &&
             processed_writes_ % SUBRANGE_REORG_INTERVAL == 0 &&
@@ -2749,14 +3379,29 @@ namespace leveldb {
         NOVA_ASSERT(WriteStaticPartition(options, key, val, subrange_id,
                                          true,
                                          last_sequence,
-                                         subrange));
+                                         subrange, type));
         return Status::OK();
     }
 
     Status DBImpl::WriteMemTablePool(const WriteOptions &options,
                                      const Slice &key,
-                                     const Slice &val) {
-        uint64_t last_sequence = versions_->last_sequence_.fetch_add(1);
+                                     const Slice &val,
+                                     ValueType type) {
+        LevelDBLogRecord record = {};
+        record.sequence_number = versions_->last_sequence_.fetch_add(1);
+        record.key = key;
+        record.value = val;
+        record.type = type;
+        return WriteMemTablePool(options,
+                                 std::vector<LevelDBLogRecord>{record});
+    }
+
+    Status DBImpl::WriteMemTablePool(const WriteOptions &options,
+                                     const std::vector<LevelDBLogRecord> &records) {
+        uint64_t size = 0;
+        for (const auto &record : records) {
+            size += record.key.size() + record.value.size();
+        }
 
         std::vector<MemTable *> full_memtables;
         AtomicMemTable *atomic_memtable = nullptr;
@@ -2950,7 +3595,7 @@ namespace leveldb {
             if (has_available_memtable) {
                 number_of_active_memtables_ += 1;
                 uint32_t memtable_id = memtable_id_seq_.fetch_add(1);
-                MemTable *new_table = new MemTable(internal_comparator_, memtable_id, db_profiler_, true);
+                MemTable *new_table = new MemTable(internal_comparator_, memtable_id, db_profiler_, true, options_.memtable_representation, MemTableHashIndexBuckets(options_));
                 if (pin) {
                     new_table->is_pinned_ = true;
                 }
@@ -3025,7 +3670,7 @@ namespace leveldb {
                 number_of_puts_wait_++;
                 NOVA_LOG(rdmaio::DEBUG)
                     << fmt::format("db[{}]: Insert {} wait for pool",
-                                   dbid_, key.ToString());
+                                   dbid_, records[0].key.ToString());
                 Log(options_.info_log,
                     "Current memtable full; Make room waiting... tid-%lu\n",
                     options.thread_id);
@@ -3037,7 +3682,7 @@ namespace leveldb {
         if (wait) {
             NOVA_LOG(rdmaio::DEBUG)
                 << fmt::format("db[{}]: Insert {} resume",
-                               dbid_, key.ToString());
+                               dbid_, records[0].key.ToString());
             Log(options_.info_log,
                 "Make room; resuming... tid-%lu\n", options.thread_id);
         }
@@ -3047,7 +3692,7 @@ namespace leveldb {
         NOVA_ASSERT(!atomic_memtable->is_immutable_);
         NOVA_ASSERT(!atomic_memtable->is_flushed_);
         NOVA_ASSERT(atomic_memtable->memtable_);
-        atomic_memtable->memtable_size_ += (key.size() + val.size());
+        atomic_memtable->memtable_size_ += size;
 
         if (nova::NovaConfig::config->log_record_mode ==
             nova::NovaLogRecordMode::LOG_RDMA && !options.local_write) {
@@ -3055,19 +3700,32 @@ namespace leveldb {
             // Increment the pending writes counter.
             atomic_memtable->number_of_pending_writes_ += 1;
             atomic_memtable->mutex_.unlock();
-            GenerateLogRecord(options, last_sequence, key, val,
+            GenerateLogRecord(options, records,
                               atomic_memtable->memtable_->memtableid());
             atomic_memtable->mutex_.lock();
             atomic_memtable->number_of_pending_writes_ -= 1;
         }
 
-        atomic_memtable->memtable_->Add(last_sequence, ValueType::kTypeValue,
-                                        key, val);
-        atomic_memtable->nentries_ += 1;
-        if (lookup_index_) {
-            lookup_index_->Insert(key, options.hash,
-                                  atomic_memtable->memtable_->memtableid());
+        for (const auto &record : records) {
+            atomic_memtable->memtable_->Add(record.sequence_number,
+                                            record.type, record.key,
+                                            record.value);
+            if (record.type == kTypeRangeDeletion) {
+                AddRangeTombstone(record.key, record.value,
+                                  record.sequence_number);
+            }
+            if (lookup_index_) {
+                // A single put carries the hash of its key in the options.
+                uint64_t hash = options.hash;
+                if (records.size() > 1) {
+                    nova::str_to_int(record.key.data(), &hash,
+                                     record.key.size());
+                }
+                lookup_index_->Insert(record.key, hash,
+                                      atomic_memtable->memtable_->memtableid());
+            }
         }
+        atomic_memtable->nentries_ += records.size();
         uint32_t full_memtable_id = 0;
         if (atomic_memtable->number_of_pending_writes_ == 0) {
             if (atomic_memtable->memtable_size_ >
@@ -3109,42 +3767,51 @@ namespace leveldb {
         return Status::OK();
     }
 
+    void DBImpl::ReplicateLogRecords(const leveldb::WriteOptions &options,
+                                     const std::vector<leveldb::LevelDBLogRecord> &log_records,
+                                     uint32_t memtable_id) {
+        auto stoc = reinterpret_cast<leveldb::StoCBlockClient *>(options.stoc_client);
+        NOVA_ASSERT(stoc);
+        options.stoc_client->InitiateReplicateLogRecords(
+                nova::LogFileName(dbid_, memtable_id),
+                options.thread_id, dbid_, memtable_id,
+                options.rdma_backing_mem, log_records,
+                options.replicate_log_record_states);
+        stoc->Wait();
+    }
+
     void DBImpl::GenerateLogRecord(const leveldb::WriteOptions &options,
                                    const std::vector<leveldb::LevelDBLogRecord> &log_records,
                                    uint32_t memtable_id) {
         if (nova::NovaConfig::config->log_record_mode ==
             nova::NovaLogRecordMode::LOG_RDMA && !options.local_write) {
-            auto stoc = reinterpret_cast<leveldb::StoCBlockClient *>(options.stoc_client);
-            NOVA_ASSERT(stoc);
-            options.stoc_client->InitiateReplicateLogRecords(
-                    nova::LogFileName(dbid_, memtable_id),
-                    options.thread_id, dbid_, memtable_id,
-                    options.rdma_backing_mem, log_records,
-                    options.replicate_log_record_states);
-            stoc->Wait();
+            if (log_group_commit_ == nullptr) {
+                ReplicateLogRecords(options, log_records, memtable_id);
+                return;
+            }
+            log_group_commit_->Commit(
+                    memtable_id, log_records, options.rdma_backing_mem_size,
+                    [&](const std::vector<LevelDBLogRecord> &batch) {
+                        ReplicateLogRecords(options, batch, memtable_id);
+                    });
         }
     }
 
     void DBImpl::GenerateLogRecord(const WriteOptions &options,
                                    SequenceNumber last_sequence,
                                    const Slice &key, const Slice &val,
-                                   uint32_t memtable_id) {
+                                   uint32_t memtable_id, ValueType type) {
         if (nova::NovaConfig::config->log_record_mode ==
             nova::NovaLogRecordMode::LOG_RDMA && !options.local_write) {
-            auto stoc = reinterpret_cast<leveldb::StoCBlockClient *>(options.stoc_client);
-            NOVA_ASSERT(stoc);
             LevelDBLogRecord log_record = {};
             log_record.sequence_number = last_sequence;
             log_record.key = key;
             log_record.value = val;
+            log_record.type = type;
             NOVA_ASSERT(8 + key.size() + val.size() + 4 + 4 + 1 <=
                         options.rdma_backing_mem_size);
-            options.stoc_client->InitiateReplicateLogRecords(
-                    nova::LogFileName(dbid_, memtable_id),
-                    options.thread_id, dbid_, memtable_id,
-                    options.rdma_backing_mem, {log_record},
-                    options.replicate_log_record_states);
-            stoc->Wait();
+            GenerateLogRecord(options, std::vector<LevelDBLogRecord>{log_record},
+                              memtable_id);
         }
     }
 
@@ -3272,6 +3939,23 @@ namespace leveldb {
             return true;
         } else if (in == "approximate-memory-usage") {
             return true;
+        } else if (in == "lookup-index") {
+            if (!lookup_index_) {
+                return false;
+            }
+            *value = lookup_index_->Stats().DebugString();
+            return true;
+        } else if (in == "log-group-commit") {
+            if (!log_group_commit_) {
+                return false;
+            }
+            *value = log_group_commit_->stats().DebugString();
+            return true;
+        } else if (in == "recovery-stats") {
+            *value = fmt::format("index-rebuild:{} index-rebuild-threads:{} time-to-first-fast-get:{}",
+                                 index_rebuild_duration_, index_rebuild_threads_,
+                                 time_to_first_fast_get_.load());
+            return true;
         }
 
         return false;
@@ -3302,7 +3986,7 @@ namespace leveldb {
     }
 
     Status DB::Delete(const WriteOptions &opt, const Slice &key) {
-        return WriteMemTablePool(opt, key, Slice());
+        return WriteMemTablePool(opt, key, Slice(), kTypeDeletion);
     }
 
     DB::~DB() = default;
@@ -3331,7 +4015,7 @@ namespace leveldb {
         if (options.memtable_type == MemTableType::kMemTablePool) {
             for (int i = 0; i < impl->min_memtables_; i++) {
                 uint32_t memtable_id = impl->memtable_id_seq_.fetch_add(1);
-                MemTable *new_table = new MemTable(impl->internal_comparator_, memtable_id, impl->db_profiler_, true);
+                MemTable *new_table = new MemTable(impl->internal_comparator_, memtable_id, impl->db_profiler_, true, impl->options_.memtable_representation, MemTableHashIndexBuckets(impl->options_));
                 new_table->is_pinned_ = true;
                 NOVA_ASSERT(memtable_id < MAX_LIVE_MEMTABLES);
                 impl->versions_->mid_table_mapping_[memtable_id]->SetMemTable(INIT_GEN_ID, new_table);
@@ -3356,7 +4040,7 @@ namespace leveldb {
             uint32_t slot_id = 0;
             for (int i = 0; i < options.num_memtable_partitions; i++) {
                 uint64_t memtable_id = impl->memtable_id_seq_.fetch_add(1);
-                MemTable *table = new MemTable(impl->internal_comparator_, memtable_id, impl->db_profiler_, true);
+                MemTable *table = new MemTable(impl->internal_comparator_, memtable_id, impl->db_profiler_, true, impl->options_.memtable_representation, MemTableHashIndexBuckets(impl->options_));
                 NOVA_ASSERT(memtable_id < MAX_LIVE_MEMTABLES);
                 impl->versions_->mid_table_mapping_[memtable_id]->SetMemTable(INIT_GEN_ID, table);
                 impl->partitioned_active_memtables_[i] = new MemTablePartition;
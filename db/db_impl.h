@@ -33,6 +33,8 @@
 #include "subrange_manager.h"
 #include "compaction.h"
 #include "lookup_index.h"
+#include "log_group_commit.h"
+#include "range_tombstone.h"
 #include "range_index.h"
 
 #include "log/log_recovery.h"
@@ -75,20 +77,37 @@ namespace leveldb {
 
         Status Delete(const WriteOptions &, const Slice &key) override;
 
+        Status DeleteRange(const WriteOptions &options, const Slice &start,
+                           const Slice &end) override;
+
+        // Write a put, a deletion, or a range deletion.
+        Status WriteRecord(const WriteOptions &options, const Slice &key,
+                           const Slice &val, ValueType type);
+
         Status WriteMemTablePool(const WriteOptions &options, const Slice &key,
-                                 const Slice &val) override;
+                                 const Slice &val,
+                                 ValueType type = kTypeValue) override;
 
         Status WriteStaticPartition(const WriteOptions &options,
                                     const Slice &key,
-                                    const Slice &val);
+                                    const Slice &val,
+                                    ValueType type = kTypeValue);
 
         Status WriteSubrange(const WriteOptions &options,
                              const Slice &key,
-                             const Slice &val);
+                             const Slice &val,
+                             ValueType type = kTypeValue);
+
+        Status Write(const WriteOptions &options, WriteBatch *updates) override;
 
         Status Get(const ReadOptions &options, const Slice &key,
                    std::string *value) override;
 
+        void MultiGet(const ReadOptions &options,
+                      const std::vector<Slice> &keys,
+                      std::vector<std::string> *values,
+                      std::vector<Status> *statuses) override;
+
         void TestCompact(EnvBGThread *bg_thread,
                          const std::vector<EnvBGTask> &tasks) override;
 
@@ -126,12 +145,24 @@ namespace leveldb {
         void GenerateLogRecord(const WriteOptions &options,
                                SequenceNumber last_sequence,
                                const Slice &key, const Slice &val,
-                               uint32_t memtable_id);
+                               uint32_t memtable_id,
+                               ValueType type = kTypeValue);
+
+        // The live range tombstones of this database.
+        RangeTombstones *range_tombstones() { return range_tombstones_; }
+
+        // Register a range tombstone replayed from a log file.
+        void RecoverRangeTombstone(const Slice &start, const Slice &end,
+                                   SequenceNumber sequence);
 
         void GenerateLogRecord(const WriteOptions &options,
                                const std::vector<LevelDBLogRecord> &log_records,
                                uint32_t memtable_id);
 
+        void ReplicateLogRecords(const WriteOptions &options,
+                                 const std::vector<LevelDBLogRecord> &log_records,
+                                 uint32_t memtable_id);
+
         void StartCoordinatedCompaction();
 
         void StopCoordinatedCompaction();
@@ -170,6 +201,10 @@ namespace leveldb {
 
         std::atomic_bool is_loading_db_;
 
+        // Point the lookup index at the memtable that replays the key from
+        // its log file.
+        void RecoverLookupIndexEntry(const Slice &key, uint32_t memtable_id);
+
     private:
         void ObtainStoCFilesOfSSTable(std::vector<std::string> *files_to_delete,
                                       std::unordered_map<uint32_t, std::vector<SSTableStoCFilePair>> *server_pairs,
@@ -181,6 +216,24 @@ namespace leveldb {
         Status GetWithRangeIndex(const ReadOptions &options, const Slice &key,
                                  std::string *value);
 
+        // Resumes options.deferred_block_reads->suspended.
+        Status ResumeGet(const ReadOptions &options, const Slice &key,
+                         std::string *value);
+
+        // Searches the L0 SSTables of "get" and then the SSTables at L1 and
+        // above, starting where "get" stopped. Returns Status::Incomplete
+        // and hands "get" to options.deferred_block_reads if it stops on a
+        // remote data block. Otherwise, releases the references of "get".
+        Status GetFromSSTables(const ReadOptions &options, const Slice &key,
+                               SuspendedGet *get, std::string *value);
+
+        // Rebuild the lookup index from the L0 SSTables using
+        // options_.num_recovery_thread threads. l0_files[i] belongs to
+        // memtable i + 1.
+        void RebuildLookupIndex(const std::vector<FileMetaData *> &l0_files);
+
+        void RecordFirstFastGet();
+
         std::atomic_bool start_compaction_;
         std::atomic_bool start_coordinated_compaction_;
         std::atomic_bool terminate_coordinated_compaction_;
@@ -337,8 +390,18 @@ namespace leveldb {
 
         // key -> memtable-id.
         LookupIndex *lookup_index_ = nullptr;
+        // nullptr if group commit of log records is disabled.
+        LogGroupCommit *log_group_commit_ = nullptr;
+        RangeTombstones *range_tombstones_ = nullptr;
         RangeIndexManager *range_index_manager_ = nullptr;
 
+        // Recovery stats.
+        timeval recovery_start_ = {};
+        uint64_t index_rebuild_duration_ = 0;
+        uint32_t index_rebuild_threads_ = 0;
+        std::atomic_bool wait_for_first_fast_get_;
+        std::atomic<uint64_t> time_to_first_fast_get_;
+
         // memtable pool.
         std::vector<AtomicMemTable *> active_memtables_;
         // partitioned memtables.
@@ -371,6 +434,48 @@ namespace leveldb {
                                   const leveldb::Slice &value,
                                   uint32_t partition_id,
                                   bool should_wait, uint64_t last_sequence,
+                                  SubRange *subrange,
+                                  ValueType type = kTypeValue);
+
+        // Register a range tombstone that is written to a memtable.
+        void AddRangeTombstone(const Slice &start, const Slice &end,
+                               SequenceNumber sequence);
+
+        // Set the bottommost flag and the range tombstones of a major
+        // compaction.
+        void SetupRangeTombstones(Version *current, CompactionState *state);
+
+        // Returns the range tombstones that the compaction may drop: No
+        // SSTable outside the compaction and no unflushed memtable may
+        // contain a version that they delete, and no snapshot needs them.
+        std::vector<RangeTombstone>
+        ObsoleteRangeTombstones(Version *current, CompactionState *state,
+                                const std::vector<RangeTombstones::Entry> &tombstones);
+
+        // Write a group of records to the same memtable. The records are
+        // replicated together.
+        bool WriteStaticPartition(const leveldb::WriteOptions &options,
+                                  const std::vector<LevelDBLogRecord> &records,
+                                  uint32_t partition_id,
+                                  bool should_wait,
+                                  SubRange *subrange);
+
+        // Write a group of records to the same memtable of the pool. The
+        // records are replicated together.
+        Status WriteMemTablePool(const WriteOptions &options,
+                                 const std::vector<LevelDBLogRecord> &records);
+
+        // Return the active memtable of the partition and create one if
+        // necessary. Returns nullptr and releases the partition mutex if all
+        // memtables are full and should_wait is false.
+        // REQUIRES: The partition mutex is held.
+        MemTable *SelectActiveMemTable(const leveldb::WriteOptions &options,
+                                       uint32_t partition_id,
+                                       bool should_wait, SubRange *subrange,
+                                       int *imm_slot);
+
+        void ScheduleFlushImmSlot(const leveldb::WriteOptions &options,
+                                  uint32_t partition_id, int imm_slot,
                                   SubRange *subrange);
 
         StoCWritableFileClient *manifest_file_ = nullptr;
@@ -4,7 +4,6 @@
 
 #include "db/db_iter.h"
 
-#include "db/db_impl.h"
 #include "db/dbformat.h"
 #include "db/filename.h"
 #include "leveldb/env.h"
@@ -47,9 +46,10 @@ namespace leveldb {
                 kForward, kReverse
             };
 
-            DBIter(DBImpl *db, const Comparator *cmp, Iterator *iter, SequenceNumber s, uint32_t seed,
+            DBIter(std::shared_ptr<const FragmentedRangeTombstones> range_tombstones,
+                   const Comparator *cmp, Iterator *iter, SequenceNumber s, uint32_t seed,
                    const nova::RangePartition &range_partition)
-                    : db_(db),
+                    : range_tombstones_(std::move(range_tombstones)),
                       user_comparator_(cmp),
                       iter_(iter),
                       sequence_(s),
@@ -109,6 +109,13 @@ namespace leveldb {
 
             bool ParseKey(ParsedInternalKey *key);
 
+            // Returns true if a range tombstone visible to this iterator
+            // deletes "ikey".
+            bool IsDeletedByRange(const ParsedInternalKey &ikey) const {
+                return range_tombstones_->IsDeleted(ikey.user_key,
+                                                    ikey.sequence, sequence_);
+            }
+
             inline void SaveKey(const Slice &k, std::string *dst) {
                 dst->assign(k.data(), k.size());
             }
@@ -127,7 +134,7 @@ namespace leveldb {
                 return rnd_.Uniform(2 * config::kReadBytesPeriod);
             }
 
-            DBImpl *db_;
+            const std::shared_ptr<const FragmentedRangeTombstones> range_tombstones_;
             const Comparator *const user_comparator_;
             Iterator *const iter_;
             SequenceNumber const sequence_;
@@ -198,6 +205,10 @@ namespace leveldb {
                 // avoid checking current key.
                 if (!GoToNextEntry(&saved_ikey_) && iter_->Valid()) {
                     iter_->SkipToNextUserKey(saved_ikey_);
+                    if (iter_->Valid()) {
+                        // The next key may be deleted.
+                        FindNextUserEntry(false, &saved_ikey_);
+                    }
                 }
                 if (!iter_->Valid()) {
                     valid_ = false;
@@ -217,9 +228,15 @@ namespace leveldb {
                 ParsedInternalKey ikey;
                 if (ParseKey(&ikey) && ikey.sequence <= sequence_) {
                     switch (ikey.type) {
+                        case kTypeDeletion:
+                        case kTypeRangeDeletion:
+                            // Let FindNextUserEntry skip the deleted key.
+                            break;
                         case kTypeValue:
                             if (user_comparator_->Compare(ikey.user_key, ExtractUserKey(*current_key)) <= 0) {
                                 // Entry hidden
+                            } else if (IsDeletedByRange(ikey)) {
+                                // Let FindNextUserEntry skip the key.
                             } else {
                                 // The next unique key. DONE. :)
                                 valid_ = true;
@@ -245,14 +262,19 @@ namespace leveldb {
                 if (ParseKey(&ikey) && ikey.sequence <= sequence_) {
                     switch (ikey.type) {
                         case kTypeDeletion:
+                        case kTypeRangeDeletion:
                             // Arrange to skip all upcoming entries for this key since
                             // they are hidden by this deletion.
-                            SaveKey(ikey.user_key, skip);
+                            SaveKey(iter_->key(), skip);
                             skipping = true;
                             break;
                         case kTypeValue:
                             if (skipping && user_comparator_->Compare(ikey.user_key, ExtractUserKey(*skip)) <= 0) {
                                 // Entry hidden
+                            } else if (IsDeletedByRange(ikey)) {
+                                // Same as a deletion.
+                                SaveKey(iter_->key(), skip);
+                                skipping = true;
                             } else {
                                 valid_ = true;
                                 saved_ikey_.clear();
@@ -307,6 +329,10 @@ namespace leveldb {
                             break;
                         }
                         value_type = ikey.type;
+                        if (value_type == kTypeRangeDeletion ||
+                            (value_type == kTypeValue && IsDeletedByRange(ikey))) {
+                            value_type = kTypeDeletion;
+                        }
                         if (value_type == kTypeDeletion) {
                             saved_ikey_.clear();
                             ClearSavedValue();
@@ -370,9 +396,11 @@ namespace leveldb {
     }  // anonymous namespace
 
     Iterator *
-    NewDBIterator(DBImpl *db, const Comparator *user_key_comparator, Iterator *internal_iter, SequenceNumber sequence,
+    NewDBIterator(std::shared_ptr<const FragmentedRangeTombstones> range_tombstones,
+                  const Comparator *user_key_comparator, Iterator *internal_iter, SequenceNumber sequence,
                   uint32_t seed, const nova::RangePartition &range_partition) {
-        return new DBIter(db, user_key_comparator, internal_iter, sequence, seed, range_partition);
+        return new DBIter(std::move(range_tombstones), user_key_comparator, internal_iter, sequence, seed,
+                          range_partition);
     }
 
 }  // namespace leveldb
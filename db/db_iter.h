@@ -6,19 +6,21 @@
 #define STORAGE_LEVELDB_DB_DB_ITER_H_
 
 #include <stdint.h>
+#include <memory>
 
 #include "db/dbformat.h"
+#include "db/range_tombstone.h"
 #include "leveldb/db.h"
 #include "common/nova_common.h"
 
 namespace leveldb {
 
-    class DBImpl;
-
 // Return a new iterator that converts internal keys (yielded by
 // "*internal_iter") that were live at the specified "sequence" number
-// into appropriate user keys.
-    Iterator *NewDBIterator(DBImpl *db, const Comparator *user_key_comparator,
+// into appropriate user keys. It skips the versions that "range_tombstones"
+// deletes.
+    Iterator *NewDBIterator(std::shared_ptr<const FragmentedRangeTombstones> range_tombstones,
+                            const Comparator *user_key_comparator,
                             Iterator *internal_iter, SequenceNumber sequence,
                             uint32_t seed, const nova::RangePartition &range_partition);
 
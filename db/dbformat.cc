@@ -56,6 +56,14 @@ namespace leveldb {
             const auto &sr = subranges[i];
             msg_size += sr.EncodeForCompaction(sendbuf + msg_size, i);
         }
+        sendbuf[msg_size] = bottommost ? 1 : 0;
+        msg_size += 1;
+        for (auto tombstones : {&range_tombstones, &obsolete_range_tombstones}) {
+            msg_size += EncodeFixed32(sendbuf + msg_size, tombstones->size());
+            for (const auto &tombstone : *tombstones) {
+                msg_size += tombstone.Encode(sendbuf + msg_size);
+            }
+        }
         return msg_size;
     }
 
@@ -91,6 +99,18 @@ namespace leveldb {
             NOVA_ASSERT(sr.DecodeForCompaction(&input));
             subranges.push_back(std::move(sr));
         }
+        NOVA_ASSERT(!input.empty());
+        bottommost = input[0] == 1;
+        input.remove_prefix(1);
+        for (auto tombstones : {&range_tombstones, &obsolete_range_tombstones}) {
+            uint32_t num_tombstones = 0;
+            NOVA_ASSERT(DecodeFixed32(&input, &num_tombstones));
+            for (int i = 0; i < num_tombstones; i++) {
+                RangeTombstone tombstone;
+                NOVA_ASSERT(tombstone.Decode(&input));
+                tombstones->push_back(std::move(tombstone));
+            }
+        }
     }
 
     uint32_t FileMetaData::Encode(char *buf) const {
@@ -132,8 +152,11 @@ namespace leveldb {
                 msg_size += StoCBlockHandle::HandleSize();
             }
         }
-        parity_block_handle.EncodeHandle(dst + msg_size);
-        msg_size += StoCBlockHandle::HandleSize();
+        msg_size += EncodeFixed32(dst + msg_size, parity_block_handles.size());
+        for (auto &handle : parity_block_handles) {
+            handle.EncodeHandle(dst + msg_size);
+            msg_size += StoCBlockHandle::HandleSize();
+        }
         return msg_size;
     }
 
@@ -189,7 +212,7 @@ namespace leveldb {
                GetInternalKey(input, &largest, copy) &&
                DecodeFixed64(input, &flush_timestamp) &&
                DecodeFixed32(input, &level) && DecodeMemTableIds(input) && DecodeReplicas(input) &&
-               StoCBlockHandle::DecodeHandle(input, &parity_block_handle);
+               StoCBlockHandle::DecodeHandles(input, &parity_block_handles);
     }
 
     uint32_t ReplicationPair::Encode(char *buf) const {
@@ -212,6 +235,24 @@ namespace leveldb {
                            replica_id, dest_stoc_file_id);
     }
 
+    uint32_t RangeTombstone::Encode(char *buf) const {
+        uint32_t msg_size = 0;
+        msg_size += EncodeStr(buf + msg_size, start);
+        msg_size += EncodeStr(buf + msg_size, end);
+        msg_size += EncodeFixed64(buf + msg_size, sequence);
+        return msg_size;
+    }
+
+    bool RangeTombstone::Decode(Slice *ptr) {
+        return DecodeStr(ptr, &start) && DecodeStr(ptr, &end) &&
+               DecodeFixed64(ptr, &sequence);
+    }
+
+    std::string RangeTombstone::DebugString() const {
+        return fmt::format("[{},{})@{}", EscapeString(start), EscapeString(end),
+                           sequence);
+    }
+
     bool DecodeInternalFileType(Slice *ptr, FileInternalType *internal_type) {
         char type = (*ptr)[0];
         bool success = true;
@@ -305,7 +346,10 @@ namespace leveldb {
             }
         }
         r.append(" parity:");
-        r.append(parity_block_handle.DebugString());
+        for (auto &parity : parity_block_handles) {
+            r.append(parity.DebugString());
+            r.append(" ");
+        }
         return r;
     }
 
@@ -455,6 +499,13 @@ namespace leveldb {
         return user_policy_->KeyMayMatch(ExtractUserKey(key), f);
     }
 
+    void InternalFilterPolicy::KeyMayMatchBatch(const Slice &key,
+                                                const Slice *filters, int n,
+                                                bool *results) const {
+        user_policy_->KeyMayMatchBatch(ExtractUserKey(key), filters, n,
+                                       results);
+    }
+
     LookupKey::LookupKey(const Slice &user_key, SequenceNumber s) {
         size_t usize = user_key.size();
         size_t needed = usize + 13;  // A conservative estimate
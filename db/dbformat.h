@@ -62,7 +62,7 @@ namespace leveldb {
 // and the value type is embedded as the low 8 bits in the sequence
 // number in internal keys, we need to use the highest-numbered
 // ValueType, not the lowest).
-    static const ValueType kValueTypeForSeek = kTypeValue;
+    static const ValueType kValueTypeForSeek = kTypeRangeDeletion;
 
 // We leave eight bits empty at the bottom so a type and sequence#
 // can be packed together into 64-bits.
@@ -88,6 +88,12 @@ namespace leveldb {
         return Slice(internal_key.data(), internal_key.size() - 8);
     }
 
+    inline ValueType ExtractValueType(const Slice &internal_key) {
+        assert(internal_key.size() >= 8);
+        return static_cast<ValueType>(
+                static_cast<unsigned char>(internal_key[internal_key.size() - 8]));
+    }
+
 // A comparator for internal keys that uses a specified comparator for
 // the user key portion and breaks ties by decreasing sequence number.
     class InternalKeyComparator : public Comparator {
@@ -127,6 +133,9 @@ namespace leveldb {
         CreateFilter(const Slice *keys, int n, std::string *dst) const override;
 
         bool KeyMayMatch(const Slice &key, const Slice &filter) const override;
+
+        void KeyMayMatchBatch(const Slice &key, const Slice *filters, int n,
+                              bool *results) const override;
     };
 
     inline int InternalKeyComparator::Compare(const InternalKey &a,
@@ -143,7 +152,7 @@ namespace leveldb {
         result->sequence = num >> 8;
         result->type = static_cast<ValueType>(c);
         result->user_key = Slice(internal_key.data(), n - 8);
-        return (c <= static_cast<uint8_t>(kTypeValue));
+        return (c <= static_cast<uint8_t>(kTypeRangeDeletion));
     }
 
 // A helper class useful for DBImpl::Get()
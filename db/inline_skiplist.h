@@ -0,0 +1,349 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+// A skiplist for memtables whose user keys are decimal integers.
+// Each node stores the user key as a uint64 and the sequence number/type tag
+// inline, so searches compare two integers instead of decoding the entry and
+// calling the comparator. The tower of next pointers is laid out right before
+// the key so that the links and the key of a node with height <= 6 share one
+// cache line. The memtable entry follows the node in the same allocation.
+//
+// Thread safety is the same as SkipList: writes require external
+// synchronization and reads proceed without locks.
+//
+// REQUIRES: The user comparator orders keys by nova::str_to_int, like
+// YCSBKeyComparator.
+
+#ifndef LEVELDB_INLINE_SKIPLIST_H
+#define LEVELDB_INLINE_SKIPLIST_H
+
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include "common/nova_console_logging.h"
+#include "common/nova_common.h"
+
+#include "util/arena.h"
+#include "util/random.h"
+
+namespace leveldb {
+
+    class InlineSkipList {
+    private:
+        struct Node;
+
+    public:
+        explicit InlineSkipList(Arena *arena);
+
+        InlineSkipList(const InlineSkipList &) = delete;
+
+        InlineSkipList &operator=(const InlineSkipList &) = delete;
+
+        // Allocate a node for the key and return its "entry_size" bytes of
+        // payload. The caller fills the payload and then calls Insert().
+        char *AllocateEntry(uint64_t user_key, uint64_t tag, size_t entry_size);
+
+        // Insert the entry returned by AllocateEntry.
+        // REQUIRES: nothing with the same key and tag is in the list.
+        void Insert(const char *entry);
+
+        class Iterator {
+        public:
+            explicit Iterator(const InlineSkipList *list,
+                              uint32_t sampled_puts = 0);
+
+            bool Valid() const { return node_ != nullptr; }
+
+            // Returns the payload of the current entry.
+            // REQUIRES: Valid()
+            const char *entry() const;
+
+            uint64_t user_key() const;
+
+            uint64_t tag() const;
+
+            void Next();
+
+            void Prev();
+
+            // Advance to the first entry at or after (user_key, tag).
+            void Seek(uint64_t user_key, uint64_t tag);
+
+            void SeekToFirst();
+
+            void SeekToLast();
+
+        private:
+            const InlineSkipList *list_;
+            Node *node_;
+            int iter_level_;
+            uint32_t sampled_puts_;
+        };
+
+    private:
+        enum {
+            kMaxHeight = 12
+        };
+
+        inline int GetMaxHeight() const {
+            return max_height_.load(std::memory_order_relaxed);
+        }
+
+        Node *AllocateNode(uint64_t user_key, uint64_t tag, int height,
+                           size_t entry_size);
+
+        int RandomHeight();
+
+        // Return true if (user_key, tag) sorts after node "n".
+        // Keys ascend and tags descend, like InternalKeyComparator.
+        static bool KeyIsAfterNode(uint64_t user_key, uint64_t tag, Node *n);
+
+        Node *FindGreaterOrEqual(uint64_t user_key, uint64_t tag,
+                                 Node **prev) const;
+
+        Node *FindLessThan(uint64_t user_key, uint64_t tag) const;
+
+        Node *FindLast() const;
+
+        Arena *const arena_;
+        Node *const head_;
+        std::atomic<int> max_height_;
+        std::atomic_int_fast32_t nputs_per_level[kMaxHeight];
+        Random rnd_;
+    };
+
+    // The links of level i > 0 are stored at next_[-i], before the node.
+    struct InlineSkipList::Node {
+        std::atomic<Node *> next_[1];
+        uint64_t user_key;
+        uint64_t tag;
+
+        const char *Entry() const {
+            return reinterpret_cast<const char *>(this + 1);
+        }
+
+        Node *Next(int n) {
+            return (&next_[0] - n)->load(std::memory_order_acquire);
+        }
+
+        void SetNext(int n, Node *x) {
+            (&next_[0] - n)->store(x, std::memory_order_release);
+        }
+
+        Node *NoBarrier_Next(int n) {
+            return (&next_[0] - n)->load(std::memory_order_relaxed);
+        }
+
+        void NoBarrier_SetNext(int n, Node *x) {
+            (&next_[0] - n)->store(x, std::memory_order_relaxed);
+        }
+
+        // Before the node is inserted, next_[0] holds its height.
+        void StashHeight(int height) {
+            next_[0].store(reinterpret_cast<Node *>(height),
+                           std::memory_order_relaxed);
+        }
+
+        int UnstashHeight() const {
+            return static_cast<int>(reinterpret_cast<intptr_t>(
+                    next_[0].load(std::memory_order_relaxed)));
+        }
+    };
+
+    inline bool
+    InlineSkipList::KeyIsAfterNode(uint64_t user_key, uint64_t tag, Node *n) {
+        return (n != nullptr) &&
+               (n->user_key < user_key ||
+                (n->user_key == user_key && n->tag > tag));
+    }
+
+    inline InlineSkipList::InlineSkipList(Arena *arena)
+            : arena_(arena),
+              head_(AllocateNode(0, 0, kMaxHeight, 0)),
+              max_height_(1),
+              rnd_(0xdeadbeef) {
+        for (int i = 0; i < kMaxHeight; i++) {
+            head_->SetNext(i, nullptr);
+            nputs_per_level[i] = 0;
+        }
+    }
+
+    inline InlineSkipList::Node *
+    InlineSkipList::AllocateNode(uint64_t user_key, uint64_t tag, int height,
+                                 size_t entry_size) {
+        size_t prefix = sizeof(std::atomic<Node *>) * (height - 1);
+        char *mem = arena_->AllocateCacheLineAware(
+                prefix + sizeof(Node) + entry_size, prefix + sizeof(Node));
+        Node *x = reinterpret_cast<Node *>(mem + prefix);
+        x->user_key = user_key;
+        x->tag = tag;
+        return x;
+    }
+
+    inline char *
+    InlineSkipList::AllocateEntry(uint64_t user_key, uint64_t tag,
+                                  size_t entry_size) {
+        int height = RandomHeight();
+        Node *x = AllocateNode(user_key, tag, height, entry_size);
+        x->StashHeight(height);
+        return const_cast<char *>(x->Entry());
+    }
+
+    inline int InlineSkipList::RandomHeight() {
+        // Increase height with probability 1 in kBranching
+        static const unsigned int kBranching = 4;
+        int height = 1;
+        while (height < kMaxHeight && ((rnd_.Next() % kBranching) == 0)) {
+            height++;
+        }
+        return height;
+    }
+
+    inline InlineSkipList::Node *
+    InlineSkipList::FindGreaterOrEqual(uint64_t user_key, uint64_t tag,
+                                       Node **prev) const {
+        Node *x = head_;
+        int level = GetMaxHeight() - 1;
+        while (true) {
+            Node *next = x->Next(level);
+            if (next != nullptr) {
+                // The tower and key of the node after next share a cache line.
+                __builtin_prefetch(next->NoBarrier_Next(level));
+            }
+            if (KeyIsAfterNode(user_key, tag, next)) {
+                x = next;
+            } else {
+                if (prev != nullptr) prev[level] = x;
+                if (level == 0) {
+                    return next;
+                }
+                level--;
+            }
+        }
+    }
+
+    inline InlineSkipList::Node *
+    InlineSkipList::FindLessThan(uint64_t user_key, uint64_t tag) const {
+        Node *x = head_;
+        int level = GetMaxHeight() - 1;
+        while (true) {
+            Node *next = x->Next(level);
+            if (KeyIsAfterNode(user_key, tag, next)) {
+                x = next;
+            } else {
+                if (level == 0) {
+                    return x;
+                }
+                level--;
+            }
+        }
+    }
+
+    inline InlineSkipList::Node *InlineSkipList::FindLast() const {
+        Node *x = head_;
+        int level = GetMaxHeight() - 1;
+        while (true) {
+            Node *next = x->Next(level);
+            if (next == nullptr) {
+                if (level == 0) {
+                    return x;
+                }
+                level--;
+            } else {
+                x = next;
+            }
+        }
+    }
+
+    inline void InlineSkipList::Insert(const char *entry) {
+        Node *x = reinterpret_cast<Node *>(const_cast<char *>(entry)) - 1;
+        int height = x->UnstashHeight();
+        Node *prev[kMaxHeight];
+        Node *next = FindGreaterOrEqual(x->user_key, x->tag, prev);
+        // Our data structure does not allow duplicate insertion
+        assert(next == nullptr || next->user_key != x->user_key ||
+               next->tag != x->tag);
+
+        if (height > GetMaxHeight()) {
+            for (int i = GetMaxHeight(); i < height; i++) {
+                prev[i] = head_;
+            }
+            // See SkipList::Insert for why no synchronization is needed.
+            max_height_.store(height, std::memory_order_relaxed);
+        }
+        for (int i = 0; i < height; i++) {
+            x->NoBarrier_SetNext(i, prev[i]->NoBarrier_Next(i));
+            prev[i]->SetNext(i, x);
+            nputs_per_level[i].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    inline InlineSkipList::Iterator::Iterator(const InlineSkipList *list,
+                                              uint32_t sampled_puts)
+            : list_(list), node_(nullptr), iter_level_(0),
+              sampled_puts_(sampled_puts) {
+        if (sampled_puts_ > 0) {
+            iter_level_ = kMaxHeight - 1;
+            while (iter_level_ >= 0) {
+                uint32_t nputs = list_->nputs_per_level[iter_level_].load(
+                        std::memory_order_relaxed);
+                if (nputs > sampled_puts_) {
+                    break;
+                }
+                iter_level_ -= 1;
+            }
+            if (iter_level_ < 0) {
+                iter_level_ = 0;
+            }
+        }
+    }
+
+    inline const char *InlineSkipList::Iterator::entry() const {
+        assert(Valid());
+        return node_->Entry();
+    }
+
+    inline uint64_t InlineSkipList::Iterator::user_key() const {
+        assert(Valid());
+        return node_->user_key;
+    }
+
+    inline uint64_t InlineSkipList::Iterator::tag() const {
+        assert(Valid());
+        return node_->tag;
+    }
+
+    inline void InlineSkipList::Iterator::Next() {
+        assert(Valid());
+        node_ = node_->Next(iter_level_);
+    }
+
+    inline void InlineSkipList::Iterator::SeekToFirst() {
+        node_ = list_->head_->Next(iter_level_);
+    }
+
+    inline void InlineSkipList::Iterator::Prev() {
+        NOVA_ASSERT(sampled_puts_ == 0);
+        assert(Valid());
+        node_ = list_->FindLessThan(node_->user_key, node_->tag);
+        if (node_ == list_->head_) {
+            node_ = nullptr;
+        }
+    }
+
+    inline void InlineSkipList::Iterator::Seek(uint64_t user_key,
+                                               uint64_t tag) {
+        NOVA_ASSERT(sampled_puts_ == 0);
+        node_ = list_->FindGreaterOrEqual(user_key, tag, nullptr);
+    }
+
+    inline void InlineSkipList::Iterator::SeekToLast() {
+        NOVA_ASSERT(sampled_puts_ == 0);
+        node_ = list_->FindLast();
+        if (node_ == list_->head_) {
+            node_ = nullptr;
+        }
+    }
+}
+
+#endif //LEVELDB_INLINE_SKIPLIST_H
@@ -0,0 +1,106 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "log_group_commit.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fmt/core.h>
+
+#include "common/nova_common.h"
+
+namespace leveldb {
+
+    LogGroupCommit::LogGroupCommit(uint32_t max_batch_bytes,
+                                   uint64_t max_delay_us)
+            : max_batch_bytes_(max_batch_bytes), max_delay_us_(max_delay_us),
+              batches_(0), records_(0) {
+    }
+
+    void LogGroupCommit::Commit(uint32_t memtable_id,
+                                const std::vector<LevelDBLogRecord> &log_records,
+                                uint32_t max_bytes,
+                                const std::function<void(
+                                        const std::vector<LevelDBLogRecord> &)> &replicate) {
+        Shard &shard = shards_[memtable_id % kNumShards];
+        Writer w;
+        w.memtable_id = memtable_id;
+        w.log_records = &log_records;
+        w.size = nova::LogRecordsSize(log_records);
+
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        shard.writers.push_back(&w);
+        shard.pending_bytes += w.size;
+        shard.leader_cv.notify_one();
+        while (!w.done && &w != shard.writers.front()) {
+            w.cv.wait(lock);
+        }
+        if (w.done) {
+            return;
+        }
+
+        // This writer is the leader.
+        const uint32_t limit = std::min(max_batch_bytes_, max_bytes);
+        if (max_delay_us_ > 0) {
+            shard.leader_cv.wait_for(lock,
+                                     std::chrono::microseconds(max_delay_us_),
+                                     [&] {
+                                         return shard.pending_bytes >= limit;
+                                     });
+        }
+        std::vector<LevelDBLogRecord> batch;
+        uint32_t batch_size = w.size;
+        uint32_t group_size = 1;
+        for (auto it = shard.writers.begin() + 1;
+             it != shard.writers.end(); it++) {
+            Writer *follower = *it;
+            if (follower->memtable_id != memtable_id ||
+                batch_size + follower->size > limit) {
+                break;
+            }
+            if (batch.empty()) {
+                batch = log_records;
+            }
+            // The records stay valid since their writer is blocked.
+            batch.insert(batch.end(), follower->log_records->begin(),
+                         follower->log_records->end());
+            batch_size += follower->size;
+            group_size++;
+        }
+        lock.unlock();
+
+        replicate(batch.empty() ? log_records : batch);
+        batches_.fetch_add(1, std::memory_order_relaxed);
+        records_.fetch_add(batch.empty() ? log_records.size() : batch.size(),
+                           std::memory_order_relaxed);
+
+        lock.lock();
+        for (uint32_t i = 0; i < group_size; i++) {
+            Writer *writer = shard.writers.front();
+            shard.writers.pop_front();
+            shard.pending_bytes -= writer->size;
+            if (writer != &w) {
+                writer->done = true;
+                writer->cv.notify_one();
+            }
+        }
+        // Hand over to the next leader.
+        if (!shard.writers.empty()) {
+            shard.writers.front()->cv.notify_one();
+        }
+    }
+
+    std::string LogGroupCommitStats::DebugString() const {
+        return fmt::format("batches:{} records:{} records-per-batch:{:.2f}",
+                           batches, records,
+                           batches == 0 ? 0.0 : (double) records / batches);
+    }
+
+    LogGroupCommitStats LogGroupCommit::stats() const {
+        LogGroupCommitStats stats;
+        stats.batches = batches_.load(std::memory_order_relaxed);
+        stats.records = records_.load(std::memory_order_relaxed);
+        return stats;
+    }
+}
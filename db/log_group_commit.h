@@ -0,0 +1,77 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+// Group commit of log records that are replicated to StoCs with RDMA.
+// Concurrent writers to the same memtable queue up. The writer at the head of
+// the queue becomes the leader. It waits up to max_delay_us for more writers,
+// combines the records of the writers behind it into one batch of at most
+// max_batch_bytes, and replicates the batch with its own StoC client and RDMA
+// buffer, i.e., one RDMA WRITE per log replica. All writers of the batch
+// return once it is replicated.
+
+#ifndef LEVELDB_LOG_GROUP_COMMIT_H
+#define LEVELDB_LOG_GROUP_COMMIT_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "leveldb/stoc_client.h"
+
+namespace leveldb {
+
+    struct LogGroupCommitStats {
+        uint64_t batches = 0;
+        uint64_t records = 0;
+
+        std::string DebugString() const;
+    };
+
+    class LogGroupCommit {
+    public:
+        LogGroupCommit(uint32_t max_batch_bytes, uint64_t max_delay_us);
+
+        // Blocks until "log_records" are replicated. The leader of a batch
+        // calls "replicate" with the records of all its writers. "max_bytes"
+        // is the size of the caller's RDMA buffer.
+        void Commit(uint32_t memtable_id,
+                    const std::vector<LevelDBLogRecord> &log_records,
+                    uint32_t max_bytes,
+                    const std::function<void(
+                            const std::vector<LevelDBLogRecord> &)> &replicate);
+
+        LogGroupCommitStats stats() const;
+
+    private:
+        struct Writer {
+            uint32_t memtable_id = 0;
+            const std::vector<LevelDBLogRecord> *log_records = nullptr;
+            uint32_t size = 0;
+            bool done = false;
+            std::condition_variable cv;
+        };
+
+        // Writers of a memtable always queue in the same shard.
+        struct Shard {
+            std::mutex mutex;
+            std::deque<Writer *> writers;
+            uint64_t pending_bytes = 0;
+            // Wakes up a leader that waits for more writers.
+            std::condition_variable leader_cv;
+        };
+
+        static const uint32_t kNumShards = 64;
+
+        const uint32_t max_batch_bytes_;
+        const uint64_t max_delay_us_;
+        Shard shards_[kNumShards];
+        std::atomic<uint64_t> batches_;
+        std::atomic<uint64_t> records_;
+    };
+}
+
+#endif //LEVELDB_LOG_GROUP_COMMIT_H
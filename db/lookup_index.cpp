@@ -6,59 +6,386 @@
 
 #include "lookup_index.h"
 
+#include <thread>
+#include <unordered_map>
 #include <fmt/core.h>
 #include "common/nova_console_logging.h"
 #include "util/coding.h"
 
 namespace leveldb {
+    namespace {
+        // Grow the table once it is more than 3/4 full.
+        const uint64_t kMaxLoadFactorNumerator = 3;
+        const uint64_t kMaxLoadFactorDenominator = 4;
+        const uint64_t kMinCapacity = 1024;
 
-    LookupIndex::LookupIndex(uint32_t size) : size_(size) {
-        table_locator_ = new TableLocation[size_];
+        uint64_t Mix(uint64_t hash) {
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccdULL;
+            hash ^= hash >> 33;
+            hash *= 0xc4ceb9fe1a85ec53ULL;
+            hash ^= hash >> 33;
+            return hash;
+        }
+
+        // Never 0 so that an empty tagged id never matches.
+        uint64_t Fingerprint(uint64_t mixed) {
+            return (mixed >> 32) | 1;
+        }
+
+        uint64_t Tag(uint64_t fingerprint, uint32_t memtableid) {
+            return (fingerprint << 32) | memtableid;
+        }
+
+        uint64_t RoundUpToPowerOfTwo(uint64_t n) {
+            uint64_t capacity = kMinCapacity;
+            while (capacity < n) {
+                capacity <<= 1;
+            }
+            return capacity;
+        }
+
+        bool NeedsToGrow(uint64_t entries, uint64_t capacity) {
+            return entries * kMaxLoadFactorDenominator >
+                   capacity * kMaxLoadFactorNumerator;
+        }
+    }
+
+    std::string LookupIndexStats::DebugString() const {
+        return fmt::format(
+                "capacity:{} entries:{} memory:{} lookups:{} hits:{} hit-ratio:{:.4f} fp-collisions:{} resizes:{} gcs:{} reclaimed:{}",
+                capacity, entries, memory_usage_bytes, lookups, hits, hit_ratio(),
+                fingerprint_collisions, resizes, garbage_collections, reclaimed_entries);
+    }
+
+    LookupIndex::Table::Table(uint64_t capacity)
+            : capacity(capacity), mask(capacity - 1) {
+        slots = new Slot[capacity];
+        for (uint64_t i = 0; i < capacity; i++) {
+            slots[i].hash.store(0, std::memory_order_relaxed);
+            slots[i].tagged_memtable_id.store(0, std::memory_order_relaxed);
+        }
+        entries = 0;
+    }
+
+    LookupIndex::Table::~Table() {
+        delete[] slots;
+    }
+
+    LookupIndex::LookupIndex(uint64_t initial_capacity) {
+        table_ = new Table(RoundUpToPowerOfTwo(initial_capacity));
+        rebuilding_ = false;
+        writers_ = 0;
+        epoch_ = 0;
+        readers_[0] = 0;
+        readers_[1] = 0;
+        inserts_since_gc_ = 0;
+        lookups_ = 0;
+        hits_ = 0;
+        fingerprint_collisions_ = 0;
+        resizes_ = 0;
+        garbage_collections_ = 0;
+        reclaimed_entries_ = 0;
         NOVA_LOG(rdmaio::INFO)
-            << fmt::format("Create lookup index of size {}", size);
+            << fmt::format("Create lookup index of capacity {}", table_.load()->capacity);
+    }
+
+    LookupIndex::~LookupIndex() {
+        delete table_.load();
+    }
+
+    LookupIndex::Table *LookupIndex::EnterEpoch(uint32_t *epoch_slot) {
+        while (true) {
+            uint64_t epoch = epoch_.load();
+            readers_[epoch & 1].fetch_add(1);
+            if (epoch_.load() == epoch) {
+                *epoch_slot = epoch & 1;
+                return table_.load();
+            }
+            // A rebuild advanced the epoch. Register in the new one.
+            readers_[epoch & 1].fetch_sub(1);
+        }
+    }
+
+    void LookupIndex::ExitEpoch(uint32_t epoch_slot) {
+        readers_[epoch_slot].fetch_sub(1);
+    }
+
+    void LookupIndex::BeginWrite() {
+        while (true) {
+            while (rebuilding_.load()) {
+                std::this_thread::yield();
+            }
+            writers_.fetch_add(1);
+            if (!rebuilding_.load()) {
+                return;
+            }
+            writers_.fetch_sub(1);
+        }
+    }
+
+    void LookupIndex::EndWrite() {
+        writers_.fetch_sub(1);
+    }
+
+    LookupIndex::Slot *
+    LookupIndex::FindOrClaimSlot(Table *table, uint64_t hash) {
+        uint64_t stored_hash = hash + 1;
+        uint64_t index = Mix(hash) & table->mask;
+        for (uint64_t i = 0; i < table->capacity; i++) {
+            Slot &slot = table->slots[(index + i) & table->mask];
+            uint64_t current = slot.hash.load();
+            if (current == 0) {
+                if (slot.hash.compare_exchange_strong(current, stored_hash)) {
+                    table->entries.fetch_add(1);
+                    return &slot;
+                }
+                // Another writer claimed it. "current" is its hash.
+            }
+            if (current == stored_hash) {
+                return &slot;
+            }
+        }
+        return nullptr;
     }
 
     uint64_t LookupIndex::Lookup(const leveldb::Slice &key, uint64_t hash) {
-//        NOVA_ASSERT(hash >= 0 && hash <= size_);
-        TableLocation &loc = table_locator_[hash % size_];
-        return loc.memtable_id.load();
+        uint64_t stored_hash = hash + 1;
+        uint64_t mixed = Mix(hash);
+        uint64_t fingerprint = Fingerprint(mixed);
+        uint32_t memtableid = 0;
+        uint32_t epoch_slot = 0;
+        Table *table = EnterEpoch(&epoch_slot);
+        lookups_.fetch_add(1, std::memory_order_relaxed);
+        for (uint64_t i = 0; i < table->capacity; i++) {
+            Slot &slot = table->slots[(mixed + i) & table->mask];
+            uint64_t tagged = slot.tagged_memtable_id.load();
+            if ((tagged >> 32) == fingerprint) {
+                if (slot.hash.load() == stored_hash) {
+                    memtableid = (uint32_t) tagged;
+                    hits_.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                }
+                fingerprint_collisions_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (tagged == 0 && slot.hash.load() == 0) {
+                // Reached an empty slot.
+                break;
+            }
+        }
+        ExitEpoch(epoch_slot);
+        return memtableid;
     }
 
     void LookupIndex::Insert(const leveldb::Slice &key, uint64_t hash,
                              uint32_t memtableid) {
-//        NOVA_ASSERT(hash >= 0 && hash <= size_) << hash;
-        TableLocation &loc = table_locator_[hash % size_];
-        loc.memtable_id.store(memtableid);
+        Upsert(hash, memtableid, false);
+    }
+
+    void LookupIndex::InsertIfNewer(const leveldb::Slice &key, uint64_t hash,
+                                    uint32_t memtableid) {
+        Upsert(hash, memtableid, true);
+    }
+
+    void LookupIndex::Upsert(uint64_t hash, uint32_t memtableid,
+                             bool only_if_newer) {
+        uint64_t fingerprint = Fingerprint(Mix(hash));
+        uint64_t tagged = Tag(fingerprint, memtableid);
+        while (true) {
+            BeginWrite();
+            Table *table = table_.load();
+            Slot *slot = FindOrClaimSlot(table, hash);
+            if (slot && !only_if_newer) {
+                slot->tagged_memtable_id.store(tagged);
+            } else if (slot) {
+                uint64_t current = slot->tagged_memtable_id.load();
+                while ((uint32_t) current < memtableid &&
+                       !slot->tagged_memtable_id.compare_exchange_weak(
+                               current, tagged)) {
+                }
+            }
+            uint64_t capacity = table->capacity;
+            bool grow = slot == nullptr || NeedsToGrow(table->entries, capacity);
+            EndWrite();
+            inserts_since_gc_.fetch_add(1, std::memory_order_relaxed);
+            if (grow) {
+                std::lock_guard<std::mutex> lock(rebuild_mutex_);
+                Table *current = table_.load();
+                if (current->capacity == capacity) {
+                    resizes_.fetch_add(1);
+                    Rebuild(capacity * 2, [](uint32_t) { return false; });
+                }
+            }
+            if (slot) {
+                return;
+            }
+        }
     }
 
     void LookupIndex::CAS(const leveldb::Slice &key, uint64_t hash,
                           uint32_t current_memtableid,
                           uint32_t new_memtableid) {
-//        NOVA_ASSERT(hash >= 0 && hash <= size_) << hash;
-        TableLocation &loc = table_locator_[hash % size_];
-        loc.memtable_id.compare_exchange_strong(current_memtableid,
-                                                new_memtableid);
+        if (current_memtableid == 0) {
+            // No entry is equivalent to memtable id 0.
+            uint64_t memtableid = Lookup(key, hash);
+            if (memtableid == 0) {
+                Insert(key, hash, new_memtableid);
+            }
+            return;
+        }
+        uint64_t fingerprint = Fingerprint(Mix(hash));
+        BeginWrite();
+        Slot *slot = FindOrClaimSlot(table_.load(), hash);
+        if (slot) {
+            uint64_t expected = Tag(fingerprint, current_memtableid);
+            slot->tagged_memtable_id.compare_exchange_strong(
+                    expected, Tag(fingerprint, new_memtableid));
+        }
+        EndWrite();
+    }
+
+    void LookupIndex::MaybeGarbageCollect(
+            const std::function<bool(uint32_t)> &is_obsolete_memtable) {
+        uint32_t epoch_slot = 0;
+        uint64_t capacity = EnterEpoch(&epoch_slot)->capacity;
+        ExitEpoch(epoch_slot);
+        if (inserts_since_gc_.load() < capacity / 2) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(rebuild_mutex_);
+        Table *current = table_.load();
+        if (inserts_since_gc_.load() < current->capacity / 2) {
+            return;
+        }
+        // Cache the status of each memtable id. A memtable stays obsolete once it is.
+        std::unordered_map<uint32_t, bool> obsolete;
+        auto drop = [&](uint32_t memtableid) {
+            if (memtableid == 0) {
+                return true;
+            }
+            auto it = obsolete.find(memtableid);
+            if (it != obsolete.end()) {
+                return it->second;
+            }
+            bool is_obsolete = is_obsolete_memtable(memtableid);
+            obsolete[memtableid] = is_obsolete;
+            return is_obsolete;
+        };
+        garbage_collections_.fetch_add(1);
+        Rebuild(current->capacity, drop);
+    }
+
+    void LookupIndex::Rebuild(uint64_t capacity,
+                              const std::function<bool(uint32_t)> &drop) {
+        // Stop writers so that no update is lost while entries are copied.
+        rebuilding_.store(true);
+        while (writers_.load() != 0) {
+            std::this_thread::yield();
+        }
+        Table *old_table = table_.load();
+        uint64_t live_entries = 0;
+        for (uint64_t i = 0; i < old_table->capacity; i++) {
+            Slot &slot = old_table->slots[i];
+            uint64_t stored_hash = slot.hash.load(std::memory_order_relaxed);
+            uint64_t tagged = slot.tagged_memtable_id.load(std::memory_order_relaxed);
+            if (stored_hash != 0 && !drop((uint32_t) tagged)) {
+                live_entries++;
+            }
+        }
+        // Shrink back after a garbage collection drops most entries but never
+        // rebuild into a table that is already too full.
+        while (NeedsToGrow(live_entries, capacity)) {
+            capacity *= 2;
+        }
+        Table *new_table = new Table(capacity);
+        uint64_t reclaimed = 0;
+        for (uint64_t i = 0; i < old_table->capacity; i++) {
+            Slot &slot = old_table->slots[i];
+            uint64_t stored_hash = slot.hash.load(std::memory_order_relaxed);
+            uint64_t tagged = slot.tagged_memtable_id.load(std::memory_order_relaxed);
+            if (stored_hash == 0) {
+                continue;
+            }
+            if (drop((uint32_t) tagged)) {
+                reclaimed++;
+                continue;
+            }
+            Slot *new_slot = FindOrClaimSlot(new_table, stored_hash - 1);
+            NOVA_ASSERT(new_slot);
+            new_slot->tagged_memtable_id.store(tagged, std::memory_order_relaxed);
+        }
+        table_.store(new_table);
+        inserts_since_gc_ = 0;
+        reclaimed_entries_.fetch_add(reclaimed);
+        rebuilding_.store(false);
+
+        // Readers that entered before the epoch advances may still hold the old table.
+        uint64_t epoch = epoch_.load();
+        epoch_.store(epoch + 1);
+        while (readers_[epoch & 1].load() != 0) {
+            std::this_thread::yield();
+        }
+        NOVA_LOG(rdmaio::DEBUG)
+            << fmt::format("Rebuilt lookup index capacity:{}->{} entries:{} reclaimed:{}",
+                           old_table->capacity, new_table->capacity,
+                           new_table->entries.load(), reclaimed);
+        delete old_table;
     }
 
     uint32_t LookupIndex::Encode(char *buf) {
-        uint32_t msg_size = 0;
-        msg_size += EncodeFixed32(buf + msg_size, size_);
-        NOVA_LOG(rdmaio::INFO) << fmt::format("Lookup index size: {}", size_);
-        for (int i = 0; i < size_; i++) {
-            TableLocation &loc = table_locator_[i];
-            msg_size += EncodeFixed32(buf + msg_size, loc.memtable_id);
+        uint32_t msg_size = 4;
+        uint32_t entries = 0;
+        uint32_t epoch_slot = 0;
+        Table *table = EnterEpoch(&epoch_slot);
+        for (uint64_t i = 0; i < table->capacity; i++) {
+            Slot &slot = table->slots[i];
+            uint64_t stored_hash = slot.hash.load();
+            uint32_t memtableid = (uint32_t) slot.tagged_memtable_id.load();
+            if (stored_hash == 0 || memtableid == 0) {
+                continue;
+            }
+            msg_size += EncodeFixed64(buf + msg_size, stored_hash - 1);
+            msg_size += EncodeFixed32(buf + msg_size, memtableid);
+            entries++;
         }
+        ExitEpoch(epoch_slot);
+        EncodeFixed32(buf, entries);
+        NOVA_LOG(rdmaio::INFO) << fmt::format("Lookup index entries: {}", entries);
         return msg_size;
     }
 
     void LookupIndex::Decode(Slice *buf) {
-        uint32_t size = 0;
-        NOVA_ASSERT(DecodeFixed32(buf, &size));
-        NOVA_LOG(rdmaio::INFO) << fmt::format("Lookup index size: {}", size);
-        for (int i = 0; i < size; i++) {
+        uint32_t entries = 0;
+        NOVA_ASSERT(DecodeFixed32(buf, &entries));
+        NOVA_LOG(rdmaio::INFO) << fmt::format("Lookup index entries: {}", entries);
+        for (int i = 0; i < entries; i++) {
+            uint64_t hash;
             uint32_t id;
+            NOVA_ASSERT(DecodeFixed64(buf, &hash));
             NOVA_ASSERT(DecodeFixed32(buf, &id));
-            table_locator_[i].memtable_id = id;
+            Insert(Slice(), hash, id);
         }
     }
-}
\ No newline at end of file
+
+    LookupIndexStats LookupIndex::Stats() {
+        LookupIndexStats stats = {};
+        uint32_t epoch_slot = 0;
+        Table *table = EnterEpoch(&epoch_slot);
+        stats.capacity = table->capacity;
+        stats.entries = table->entries;
+        stats.memory_usage_bytes = sizeof(LookupIndex) + sizeof(Table) + table->capacity * sizeof(Slot);
+        ExitEpoch(epoch_slot);
+        stats.lookups = lookups_;
+        stats.hits = hits_;
+        stats.fingerprint_collisions = fingerprint_collisions_;
+        stats.resizes = resizes_;
+        stats.garbage_collections = garbage_collections_;
+        stats.reclaimed_entries = reclaimed_entries_;
+        return stats;
+    }
+
+    std::string LookupIndex::DebugString() {
+        return Stats().DebugString();
+    }
+}
@@ -2,41 +2,132 @@
 //
 // Created by Haoyu Huang on 5/19/20.
 // Copyright (c) 2020 University of Southern California. All rights reserved.
-// It assumes a fixed size lookup index. One may swap it with any implementation of concurrent hash map.
-// TODO: Support cleaning up the lookup index to remove entries that point to obsolete memtable ids.
+// A concurrent hash index that maps a key to the memtable that contains its latest value.
+// It uses open addressing. Each slot stores the key's hash and a word that packs a fingerprint
+// of the hash with the memtable id. A probe loads the full hash only when the fingerprint matches.
+// Lookups are lock-free. Inserts run concurrently and pause only while the table is rebuilt.
+// A rebuild either grows the table or drops entries that point to obsolete memtables. The old
+// table is freed once every reader that may still hold it has left its epoch.
+// A key without an entry is not in any memtable or L0 SSTable; the caller searches L1 and above.
 // TODO: Support repairing lookup index upon recovery from a crash.
 
 #ifndef LEVELDB_LOOKUP_INDEX_H
 #define LEVELDB_LOOKUP_INDEX_H
 
 #include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
 #include "leveldb/slice.h"
 
 namespace leveldb {
-    struct TableLocation {
-        std::atomic<uint32_t> memtable_id;
+    struct LookupIndexStats {
+        uint64_t capacity = 0;
+        uint64_t entries = 0;
+        uint64_t memory_usage_bytes = 0;
+        uint64_t lookups = 0;
+        uint64_t hits = 0;
+        uint64_t fingerprint_collisions = 0;
+        uint64_t resizes = 0;
+        uint64_t garbage_collections = 0;
+        uint64_t reclaimed_entries = 0;
+
+        double hit_ratio() const {
+            return lookups == 0 ? 0 : (double) hits / lookups;
+        }
+
+        std::string DebugString() const;
     };
 
     class LookupIndex {
     public:
-        LookupIndex(uint32_t size);
+        LookupIndex(uint64_t initial_capacity);
+
+        ~LookupIndex();
 
+        // Return the memtable id of the key or 0 if the index has no entry for it.
         uint64_t Lookup(const Slice &key, uint64_t hash);
 
         void Insert(const Slice &key, uint64_t hash, uint32_t memtableid);
 
+        // Insert the key unless its entry already points to a memtable with a
+        // larger id. Memtable ids increase monotonically, so concurrent
+        // recovery threads converge to the newest memtable of each key.
+        void InsertIfNewer(const Slice &key, uint64_t hash, uint32_t memtableid);
+
         void CAS(const Slice &key, uint64_t hash, uint32_t current_memtableid,
                  uint32_t new_memtableid);
 
+        // Rebuild the index without the entries whose memtable is obsolete.
+        // It is a no-op until enough inserts have happened since the last rebuild.
+        // Called by background compaction threads.
+        void
+        MaybeGarbageCollect(const std::function<bool(uint32_t)> &is_obsolete_memtable);
+
         uint32_t Encode(char *buf);
 
         void Decode(Slice *buf);
 
+        LookupIndexStats Stats();
+
         std::string DebugString();
 
     private:
-        uint32_t size_ = 0;
-        TableLocation *table_locator_ = nullptr;
+        friend class LookupIndexTest;
+
+        struct Slot {
+            // Hash + 1. 0 means the slot is empty.
+            std::atomic<uint64_t> hash;
+            // Fingerprint in the upper 32 bits and memtable id in the lower 32 bits.
+            std::atomic<uint64_t> tagged_memtable_id;
+        };
+
+        struct Table {
+            Table(uint64_t capacity);
+
+            ~Table();
+
+            const uint64_t capacity;
+            const uint64_t mask;
+            Slot *slots = nullptr;
+            std::atomic<uint64_t> entries;
+        };
+
+        // Return the slot of the hash, claiming an empty one if absent.
+        // Return nullptr if the table is full.
+        static Slot *FindOrClaimSlot(Table *table, uint64_t hash);
+
+        void Upsert(uint64_t hash, uint32_t memtableid, bool only_if_newer);
+
+        // Block until no rebuild is in progress and register as a writer.
+        void BeginWrite();
+
+        void EndWrite();
+
+        Table *EnterEpoch(uint32_t *epoch_slot);
+
+        void ExitEpoch(uint32_t epoch_slot);
+
+        // Replace the table with a new one of "capacity" slots that contains
+        // all entries except those for which "drop" returns true.
+        // REQUIRES: rebuild_mutex_ is held.
+        void Rebuild(uint64_t capacity,
+                     const std::function<bool(uint32_t)> &drop);
+
+        std::atomic<Table *> table_;
+        std::mutex rebuild_mutex_;
+        std::atomic_bool rebuilding_;
+        std::atomic<uint64_t> writers_;
+        std::atomic<uint64_t> epoch_;
+        std::atomic<uint64_t> readers_[2];
+        std::atomic<uint64_t> inserts_since_gc_;
+
+        std::atomic<uint64_t> lookups_;
+        std::atomic<uint64_t> hits_;
+        std::atomic<uint64_t> fingerprint_collisions_;
+        std::atomic<uint64_t> resizes_;
+        std::atomic<uint64_t> garbage_collections_;
+        std::atomic<uint64_t> reclaimed_entries_;
     };
 }
 
@@ -0,0 +1,217 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "db/lookup_index.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "common/nova_common.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+    class LookupIndexTest {
+    public:
+        // The index ignores the key and uses the hash.
+        static uint64_t Lookup(LookupIndex *index, uint64_t hash) {
+            return index->Lookup(Slice(), hash);
+        }
+
+        static void Insert(LookupIndex *index, uint64_t hash, uint32_t id) {
+            index->Insert(Slice(), hash, id);
+        }
+
+        // Enter a reader epoch and return the table it pins.
+        static const void *EnterEpoch(LookupIndex *index, uint32_t *slot) {
+            return index->EnterEpoch(slot);
+        }
+
+        static void ExitEpoch(LookupIndex *index, uint32_t slot) {
+            index->ExitEpoch(slot);
+        }
+
+        static const void *CurrentTable(LookupIndex *index) {
+            return index->table_.load();
+        }
+
+        static uint64_t Capacity(LookupIndex *index) {
+            return index->Stats().capacity;
+        }
+
+        // Insert keys [begin, end) until the table is replaced.
+        static uint64_t InsertUntilResize(LookupIndex *index, uint64_t begin) {
+            uint64_t capacity = Capacity(index);
+            uint64_t hash = begin;
+            while (Capacity(index) == capacity) {
+                Insert(index, hash, static_cast<uint32_t>(hash % 100 + 1));
+                hash++;
+            }
+            return hash;
+        }
+    };
+
+    TEST(LookupIndexTest, InsertLookup) {
+        LookupIndex index(1024);
+        ASSERT_EQ(0, Lookup(&index, 1));
+        Insert(&index, 1, 10);
+        Insert(&index, 2, 20);
+        ASSERT_EQ(10, Lookup(&index, 1));
+        ASSERT_EQ(20, Lookup(&index, 2));
+        ASSERT_EQ(0, Lookup(&index, 3));
+
+        Insert(&index, 1, 11);
+        ASSERT_EQ(11, Lookup(&index, 1));
+        index.InsertIfNewer(Slice(), 1, 5);
+        ASSERT_EQ(11, Lookup(&index, 1));
+        index.InsertIfNewer(Slice(), 1, 12);
+        ASSERT_EQ(12, Lookup(&index, 1));
+
+        index.CAS(Slice(), 2, 19, 30);
+        ASSERT_EQ(20, Lookup(&index, 2));
+        index.CAS(Slice(), 2, 20, 30);
+        ASSERT_EQ(30, Lookup(&index, 2));
+    }
+
+    TEST(LookupIndexTest, Resize) {
+        LookupIndex index(1024);
+        const uint64_t kKeys = 10000;
+        for (uint64_t i = 0; i < kKeys; i++) {
+            Insert(&index, i, static_cast<uint32_t>(i % 1000 + 1));
+        }
+        LookupIndexStats stats = index.Stats();
+        ASSERT_EQ(kKeys, stats.entries);
+        ASSERT_GT(stats.resizes, 0);
+        ASSERT_GE(stats.capacity, kKeys);
+        for (uint64_t i = 0; i < kKeys; i++) {
+            ASSERT_EQ(i % 1000 + 1, Lookup(&index, i));
+        }
+    }
+
+    TEST(LookupIndexTest, ConcurrentInsertLookupAcrossResize) {
+        LookupIndex index(1024);
+        const int kWriters = 4;
+        const int kReaders = 4;
+        const uint64_t kKeysPerWriter = 50000;
+        // Writer w inserts keys w, w + kWriters, ... with id (key % 1000) + 1.
+        // inserted[w] is the number of keys it has inserted so far.
+        std::atomic<uint64_t> inserted[kWriters];
+        for (int w = 0; w < kWriters; w++) {
+            inserted[w] = 0;
+        }
+        std::atomic_bool done(false);
+        std::atomic<uint64_t> misses(0);
+
+        std::vector<std::thread> threads;
+        for (int w = 0; w < kWriters; w++) {
+            threads.emplace_back([&, w]() {
+                for (uint64_t i = 0; i < kKeysPerWriter; i++) {
+                    uint64_t key = i * kWriters + w;
+                    Insert(&index, key, static_cast<uint32_t>(key % 1000 + 1));
+                    inserted[w].store(i + 1);
+                }
+            });
+        }
+        for (int r = 0; r < kReaders; r++) {
+            threads.emplace_back([&, r]() {
+                uint64_t n = r;
+                while (!done.load()) {
+                    int w = static_cast<int>(n % kWriters);
+                    uint64_t count = inserted[w].load();
+                    n = n * 6364136223846793005ULL + 1442695040888963407ULL;
+                    if (count == 0) {
+                        continue;
+                    }
+                    // Every inserted key must be visible, also while the
+                    // table is being rebuilt.
+                    uint64_t key = ((n >> 17) % count) * kWriters + w;
+                    if (Lookup(&index, key) != key % 1000 + 1) {
+                        misses.fetch_add(1);
+                    }
+                }
+            });
+        }
+        for (int w = 0; w < kWriters; w++) {
+            threads[w].join();
+        }
+        done.store(true);
+        for (int r = 0; r < kReaders; r++) {
+            threads[kWriters + r].join();
+        }
+
+        ASSERT_EQ(0, misses.load());
+        LookupIndexStats stats = index.Stats();
+        ASSERT_GT(stats.resizes, 0);
+        ASSERT_EQ(kWriters * kKeysPerWriter, stats.entries);
+        for (uint64_t key = 0; key < kWriters * kKeysPerWriter; key++) {
+            ASSERT_EQ(key % 1000 + 1, Lookup(&index, key));
+        }
+    }
+
+    TEST(LookupIndexTest, RetiredTableOutlivesReaders) {
+        LookupIndex index(1024);
+        Insert(&index, 7, 70);
+
+        // A reader pins the current table.
+        uint32_t slot = 0;
+        const void *pinned = EnterEpoch(&index, &slot);
+        ASSERT_TRUE(pinned == CurrentTable(&index));
+
+        // Grow the table. The rebuild publishes the new table but must wait
+        // for the reader before it frees the old one.
+        std::atomic_bool rebuilt(false);
+        std::thread writer([&]() {
+            InsertUntilResize(&index, 1000);
+            rebuilt.store(true);
+        });
+        while (CurrentTable(&index) == pinned) {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ASSERT_TRUE(!rebuilt.load());
+
+        // New readers see the new table and are not blocked.
+        ASSERT_EQ(70, Lookup(&index, 7));
+
+        ExitEpoch(&index, slot);
+        writer.join();
+        ASSERT_TRUE(rebuilt.load());
+        ASSERT_EQ(70, Lookup(&index, 7));
+    }
+
+    TEST(LookupIndexTest, GarbageCollect) {
+        // Large enough not to resize, which would also reset the number of
+        // inserts since the last collection.
+        LookupIndex index(8192);
+        const uint64_t kKeys = 4000;
+        // A collection needs at least capacity / 2 inserts.
+        for (int round = 0; round < 2; round++) {
+            for (uint64_t i = 0; i < kKeys; i++) {
+                Insert(&index, i, static_cast<uint32_t>(i % 10 + 1));
+            }
+        }
+        ASSERT_EQ(0, index.Stats().resizes);
+        // Memtables 1 to 5 are obsolete.
+        index.MaybeGarbageCollect([](uint32_t id) { return id <= 5; });
+        LookupIndexStats stats = index.Stats();
+        ASSERT_EQ(1, stats.garbage_collections);
+        ASSERT_EQ(kKeys / 2, stats.reclaimed_entries);
+        ASSERT_EQ(kKeys / 2, stats.entries);
+        for (uint64_t i = 0; i < kKeys; i++) {
+            uint64_t id = i % 10 + 1;
+            ASSERT_EQ(id <= 5 ? 0 : id, Lookup(&index, i));
+        }
+
+        // Too few inserts since the last collection.
+        index.MaybeGarbageCollect([](uint32_t) { return true; });
+        ASSERT_EQ(1, index.Stats().garbage_collections);
+    }
+
+}  // namespace leveldb
+
+nova::NovaGlobalVariables nova::NovaGlobalVariables::global;
+
+int main(int argc, char **argv) { return leveldb::test::RunAllTests(); }
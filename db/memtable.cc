@@ -12,6 +12,7 @@
 #include "leveldb/env.h"
 #include "leveldb/iterator.h"
 #include "util/coding.h"
+#include "util/hash.h"
 
 namespace leveldb {
 
@@ -23,18 +24,104 @@ namespace leveldb {
         return Slice(p, len);
     }
 
+    static uint32_t HashUserKey(const Slice &user_key) {
+        return Hash(user_key.data(), user_key.size(), 0xbc9f1d34);
+    }
+
+    MemTableHashIndex::MemTableHashIndex(const Comparator *user_comparator,
+                                         Arena *arena, uint32_t buckets)
+            : user_comparator_(user_comparator), arena_(arena),
+              mask_(buckets == 0 ? 0 : buckets - 1) {
+        if (buckets == 0) {
+            return;
+        }
+        NOVA_ASSERT((buckets & (buckets - 1)) == 0) << buckets;
+        char *mem = arena_->AllocateAligned(
+                sizeof(std::atomic<Node *>) * buckets);
+        buckets_ = reinterpret_cast<std::atomic<Node *> *>(mem);
+        for (uint32_t i = 0; i < buckets; i++) {
+            new(&buckets_[i]) std::atomic<Node *>(nullptr);
+        }
+    }
+
+    void MemTableHashIndex::Insert(const Slice &user_key, SequenceNumber seq,
+                                   const char *entry) {
+        uint32_t hash = HashUserKey(user_key);
+        std::atomic<Node *> *bucket = &buckets_[hash & mask_];
+        Node *head = bucket->load(std::memory_order_relaxed);
+        for (Node *n = head; n != nullptr;
+             n = n->next.load(std::memory_order_relaxed)) {
+            if (n->hash != hash) {
+                continue;
+            }
+            Slice key = GetLengthPrefixedSlice(
+                    n->entry.load(std::memory_order_relaxed));
+            if (user_comparator_->Compare(
+                    Slice(key.data(), key.size() - 8), user_key) == 0) {
+                if (seq > n->seq) {
+                    n->seq = seq;
+                    n->entry.store(entry, std::memory_order_release);
+                }
+                return;
+            }
+        }
+        char *mem = arena_->AllocateAligned(sizeof(Node));
+        Node *n = reinterpret_cast<Node *>(mem);
+        n->hash = hash;
+        n->seq = seq;
+        new(&n->entry) std::atomic<const char *>(entry);
+        new(&n->next) std::atomic<Node *>(head);
+        bucket->store(n, std::memory_order_release);
+    }
+
+    const char *MemTableHashIndex::Lookup(const Slice &user_key) const {
+        uint32_t hash = HashUserKey(user_key);
+        for (Node *n = buckets_[hash & mask_].load(std::memory_order_acquire);
+             n != nullptr; n = n->next.load(std::memory_order_acquire)) {
+            if (n->hash != hash) {
+                continue;
+            }
+            const char *entry = n->entry.load(std::memory_order_acquire);
+            Slice key = GetLengthPrefixedSlice(entry);
+            if (user_comparator_->Compare(
+                    Slice(key.data(), key.size() - 8), user_key) == 0) {
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    uint32_t MemTableHashIndexBuckets(const Options &options) {
+        if (!options.enable_memtable_hash_index) {
+            return 0;
+        }
+        // Roughly one bucket per 256 bytes of memtable, i.e., a few entries
+        // per bucket for small values.
+        uint64_t target = options.write_buffer_size / 256;
+        uint32_t buckets = 1024;
+        while (buckets < target && buckets < (1u << 30)) {
+            buckets <<= 1;
+        }
+        return buckets;
+    }
+
     MemTable::MemTable(const InternalKeyComparator &comparator,
                        uint32_t memtable_id,
                        DBProfiler *db_profiler,
-                       bool is_ready)
-            : comparator_(comparator), memtable_id_(memtable_id), refs_(0),
+                       bool is_ready,
+                       MemTableRepresentation representation,
+                       uint32_t hash_index_buckets)
+            : is_ready_(is_ready), is_ready_signal_(&is_ready_mutex_),
+              db_profiler_(db_profiler), comparator_(comparator), refs_(0),
+              memtable_id_(memtable_id), representation_(representation),
               table_(comparator_, &arena_),
-              db_profiler_(db_profiler), is_ready_(is_ready),
-              is_ready_signal_(&is_ready_mutex_) {
+              inline_table_(&arena_),
+              hash_index_(comparator_.comparator.user_comparator(), &arena_,
+                          hash_index_buckets) {
     }
 
     void MemTable::WaitUntilReady() {
-        if (nova::NovaConfig::config->cfgs.size() == 1 || is_ready_) {
+        if (is_ready_ || nova::NovaConfig::config->cfgs.size() == 1) {
             return;
         }
         is_ready_mutex_.Lock();
@@ -93,9 +180,8 @@ namespace leveldb {
     public:
         explicit MemTableIterator(MemTable *table, TraceType trace_type,
                                   AccessCaller caller, uint32_t sample_size)
-                : iter_(
-                &(table->table_), sample_size), trace_type_(trace_type),
-                  caller_(caller) {
+                : trace_type_(trace_type), caller_(caller),
+                  iter_(&(table->table_), sample_size) {
             if (db_profiler_ != nullptr) {
                 Access access = {
                         .trace_type = trace_type_,
@@ -179,10 +265,81 @@ namespace leveldb {
         std::string tmp_;  // For passing to EncodeKey
     };
 
+    // Iterates over a kMemTableInlineSkipList memtable. Entries have the same
+    // format as in MemTableIterator.
+    class InlineMemTableIterator : public Iterator {
+    public:
+        explicit InlineMemTableIterator(MemTable *table, uint32_t sample_size)
+                : iter_(&(table->inline_table_), sample_size) {
+        }
+
+        InlineMemTableIterator(const InlineMemTableIterator &) = delete;
+
+        InlineMemTableIterator &operator=(const InlineMemTableIterator &) = delete;
+
+        ~InlineMemTableIterator() override = default;
+
+        bool Valid() const override { return iter_.Valid(); }
+
+        void Seek(const Slice &k) override {
+            Slice userkey = ExtractUserKey(k);
+            uint64_t userkeyint = 0;
+            nova::str_to_int(userkey.data(), &userkeyint, userkey.size());
+            iter_.Seek(userkeyint, DecodeFixed64(k.data() + k.size() - 8));
+            seeked_ = true;
+        }
+
+        void SeekToFirst() override {
+            iter_.SeekToFirst();
+            seeked_ = true;
+        }
+
+        void SeekToLast() override {
+            iter_.SeekToLast();
+            seeked_ = true;
+        }
+
+        void SkipToNextUserKey(const Slice &target) override {
+            if (!seeked_) {
+                Seek(target);
+            }
+            auto userkey = ExtractUserKey(target);
+            uint64_t userkeyint;
+            nova::str_to_int(userkey.data(), &userkeyint, userkey.size());
+            while (Valid() && iter_.user_key() == userkeyint) {
+                Next();
+            }
+        }
+
+        void Next() override {
+            iter_.Next();
+        }
+
+        void Prev() override { iter_.Prev(); }
+
+        Slice key() const override {
+            return GetLengthPrefixedSlice(iter_.entry());
+        }
+
+        Slice value() const override {
+            Slice key_slice = GetLengthPrefixedSlice(iter_.entry());
+            return GetLengthPrefixedSlice(key_slice.data() + key_slice.size());
+        }
+
+        Status status() const override { return Status::OK(); }
+
+    private:
+        InlineSkipList::Iterator iter_;
+        bool seeked_ = false;
+    };
+
     Iterator *MemTable::NewIterator(TraceType trace_type,
                                     AccessCaller caller,
                                     uint32_t sample_size) {
         WaitUntilReady();
+        if (representation_ == MemTableRepresentation::kMemTableInlineSkipList) {
+            return new InlineMemTableIterator(this, sample_size);
+        }
         return new MemTableIterator(this, trace_type, caller, sample_size);
     }
 
@@ -199,20 +356,94 @@ namespace leveldb {
         const size_t encoded_len = VarintLength(internal_key_size) +
                                    internal_key_size + VarintLength(val_size) +
                                    val_size;
-        char *buf = arena_.Allocate(encoded_len);
+        const uint64_t tag = (s << 8) | type;
+        char *buf;
+        if (representation_ == MemTableRepresentation::kMemTableInlineSkipList) {
+            uint64_t userkeyint = 0;
+            nova::str_to_int(key.data(), &userkeyint, key_size);
+            buf = inline_table_.AllocateEntry(userkeyint, tag, encoded_len);
+        } else {
+            buf = arena_.Allocate(encoded_len);
+        }
         char *p = EncodeVarint32(buf, internal_key_size);
         memcpy(p, key.data(), key_size);
         p += key_size;
-        EncodeFixed64(p, (s << 8) | type);
+        EncodeFixed64(p, tag);
         p += 8;
         p = EncodeVarint32(p, val_size);
         memcpy(p, value.data(), val_size);
         assert(p + val_size == buf + encoded_len);
-        table_.Insert(buf);
+        if (representation_ == MemTableRepresentation::kMemTableInlineSkipList) {
+            inline_table_.Insert(buf);
+        } else {
+            table_.Insert(buf);
+        }
+        if (hash_index_.enabled()) {
+            hash_index_.Insert(key, s, buf);
+        }
     }
 
-    bool MemTable::Get(const LookupKey &key, std::string *value, Status *s) {
+    bool MemTable::Get(const LookupKey &key, std::string *value, Status *s,
+                       SequenceNumber *seq) {
         WaitUntilReady();
+        Slice lookup_ikey = key.internal_key();
+        if (hash_index_.enabled() &&
+            (DecodeFixed64(lookup_ikey.data() + lookup_ikey.size() - 8) >> 8) ==
+            kMaxSequenceNumber) {
+            // Reads of the latest version use the hash directory.
+            const char *entry = hash_index_.Lookup(key.user_key());
+            if (entry == nullptr) {
+                return false;
+            }
+            Slice internal_key = GetLengthPrefixedSlice(entry);
+            const uint64_t tag = DecodeFixed64(
+                    internal_key.data() + internal_key.size() - 8);
+            if (seq != nullptr) {
+                *seq = tag >> 8;
+            }
+            switch (static_cast<ValueType>(tag & 0xff)) {
+                case kTypeValue: {
+                    Slice v = GetLengthPrefixedSlice(
+                            internal_key.data() + internal_key.size());
+                    value->assign(v.data(), v.size());
+                    return true;
+                }
+                case kTypeDeletion:
+                case kTypeRangeDeletion:
+                    *s = Status::NotFound(Slice());
+                    return true;
+            }
+            return false;
+        }
+        if (representation_ == MemTableRepresentation::kMemTableInlineSkipList) {
+            Slice ikey = key.internal_key();
+            uint64_t userkeyint = 0;
+            nova::str_to_int(key.user_key().data(), &userkeyint,
+                             key.user_key().size());
+            InlineSkipList::Iterator iter(&inline_table_);
+            iter.Seek(userkeyint,
+                      DecodeFixed64(ikey.data() + ikey.size() - 8));
+            if (!iter.Valid() || iter.user_key() != userkeyint) {
+                return false;
+            }
+            if (seq != nullptr) {
+                *seq = iter.tag() >> 8;
+            }
+            switch (static_cast<ValueType>(iter.tag() & 0xff)) {
+                case kTypeValue: {
+                    Slice key_slice = GetLengthPrefixedSlice(iter.entry());
+                    Slice v = GetLengthPrefixedSlice(
+                            key_slice.data() + key_slice.size());
+                    value->assign(v.data(), v.size());
+                    return true;
+                }
+                case kTypeDeletion:
+                case kTypeRangeDeletion:
+                    *s = Status::NotFound(Slice());
+                    return true;
+            }
+            return false;
+        }
         Slice memkey = key.memtable_key();
         Table::Iterator iter(&table_);
         iter.Seek(memkey.data());
@@ -233,6 +464,9 @@ namespace leveldb {
                     Slice(key_ptr, key_length - 8), key.user_key()) == 0) {
                 // Correct user key
                 const uint64_t tag = DecodeFixed64(key_ptr + key_length - 8);
+                if (seq != nullptr) {
+                    *seq = tag >> 8;
+                }
                 switch (static_cast<ValueType>(tag & 0xff)) {
                     case kTypeValue: {
                         Slice v = GetLengthPrefixedSlice(key_ptr + key_length);
@@ -240,6 +474,7 @@ namespace leveldb {
                         return true;
                     }
                     case kTypeDeletion:
+                    case kTypeRangeDeletion:
                         *s = Status::NotFound(Slice());
                         return true;
                 }
@@ -331,7 +566,8 @@ namespace leveldb {
         return msg_size;
     }
 
-    bool AtomicMemTable::Decode(Slice *buf, const InternalKeyComparator &cmp) {
+    bool AtomicMemTable::Decode(Slice *buf, const InternalKeyComparator &cmp,
+                                const Options &options) {
         NOVA_ASSERT(DecodeBool(buf, &is_immutable_));
         NOVA_ASSERT(DecodeBool(buf, &is_flushed_));
         NOVA_ASSERT(DecodeFixed32(buf, &last_version_id_));
@@ -350,7 +586,9 @@ namespace leveldb {
 
         bool memtable_exists = true;
         if (!is_flushed_ && !memtable_) {
-            memtable_ = new MemTable(cmp, memtable_id_, nullptr, false);
+            memtable_ = new MemTable(cmp, memtable_id_, nullptr, false,
+                                     options.memtable_representation,
+                                     MemTableHashIndexBuckets(options));
             memtable_exists = false;
         }
         return memtable_exists;
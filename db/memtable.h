@@ -12,6 +12,7 @@
 #include "leveldb/db_profiler.h"
 #include "db/dbformat.h"
 #include "db/skiplist.h"
+#include "db/inline_skiplist.h"
 #include "leveldb/db.h"
 #include "util/arena.h"
 
@@ -21,6 +22,44 @@ namespace leveldb {
 
     class MemTableIterator;
 
+    // A hash directory from a user key to its latest entry in a memtable.
+    // Buckets and nodes are allocated from the memtable's arena.
+    // Writes require external synchronization. Reads proceed without locks.
+    class MemTableHashIndex {
+    public:
+        // A directory with 0 buckets is disabled.
+        MemTableHashIndex(const Comparator *user_comparator, Arena *arena,
+                          uint32_t buckets);
+
+        bool enabled() const { return buckets_ != nullptr; }
+
+        // Point the user key to "entry" unless it already points to an entry
+        // with a larger sequence number.
+        void Insert(const Slice &user_key, SequenceNumber seq,
+                    const char *entry);
+
+        // Return the latest entry of the user key or nullptr if the memtable
+        // does not contain it.
+        const char *Lookup(const Slice &user_key) const;
+
+    private:
+        struct Node {
+            uint32_t hash;
+            SequenceNumber seq;
+            std::atomic<const char *> entry;
+            std::atomic<Node *> next;
+        };
+
+        const Comparator *user_comparator_;
+        Arena *const arena_;
+        const uint32_t mask_;
+        std::atomic<Node *> *buckets_ = nullptr;
+    };
+
+    // Return the number of hash directory buckets of a memtable or 0 if
+    // options.enable_memtable_hash_index is false.
+    uint32_t MemTableHashIndexBuckets(const Options &options);
+
     class MemTable {
     public:
         // MemTables are reference counted.  The initial reference count
@@ -28,7 +67,9 @@ namespace leveldb {
         explicit MemTable(const InternalKeyComparator &comparator,
                           uint32_t memtable_id,
                           DBProfiler *db_profiler,
-                          bool is_ready);
+                          bool is_ready,
+                          MemTableRepresentation representation = MemTableRepresentation::kMemTableSkipList,
+                          uint32_t hash_index_buckets = 0);
 
         MemTable(const MemTable &) = delete;
 
@@ -76,7 +117,9 @@ namespace leveldb {
         // If memtable contains a deletion for key, store a NotFound() error
         // in *status and return true.
         // Else, return false.
-        bool Get(const LookupKey &key, std::string *value, Status *s);
+        // "*seq" is set to the sequence number of the value or the deletion.
+        bool Get(const LookupKey &key, std::string *value, Status *s,
+                 SequenceNumber *seq = nullptr);
 
         FileMetaData &meta() {
             return flushed_meta_;
@@ -92,6 +135,8 @@ namespace leveldb {
 
         friend class MemTableBackwardIterator;
 
+        friend class InlineMemTableIterator;
+
         struct KeyComparator {
             const InternalKeyComparator comparator;
 
@@ -110,7 +155,11 @@ namespace leveldb {
         int refs_ = 0;
         uint32_t memtable_id_ = 0;
         Arena arena_;
+        const MemTableRepresentation representation_;
         Table table_;
+        // Used instead of table_ by kMemTableInlineSkipList.
+        InlineSkipList inline_table_;
+        MemTableHashIndex hash_index_;
         FileMetaData flushed_meta_;
     };
 
@@ -138,7 +187,8 @@ namespace leveldb {
 
         uint32_t Encode(char *buf);
 
-        bool Decode(Slice *buf, const InternalKeyComparator& cmp);
+        bool Decode(Slice *buf, const InternalKeyComparator &cmp,
+                    const Options &options);
 
         bool is_immutable_ = false;
         bool is_flushed_ = false;
@@ -0,0 +1,265 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "range_tombstone.h"
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+
+namespace leveldb {
+
+    namespace {
+        // Starts or ends the coverage of the sequence numbers
+        // [begin, end) at "key".
+        struct Boundary {
+            const std::string *key;
+            bool is_start;
+            const SequenceNumber *begin;
+            const SequenceNumber *end;
+        };
+    }
+
+    FragmentedRangeTombstones::FragmentedRangeTombstones(
+            const Comparator *user_comparator,
+            const std::vector<RangeTombstone> &tombstones)
+            : user_comparator_(user_comparator) {
+        fragments_ = Merge(std::vector<Fragment>(), tombstones);
+    }
+
+    FragmentedRangeTombstones::FragmentedRangeTombstones(
+            const FragmentedRangeTombstones &base,
+            const RangeTombstone &tombstone)
+            : user_comparator_(base.user_comparator_),
+              fragments_(base.fragments_),
+              unfragmented_(base.unfragmented_) {
+        unfragmented_.push_back(tombstone);
+        if (unfragmented_.size() >= kMaxUnfragmented) {
+            fragments_ = Merge(*fragments_, unfragmented_);
+            unfragmented_.clear();
+        }
+    }
+
+    FragmentedRangeTombstones::FragmentedRangeTombstones(
+            const FragmentedRangeTombstones &base,
+            const std::set<SequenceNumber> &removed)
+            : user_comparator_(base.user_comparator_) {
+        auto fragments = std::make_shared<std::vector<Fragment>>();
+        for (const auto &fragment : *base.fragments_) {
+            std::vector<SequenceNumber> sequences;
+            for (SequenceNumber sequence : fragment.sequences) {
+                if (removed.find(sequence) == removed.end()) {
+                    sequences.push_back(sequence);
+                }
+            }
+            if (sequences.empty()) {
+                continue;
+            }
+            if (!fragments->empty() &&
+                user_comparator_->Compare(fragments->back().end,
+                                          fragment.start) == 0 &&
+                fragments->back().sequences == sequences) {
+                // Coalesce with the previous fragment.
+                fragments->back().end = fragment.end;
+                continue;
+            }
+            fragments->push_back({fragment.start, fragment.end,
+                                  std::move(sequences)});
+        }
+        fragments_ = std::move(fragments);
+        for (const auto &tombstone : base.unfragmented_) {
+            if (removed.find(tombstone.sequence) == removed.end()) {
+                unfragmented_.push_back(tombstone);
+            }
+        }
+    }
+
+    std::shared_ptr<const std::vector<FragmentedRangeTombstones::Fragment>>
+    FragmentedRangeTombstones::Merge(
+            const std::vector<Fragment> &base,
+            const std::vector<RangeTombstone> &tombstones) const {
+        auto less = [&](const Boundary &a, const Boundary &b) {
+            return user_comparator_->Compare(*a.key, *b.key) < 0;
+        };
+        // The fragments are sorted and do not overlap, so their boundaries
+        // are already in order.
+        std::vector<Boundary> fragment_boundaries;
+        fragment_boundaries.reserve(base.size() * 2);
+        for (const auto &fragment : base) {
+            const SequenceNumber *begin = fragment.sequences.data();
+            const SequenceNumber *end = begin + fragment.sequences.size();
+            fragment_boundaries.push_back({&fragment.start, true, begin, end});
+            fragment_boundaries.push_back({&fragment.end, false, begin, end});
+        }
+        std::vector<Boundary> tombstone_boundaries;
+        tombstone_boundaries.reserve(tombstones.size() * 2);
+        for (const auto &tombstone : tombstones) {
+            if (user_comparator_->Compare(tombstone.start, tombstone.end) >= 0) {
+                continue;
+            }
+            const SequenceNumber *sequence = &tombstone.sequence;
+            tombstone_boundaries.push_back(
+                    {&tombstone.start, true, sequence, sequence + 1});
+            tombstone_boundaries.push_back(
+                    {&tombstone.end, false, sequence, sequence + 1});
+        }
+        std::sort(tombstone_boundaries.begin(), tombstone_boundaries.end(),
+                  less);
+        std::vector<Boundary> boundaries;
+        boundaries.reserve(fragment_boundaries.size() +
+                           tombstone_boundaries.size());
+        std::merge(fragment_boundaries.begin(), fragment_boundaries.end(),
+                   tombstone_boundaries.begin(), tombstone_boundaries.end(),
+                   std::back_inserter(boundaries), less);
+
+        // Sweep the boundaries. "active" holds the sequence numbers of the
+        // tombstones that cover the keys between two boundaries.
+        auto fragments = std::make_shared<std::vector<Fragment>>();
+        std::multiset<SequenceNumber> active;
+        uint32_t i = 0;
+        while (i < boundaries.size()) {
+            const std::string &key = *boundaries[i].key;
+            for (; i < boundaries.size() &&
+                   user_comparator_->Compare(*boundaries[i].key, key) == 0; i++) {
+                for (const SequenceNumber *sequence = boundaries[i].begin;
+                     sequence != boundaries[i].end; sequence++) {
+                    if (boundaries[i].is_start) {
+                        active.insert(*sequence);
+                    } else {
+                        active.erase(active.find(*sequence));
+                    }
+                }
+            }
+            if (active.empty() || i == boundaries.size()) {
+                continue;
+            }
+            std::vector<SequenceNumber> sequences(active.begin(), active.end());
+            sequences.erase(std::unique(sequences.begin(), sequences.end()),
+                            sequences.end());
+            if (!fragments->empty() &&
+                user_comparator_->Compare(fragments->back().end, key) == 0 &&
+                fragments->back().sequences == sequences) {
+                // Coalesce with the previous fragment.
+                fragments->back().end = *boundaries[i].key;
+                continue;
+            }
+            Fragment fragment;
+            fragment.start = key;
+            fragment.end = *boundaries[i].key;
+            fragment.sequences = std::move(sequences);
+            fragments->push_back(std::move(fragment));
+        }
+        return fragments;
+    }
+
+    bool FragmentedRangeTombstones::IsDeleted(const Slice &key,
+                                              SequenceNumber sequence,
+                                              SequenceNumber snapshot) const {
+        for (const auto &tombstone : unfragmented_) {
+            if (tombstone.sequence > sequence && tombstone.sequence <= snapshot &&
+                user_comparator_->Compare(key, tombstone.start) >= 0 &&
+                user_comparator_->Compare(key, tombstone.end) < 0) {
+                return true;
+            }
+        }
+        // The first fragment that starts after key.
+        auto fragment = std::upper_bound(fragments_->begin(), fragments_->end(),
+                                         key,
+                                         [&](const Slice &k, const Fragment &f) {
+                                             return user_comparator_->Compare(
+                                                     k, f.start) < 0;
+                                         });
+        if (fragment == fragments_->begin()) {
+            return false;
+        }
+        fragment--;
+        if (user_comparator_->Compare(key, fragment->end) >= 0) {
+            return false;
+        }
+        // The newest tombstone that is visible at snapshot.
+        auto newest = std::upper_bound(fragment->sequences.begin(),
+                                       fragment->sequences.end(), snapshot);
+        if (newest == fragment->sequences.begin()) {
+            return false;
+        }
+        newest--;
+        return *newest > sequence;
+    }
+
+    RangeTombstones::RangeTombstones(const Comparator *user_comparator)
+            : user_comparator_(user_comparator),
+              fragments_(std::make_shared<FragmentedRangeTombstones>(
+                      user_comparator, std::vector<RangeTombstone>())),
+              size_(0) {
+    }
+
+    void RangeTombstones::PublishFragments(
+            std::shared_ptr<const FragmentedRangeTombstones> fragments) {
+        std::atomic_store(&fragments_, fragments);
+        size_ = entries_.size();
+    }
+
+    void RangeTombstones::Add(const RangeTombstone &tombstone,
+                              uint32_t memtable_id_watermark) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(tombstone.sequence);
+        if (it != entries_.end()) {
+            // Replayed from a log file.
+            it->second.memtable_id_watermark = std::max(
+                    it->second.memtable_id_watermark, memtable_id_watermark);
+            return;
+        }
+        Entry &entry = entries_[tombstone.sequence];
+        entry.tombstone = tombstone;
+        entry.memtable_id_watermark = memtable_id_watermark;
+        PublishFragments(std::make_shared<FragmentedRangeTombstones>(
+                *fragments_, tombstone));
+    }
+
+    void RangeTombstones::Remove(const std::vector<RangeTombstone> &tombstones) {
+        if (tombstones.empty()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::set<SequenceNumber> removed;
+        for (const auto &tombstone : tombstones) {
+            if (entries_.erase(tombstone.sequence) > 0) {
+                removed.insert(tombstone.sequence);
+            }
+        }
+        if (!removed.empty()) {
+            PublishFragments(std::make_shared<FragmentedRangeTombstones>(
+                    *fragments_, removed));
+        }
+    }
+
+    std::vector<RangeTombstone> RangeTombstones::tombstones() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<RangeTombstone> tombstones;
+        tombstones.reserve(entries_.size());
+        for (const auto &it : entries_) {
+            tombstones.push_back(it.second.tombstone);
+        }
+        return tombstones;
+    }
+
+    std::vector<RangeTombstones::Entry>
+    RangeTombstones::Overlapping(const Slice &smallest,
+                                 const Slice &largest) const {
+        std::vector<Entry> entries;
+        if (size_ == 0) {
+            return entries;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &it : entries_) {
+            const RangeTombstone &tombstone = it.second.tombstone;
+            if (user_comparator_->Compare(tombstone.start, largest) > 0 ||
+                user_comparator_->Compare(tombstone.end, smallest) <= 0) {
+                continue;
+            }
+            entries.push_back(it.second);
+        }
+        return entries;
+    }
+}
@@ -0,0 +1,145 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+// Range tombstones written by DB::DeleteRange. A range tombstone is the entry
+// (start, sequence, kTypeRangeDeletion) => end. Memtables and SSTables store
+// it with their other entries. An SSTable also keeps a copy in its range
+// tombstone block. Compactions carry it to their outputs until it is
+// obsolete, see DBImpl::ObsoleteRangeTombstones.
+//
+// Nova serves a Get from the memtable or the L0 SSTables that the lookup
+// index points to, so a range tombstone may be stored far away from the keys
+// it deletes. RangeTombstones keeps all live range tombstones of a database
+// in memory. Reads check a found version against it and compactions drop the
+// versions that it deletes.
+
+#ifndef LEVELDB_RANGE_TOMBSTONE_H
+#define LEVELDB_RANGE_TOMBSTONE_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "db/dbformat.h"
+#include "leveldb/comparator.h"
+
+namespace leveldb {
+
+    // An immutable view of a set of range tombstones. The tombstones are
+    // split into sorted, non-overlapping fragments. Each fragment holds the
+    // sequence numbers of the tombstones that cover it, so a lookup is a
+    // binary search over the fragments and then over the sequence numbers.
+    //
+    // A view derived from another one shares its fragments. The tombstones
+    // added since then wait in a short unfragmented list and are merged into
+    // new fragments once the list is full.
+    class FragmentedRangeTombstones {
+    public:
+        FragmentedRangeTombstones(const Comparator *user_comparator,
+                                  const std::vector<RangeTombstone> &tombstones);
+
+        // "base" with "tombstone" added.
+        FragmentedRangeTombstones(const FragmentedRangeTombstones &base,
+                                  const RangeTombstone &tombstone);
+
+        // "base" without the tombstones whose sequence numbers are in
+        // "removed".
+        FragmentedRangeTombstones(const FragmentedRangeTombstones &base,
+                                  const std::set<SequenceNumber> &removed);
+
+        // Returns true if a tombstone that is visible at "snapshot" deletes
+        // the version "sequence" of "key".
+        bool IsDeleted(const Slice &key, SequenceNumber sequence,
+                       SequenceNumber snapshot = kMaxSequenceNumber) const;
+
+        bool empty() const {
+            return fragments_->empty() && unfragmented_.empty();
+        }
+
+        uint32_t num_fragments() const { return fragments_->size(); }
+
+        uint32_t num_unfragmented() const { return unfragmented_.size(); }
+
+    private:
+        // Deletes the versions of the user keys in [start, end) that are
+        // older than one of "sequences".
+        struct Fragment {
+            std::string start;
+            std::string end;
+            // In ascending order.
+            std::vector<SequenceNumber> sequences;
+        };
+
+        // The number of unfragmented tombstones that triggers a merge.
+        static const uint32_t kMaxUnfragmented = 32;
+
+        // Merges "tombstones" into the fragments "base".
+        std::shared_ptr<const std::vector<Fragment>>
+        Merge(const std::vector<Fragment> &base,
+              const std::vector<RangeTombstone> &tombstones) const;
+
+        const Comparator *user_comparator_;
+        std::shared_ptr<const std::vector<Fragment>> fragments_;
+        std::vector<RangeTombstone> unfragmented_;
+    };
+
+    class RangeTombstones {
+    public:
+        struct Entry {
+            RangeTombstone tombstone;
+            // Memtables with smaller ids may contain versions that the
+            // tombstone deletes.
+            uint32_t memtable_id_watermark = 0;
+        };
+
+        explicit RangeTombstones(const Comparator *user_comparator);
+
+        void Add(const RangeTombstone &tombstone,
+                 uint32_t memtable_id_watermark);
+
+        void Remove(const std::vector<RangeTombstone> &tombstones);
+
+        // Returns true if a tombstone that is visible at "snapshot" deletes
+        // the version "sequence" of "key". It does not take mutex_.
+        bool IsDeleted(const Slice &key, SequenceNumber sequence,
+                       SequenceNumber snapshot = kMaxSequenceNumber) const {
+            if (size_ == 0) {
+                return false;
+            }
+            return fragments()->IsDeleted(key, sequence, snapshot);
+        }
+
+        // The fragments of the current tombstones. Add and Remove publish a
+        // new view derived from the current one, so the returned view never
+        // changes.
+        std::shared_ptr<const FragmentedRangeTombstones> fragments() const {
+            return std::atomic_load(&fragments_);
+        }
+
+        // Returns the tombstones that overlap the user keys [smallest, largest].
+        std::vector<Entry>
+        Overlapping(const Slice &smallest, const Slice &largest) const;
+
+        std::vector<RangeTombstone> tombstones() const;
+
+        uint32_t size() const { return size_; }
+
+    private:
+        // REQUIRES: mutex_ is held.
+        void PublishFragments(
+                std::shared_ptr<const FragmentedRangeTombstones> fragments);
+
+        const Comparator *user_comparator_;
+        // Serializes the writers.
+        mutable std::mutex mutex_;
+        // Indexed by the sequence number of the tombstone.
+        std::map<SequenceNumber, Entry> entries_;
+        std::shared_ptr<const FragmentedRangeTombstones> fragments_;
+        std::atomic_uint_fast32_t size_;
+    };
+}
+
+#endif //LEVELDB_RANGE_TOMBSTONE_H
@@ -0,0 +1,432 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "db/range_tombstone.h"
+
+#include <atomic>
+#include <functional>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/nova_common.h"
+#include "common/nova_config.h"
+#include "db/compaction.h"
+#include "db/db_iter.h"
+#include "db/memtable.h"
+#include "leveldb/env.h"
+#include "ltc/compaction_thread.h"
+#include "ltc/stoc_client_impl.h"
+#include "ltc/storage_selector.h"
+#include "util/random.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+    static std::string Key(int i) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%03d", i);
+        return buf;
+    }
+
+    static RangeTombstone Tombstone(int start, int end, SequenceNumber seq) {
+        RangeTombstone tombstone;
+        tombstone.start = Key(start);
+        tombstone.end = Key(end);
+        tombstone.sequence = seq;
+        return tombstone;
+    }
+
+    class FragmentTest {
+    };
+
+    TEST(FragmentTest, Empty) {
+        FragmentedRangeTombstones fragments(BytewiseComparator(), {});
+        ASSERT_TRUE(fragments.empty());
+        ASSERT_TRUE(!fragments.IsDeleted(Key(1), 0));
+    }
+
+    TEST(FragmentTest, StartInclusiveEndExclusive) {
+        FragmentedRangeTombstones fragments(BytewiseComparator(),
+                                            {Tombstone(10, 20, 5)});
+        ASSERT_EQ(1, fragments.num_fragments());
+        ASSERT_TRUE(!fragments.IsDeleted(Key(9), 1));
+        ASSERT_TRUE(fragments.IsDeleted(Key(10), 1));
+        ASSERT_TRUE(fragments.IsDeleted(Key(19), 4));
+        ASSERT_TRUE(!fragments.IsDeleted(Key(20), 1));
+        // Versions at or after the tombstone survive.
+        ASSERT_TRUE(!fragments.IsDeleted(Key(15), 5));
+        ASSERT_TRUE(!fragments.IsDeleted(Key(15), 6));
+    }
+
+    TEST(FragmentTest, Snapshot) {
+        FragmentedRangeTombstones fragments(BytewiseComparator(),
+                                            {Tombstone(10, 20, 5)});
+        // The tombstone is invisible to older snapshots.
+        ASSERT_TRUE(!fragments.IsDeleted(Key(15), 1, 4));
+        ASSERT_TRUE(fragments.IsDeleted(Key(15), 1, 5));
+        ASSERT_TRUE(fragments.IsDeleted(Key(15), 1, 6));
+    }
+
+    TEST(FragmentTest, Overlapping) {
+        // [10, 30) @ 5 and [20, 40) @ 8.
+        FragmentedRangeTombstones fragments(
+                BytewiseComparator(),
+                {Tombstone(20, 40, 8), Tombstone(10, 30, 5)});
+        ASSERT_EQ(3, fragments.num_fragments());
+        ASSERT_TRUE(fragments.IsDeleted(Key(15), 4));
+        ASSERT_TRUE(!fragments.IsDeleted(Key(15), 6));
+        ASSERT_TRUE(fragments.IsDeleted(Key(25), 6));
+        ASSERT_TRUE(fragments.IsDeleted(Key(35), 6));
+        ASSERT_TRUE(!fragments.IsDeleted(Key(35), 8));
+        // Only [10, 30) @ 5 is visible at snapshot 6.
+        ASSERT_TRUE(fragments.IsDeleted(Key(25), 4, 6));
+        ASSERT_TRUE(!fragments.IsDeleted(Key(25), 5, 6));
+        ASSERT_TRUE(!fragments.IsDeleted(Key(35), 4, 6));
+    }
+
+    TEST(FragmentTest, Coalesce) {
+        // Adjacent tombstones with the same sequence number form one fragment.
+        FragmentedRangeTombstones fragments(
+                BytewiseComparator(),
+                {Tombstone(10, 20, 5), Tombstone(20, 30, 5),
+                 Tombstone(15, 25, 5)});
+        ASSERT_EQ(1, fragments.num_fragments());
+        ASSERT_TRUE(fragments.IsDeleted(Key(10), 1));
+        ASSERT_TRUE(fragments.IsDeleted(Key(29), 1));
+        ASSERT_TRUE(!fragments.IsDeleted(Key(30), 1));
+
+        // A gap splits them.
+        FragmentedRangeTombstones gap(
+                BytewiseComparator(),
+                {Tombstone(10, 20, 5), Tombstone(21, 30, 5)});
+        ASSERT_EQ(2, gap.num_fragments());
+        ASSERT_TRUE(!gap.IsDeleted(Key(20), 1));
+    }
+
+    TEST(FragmentTest, EmptyRange) {
+        FragmentedRangeTombstones fragments(BytewiseComparator(),
+                                            {Tombstone(20, 20, 5),
+                                             Tombstone(30, 25, 5)});
+        ASSERT_TRUE(fragments.empty());
+    }
+
+    TEST(FragmentTest, IncrementalMatchesFull) {
+        Random rnd(301);
+        std::vector<RangeTombstone> tombstones;
+        FragmentedRangeTombstones incremental(BytewiseComparator(), {});
+        std::set<SequenceNumber> removed;
+        for (int i = 1; i <= 200; i++) {
+            int start = rnd.Uniform(100);
+            tombstones.push_back(
+                    Tombstone(start, start + 1 + rnd.Uniform(20), 10 * i));
+            incremental = FragmentedRangeTombstones(incremental,
+                                                    tombstones.back());
+            if (i % 7 == 0) {
+                removed.insert(10 * (1 + rnd.Uniform(i)));
+                incremental = FragmentedRangeTombstones(incremental, removed);
+            }
+        }
+        ASSERT_TRUE(incremental.num_unfragmented() > 0);
+        std::vector<RangeTombstone> live;
+        for (const auto &tombstone : tombstones) {
+            if (removed.find(tombstone.sequence) == removed.end()) {
+                live.push_back(tombstone);
+            }
+        }
+        FragmentedRangeTombstones full(BytewiseComparator(), live);
+        for (int key = 0; key < 125; key++) {
+            for (SequenceNumber seq = 0; seq <= 2010; seq += 5) {
+                ASSERT_EQ(full.IsDeleted(Key(key), seq),
+                          incremental.IsDeleted(Key(key), seq));
+                ASSERT_EQ(full.IsDeleted(Key(key), 1, seq),
+                          incremental.IsDeleted(Key(key), 1, seq));
+            }
+        }
+    }
+
+    class RangeTombstonesTest {
+    };
+
+    TEST(RangeTombstonesTest, AddRemove) {
+        RangeTombstones tombstones(BytewiseComparator());
+        ASSERT_TRUE(!tombstones.IsDeleted(Key(15), 1));
+        tombstones.Add(Tombstone(10, 20, 5), 3);
+        tombstones.Add(Tombstone(30, 40, 6), 4);
+        ASSERT_EQ(2, tombstones.size());
+        ASSERT_TRUE(tombstones.IsDeleted(Key(15), 1));
+        ASSERT_TRUE(tombstones.IsDeleted(Key(35), 1));
+
+        // Replayed from a log file.
+        tombstones.Add(Tombstone(10, 20, 5), 7);
+        ASSERT_EQ(2, tombstones.size());
+        std::vector<RangeTombstones::Entry> entries =
+                tombstones.Overlapping(Key(0), Key(15));
+        ASSERT_EQ(1, entries.size());
+        ASSERT_EQ(5, entries[0].tombstone.sequence);
+        ASSERT_EQ(7, entries[0].memtable_id_watermark);
+        ASSERT_EQ(2, tombstones.Overlapping(Key(15), Key(30)).size());
+        ASSERT_EQ(0, tombstones.Overlapping(Key(40), Key(50)).size());
+
+        // A view taken before Remove does not change.
+        std::shared_ptr<const FragmentedRangeTombstones> fragments =
+                tombstones.fragments();
+        tombstones.Remove({Tombstone(10, 20, 5)});
+        ASSERT_EQ(1, tombstones.size());
+        ASSERT_TRUE(!tombstones.IsDeleted(Key(15), 1));
+        ASSERT_TRUE(tombstones.IsDeleted(Key(35), 1));
+        ASSERT_TRUE(fragments->IsDeleted(Key(15), 1));
+        ASSERT_EQ(1, tombstones.tombstones().size());
+    }
+
+    TEST(RangeTombstonesTest, ConcurrentReaders) {
+        RangeTombstones tombstones(BytewiseComparator());
+        // [0, 10) stays deleted while the writer adds and removes others.
+        tombstones.Add(Tombstone(0, 10, 1000), 1);
+        std::atomic_bool done(false);
+        std::atomic<uint64_t> misses(0);
+        std::vector<std::thread> readers;
+        for (int r = 0; r < 4; r++) {
+            readers.emplace_back([&, r]() {
+                int i = r;
+                while (!done.load()) {
+                    if (!tombstones.IsDeleted(Key(i % 10), 1)) {
+                        misses.fetch_add(1);
+                    }
+                    i++;
+                }
+            });
+        }
+        for (int i = 1; i < 500; i++) {
+            tombstones.Add(Tombstone(10 + i % 90, 11 + i % 90, i), 1);
+            if (i % 3 == 0) {
+                tombstones.Remove({Tombstone(10 + i % 90, 11 + i % 90, i)});
+            }
+        }
+        done.store(true);
+        for (auto &reader : readers) {
+            reader.join();
+        }
+        ASSERT_EQ(0, misses.load());
+        ASSERT_EQ(1 + 499 - 166, tombstones.size());
+    }
+
+    // Writes go to a memtable and range tombstones are also added to
+    // RangeTombstones, as in DBImpl. Get and MultiGet check a version found in
+    // a memtable against RangeTombstones in the same way as DBImpl.
+    class RangeDeletionTest {
+    public:
+        RangeDeletionTest()
+                : icmp_(BytewiseComparator()),
+                  tombstones_(BytewiseComparator()) {
+            mem_ = new MemTable(icmp_, 1, nullptr, true);
+            mem_->Ref();
+        }
+
+        ~RangeDeletionTest() { mem_->Unref(); delete mem_; }
+
+        void Put(int key, const std::string &value) {
+            mem_->Add(++seq_, kTypeValue, Key(key), value);
+        }
+
+        void Delete(int key) {
+            mem_->Add(++seq_, kTypeDeletion, Key(key), Slice());
+        }
+
+        void DeleteRange(int start, int end) {
+            mem_->Add(++seq_, kTypeRangeDeletion, Key(start), Key(end));
+            tombstones_.Add(Tombstone(start, end, seq_), 1);
+        }
+
+        std::string Get(int key) {
+            LookupKey lkey(Key(key), kMaxSequenceNumber);
+            std::string value;
+            Status s;
+            SequenceNumber seq = 0;
+            if (mem_->Get(lkey, &value, &s, &seq) && s.ok() &&
+                !tombstones_.IsDeleted(Key(key), seq)) {
+                return value;
+            }
+            return "NOT_FOUND";
+        }
+
+        std::vector<std::string> MultiGet(const std::vector<int> &keys) {
+            std::vector<std::string> values;
+            for (int key : keys) {
+                values.push_back(Get(key));
+            }
+            return values;
+        }
+
+        Iterator *NewIterator(SequenceNumber snapshot = kMaxSequenceNumber) {
+            nova::RangePartition range = {0, 1000};
+            return NewDBIterator(tombstones_.fragments(), BytewiseComparator(),
+                                 mem_->NewIterator(TraceType::MEMTABLE,
+                                                   AccessCaller::kUserIterator),
+                                 std::min(snapshot, seq_), 0, range);
+        }
+
+        // The key=value pairs in iteration order.
+        std::string Scan(SequenceNumber snapshot = kMaxSequenceNumber) {
+            std::string result;
+            Iterator *iter = NewIterator(snapshot);
+            for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+                result += iter->key().ToString() + "=" +
+                          iter->value().ToString() + " ";
+            }
+            delete iter;
+            return result;
+        }
+
+        std::string ReverseScan() {
+            std::string result;
+            Iterator *iter = NewIterator();
+            for (iter->SeekToLast(); iter->Valid(); iter->Prev()) {
+                result += iter->key().ToString() + "=" +
+                          iter->value().ToString() + " ";
+            }
+            delete iter;
+            return result;
+        }
+
+        // Compact the memtable into a list of "key@seq:type" entries.
+        // "smallest_snapshot" is at most the last sequence number, as in
+        // DBImpl.
+        std::string Compact(SequenceNumber smallest_snapshot,
+                            const std::vector<RangeTombstone> &obsolete) {
+            std::function<uint64_t(void)> fn_generator = []() {
+                return (uint64_t) 0;
+            };
+            LTCNoopCompactionThread bg_thread;
+            CompactionJob job(fn_generator, Env::Default(), "/tmp",
+                              BytewiseComparator(), options_, &bg_thread,
+                              nullptr);
+            CompactionState state(nullptr, nullptr, smallest_snapshot);
+            state.range_tombstones = tombstones_.tombstones();
+            state.obsolete_range_tombstones = obsolete;
+            CompactionStats stats;
+            std::string result;
+            Status s = job.CompactTables(
+                    &state, mem_->NewIterator(TraceType::MEMTABLE,
+                                              AccessCaller::kCompaction),
+                    &stats, true, kCompactInputMemTables,
+                    kCompactOutputMemTables,
+                    [&](const ParsedInternalKey &ikey, const Slice &value) {
+                        result += ikey.user_key.ToString() + "@" +
+                                  std::to_string(ikey.sequence) + ":" +
+                                  std::to_string(ikey.type) + " ";
+                    });
+            ASSERT_OK(s);
+            return result;
+        }
+
+        InternalKeyComparator icmp_;
+        Options options_;
+        MemTable *mem_ = nullptr;
+        RangeTombstones tombstones_;
+        SequenceNumber seq_ = 0;
+    };
+
+    TEST(RangeDeletionTest, Get) {
+        Put(1, "a");
+        Put(2, "b");
+        Put(3, "c");
+        Put(5, "e");
+        Delete(1);
+        DeleteRange(2, 5);
+        ASSERT_EQ("NOT_FOUND", Get(1));
+        ASSERT_EQ("NOT_FOUND", Get(2));
+        ASSERT_EQ("NOT_FOUND", Get(3));
+        ASSERT_EQ("e", Get(5));
+
+        // Newer versions are visible.
+        Put(3, "c2");
+        Put(1, "a2");
+        ASSERT_EQ("a2", Get(1));
+        ASSERT_EQ("NOT_FOUND", Get(2));
+        ASSERT_EQ("c2", Get(3));
+    }
+
+    TEST(RangeDeletionTest, MultiGet) {
+        for (int i = 0; i < 10; i++) {
+            Put(i, "v" + std::to_string(i));
+        }
+        DeleteRange(2, 4);
+        Delete(6);
+        DeleteRange(8, 20);
+        std::vector<std::string> expected = {
+                "v0", "v1", "NOT_FOUND", "NOT_FOUND", "v4", "v5", "NOT_FOUND",
+                "v7", "NOT_FOUND", "NOT_FOUND", "NOT_FOUND"};
+        ASSERT_TRUE(expected ==
+                    MultiGet({0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10}));
+    }
+
+    TEST(RangeDeletionTest, Iterator) {
+        for (int i = 0; i < 8; i++) {
+            Put(i, "v" + std::to_string(i));
+        }
+        SequenceNumber before = seq_;
+        Delete(1);
+        DeleteRange(3, 6);
+        Put(4, "v4.2");
+        ASSERT_EQ("000=v0 002=v2 004=v4.2 006=v6 007=v7 ", Scan());
+        ASSERT_EQ("007=v7 006=v6 004=v4.2 002=v2 000=v0 ", ReverseScan());
+        // An older snapshot does not see the deletions.
+        ASSERT_EQ("000=v0 001=v1 002=v2 003=v3 004=v4 005=v5 006=v6 007=v7 ",
+                  Scan(before));
+
+        Iterator *iter = NewIterator();
+        iter->Seek(Key(3));
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(Key(4), iter->key().ToString());
+        iter->Seek(Key(5));
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(Key(6), iter->key().ToString());
+        delete iter;
+    }
+
+    TEST(RangeDeletionTest, IteratorSkipsDeletedRuns) {
+        // Next() steps from a live key straight onto a deleted one.
+        for (int i = 0; i < 20; i++) {
+            Put(i, "v");
+        }
+        DeleteRange(1, 10);
+        Delete(11);
+        DeleteRange(12, 19);
+        ASSERT_EQ("000=v 010=v 019=v ", Scan());
+    }
+
+    TEST(RangeDeletionTest, CompactionDropsDeletedVersions) {
+        Put(1, "a");
+        Put(2, "b");
+        Put(3, "c");
+        DeleteRange(1, 3);
+        Put(2, "b2");
+        // 001@1, 002@2 and 003@3 are values; 001@4 is the tombstone.
+        ASSERT_EQ("001@4:2 002@5:1 003@3:1 ", Compact(seq_, {}));
+
+        // The tombstone is dropped once it is obsolete.
+        ASSERT_EQ("002@5:1 003@3:1 ",
+                  Compact(seq_, {Tombstone(1, 3, 4)}));
+    }
+
+    TEST(RangeDeletionTest, CompactionKeepsVersionsVisibleToSnapshots) {
+        Put(1, "a");
+        Put(2, "b");
+        DeleteRange(1, 3);
+        // A snapshot at 2 still reads 001@1 and 002@2.
+        ASSERT_EQ("001@3:2 001@1:1 002@2:1 ", Compact(2, {}));
+        ASSERT_EQ("001@3:2 ", Compact(3, {}));
+    }
+
+}  // namespace leveldb
+
+nova::NovaConfig *nova::NovaConfig::config;
+nova::NovaGlobalVariables nova::NovaGlobalVariables::global;
+std::atomic<nova::Servers *> leveldb::StorageSelector::available_stoc_servers;
+std::atomic_int_fast32_t leveldb::StorageSelector::stoc_for_compaction_seq_id;
+std::atomic_int_fast32_t leveldb::StoCBlockClient::rdma_worker_seq_id_;
+
+int main(int argc, char **argv) { return leveldb::test::RunAllTests(); }
@@ -1183,7 +1183,9 @@ namespace leveldb {
                                 partition->slot_imm_id[next_imm_slot] = table->memtableid();
                                 uint32_t memtable_id = memtable_id_seq_->fetch_add(1);
                                 partition->immutable_memtable_ids.push_back(table->memtableid());
-                                table = new MemTable(*internal_comparator_, memtable_id, nullptr, true);
+                                table = new MemTable(*internal_comparator_, memtable_id, nullptr, true,
+                                                     options_.memtable_representation,
+                                                     MemTableHashIndexBuckets(options_));
                                 auto new_atomic_table = versions_->mid_table_mapping_[table->memtableid()];
                                 NOVA_ASSERT(memtable_id < MAX_LIVE_MEMTABLES);
                                 new_atomic_table->SetMemTable(impacted_dranges.generation_id, table);
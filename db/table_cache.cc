@@ -16,12 +16,15 @@ namespace leveldb {
     struct TableAndFile {
         RandomAccessFile *file = nullptr;
         Table *table = nullptr;
+        // Owned copy of the file's metadata in a shared table cache.
+        FileMetaData *meta = nullptr;
     };
 
     static void DeleteEntry(const Slice &key, void *value) {
         TableAndFile *tf = reinterpret_cast<TableAndFile *>(value);
         delete tf->table;
         delete tf->file;
+        delete tf->meta;
         delete tf;
     }
 
@@ -38,7 +41,18 @@ namespace leveldb {
               options_(options),
               cache_(NewLRUCache(entries)), db_profiler_(db_profiler) {}
 
-    TableCache::~TableCache() { delete cache_; }
+    TableCache::TableCache(const std::string &dbname, const Options &options,
+                           Cache *shared_cache)
+            : env_(options.env),
+              dbname_(dbname),
+              options_(options),
+              cache_(shared_cache), shared_(true) {}
+
+    TableCache::~TableCache() {
+        if (!shared_) {
+            delete cache_;
+        }
+    }
 
 //    bool
 //    TableCache::IsTableCached(AccessCaller caller, const FileMetaData *meta) {
@@ -76,6 +90,14 @@ namespace leveldb {
         EncodeFixed64(buf + 1, file_number);
         EncodeFixed32(buf + 9, replica_id);
         Slice key(buf, 1 + 8 + 4);
+        std::string prefixed_key;
+        if (shared_) {
+            prefixed_key = dbname_;
+            prefixed_key.append(buf, 1 + 8 + 4);
+            key = prefixed_key;
+        }
+        uint64_t charge = shared_ ? file_size : 1;
+        TableAndFile *tf = nullptr;
         StoCRandomAccessFileClientImpl *file = nullptr;
         if (force_insert) {
             Table *table = nullptr;
@@ -85,6 +107,11 @@ namespace leveldb {
             }
             std::string filename = TableFileName(dbname_, file_number, FileInternalType::kFileData,
                                                  replica_id);
+            tf = new TableAndFile;
+            if (shared_) {
+                tf->meta = new FileMetaData(*meta);
+                meta = tf->meta;
+            }
             file = new StoCRandomAccessFileClientImpl(env_, options_, dbname_,
                                                       file_number,
                                                       replica_id,
@@ -99,10 +126,9 @@ namespace leveldb {
             NOVA_ASSERT(s.ok())
                 << fmt::format("file:{} status:{}", meta->DebugString(),
                                s.ToString());
-            TableAndFile *tf = new TableAndFile;
             tf->file = file;
             tf->table = table;
-            *handle = cache_->Insert(key, tf, 1, &DeleteEntry);
+            *handle = cache_->Insert(key, tf, charge, &DeleteEntry);
             return s;
         }
 
@@ -115,11 +141,17 @@ namespace leveldb {
         if (*handle) {
             cache_hit = true;
             // Check if the file is deleted.
-            TableAndFile *tf = reinterpret_cast<TableAndFile *>(cache_->Value(*handle));
+            tf = reinterpret_cast<TableAndFile *>(cache_->Value(*handle));
             file = dynamic_cast<StoCRandomAccessFileClientImpl *>(tf->file);
         } else {
             cache_hit = false;
         }
+        if (shared_) {
+            nova::NovaGlobalVariables::global.stoc_table_cache_lookups += 1;
+            if (cache_hit) {
+                nova::NovaGlobalVariables::global.stoc_table_cache_hits += 1;
+            }
+        }
 
         if (!cache_hit) {
             Table *table = nullptr;
@@ -128,6 +160,11 @@ namespace leveldb {
                 prefetch_all = true;
             }
             std::string filename = TableFileName(dbname_, file_number, FileInternalType::kFileData, replica_id);
+            tf = new TableAndFile;
+            if (shared_) {
+                tf->meta = new FileMetaData(*meta);
+                meta = tf->meta;
+            }
             file = new StoCRandomAccessFileClientImpl(env_, options_, dbname_,
                                                       file_number,
                                                       replica_id,
@@ -142,10 +179,9 @@ namespace leveldb {
             NOVA_ASSERT(s.ok())
                 << fmt::format("file:{} status:{}", meta->DebugString(),
                                s.ToString());
-            TableAndFile *tf = new TableAndFile;
             tf->file = file;
             tf->table = table;
-            *handle = cache_->Insert(key, tf, 1, &DeleteEntry);
+            *handle = cache_->Insert(key, tf, charge, &DeleteEntry);
         }
         NOVA_LOG(rdmaio::DEBUG)
             << fmt::format("table cache hit {} fn:{} cs:{} ltc:{}", cache_hit,
@@ -201,6 +237,35 @@ namespace leveldb {
         return s;
     }
 
+    Status
+    TableCache::GetTable(const ReadOptions &options, const FileMetaData *meta,
+                         uint64_t file_number, uint32_t replica_id,
+                         uint64_t file_size, int level,
+                         Cache::Handle **handle, Table **table) {
+        *table = nullptr;
+        Status s = FindTable(AccessCaller::kUserGet, options, meta, file_number,
+                             replica_id, file_size, level, handle);
+        if (s.ok()) {
+            *table = reinterpret_cast<TableAndFile *>(cache_->Value(
+                    *handle))->table;
+        }
+        return s;
+    }
+
+    void TableCache::Release(Cache::Handle *handle) {
+        cache_->Release(handle);
+    }
+
+    void TableCache::Erase(const Slice &key) {
+        if (!shared_) {
+            cache_->Erase(key);
+            return;
+        }
+        std::string prefixed_key = dbname_;
+        prefixed_key.append(key.data(), key.size());
+        cache_->Erase(prefixed_key);
+    }
+
     void TableCache::Evict(uint64_t file_number, bool compaction_file_only) {
         char buf[1 + 8 + 4];
         buf[0] = 'c';
@@ -208,7 +273,7 @@ namespace leveldb {
                                  nova::NovaConfig::config->number_of_sstable_metadata_replicas; replica_id++) {
             EncodeFixed64(buf + 1, file_number);
             EncodeFixed32(buf + 9, replica_id);
-            cache_->Erase(Slice(buf, 1 + 8 + 4));
+            Erase(Slice(buf, 1 + 8 + 4));
         }
 
         if (compaction_file_only) {
@@ -220,7 +285,7 @@ namespace leveldb {
                                  nova::NovaConfig::config->number_of_sstable_metadata_replicas; replica_id++) {
             EncodeFixed64(buf + 1, file_number);
             EncodeFixed32(buf + 9, replica_id);
-            cache_->Erase(Slice(buf, 1 + 8 + 4));
+            Erase(Slice(buf, 1 + 8 + 4));
         }
     }
 
@@ -25,6 +25,14 @@ namespace leveldb {
         TableCache(const std::string &dbname, const Options &options,
                    int entries, DBProfiler *db_profiler);
 
+        // A table cache backed by "shared_cache", which it does not own.
+        // Several databases may share the cache, so keys are prefixed with
+        // the database name. Each table is charged its file size and owns a
+        // copy of its FileMetaData, so it outlives the request that opened
+        // it. Lookups are counted in the StoC table cache stats.
+        TableCache(const std::string &dbname, const Options &options,
+                   Cache *shared_cache);
+
         ~TableCache();
 
         // Return an iterator for the specified file number (the corresponding
@@ -47,6 +55,16 @@ namespace leveldb {
                    uint64_t file_size, int level, const Slice &k, void *arg,
                    void (*handle_result)(void *, const Slice &, const Slice &));
 
+        // Return the table of the specified file in "*table". The table is
+        // pinned in the cache until the caller calls Release(*handle).
+        Status
+        GetTable(const ReadOptions &options, const FileMetaData *meta,
+                 uint64_t file_number, uint32_t replica_id,
+                 uint64_t file_size, int level, Cache::Handle **handle,
+                 Table **table);
+
+        void Release(Cache::Handle *handle);
+
         // Evict any entry for the specified file number
         void
         Evict(uint64_t file_number, bool compaction_file_only);
@@ -61,10 +79,14 @@ namespace leveldb {
 
         Cache *cache_;
     private:
+        // Erase the entry whose unprefixed key is "key".
+        void Erase(const Slice &key);
+
         Env *const env_;
         const std::string dbname_;
         const Options options_;
         DBProfiler *db_profiler_ = nullptr;
+        const bool shared_ = false;
     };
 
 }  // namespace leveldb
@@ -70,7 +70,7 @@ namespace leveldb {
                 const InternalKey &smallest,
                 const InternalKey &largest,
                 const std::vector<FileReplicaMetaData>& replicas,
-                StoCBlockHandle parity_block_handle) {
+                const std::vector<StoCBlockHandle> &parity_block_handles) {
             FileMetaData f;
             f.level = level;
             f.memtable_ids = memtable_ids;
@@ -81,7 +81,7 @@ namespace leveldb {
             f.smallest = smallest;
             f.largest = largest;
             f.block_replica_handles = replicas;
-            f.parity_block_handle = parity_block_handle;
+            f.parity_block_handles = parity_block_handles;
             new_files_.emplace_back(std::make_pair(level, f));
         }
 
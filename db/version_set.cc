@@ -7,6 +7,9 @@
 #include <stdio.h>
 
 #include <algorithm>
+#include <map>
+#include <memory>
+#include <tuple>
 #include <fmt/core.h>
 #include <getopt.h>
 #include <common/nova_common.h>
@@ -20,6 +23,7 @@
 #include "db/memtable.h"
 #include "db/table_cache.h"
 #include "leveldb/env.h"
+#include "leveldb/filter_policy.h"
 #include "leveldb/table_builder.h"
 #include "table/merger.h"
 #include "table/two_level_iterator.h"
@@ -311,12 +315,51 @@ namespace leveldb {
                 s->state = (parsed_key.type == kTypeValue) ? kFound : kDeleted;
                 if (s->state == kFound) {
                     s->value->assign(v.data(), v.size());
-                    *s->seq = parsed_key.sequence;
                 }
+                *s->seq = parsed_key.sequence;
             }
         }
     }
 
+    // Resumes the lookup of "ikey" in "file" with the data block that the
+    // caller has read. See ReadOptions::deferred_block_reads.
+    static Status ResumeTableGet(TableCache *table_cache,
+                                 const ReadOptions &options,
+                                 FileMetaData *file, int level,
+                                 const Slice &ikey, Saver *saver) {
+        DeferredBlockReads *deferred = options.deferred_block_reads;
+        if (deferred->block == nullptr) {
+            // The caller could not read the block. Wait for it instead.
+            ReadOptions blocking_options = options;
+            blocking_options.deferred_block_reads = nullptr;
+            return table_cache->Get(blocking_options, file, file->number,
+                                    file->SelectReplica(),
+                                    file->converted_file_size, level, ikey,
+                                    saver, SaveValue);
+        }
+        Cache::Handle *table_handle = nullptr;
+        Table *table = nullptr;
+        Status s = table_cache->GetTable(options, file, file->number,
+                                         file->SelectReplica(),
+                                         file->converted_file_size, level,
+                                         &table_handle, &table);
+        if (!s.ok()) {
+            return s;
+        }
+        const StoCBlockHandle &handle = deferred->pending;
+        Iterator *block_iter = table->NewDataBlock(
+                options, handle,
+                Slice(deferred->block, handle.size + kBlockTrailerSize));
+        block_iter->SeekForGet(ikey);
+        if (block_iter->Valid()) {
+            SaveValue(saver, block_iter->key(), block_iter->value());
+        }
+        s = block_iter->status();
+        delete block_iter;
+        table_cache->Release(table_handle);
+        return s;
+    }
+
     static bool NewestFirst(FileMetaData *a, FileMetaData *b) {
         return a->number > b->number;
     }
@@ -374,9 +417,30 @@ namespace leveldb {
                         std::vector<uint64_t> &fns,
                         const leveldb::LookupKey &key,
                         SequenceNumber *seq,
-                        std::string *val, uint64_t *num_searched_files) {
+                        std::string *val, uint64_t *num_searched_files,
+                        SuspendedGet *suspended) {
+        if (options_->enable_parallel_l0_probe && options.stoc_client &&
+            options.mem_manager && options.deferred_block_reads == nullptr) {
+            return ParallelGet(options, fns, key, seq, val,
+                               num_searched_files);
+        }
         bool found = false;
-        for (int i = fns.size() - 1; i >= 0; i--) {
+        bool deleted = false;
+        std::string tmp_val;
+        int i = fns.size() - 1;
+        bool resume = suspended != nullptr && suspended->file_number != 0;
+        if (resume) {
+            found = suspended->found;
+            deleted = suspended->deleted;
+            *seq = suspended->seq;
+            val->swap(suspended->value);
+            while (i >= 0 && fns[i] != suspended->file_number) {
+                i--;
+            }
+            NOVA_ASSERT(i >= 0) << suspended->file_number;
+            suspended->file_number = 0;
+        }
+        for (; i >= 0; i--) {
             auto fn = fns[i];
             if (fn_files_.find(fn) == fn_files_.end()) {
                 return Status::IOError(fmt::format("fn {} not found", fn));
@@ -394,31 +458,251 @@ namespace leveldb {
                     file->largest.user_key(), key.user_key()) < 0) {
                 continue;
             }
-            *num_searched_files += 1;
             SequenceNumber tmp_seq;
             Saver saver;
             saver.state = kNotFound;
             saver.ucmp = icmp_->user_comparator();
             saver.user_key = key.user_key();
-            saver.value = val;
+            saver.value = &tmp_val;
             saver.seq = &tmp_seq;
-            Status s = table_cache_->Get(options,
-                                         file,
-                                         file->number,
-                                         file->SelectReplica(),
-                                         file->converted_file_size,
-                                         0,
-                                         key.internal_key(),
-                                         &saver,
-                                         SaveValue);
-            if (saver.state == kFound) {
-                found = true;
-                if (tmp_seq > *seq) {
-                    // A newer value.
+            Status s;
+            if (resume) {
+                resume = false;
+                s = ResumeTableGet(table_cache_, options, file, 0,
+                                   key.internal_key(), &saver);
+            } else {
+                *num_searched_files += 1;
+                s = table_cache_->Get(options,
+                                      file,
+                                      file->number,
+                                      file->SelectReplica(),
+                                      file->converted_file_size,
+                                      0,
+                                      key.internal_key(),
+                                      &saver,
+                                      SaveValue);
+            }
+            if (s.IsIncomplete()) {
+                NOVA_ASSERT(suspended);
+                suspended->file_number = fn;
+                suspended->found = found;
+                suspended->deleted = deleted;
+                suspended->seq = *seq;
+                suspended->value.swap(*val);
+                return s;
+            }
+            if (saver.state == kFound || saver.state == kDeleted) {
+                if (!found || tmp_seq > *seq) {
+                    // A newer value or deletion.
                     *seq = tmp_seq;
-//                    val->assign(tmp_val);
+                    deleted = saver.state == kDeleted;
+                    if (!deleted) {
+                        val->swap(tmp_val);
+                    }
+                }
+                found = true;
+            }
+        }
+        if (found && deleted) {
+            return Status::NotFound("Deleted in L0");
+        }
+        if (found) {
+            return Status::OK();
+        }
+        return Status::NotFound("Not found in L0");
+    }
+
+    Status Version::ParallelGet(const leveldb::ReadOptions &options,
+                                std::vector<uint64_t> &fns,
+                                const leveldb::LookupKey &key,
+                                SequenceNumber *seq, std::string *val,
+                                uint64_t *num_searched_files) {
+        struct L0Probe {
+            FileMetaData *file;
+            Cache::Handle *table_handle;
+            Table *table;
+            StoCBlockHandle block_handle;
+            Iterator *block_iter;
+            char *buf;
+            char *backing_mem;
+        };
+        const Comparator *ucmp = icmp_->user_comparator();
+        uint32_t scid = options.mem_manager->slabclassid(options.thread_id,
+                                                         MAX_BLOCK_SIZE);
+        bool use_rdma_backing_mem = options.rdma_backing_mem != nullptr;
+        uint32_t pending_reads = 0;
+        std::vector<L0Probe> probes;
+        Status s;
+
+        // Phase 1: Locate the data block of all candidate SSTables, newest
+        // first, and check their filters in one batch. Then issue a read for
+        // every data block that may contain the key and is not in the block
+        // cache without waiting for it.
+        std::vector<L0Probe> candidates;
+        std::vector<Slice> filters;
+        std::vector<uint32_t> filtered;
+        for (int i = fns.size() - 1; i >= 0; i--) {
+            auto fn = fns[i];
+            auto it = fn_files_.find(fn);
+            if (it == fn_files_.end()) {
+                s = Status::IOError(fmt::format("fn {} not found", fn));
+                break;
+            }
+            FileMetaData *file = it->second;
+            NOVA_ASSERT(file) << fn;
+            NOVA_ASSERT(file->number == fn);
+            if (ucmp->Compare(file->smallest.user_key(), key.user_key()) > 0) {
+                continue;
+            }
+            if (ucmp->Compare(file->largest.user_key(), key.user_key()) < 0) {
+                continue;
+            }
+            *num_searched_files += 1;
+            L0Probe probe = {};
+            probe.file = file;
+            s = table_cache_->GetTable(options, file, file->number,
+                                       file->SelectReplica(),
+                                       file->converted_file_size, 0,
+                                       &probe.table_handle, &probe.table);
+            if (!s.ok()) {
+                break;
+            }
+            Slice filter;
+            bool has_filter = false;
+            if (!probe.table->LocateGet(key.internal_key(),
+                                        &probe.block_handle, &filter,
+                                        &has_filter)) {
+                table_cache_->Release(probe.table_handle);
+                continue;
+            }
+            if (has_filter) {
+                filtered.push_back(candidates.size());
+                filters.push_back(filter);
+            }
+            candidates.push_back(probe);
+        }
+
+        std::unique_ptr<bool[]> may_match(new bool[candidates.size()]);
+        std::fill(may_match.get(), may_match.get() + candidates.size(), true);
+        if (!filters.empty()) {
+            std::unique_ptr<bool[]> results(new bool[filters.size()]);
+            candidates[filtered[0]].table->filter_policy()->KeyMayMatchBatch(
+                    key.internal_key(), filters.data(), filters.size(),
+                    results.get());
+            for (uint32_t i = 0; i < filtered.size(); i++) {
+                may_match[filtered[i]] = results[i];
+            }
+        }
+
+        for (uint32_t i = 0; i < candidates.size(); i++) {
+            L0Probe probe = candidates[i];
+            if (!may_match[i]) {
+                table_cache_->Release(probe.table_handle);
+                continue;
+            }
+            probe.block_iter = probe.table->CachedDataBlock(
+                    probe.block_handle);
+            if (probe.block_iter == nullptr) {
+                uint32_t n = probe.block_handle.size + kBlockTrailerSize;
+                probe.buf = new char[n];
+                if (use_rdma_backing_mem) {
+                    // The first read uses the worker's backing memory.
+                    probe.backing_mem = options.rdma_backing_mem;
+                    use_rdma_backing_mem = false;
+                } else {
+                    probe.backing_mem = options.mem_manager->ItemAlloc(
+                            options.thread_id, scid);
+                    NOVA_ASSERT(probe.backing_mem) << "Running out of memory";
                 }
+                auto ra_file = reinterpret_cast<StoCRandomAccessFileClient *>(probe.table->file());
+                if (ra_file->InitiateRead(options, probe.block_handle,
+                                          probe.block_handle.offset, n,
+                                          probe.backing_mem, probe.buf)) {
+                    pending_reads += 1;
+                } else {
+                    if (probe.backing_mem == options.rdma_backing_mem) {
+                        use_rdma_backing_mem = true;
+                    } else {
+                        options.mem_manager->FreeItem(options.thread_id,
+                                                      probe.backing_mem,
+                                                      scid);
+                    }
+                    probe.backing_mem = nullptr;
+                }
+            }
+            probes.push_back(probe);
+        }
+
+        // Phase 2: Wait for all outstanding reads. Their buffers can only
+        // be reused once the StoC has completed them.
+        auto stoc_client = reinterpret_cast<StoCBlockClient *>(options.stoc_client);
+        for (uint32_t i = 0; i < pending_reads; i++) {
+            stoc_client->Wait();
+        }
+
+        // Phase 3: Search the fetched blocks. The value with the newest
+        // sequence number wins. With ordered flush, a newer SSTable always
+        // contains newer values so the blocks of older SSTables are
+        // abandoned once the key is found.
+        bool found = false;
+        bool deleted = false;
+        std::string tmp_val;
+        for (auto &probe : probes) {
+            uint32_t n = probe.block_handle.size + kBlockTrailerSize;
+            bool abandon = !s.ok() ||
+                           (found && nova::NovaConfig::config->use_ordered_flush);
+            if (!abandon) {
+                if (probe.block_iter == nullptr) {
+                    if (probe.backing_mem) {
+                        NOVA_ASSERT(nova::IsRDMAWRITEComplete(probe.backing_mem, n));
+                        memcpy(probe.buf, probe.backing_mem, n);
+                    }
+                    probe.block_iter = probe.table->NewDataBlock(options,
+                                                                 probe.block_handle,
+                                                                 probe.buf);
+                    probe.buf = nullptr;
+                }
+                probe.block_iter->SeekForGet(key.internal_key());
+                if (probe.block_iter->Valid()) {
+                    SequenceNumber tmp_seq = 0;
+                    Saver saver;
+                    saver.state = kNotFound;
+                    saver.ucmp = ucmp;
+                    saver.user_key = key.user_key();
+                    saver.value = &tmp_val;
+                    saver.seq = &tmp_seq;
+                    SaveValue(&saver, probe.block_iter->key(),
+                              probe.block_iter->value());
+                    if (saver.state == kFound || saver.state == kDeleted) {
+                        if (!found || tmp_seq > *seq) {
+                            // A newer value or deletion.
+                            *seq = tmp_seq;
+                            deleted = saver.state == kDeleted;
+                            if (!deleted) {
+                                val->swap(tmp_val);
+                            }
+                        }
+                        found = true;
+                    }
+                }
+                if (s.ok()) {
+                    s = probe.block_iter->status();
+                }
+            }
+            delete probe.block_iter;
+            delete[] probe.buf;
+            if (probe.backing_mem &&
+                probe.backing_mem != options.rdma_backing_mem) {
+                options.mem_manager->FreeItem(options.thread_id,
+                                              probe.backing_mem, scid);
             }
+            table_cache_->Release(probe.table_handle);
+        }
+        if (!s.ok()) {
+            return s;
+        }
+        if (found && deleted) {
+            return Status::NotFound("Deleted in L0");
         }
         if (found) {
             return Status::OK();
@@ -426,11 +710,259 @@ namespace leveldb {
         return Status::NotFound("Not found in L0");
     }
 
+    namespace {
+        struct MultiGetProbe {
+            Version::MultiGetKey *key;
+            Cache::Handle *table_handle;
+            Table *table;
+            StoCBlockHandle block_handle;
+            Iterator *block_iter;
+            char *buf;
+        };
+
+        struct CoalescedRead {
+            std::vector<StoCBlockHandle> block_handles;
+            uint32_t size = 0;
+            char *backing_mem = nullptr;
+        };
+
+        // Location of a block in the backing memory of a coalesced read.
+        struct CoalescedBlock {
+            uint32_t server_id;
+            uint32_t read_id;
+            uint32_t offset;
+        };
+
+        const uint32_t kMaxBlocksPerCoalescedRead = 64;
+        const uint32_t kMaxCoalescedReadSize = 64 * MAX_BLOCK_SIZE;
+
+        // Fetch the data blocks of the probes that are not in the block
+        // cache into probe.buf. Blocks on the same StoC are fetched with one
+        // request and a block is fetched once even if many probes need it.
+        void FetchDataBlocks(const ReadOptions &options,
+                             std::vector<MultiGetProbe> *probes) {
+            std::map<uint32_t, std::vector<CoalescedRead>> reads;
+            std::map<std::tuple<uint32_t, uint32_t, uint64_t>, CoalescedBlock> blocks;
+            std::vector<std::pair<MultiGetProbe *, CoalescedBlock>> fetches;
+            for (auto &probe : *probes) {
+                if (probe.block_iter != nullptr) {
+                    continue;
+                }
+                const StoCBlockHandle &handle = probe.block_handle;
+                uint32_t n = handle.size + kBlockTrailerSize;
+                probe.buf = new char[n];
+                auto ra_file = reinterpret_cast<StoCRandomAccessFileClient *>(probe.table->file());
+                if (!ra_file->IsRemoteRead(handle)) {
+                    Slice result;
+                    NOVA_ASSERT(ra_file->Read(options, handle, handle.offset,
+                                              n, &result, probe.buf).ok());
+                    if (result.data() != probe.buf) {
+                        memcpy(probe.buf, result.data(), n);
+                    }
+                    continue;
+                }
+                auto id = std::make_tuple(handle.server_id,
+                                          handle.stoc_file_id,
+                                          handle.offset);
+                auto it = blocks.find(id);
+                if (it != blocks.end()) {
+                    fetches.emplace_back(&probe, it->second);
+                    continue;
+                }
+                std::vector<CoalescedRead> &server_reads = reads[handle.server_id];
+                if (server_reads.empty() ||
+                    server_reads.back().block_handles.size() >=
+                    kMaxBlocksPerCoalescedRead ||
+                    server_reads.back().size + n > kMaxCoalescedReadSize) {
+                    server_reads.emplace_back();
+                }
+                CoalescedRead &read = server_reads.back();
+                CoalescedBlock block = {};
+                block.server_id = handle.server_id;
+                block.read_id = server_reads.size() - 1;
+                block.offset = read.size;
+                StoCBlockHandle read_handle = handle;
+                read_handle.size = n;
+                read.block_handles.push_back(read_handle);
+                read.size += n;
+                blocks[id] = block;
+                fetches.emplace_back(&probe, block);
+            }
+            if (fetches.empty()) {
+                return;
+            }
+
+            NOVA_ASSERT(options.stoc_client && options.mem_manager);
+            auto stoc_client = reinterpret_cast<StoCBlockClient *>(options.stoc_client);
+            uint32_t pending_reads = 0;
+            for (auto &server_reads : reads) {
+                for (auto &read : server_reads.second) {
+                    uint32_t scid = options.mem_manager->slabclassid(
+                            options.thread_id, read.size);
+                    read.backing_mem = options.mem_manager->ItemAlloc(
+                            options.thread_id, scid);
+                    NOVA_ASSERT(read.backing_mem) << "Running out of memory";
+                    stoc_client->InitiateReadDataBlocks(read.block_handles,
+                                                        read.backing_mem,
+                                                        read.size, true);
+                    pending_reads += 1;
+                }
+            }
+            for (uint32_t i = 0; i < pending_reads; i++) {
+                stoc_client->Wait();
+            }
+            for (auto &fetch : fetches) {
+                const CoalescedBlock &block = fetch.second;
+                const CoalescedRead &read = reads[block.server_id][block.read_id];
+                NOVA_ASSERT(nova::IsRDMAWRITEComplete(read.backing_mem, read.size));
+                memcpy(fetch.first->buf, read.backing_mem + block.offset,
+                       fetch.first->block_handle.size + kBlockTrailerSize);
+            }
+            for (auto &server_reads : reads) {
+                for (auto &read : server_reads.second) {
+                    uint32_t scid = options.mem_manager->slabclassid(
+                            options.thread_id, read.size);
+                    options.mem_manager->FreeItem(options.thread_id,
+                                                  read.backing_mem, scid);
+                }
+            }
+        }
+    }
+
+    void Version::MultiGet(const ReadOptions &options,
+                           std::vector<MultiGetKey> *keys,
+                           uint64_t *num_searched_files) {
+        const Comparator *ucmp = icmp_->user_comparator();
+        std::vector<MultiGetKey *> pending;
+        for (auto &key : *keys) {
+            pending.push_back(&key);
+        }
+
+        std::vector<MultiGetProbe> probes;
+        auto add_probe = [&](MultiGetKey *key, FileMetaData *file, int level) {
+            if (ucmp->Compare(file->smallest.user_key(), key->key->user_key()) > 0 ||
+                ucmp->Compare(file->largest.user_key(), key->key->user_key()) < 0) {
+                return;
+            }
+            *num_searched_files += 1;
+            MultiGetProbe probe = {};
+            probe.key = key;
+            Status s = table_cache_->GetTable(options, file, file->number,
+                                              file->SelectReplica(),
+                                              file->converted_file_size,
+                                              level, &probe.table_handle,
+                                              &probe.table);
+            if (!s.ok()) {
+                key->status = s;
+                return;
+            }
+            if (!probe.table->PrepareGet(key->key->internal_key(),
+                                         &probe.block_handle)) {
+                table_cache_->Release(probe.table_handle);
+                return;
+            }
+            probe.block_iter = probe.table->CachedDataBlock(probe.block_handle);
+            probes.push_back(probe);
+        };
+
+        for (int level = 0; level < options_->level && !pending.empty(); level++) {
+            probes.clear();
+            for (auto key : pending) {
+                if (level == 0) {
+                    // Newest first.
+                    for (int i = key->l0fns.size() - 1; i >= 0 && key->status.ok(); i--) {
+                        auto it = fn_files_.find(key->l0fns[i]);
+                        if (it == fn_files_.end()) {
+                            key->status = Status::IOError(
+                                    fmt::format("fn {} not found", key->l0fns[i]));
+                            break;
+                        }
+                        add_probe(key, it->second, 0);
+                    }
+                    continue;
+                }
+                uint32_t index = FindFile(*icmp_, files_[level],
+                                          key->key->internal_key());
+                if (index < files_[level].size()) {
+                    add_probe(key, files_[level][index], level);
+                }
+            }
+
+            FetchDataBlocks(options, &probes);
+
+            // Search the blocks. The value with the newest sequence number
+            // wins. With ordered flush, the blocks of older SSTables are
+            // abandoned once the key is found.
+            for (auto &probe : probes) {
+                MultiGetKey *key = probe.key;
+                bool abandon = !key->status.ok() ||
+                               (key->found &&
+                                nova::NovaConfig::config->use_ordered_flush);
+                if (!abandon) {
+                    if (probe.block_iter == nullptr) {
+                        probe.block_iter = probe.table->NewDataBlock(options,
+                                                                     probe.block_handle,
+                                                                     probe.buf);
+                        probe.buf = nullptr;
+                    }
+                    probe.block_iter->SeekForGet(key->key->internal_key());
+                    if (probe.block_iter->Valid()) {
+                        std::string tmp_val;
+                        SequenceNumber tmp_seq = 0;
+                        Saver saver;
+                        saver.state = kNotFound;
+                        saver.ucmp = ucmp;
+                        saver.user_key = key->key->user_key();
+                        saver.value = &tmp_val;
+                        saver.seq = &tmp_seq;
+                        SaveValue(&saver, probe.block_iter->key(),
+                                  probe.block_iter->value());
+                        if (saver.state == kFound ||
+                            saver.state == kDeleted) {
+                            if (!key->found || tmp_seq > key->seq) {
+                                key->seq = tmp_seq;
+                                key->deleted = saver.state == kDeleted;
+                                if (!key->deleted) {
+                                    key->value->swap(tmp_val);
+                                }
+                            }
+                            key->found = true;
+                        } else if (saver.state == kCorrupt) {
+                            key->status = Status::Corruption(
+                                    "corrupted key for ", saver.user_key);
+                        }
+                    }
+                    if (key->status.ok()) {
+                        key->status = probe.block_iter->status();
+                    }
+                }
+                delete probe.block_iter;
+                delete[] probe.buf;
+                table_cache_->Release(probe.table_handle);
+            }
+
+            std::vector<MultiGetKey *> next;
+            for (auto key : pending) {
+                if (key->status.ok() && !key->found) {
+                    next.push_back(key);
+                }
+            }
+            pending.swap(next);
+        }
+
+        for (auto &key : *keys) {
+            if (key.status.ok() && (!key.found || key.deleted)) {
+                key.status = Status::NotFound("");
+            }
+        }
+    }
+
     Status Version::Get(const ReadOptions &options, const LookupKey &k,
                         SequenceNumber *seq,
                         std::string *value, GetStats *stats,
                         GetSearchScope search_scope,
-                        uint64_t *num_searched_files) {
+                        uint64_t *num_searched_files,
+                        SuspendedGet *suspended) {
         stats->seek_file = nullptr;
         stats->seek_file_level = -1;
 
@@ -446,9 +978,29 @@ namespace leveldb {
             Status s;
             bool found;
             uint64_t *num_searched_files;
+            SuspendedGet *suspended;
+            // Skip the SSTables before the one that the lookup resumes in.
+            bool resume;
 
             static bool Match(void *arg, int level, FileMetaData *f) {
                 State *state = reinterpret_cast<State *>(arg);
+                if (state->s.IsIncomplete()) {
+                    // Suspended. Search the remaining SSTables on resume.
+                    return false;
+                }
+                if (state->resume) {
+                    if (f->number != state->suspended->file_number) {
+                        return true;
+                    }
+                    state->resume = false;
+                    state->suspended->file_number = 0;
+                    state->last_file_read = f;
+                    state->last_file_read_level = level;
+                    state->s = ResumeTableGet(state->table_cache,
+                                              *state->options, f, level,
+                                              state->ikey, &state->saver);
+                    return state->Matched(f);
+                }
                 if (state->stats->seek_file == nullptr &&
                     state->last_file_read != nullptr) {
                     // We have had more than one seek for this read.  Charge the 1st file.
@@ -468,24 +1020,37 @@ namespace leveldb {
                                                    &state->saver,
                                                    SaveValue);
                 (*state->num_searched_files) += 1;
-
-                if (!state->s.ok()) {
-                    state->found = true;
+                return state->Matched(f);
+            }
+
+            // Returns true if the lookup continues after searching "f".
+            bool Matched(FileMetaData *f) {
+                if (s.IsIncomplete()) {
+                    NOVA_ASSERT(suspended);
+                    suspended->file_number = f->number;
+                    suspended->found = found;
+                    suspended->deleted = saver.state == kDeleted;
+                    suspended->seq = *saver.seq;
+                    suspended->value.swap(*saver.value);
+                    found = true;
+                    return false;
+                }
+                if (!s.ok()) {
+                    found = true;
                     return false;
                 }
-                switch (state->saver.state) {
+                switch (saver.state) {
                     case kNotFound:
                         return true;  // Keep searching in other files
                     case kFound:
-                        state->found = true;
+                        found = true;
                         return false;
                     case kDeleted:
                         return false;
                     case kCorrupt:
-                        state->s =
-                                Status::Corruption("corrupted key for ",
-                                                   state->saver.user_key);
-                        state->found = true;
+                        s = Status::Corruption("corrupted key for ",
+                                               saver.user_key);
+                        found = true;
                         return false;
                 }
 
@@ -509,8 +1074,21 @@ namespace leveldb {
         state.saver.seq = seq;
         state.saver.value = value;
         state.num_searched_files = num_searched_files;
+        state.suspended = suspended;
+        state.resume = suspended != nullptr && suspended->file_number != 0;
+        if (state.resume) {
+            state.found = suspended->found;
+            if (suspended->deleted) {
+                state.saver.state = kDeleted;
+            } else if (suspended->found) {
+                state.saver.state = kFound;
+            }
+            *seq = suspended->seq;
+            value->swap(suspended->value);
+        }
         ForEachOverlapping(state.saver.user_key, state.ikey, &state,
                            &State::Match, search_scope);
+        NOVA_ASSERT(!state.resume) << suspended->file_number;
         return state.found ? state.s : Status::NotFound("Not found in L1.");
     }
 
@@ -1404,7 +1982,7 @@ namespace leveldb {
             }
             NOVA_LOG(rdmaio::INFO) << fmt::format("Decode tableid mapping: {}", mid);
             NOVA_ASSERT(mid < MAX_LIVE_MEMTABLES);
-            if (!mid_table_mapping_[mid]->Decode(buf, cmp)) {
+            if (!mid_table_mapping_[mid]->Decode(buf, cmp, *options_)) {
                 NOVA_LOG(rdmaio::INFO)
                     << fmt::format("MemTable does not exist in memtable partitions {}:{}", dbname_, mid);
             }
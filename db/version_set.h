@@ -80,6 +80,29 @@ namespace leveldb {
         double score;
     };
 
+    // A point lookup that waits for a remote data block. See
+    // ReadOptions::deferred_block_reads. It resumes in the SSTable where it
+    // stopped and does not search the memtables or the SSTables before it
+    // again.
+    struct SuspendedGet {
+        // The lookup holds a reference to the version "version_id" and to
+        // "range_index" if it is not null until it completes.
+        uint32_t version_id = 0;
+        RangeIndex *range_index = nullptr;
+        SequenceNumber snapshot = 0;
+        std::vector<uint64_t> l0fns;
+        // The L0 SSTables do not contain the key. Search L1 and above.
+        bool search_l1 = false;
+
+        // Set by Version::Get. The SSTable that waits for the block and the
+        // results of the SSTables searched before it.
+        uint64_t file_number = 0;
+        bool found = false;
+        bool deleted = false;
+        SequenceNumber seq = 0;
+        std::string value;
+    };
+
     enum GetSearchScope {
         kAllLevels = 0,
         kAllL0AndAllLevels = 1,
@@ -126,15 +149,38 @@ namespace leveldb {
         void AddIterators(const ReadOptions &, const RangeIndex *range_index,
                           std::vector<Iterator *> *iters, ScanStats *stats);
 
+        // With deferred block reads, "suspended" records where the lookup
+        // stops when it returns Status::Incomplete. The lookup resumes there
+        // if "suspended->file_number" is set.
         Status
         Get(const ReadOptions &, const LookupKey &key, SequenceNumber *seq,
             std::string *val, GetStats *stats, GetSearchScope search_scope,
-            uint64_t *num_searched_files);
+            uint64_t *num_searched_files, SuspendedGet *suspended = nullptr);
 
         Status Get(const ReadOptions &, std::vector<uint64_t> &fns,
                    const LookupKey &key,
                    SequenceNumber *seq,
-                   std::string *val, uint64_t *num_searched_files);
+                   std::string *val, uint64_t *num_searched_files,
+                   SuspendedGet *suspended = nullptr);
+
+        // A key of MultiGet. "l0fns" are the L0 SSTables that may contain
+        // the key. "deleted" is true if the newest entry found is a deletion.
+        struct MultiGetKey {
+            const LookupKey *key = nullptr;
+            std::vector<uint64_t> l0fns;
+            std::string *value = nullptr;
+            SequenceNumber seq = 0;
+            bool found = false;
+            bool deleted = false;
+            Status status;
+        };
+
+        // Search the SSTables for all keys level by level. The data blocks
+        // of all keys at a level are fetched together and the reads to the
+        // same StoC are coalesced into one request. Sets the status of
+        // each key.
+        void MultiGet(const ReadOptions &, std::vector<MultiGetKey> *keys,
+                      uint64_t *num_searched_files);
 
         // Reference count management (so Versions do not disappear out from
         // under live iterators)
@@ -232,6 +278,15 @@ namespace leveldb {
 
         Version &operator=(const Version &) = delete;
 
+        // Search the L0 SSTables "fns" in two phases. First, it checks the
+        // filters of all candidate SSTables. Second, it fetches the data
+        // blocks that may contain the key concurrently.
+        Status ParallelGet(const ReadOptions &, std::vector<uint64_t> &fns,
+                           const LookupKey &key,
+                           SequenceNumber *seq,
+                           std::string *val,
+                           uint64_t *num_searched_files);
+
         void GetOverlappingInputs(
                 std::vector<FileMetaData *> &inputs,
                 const Slice &begin,  // nullptr means before all keys
@@ -19,6 +19,7 @@
 #include "db/memtable.h"
 #include "db/write_batch_internal.h"
 #include "leveldb/db.h"
+#include "leveldb/stoc_client.h"
 #include "util/coding.h"
 
 namespace leveldb {
@@ -150,4 +151,73 @@ namespace leveldb {
                          src->rep_.size() - kHeader);
     }
 
+    namespace {
+        class RecordCollector : public WriteBatch::Handler {
+        public:
+            RecordCollector(SequenceNumber sequence,
+                            std::vector<LevelDBLogRecord> *records)
+                    : sequence_(sequence), records_(records) {}
+
+            void Put(const Slice &key, const Slice &value) override {
+                LevelDBLogRecord record = {};
+                record.sequence_number = sequence_;
+                record.key = key;
+                record.value = value;
+                record.batch_continues = true;
+                records_->push_back(record);
+                sequence_++;
+            }
+
+            void Delete(const Slice &key) override {
+                Put(key, Slice());
+                records_->back().type = kTypeDeletion;
+            }
+
+        private:
+            SequenceNumber sequence_;
+            std::vector<LevelDBLogRecord> *records_;
+        };
+
+        struct SliceLess {
+            bool operator()(const Slice &a, const Slice &b) const {
+                return a.compare(b) < 0;
+            }
+        };
+    }
+
+    Status WriteBatchInternal::CollectRecords(
+            const WriteBatch *batch, SequenceNumber sequence,
+            std::vector<LevelDBLogRecord> *records) {
+        size_t first = records->size();
+        RecordCollector collector(sequence, records);
+        Status s = batch->Iterate(&collector);
+        if (!s.ok()) {
+            records->resize(first);
+            return s;
+        }
+        if (records->size() > first) {
+            records->back().batch_continues = false;
+        }
+        return s;
+    }
+
+    void WriteBatchInternal::GroupRecords(
+            const std::vector<LevelDBLogRecord> &records,
+            const std::function<int(const LevelDBLogRecord &)> &route,
+            std::map<int, std::vector<LevelDBLogRecord>> *groups) {
+        std::map<Slice, int, SliceLess> routes;
+        for (const auto &record : records) {
+            auto it = routes.find(record.key);
+            if (it == routes.end()) {
+                it = routes.emplace(record.key, route(record)).first;
+            }
+            std::vector<LevelDBLogRecord> &group = (*groups)[it->second];
+            if (!group.empty()) {
+                group.back().batch_continues = true;
+            }
+            group.push_back(record);
+            group.back().batch_continues = false;
+        }
+    }
+
 }  // namespace leveldb
@@ -5,6 +5,10 @@
 #ifndef STORAGE_LEVELDB_DB_WRITE_BATCH_INTERNAL_H_
 #define STORAGE_LEVELDB_DB_WRITE_BATCH_INTERNAL_H_
 
+#include <functional>
+#include <map>
+#include <vector>
+
 #include "db/dbformat.h"
 #include "leveldb/write_batch.h"
 
@@ -12,6 +16,8 @@ namespace leveldb {
 
     class MemTable;
 
+    struct LevelDBLogRecord;
+
 // WriteBatchInternal provides static methods for manipulating a
 // WriteBatch that we don't want in the public WriteBatch interface.
     class WriteBatchInternal {
@@ -41,6 +47,22 @@ namespace leveldb {
         static Status InsertInto(const WriteBatch *batch, MemTable *memtable);
 
         static void Append(WriteBatch *dst, const WriteBatch *src);
+
+        // Append the records of "batch" to "records" with consecutive
+        // sequence numbers starting at "sequence". All records but the last
+        // are marked as continuing the batch.
+        static Status CollectRecords(const WriteBatch *batch,
+                                     SequenceNumber sequence,
+                                     std::vector<LevelDBLogRecord> *records);
+
+        // Group "records" by the id that "route" returns for their key.
+        // "route" is called once per distinct key so that all records of a
+        // key fall into the same group. Each group keeps the batch order
+        // and its records but the last are marked as continuing the batch.
+        static void GroupRecords(
+                const std::vector<LevelDBLogRecord> &records,
+                const std::function<int(const LevelDBLogRecord &)> &route,
+                std::map<int, std::vector<LevelDBLogRecord>> *groups);
     };
 
 }  // namespace leveldb
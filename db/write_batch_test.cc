@@ -4,9 +4,14 @@
 
 #include "leveldb/db.h"
 
+#include "common/nova_common.h"
+#include "common/nova_config.h"
 #include "db/memtable.h"
 #include "db/write_batch_internal.h"
 #include "leveldb/env.h"
+#include "leveldb/stoc_client.h"
+#include "ltc/stoc_client_impl.h"
+#include "ltc/storage_selector.h"
 #include "util/logging.h"
 #include "util/testharness.h"
 
@@ -14,7 +19,7 @@ namespace leveldb {
 
     static std::string PrintContents(WriteBatch *b) {
         InternalKeyComparator cmp(BytewiseComparator());
-        MemTable *mem = new MemTable(cmp, nullptr);
+        MemTable *mem = new MemTable(cmp, 0, nullptr, true);
         mem->Ref();
         std::string state;
         Status s = WriteBatchInternal::InsertInto(b, mem);
@@ -135,6 +140,117 @@ namespace leveldb {
         ASSERT_LT(two_keys_size, post_delete_size);
     }
 
+    static std::string Records(const std::vector<LevelDBLogRecord> &records) {
+        std::string state;
+        for (const auto &record : records) {
+            state.append(record.type == kTypeValue ? "Put(" : "Delete(");
+            state.append(record.key.ToString());
+            if (record.type == kTypeValue) {
+                state.append(", ");
+                state.append(record.value.ToString());
+            }
+            state.append(")@");
+            state.append(NumberToString(record.sequence_number));
+            if (record.batch_continues) {
+                state.append("+");
+            }
+        }
+        return state;
+    }
+
+    static WriteBatch RepeatedKeyBatch() {
+        WriteBatch batch;
+        batch.Put(Slice("foo"), Slice("v1"));
+        batch.Put(Slice("bar"), Slice("b1"));
+        batch.Delete(Slice("foo"));
+        batch.Put(Slice("foo"), Slice("v2"));
+        return batch;
+    }
+
+    TEST(WriteBatchTest, CollectRepeatedKey) {
+        WriteBatch batch = RepeatedKeyBatch();
+        std::vector<LevelDBLogRecord> records;
+        ASSERT_OK(WriteBatchInternal::CollectRecords(&batch, 100, &records));
+        ASSERT_EQ(
+                "Put(foo, v1)@100+"
+                "Put(bar, b1)@101+"
+                "Delete(foo)@102+"
+                "Put(foo, v2)@103",
+                Records(records));
+    }
+
+    TEST(WriteBatchTest, GroupRepeatedKey) {
+        WriteBatch batch = RepeatedKeyBatch();
+        std::vector<LevelDBLogRecord> records;
+        ASSERT_OK(WriteBatchInternal::CollectRecords(&batch, 100, &records));
+        // Every lookup returns a different group, as if the key fell into
+        // duplicated subranges.
+        int lookups = 0;
+        std::map<int, std::vector<LevelDBLogRecord>> groups;
+        WriteBatchInternal::GroupRecords(
+                records, [&](const LevelDBLogRecord &record) {
+                    return lookups++;
+                }, &groups);
+        ASSERT_EQ(2, lookups);
+        ASSERT_EQ(2, groups.size());
+        ASSERT_EQ(
+                "Put(foo, v1)@100+"
+                "Delete(foo)@102+"
+                "Put(foo, v2)@103",
+                Records(groups[0]));
+        ASSERT_EQ("Put(bar, b1)@101", Records(groups[1]));
+    }
+
+    TEST(WriteBatchTest, ReplayRepeatedKey) {
+        WriteBatch batch = RepeatedKeyBatch();
+        std::vector<LevelDBLogRecord> records;
+        ASSERT_OK(WriteBatchInternal::CollectRecords(&batch, 100, &records));
+        std::string log(nova::LogRecordsSize(records) + 8, 0);
+        uint32_t size = 0;
+        for (const auto &record : records) {
+            size += nova::EncodeLogRecord(&log[size], record);
+        }
+        ASSERT_EQ(nova::LogRecordsSize(records), size);
+
+        // The log ends before the last record of the batch.
+        for (uint32_t end = 0; end < size; end++) {
+            Slice truncated(log.data(), end);
+            std::vector<LevelDBLogRecord> replayed;
+            ASSERT_TRUE(!nova::DecodeLogRecordBatch(&truncated, &replayed));
+            ASSERT_TRUE(replayed.empty());
+        }
+
+        Slice input(log);
+        std::vector<LevelDBLogRecord> replayed;
+        ASSERT_TRUE(nova::DecodeLogRecordBatch(&input, &replayed));
+        ASSERT_EQ(Records(records), Records(replayed));
+        std::vector<LevelDBLogRecord> next;
+        ASSERT_TRUE(!nova::DecodeLogRecordBatch(&input, &next));
+
+        InternalKeyComparator cmp(BytewiseComparator());
+        MemTable *mem = new MemTable(cmp, 0, nullptr, true);
+        mem->Ref();
+        for (const auto &record : replayed) {
+            mem->Add(record.sequence_number, record.type, record.key,
+                     record.value);
+        }
+        std::string value;
+        Status s;
+        SequenceNumber seq = 0;
+        ASSERT_TRUE(mem->Get(LookupKey("foo", kMaxSequenceNumber), &value,
+                             &s, &seq));
+        ASSERT_OK(s);
+        ASSERT_EQ("v2", value);
+        ASSERT_EQ(103, seq);
+        mem->Unref();
+    }
+
 }  // namespace leveldb
 
+nova::NovaConfig *nova::NovaConfig::config;
+nova::NovaGlobalVariables nova::NovaGlobalVariables::global;
+std::atomic<nova::Servers *> leveldb::StorageSelector::available_stoc_servers;
+std::atomic_int_fast32_t leveldb::StorageSelector::stoc_for_compaction_seq_id;
+std::atomic_int_fast32_t leveldb::StoCBlockClient::rdma_worker_seq_id_;
+
 int main(int argc, char **argv) { return leveldb::test::RunAllTests(); }
@@ -31,6 +31,12 @@ namespace leveldb {
 // of Cache uses a least-recently-used eviction policy.
     LEVELDB_EXPORT Cache *NewLRUCache(size_t capacity);
 
+// Create a new cache with a fixed size capacity.  This implementation
+// of Cache uses a sharded CLOCK eviction policy with frequency-based
+// admission.  Lookups do not take an exclusive lock, and a scan that reads
+// each block once does not flush frequently read blocks.
+    LEVELDB_EXPORT Cache *NewClockCache(size_t capacity);
+
     class LEVELDB_EXPORT Cache {
     public:
         Cache() = default;
@@ -47,6 +53,13 @@ namespace leveldb {
         struct Handle {
         };
 
+        // Low-priority entries, e.g., blocks read by scans, are evicted
+        // first and may not be admitted at all.
+        enum Priority {
+            kHighPriority,
+            kLowPriority
+        };
+
         // Insert a mapping from key->value into the cache and assign it
         // the specified charge against the total cache capacity.
         //
@@ -60,6 +73,16 @@ namespace leveldb {
                                void (*deleter)(const Slice &key,
                                                void *value)) = 0;
 
+        // Same as above with a priority hint. The entry may not be cached,
+        // but the returned handle is valid either way. The default
+        // implementation ignores the hint.
+        virtual Handle *Insert(const Slice &key, void *value, size_t charge,
+                               void (*deleter)(const Slice &key,
+                                               void *value),
+                               Priority priority) {
+            return Insert(key, value, charge, deleter);
+        }
+
         // If the cache has no mapping for "key", returns nullptr.
         //
         // Else return a handle that corresponds to the mapping.  The caller
@@ -141,12 +141,32 @@ namespace leveldb {
         virtual Status
         Delete(const WriteOptions &options, const Slice &key) = 0;
 
+        // Remove the database entries (if any) for the keys in [start, end).
+        // Returns InvalidArgument if "start" is not smaller than "end".
+        virtual Status
+        DeleteRange(const WriteOptions &options, const Slice &start,
+                    const Slice &end) {
+            return Status::NotSupported("DeleteRange");
+        }
+
+        // Apply the specified updates to the database. The batch is not
+        // atomic: a concurrent read may see some of its updates but not the
+        // others. With subranges, the updates are grouped by subrange and
+        // each group is applied under its own partition lock. Otherwise the
+        // batch goes into one memtable partition. With a memtable pool, the
+        // updates are applied one key at a time. The updates of a batch are
+        // assigned a contiguous range of sequence numbers, except with a
+        // memtable pool, and updates to the same key are applied in batch
+        // order. Returns OK on success, non-OK on failure.
+        virtual Status
+        Write(const WriteOptions &options, WriteBatch *updates) = 0;
+
         // Apply the specified updates to the database.
         // Returns OK on success, non-OK on failure.
         // Note: consider setting options.sync = true.
         virtual Status
         WriteMemTablePool(const WriteOptions &options, const Slice &key,
-                          const Slice &value) = 0;
+                          const Slice &value, ValueType type = kTypeValue) = 0;
 
         // If the database contains an entry for "key" store the
         // corresponding value in *value and return OK.
@@ -158,6 +178,14 @@ namespace leveldb {
         virtual Status Get(const ReadOptions &options, const Slice &key,
                            std::string *value) = 0;
 
+        // Look up the values of "keys". (*values)[i] and (*statuses)[i] hold
+        // the value and the status of keys[i]. The status is NotFound if
+        // there is no entry for the key.
+        virtual void MultiGet(const ReadOptions &options,
+                              const std::vector<Slice> &keys,
+                              std::vector<std::string> *values,
+                              std::vector<Status> *statuses) = 0;
+
         virtual void StartTracing() = 0;
 
         virtual void TestCompact(EnvBGThread *bg_thread,
@@ -199,6 +227,11 @@ namespace leveldb {
         //     of the sstables that make up the db contents.
         //  "leveldb.approximate-memory-usage" - returns the approximate number of
         //     bytes of memory in use by the DB.
+        //  "leveldb.lookup-index" - returns the capacity, memory footprint, hit
+        //     ratio and garbage collection counters of the lookup index.
+        //  "leveldb.recovery-stats" - returns the time to rebuild the indexes
+        //     during recovery and the time from the start of recovery to the
+        //     first GET served by the lookup index.
         virtual bool GetProperty(const Slice &property, std::string *value) = 0;
 
         // For each i in [0,n-1], store in "sizes[i]", the approximate
@@ -56,7 +56,7 @@ namespace leveldb {
 // DO NOT CHANGE THESE ENUM VALUES: they are embedded in the on-disk
 // data structures.
     enum ValueType {
-        kTypeDeletion = 0x0, kTypeValue = 0x1
+        kTypeDeletion = 0x0, kTypeValue = 0x1, kTypeRangeDeletion = 0x2
     };
 
     struct ScanStats {
@@ -115,6 +115,21 @@ namespace leveldb {
         std::string DebugString() const;
     };
 
+    // Deletes the user keys in [start, end) whose sequence numbers are smaller
+    // than "sequence". It is stored as the entry (start, sequence,
+    // kTypeRangeDeletion) => end.
+    struct RangeTombstone {
+        std::string start;
+        std::string end;
+        SequenceNumber sequence = 0;
+
+        uint32_t Encode(char *buf) const;
+
+        bool Decode(Slice *ptr);
+
+        std::string DebugString() const;
+    };
+
     enum FileCompactionStatus {
         NONE = 0,
         COMPACTING = 1,
@@ -191,7 +206,7 @@ namespace leveldb {
         InternalKey largest;   // Largest internal key served by table
         FileCompactionStatus compaction_status;
         std::vector<FileReplicaMetaData> block_replica_handles = {};
-        StoCBlockHandle parity_block_handle;
+        std::vector<StoCBlockHandle> parity_block_handles = {};
     };
 
     class LEVELDB_EXPORT MemManager {
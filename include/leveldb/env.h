@@ -298,6 +298,18 @@ namespace leveldb {
 
         virtual Status Append(const Slice &data) = 0;
 
+        // Append "data[0..n-1]" in order. Implementations may issue a single
+        // vectored write.
+        virtual Status AppendV(const Slice *data, int n) {
+            for (int i = 0; i < n; i++) {
+                Status s = Append(data[i]);
+                if (!s.ok()) {
+                    return s;
+                }
+            }
+            return Status::OK();
+        }
+
         virtual Status Close() = 0;
 
         virtual Status Flush() = 0;
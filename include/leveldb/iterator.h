@@ -48,6 +48,11 @@ namespace leveldb {
         // an entry that comes at or past target.
         virtual void Seek(const Slice &target) = 0;
 
+        // Same as Seek but for a point lookup of the user key of the internal
+        // key "target". The iterator may become !Valid() if the source does
+        // not contain that user key.
+        virtual void SeekForGet(const Slice &target) { Seek(target); }
+
         // Skip to the next key.
         virtual void SkipToNextUserKey(const Slice& target) = 0;
 
@@ -6,7 +6,9 @@
 #define STORAGE_LEVELDB_INCLUDE_OPTIONS_H_
 
 #include <stddef.h>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "leveldb/export.h"
 #include "leveldb/stoc_client.h"
@@ -28,6 +30,12 @@ namespace leveldb {
 
     class Snapshot;
 
+    struct SuspendedGet;
+
+    namespace port {
+        class ZstdDictionary;
+    }
+
 // DB contents are stored in a set of blocks, each of which holds a
 // sequence of key,value pairs.  Each block may be compressed before
 // being stored in a file.  The following enum describes which
@@ -36,7 +44,9 @@ namespace leveldb {
         // NOTE: do not change the values of existing entries, as these are
         // part of the persistent format on disk.
         kNoCompression = 0x0,
-        kSnappyCompression = 0x1
+        kSnappyCompression = 0x1,
+        kLZ4Compression = 0x4,
+        kZstdCompression = 0x7
     };
 
     enum MemTableType {
@@ -44,6 +54,15 @@ namespace leveldb {
         kStaticPartition = 1,
     };
 
+    // How a memtable stores its entries.
+    enum MemTableRepresentation {
+        kMemTableSkipList = 0,
+        // Keys are decoded into integers and stored inline in cache-line
+        // sized skiplist nodes. Requires a comparator that orders keys by
+        // their decimal value, e.g., YCSBKeyComparator.
+        kMemTableInlineSkipList = 1,
+    };
+
     enum MajorCompactionType {
         kMajorDisabled = 0,
         kMajorSingleThreaded = 1,
@@ -134,6 +153,8 @@ namespace leveldb {
 
         MemTableType memtable_type = MemTableType::kStaticPartition;
 
+        MemTableRepresentation memtable_representation = MemTableRepresentation::kMemTableSkipList;
+
         bool enable_subranges = false;
         bool enable_detailed_stats = true;
 
@@ -148,6 +169,17 @@ namespace leveldb {
         bool enable_lookup_index = false;
         bool enable_range_index = false;
 
+        // If true, a get that searches multiple L0 SSTables checks the
+        // filters of all candidates first and then fetches the remaining
+        // data blocks from StoCs concurrently.
+        bool enable_parallel_l0_probe = false;
+
+        // If true, each memtable keeps a hash directory from a user key to
+        // its latest entry so that point lookups of the latest value skip
+        // the skiplist search. The directory is allocated from the
+        // memtable's arena.
+        bool enable_memtable_hash_index = false;
+
         uint32_t subrange_no_flush_num_keys = 100;
         uint32_t num_compaction_threads = 0;
 
@@ -195,6 +227,15 @@ namespace leveldb {
         // leave this parameter alone.
         int block_restart_interval = 16;
 
+        // If true, data blocks end with a hash index that maps user keys to
+        // their restart points. Point lookups use it to skip the binary search
+        // over the restart points. Blocks without the index are still read.
+        // Requires internal keys, i.e., tables built by the DB.
+        bool data_block_hash_index = false;
+
+        // Average number of keys per bucket of the data block hash index.
+        double data_block_hash_index_util_ratio = 0.75;
+
         // Leveldb will write up to this amount of bytes to a file before
         // switching to a new one.
         // Most clients should leave this parameter alone.  However if your
@@ -227,14 +268,77 @@ namespace leveldb {
         // efficiently detect that and will switch to uncompressed mode.
         CompressionType compression = kSnappyCompression;
 
+        // If non-empty, overrides "compression" for the SSTables written to
+        // a level. Entry i is used for level i and the last entry for all
+        // deeper levels, e.g., {none, none, lz4, zstd} keeps L0 flushes and
+        // L1 compactions cheap and compresses the large levels hard.
+        std::vector<CompressionType> compression_per_level;
+
+        // Compression level of kZstdCompression.
+        int zstd_compression_level = 3;
+
+        // If non-null, a dictionary trained on sample blocks, e.g., with
+        // "zstd --train", used by kZstdCompression. It is digested once when
+        // it is created and shared by all copies of the options. It must
+        // stay the same for the lifetime of the SSTables written with it.
+        std::shared_ptr<const port::ZstdDictionary> zstd_dictionary;
+
         // If non-null, use the specified filter policy to reduce disk reads.
         // Many applications will benefit from passing the result of
         // NewBloomFilterPolicy() here.
         const FilterPolicy *filter_policy = nullptr;
 
+        // If true, the index and filter blocks of an SSTable are written in
+        // partitions of about metadata_partition_size bytes of index entries.
+        // Opening such a table only loads its top-level index, which stays in
+        // memory. The partitions are loaded on demand through block_cache.
+        // Tables are read correctly regardless of this option.
+        bool partition_index_and_filters = false;
+
+        uint32_t metadata_partition_size = 4096;
+
+        // If true, the partitions of L0 SSTables are loaded when they are
+        // opened and stay in memory. Every Get probes all L0 SSTables that
+        // overlap its key. Partitions are always pinned without block_cache.
+        bool pin_l0_metadata_partitions = false;
+
+        // An iterator over an SSTable on a remote StoC reads ahead once it
+        // reads two consecutive data blocks. The readahead window starts at
+        // two blocks and doubles up to this many blocks. 0 disables it.
+        uint32_t readahead_max_blocks = 0;
+
+        // Compaction input iterators read ahead this many data blocks from
+        // their first block. 0 disables it.
+        uint32_t compaction_readahead_blocks = 0;
+
+        // Writers to the same memtable replicate their log records in one
+        // batch of up to this many bytes. The batch is further bounded by
+        // the leader's RDMA buffer. 0 disables group commit.
+        uint32_t log_group_commit_max_bytes = 0;
+
+        // How long the leader of a batch waits for more writers.
+        uint64_t log_group_commit_max_delay_us = 0;
+
         MemTablePool *memtable_pool = nullptr;
     };
 
+// A point lookup that waits for a remote data block that the caller reads
+// itself. See ReadOptions::deferred_block_reads.
+    struct LEVELDB_EXPORT DeferredBlockReads {
+        // The block the lookup waits for.
+        StoCBlockHandle pending = {};
+
+        // The contents and the trailer of "pending" once the caller has read
+        // them. The lookup parses the block in place, so it must stay valid
+        // until Get() returns. If null, the lookup reads the block itself
+        // and waits for it.
+        const char *block = nullptr;
+
+        // Where the lookup resumes. The DB owns it until the lookup
+        // completes.
+        SuspendedGet *suspended = nullptr;
+    };
+
 // Options that control read operations
     struct LEVELDB_EXPORT ReadOptions {
         ReadOptions() = default;
@@ -258,6 +362,14 @@ namespace leveldb {
 
         uint64_t hash = 0;
 
+        // If non-null, Get() does not wait for a data block that is read
+        // from a remote StoC. It suspends the lookup, sets
+        // deferred_block_reads->pending and returns Status::Incomplete
+        // instead. The caller reads the block into
+        // deferred_block_reads->block and calls Get() again with the same
+        // key. The lookup then resumes in the SSTable where it stopped.
+        DeferredBlockReads *deferred_block_reads = nullptr;
+
         // If "snapshot" is non-null, read as of the supplied snapshot
         // (which must belong to the DB that is being read and which must
         // not have been released).  If "snapshot" is null, use an implicit
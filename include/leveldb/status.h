@@ -64,6 +64,10 @@ namespace leveldb {
             return Status(kIOError, msg, msg2);
         }
 
+        static Status Incomplete(const Slice &msg, const Slice &msg2 = Slice()) {
+            return Status(kIncomplete, msg, msg2);
+        }
+
         // Returns true iff the status indicates success.
         bool ok() const { return (state_ == nullptr); }
 
@@ -82,6 +86,10 @@ namespace leveldb {
         // Returns true iff the status indicates an InvalidArgument.
         bool IsInvalidArgument() const { return code() == kInvalidArgument; }
 
+        // Returns true iff the status indicates that the operation must be
+        // retried once the caller has done its part.
+        bool IsIncomplete() const { return code() == kIncomplete; }
+
         // Return a string representation of this status suitable for printing.
         // Returns the string "OK" for success.
         std::string ToString() const;
@@ -93,7 +101,8 @@ namespace leveldb {
             kCorruption = 2,
             kNotSupported = 3,
             kInvalidArgument = 4,
-            kIOError = 5
+            kIOError = 5,
+            kIncomplete = 6
         };
 
         Code code() const {
@@ -8,6 +8,7 @@
 #define NOVA_STOC_CLIENT_H
 
 #include <cstdint>
+#include <functional>
 #include <vector>
 #include <infiniband/verbs.h>
 #include <semaphore.h>
@@ -39,6 +40,13 @@ namespace leveldb {
         std::vector<SubRange> subranges;
         uint32_t source_level = 0;
         uint32_t target_level = 0;
+        // No SSTable below target_level overlaps the inputs.
+        bool bottommost = false;
+        // The range tombstones that overlap the inputs.
+        std::vector<RangeTombstone> range_tombstones;
+        // The range tombstones to drop from the outputs. A subset of
+        // range_tombstones.
+        std::vector<RangeTombstone> obsolete_range_tombstones;
         sem_t *completion_signal = nullptr;
 
         std::vector<FileMetaData *> outputs;
@@ -98,6 +106,8 @@ namespace leveldb {
         uint64_t stoc_queue_depth = 0;
         uint64_t stoc_pending_read_bytes = 0;
         uint64_t stoc_pending_write_bytes = 0;
+        uint64_t stoc_table_cache_lookups = 0;
+        uint64_t stoc_table_cache_hits = 0;
 
         // log records.
         char *log_record_mem = nullptr;
@@ -127,7 +137,15 @@ namespace leveldb {
         uint64_t stoc_queue_depth;
         uint64_t stoc_pending_read_bytes;
         uint64_t stoc_pending_write_bytes;
+        // Lookups and hits of the table cache of StoC-side compactions.
+        uint64_t stoc_table_cache_lookups = 0;
+        uint64_t stoc_table_cache_hits = 0;
         bool is_ready_to_process_requests;
+
+        double stoc_table_cache_hit_ratio() const {
+            return stoc_table_cache_lookups == 0 ? 0 :
+                   (double) stoc_table_cache_hits / stoc_table_cache_lookups;
+        }
     };
 
     enum RDMAClientRequestType : char {
@@ -147,17 +165,27 @@ namespace leveldb {
         RDMA_CLIENT_RDMA_WRITE_REQUEST = 'n',
         RDMA_CLIENT_RDMA_WRITE_REMOTE_BUF_ALLOCATED = 'o',
         RDMA_CLIENT_RECONSTRUCT_MISSING_REPLICA = 'p',
+        RDMA_CLIENT_REQ_READ_BLOCKS = 'q',
     };
 
     struct LevelDBLogRecord {
         Slice key;
         Slice value;
         uint64_t sequence_number = 0;
+        ValueType type = kTypeValue;
+        // True if the next record belongs to the same write batch. Recovery
+        // replays a batch only if all of its records are in the log.
+        bool batch_continues = false;
     };
 
+    // Invoked by the RDMA thread once an asynchronous request completes.
+    typedef std::function<void()> StoCCallback;
+
     struct RDMARequestTask {
         RDMAClientRequestType type;
         sem_t *sem = nullptr;
+        // Set instead of sem by asynchronous requests.
+        StoCCallback callback;
 
         char *rdma_log_record_backing_mem = nullptr;
         uint64_t remote_stoc_offset = 0;
@@ -168,6 +196,7 @@ namespace leveldb {
         char *result = nullptr;
         std::string filename;
         bool is_foreground_reads;
+        std::vector<StoCBlockHandle> stoc_block_handles;
 
         std::vector<std::string> log_files;
 
@@ -226,6 +255,14 @@ namespace leveldb {
                               std::string filename,
                               bool is_foreground_reads) = 0;
 
+        // Read the blocks into consecutive ranges of "result" with a single
+        // request. All blocks must reside on the same StoC.
+        virtual uint32_t
+        InitiateReadDataBlocks(const std::vector<StoCBlockHandle> &block_handles,
+                               char *result,
+                               uint32_t result_size,
+                               bool is_foreground_reads) = 0;
+
         virtual uint32_t InitiateQueryLogFile(
                 uint32_t stoc_id, uint32_t server_id,
                 uint32_t dbid,
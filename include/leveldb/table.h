@@ -6,8 +6,11 @@
 #define STORAGE_LEVELDB_INCLUDE_TABLE_H_
 
 #include <stdint.h>
+#include <functional>
 #include "table/format.h"
 
+#include "leveldb/cache.h"
+#include "leveldb/db_types.h"
 #include "leveldb/export.h"
 #include "leveldb/iterator.h"
 #include "db_profiler.h"
@@ -18,6 +21,8 @@ namespace leveldb {
 
     class BlockHandle;
 
+    class FilterPolicy;
+
     class Footer;
 
     struct Options;
@@ -79,21 +84,73 @@ namespace leveldb {
         // be close to the file length.
         uint64_t ApproximateOffsetOf(const Slice &key) const;
 
+        // "compression_dict" is the Zstd dictionary of the data blocks. See
+        // Options::zstd_dictionary.
         static Status
         ReadBlock(RandomAccessFile *file, const ReadOptions &options,
                   const StoCBlockHandle &stoc_block_handle,
-                  BlockContents *result);
-
+                  BlockContents *result,
+                  const port::ZstdDictionary *compression_dict = nullptr);
 
+        // Takes the ownership of "buf". A compressed block is uncompressed
+        // into a single buffer of its exact uncompressed length.
         static Status
         ReadBlock(const char *buf, const Slice &content,
                   const ReadOptions &options,
-                  const StoCBlockHandle &handle, BlockContents *result);
+                  const StoCBlockHandle &handle, BlockContents *result,
+                  const port::ZstdDictionary *compression_dict = nullptr);
 
+        // Two-phase point lookup that allows a caller to probe the data
+        // blocks of multiple tables concurrently.
+        //
+        // Searches the index block and the filter block for "k". Returns
+        // false if "k" is definitely not in this table. Otherwise, sets
+        // "*handle" to the data block that may contain "k".
+        bool PrepareGet(const Slice &k, StoCBlockHandle *handle);
+
+        // Same as PrepareGet but leaves the filter check to the caller so that
+        // it can check the filters of many tables in one batch. Returns false
+        // if "k" is beyond the last data block. Otherwise, sets "*handle" and
+        // sets "*filter" to the filter of the data block. "*has_filter" is
+        // false if the data block has no filter, i.e., it may contain "k".
+        // A filter partition that is not pinned is checked in place since it
+        // may be evicted once released. LocateGet then returns false if the
+        // filter rules "k" out.
+        bool LocateGet(const Slice &k, StoCBlockHandle *handle, Slice *filter,
+                       bool *has_filter);
+
+        const FilterPolicy *filter_policy() const;
+
+        // The range tombstones stored in the range tombstone block.
+        const std::vector<RangeTombstone> &range_tombstones() const;
+
+        // Returns an iterator over the data block "handle" if it is in the
+        // block cache. Otherwise, returns nullptr.
+        Iterator *CachedDataBlock(const StoCBlockHandle &handle);
+
+        // Returns an iterator over the data block "handle". "buf" contains
+        // the block contents and the block trailer read from "handle". The
+        // returned iterator takes the ownership of "buf".
+        Iterator *
+        NewDataBlock(const ReadOptions &options,
+                     const StoCBlockHandle &handle, char *buf,
+                     Cache::Priority priority = Cache::kHighPriority);
+
+        // Same as above but does not take the ownership of "block". The
+        // block is parsed in place, so "block" must outlive the returned
+        // iterator. It is only copied if the block cache keeps it.
+        Iterator *
+        NewDataBlock(const ReadOptions &options,
+                     const StoCBlockHandle &handle, const Slice &block,
+                     Cache::Priority priority = Cache::kHighPriority);
+
+        RandomAccessFile *file() const;
     private:
 
         friend class TableCache;
 
+        friend class BlockReadahead;
+
         static Iterator *
         DataBlockReader(void *arg, void *arg2, BlockReadContext context,
                         const ReadOptions &options,
@@ -108,12 +165,57 @@ namespace leveldb {
                            void (*handle_result)(void *arg, const Slice &k,
                                                  const Slice &v));
 
+        // Reads the data block "handle". With deferred block reads, returns
+        // Status::Incomplete for a remote block and records it as pending.
+        Status ReadDataBlock(const ReadOptions &options,
+                             const StoCBlockHandle &handle,
+                             BlockContents *contents) const;
+
         uint64_t TranslateToDataBlockOffset(const StoCBlockHandle &handle);
 
+        void ResolveDataBlockHandle(StoCBlockHandle *handle) const;
+
+        Iterator *
+        NewBlockIterator(Block *block, Cache::Handle *cache_handle) const;
+
+        // Inserts the block into the block cache if "contents" is cachable.
+        Iterator *
+        NewDataBlock(const ReadOptions &options,
+                     const StoCBlockHandle &handle,
+                     const BlockContents &contents, Cache::Priority priority);
+
         void ReadMeta(const Footer &footer);
 
         void ReadFilter(const Slice &filter_handle_value);
 
+        void ReadRangeTombstones(const Slice &handle_value);
+
+        // The index and filter of a partition of a partitioned table, or of
+        // the whole table otherwise.
+        struct Partition;
+
+        // Sets "*partition" to the partition that may contain "k". Returns
+        // false if "k" is beyond the last partition. The partition must be
+        // released with ReleasePartition.
+        bool FindPartition(const Slice &k, Partition *partition) const;
+
+        void LoadPartition(const PartitionHandle &handle,
+                           Partition *partition) const;
+
+        void ReleasePartition(Partition *partition) const;
+
+        // Load all partitions of a partitioned table and keep them in memory.
+        void PinPartitions();
+
+        // Returns an iterator over the index entries of all data blocks.
+        Iterator *NewIndexIterator(BlockReadContext context,
+                                   const ReadOptions &options) const;
+
+        static Iterator *
+        IndexPartitionReader(void *arg, void *arg2, BlockReadContext context,
+                             const ReadOptions &options,
+                             const Slice &index_value, std::string *next_key);
+
         Rep *rep_;
         DBProfiler *db_profiler_ = nullptr;
     };
@@ -124,6 +226,31 @@ namespace leveldb {
         Read(const ReadOptions &read_options,
              const StoCBlockHandle &stoc_block_handle,
              uint64_t offset, size_t n, Slice *result, char *scratch) = 0;
+
+        // Issue a read of "n" bytes at "offset" without waiting for it.
+        // Returns true if the read is pending. The caller must then call
+        // StoCClient::Wait() once and copy the block from "backing_mem"
+        // into "scratch". Returns false if the read is served
+        // synchronously into "scratch".
+        virtual bool
+        InitiateRead(const ReadOptions &read_options,
+                     const StoCBlockHandle &stoc_block_handle,
+                     uint64_t offset, size_t n, char *backing_mem,
+                     char *scratch) = 0;
+
+        // Issue a read of "n" bytes at "offset" of a remote block into
+        // "backing_mem". "callback" runs on an RDMA thread once the read
+        // completes. Requires IsRemoteRead(stoc_block_handle).
+        virtual void
+        InitiateAsyncRead(const ReadOptions &read_options,
+                          const StoCBlockHandle &stoc_block_handle,
+                          uint64_t offset, size_t n, char *backing_mem,
+                          bool is_foreground_reads,
+                          const std::function<void()> &callback) = 0;
+
+        // Returns true if the block is read from a remote StoC. Otherwise,
+        // Read() serves it locally without waiting.
+        virtual bool IsRemoteRead(const StoCBlockHandle &stoc_block_handle) = 0;
     };
 
 }  // namespace leveldb
@@ -32,7 +32,10 @@ namespace leveldb {
         // Create a builder that will store the contents of the table it is
         // building in *file.  Does not close the file.  It is up to the
         // caller to close the file after calling Finish().
-        TableBuilder(const Options &options, WritableFile *file);
+        // Data blocks are compressed with the compression type of "level".
+        // See Options::compression_per_level.
+        TableBuilder(const Options &options, WritableFile *file,
+                     int level = -1);
 
         TableBuilder(const TableBuilder &) = delete;
 
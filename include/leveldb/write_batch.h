@@ -2,7 +2,8 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file. See the AUTHORS file for names of contributors.
 //
-// WriteBatch holds a collection of updates to apply atomically to a DB.
+// WriteBatch holds a collection of updates to apply to a DB. See DB::Write
+// for the guarantees of applying a batch.
 //
 // The updates are applied in the order in which they are added
 // to the WriteBatch.  For example, the value of "key" will be "v3"
@@ -5,6 +5,12 @@
 //
 
 #include "log_recovery.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #include "db/db_impl.h"
 #include "common/nova_config.h"
 
@@ -26,15 +32,17 @@ namespace leveldb {
         if (memtables_to_recover.empty()) {
             return;
         }
+        std::vector<const leveldb::MemTableLogFilePair *> replicas;
         std::vector<char *> rdma_bufs;
         std::vector<uint32_t> reqs;
         timeval start = {};
         gettimeofday(&start, nullptr);
+        uint32_t scid = mem_manager_->slabclassid(0, nova::NovaConfig::config->max_stoc_file_size);
         for (const auto &replica : memtables_to_recover) {
-            uint32_t scid = mem_manager_->slabclassid(0, nova::NovaConfig::config->max_stoc_file_size);
             char *rdma_buf = mem_manager_->ItemAlloc(0, scid);
             NOVA_ASSERT(rdma_buf);
             rdma_bufs.push_back(rdma_buf);
+            replicas.push_back(&replica.second);
             NOVA_ASSERT(!replica.second.server_logbuf.empty());
 
             uint32_t server_id = replica.second.server_logbuf.begin()->first;
@@ -47,41 +55,51 @@ namespace leveldb {
             reqs.push_back(reqid);
         }
 
-        // Wait for all RDMA READ to complete.
-        for (const auto &replica : memtables_to_recover) {
-            client_->Wait();
-        }
-
-        for (int i = 0; i < reqs.size(); i++) {
-            leveldb::StoCResponse response;
-            NOVA_ASSERT(client_->IsDone(reqs[i], &response, nullptr));
-        }
-
-        timeval rdma_read_complete;
-        gettimeofday(&rdma_read_complete, nullptr);
-        uint32_t recovered_log_records = 0;
-        int index = 0;
+        // Replay threads pick up a log file as soon as its RDMA READ completes.
+        // Each log file belongs to its own memtable, so the threads never
+        // insert into the same memtable.
         leveldb::DBImpl *dbimpl = reinterpret_cast<leveldb::DBImpl *>(nova::NovaConfig::config->cfgs[cfg_id]->fragments[dbid]->db);
+        uint32_t nthreads = std::max(1u, std::min(nova::NovaConfig::config->number_of_recovery_threads,
+                                                  (uint32_t) replicas.size()));
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<uint32_t> arrived;
+        bool all_arrived = false;
+        std::mutex schedule_mutex;
         uint32_t rand_seed = 0;
-        for (const auto &replica : memtables_to_recover) {
+        std::atomic_uint_fast64_t recovered_log_records(0);
+        std::atomic_uint_fast64_t replay_duration(0);
+
+        auto replay = [&](uint32_t index) {
+            timeval replay_start{};
+            gettimeofday(&replay_start, nullptr);
             char *buf = rdma_bufs[index];
+            const leveldb::MemTableLogFilePair &replica = *replicas[index];
             leveldb::Slice slice(buf, nova::NovaConfig::config->max_stoc_file_size);
 
-            leveldb::MemTable *memtable = replica.second.memtable;
-            leveldb::LevelDBLogRecord record = {};
+            leveldb::MemTable *memtable = replica.memtable;
+            std::vector<leveldb::LevelDBLogRecord> batch;
             uint32_t log_records = 0;
-            while (nova::DecodeLogRecord(&slice, &record)) {
-                memtable->Add(record.sequence_number, leveldb::ValueType::kTypeValue, record.key, record.value);
-                recovered_log_records += 1;
-                log_records += 1;
+            // A write batch is replayed only if all its records are logged.
+            while (nova::DecodeLogRecordBatch(&slice, &batch)) {
+                for (const auto &record : batch) {
+                    memtable->Add(record.sequence_number, record.type, record.key, record.value);
+                    dbimpl->RecoverLookupIndexEntry(record.key, memtable->memtableid());
+                    if (record.type == leveldb::kTypeRangeDeletion) {
+                        dbimpl->RecoverRangeTombstone(record.key, record.value,
+                                                      record.sequence_number);
+                    }
+                    log_records += 1;
+                }
             }
             memtable->SetReadyToProcessRequests();
             // Schedule for compaction.
-            if (replica.second.is_immutable) {
+            if (replica.is_immutable) {
+                std::lock_guard<std::mutex> lock(schedule_mutex);
                 int thread_id = -1;
                 bool merge_memtables_without_flushing = false;
-                if (replica.second.subrange) {
-                    thread_id = replica.second.subrange->GetCompactionThreadId(
+                if (replica.subrange) {
+                    thread_id = replica.subrange->GetCompactionThreadId(
                             &EnvBGThread::bg_flush_memtable_thread_id_seq,
                             &merge_memtables_without_flushing);
                 } else {
@@ -90,15 +108,62 @@ namespace leveldb {
                                     1, std::memory_order_relaxed) %
                             dbimpl->bg_flush_memtable_threads_.size();
                 }
-                dbimpl->ScheduleFlushMemTableTask(thread_id, memtable->memtableid(), memtable, replica.second.partition_id,
-                                                  replica.second.imm_slot, &rand_seed,
+                dbimpl->ScheduleFlushMemTableTask(thread_id, memtable->memtableid(), memtable, replica.partition_id,
+                                                  replica.imm_slot, &rand_seed,
                                                   merge_memtables_without_flushing);
             }
-            index++;
             NOVA_LOG(rdmaio::INFO)
                 << fmt::format("Recovery memtable-{} with {} log records", memtable->memtableid(), log_records);
-            uint32_t scid = mem_manager_->slabclassid(0, nova::NovaConfig::config->max_stoc_file_size);
             mem_manager_->FreeItem(0, buf, scid);
+            timeval replay_end{};
+            gettimeofday(&replay_end, nullptr);
+            recovered_log_records += log_records;
+            replay_duration += time_diff(replay_start, replay_end);
+        };
+
+        std::vector<std::thread> threads;
+        for (uint32_t tid = 0; tid < nthreads; tid++) {
+            threads.emplace_back([&]() {
+                while (true) {
+                    uint32_t index;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        cv.wait(lock, [&] {
+                            return !arrived.empty() || all_arrived;
+                        });
+                        if (arrived.empty()) {
+                            return;
+                        }
+                        index = arrived.front();
+                        arrived.pop_front();
+                    }
+                    replay(index);
+                }
+            });
+        }
+
+        timeval first_read_complete{};
+        bool first_read = true;
+        WaitForReads(client_, reqs, [&](uint32_t index) {
+            if (first_read) {
+                gettimeofday(&first_read_complete, nullptr);
+                first_read = false;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                arrived.push_back(index);
+            }
+            cv.notify_one();
+        });
+        timeval rdma_read_complete{};
+        gettimeofday(&rdma_read_complete, nullptr);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            all_arrived = true;
+        }
+        cv.notify_all();
+        for (auto &thread : threads) {
+            thread.join();
         }
 
         timeval end{};
@@ -106,8 +171,17 @@ namespace leveldb {
         NOVA_LOG(rdmaio::INFO)
             << fmt::format("memtable recovery duration: {},{},{},{}",
                            memtables_to_recover.size(),
-                           recovered_log_records,
+                           recovered_log_records.load(),
                            time_diff(start, rdma_read_complete),
                            time_diff(start, end));
+        // first read, all reads, replay time summed over threads, and the
+        // replay that remains after the last read completes.
+        NOVA_LOG(rdmaio::INFO)
+            << fmt::format("memtable recovery phases: threads:{} first-read:{} all-reads:{} replay:{} replay-after-reads:{}",
+                           nthreads,
+                           time_diff(start, first_read_complete),
+                           time_diff(start, rdma_read_complete),
+                           replay_duration.load(),
+                           time_diff(rdma_read_complete, end));
     }
-}
\ No newline at end of file
+}
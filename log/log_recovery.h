@@ -7,12 +7,44 @@
 #ifndef LEVELDB_LOG_RECOVERY_H
 #define LEVELDB_LOG_RECOVERY_H
 
+#include <functional>
+#include <vector>
+#include <fmt/core.h>
+
 #include "db/memtable.h"
 #include "ltc/stoc_client_impl.h"
 
 namespace leveldb {
     class StoCBlockClient;
 
+    // Wait for the reads "reqs" issued on "client" and call "arrived" with
+    // the index of each read once it completes. Each completed read posts
+    // the semaphore of the client once. Wait() is called exactly once per
+    // read so that no post is left over for the next user of the client.
+    template<typename Client>
+    void WaitForReads(Client *client, const std::vector<uint32_t> &reqs,
+                      const std::function<void(uint32_t)> &arrived) {
+        std::vector<bool> is_done(reqs.size(), false);
+        uint32_t completed = 0;
+        for (uint32_t waits = 0; waits < reqs.size(); waits++) {
+            client->Wait();
+            for (uint32_t i = 0; i < reqs.size(); i++) {
+                if (is_done[i]) {
+                    continue;
+                }
+                leveldb::StoCResponse response;
+                if (!client->IsDone(reqs[i], &response, nullptr)) {
+                    continue;
+                }
+                is_done[i] = true;
+                completed++;
+                arrived(i);
+            }
+        }
+        NOVA_ASSERT(completed == reqs.size())
+            << fmt::format("{} {}", completed, reqs.size());
+    }
+
     class LogRecovery {
     public:
         LogRecovery(leveldb::MemManager *mem_manager,
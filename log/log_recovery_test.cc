@@ -0,0 +1,124 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "log/log_recovery.h"
+
+#include <semaphore.h>
+#include <set>
+#include <vector>
+
+#include "common/nova_config.h"
+#include "ltc/storage_selector.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+    // Completes reads like the RDMA threads: a completed read is visible
+    // through IsDone before its post on the semaphore.
+    class FakeLogClient {
+    public:
+        FakeLogClient() {
+            sem_init(&sem_, 0, 0);
+        }
+
+        ~FakeLogClient() {
+            sem_destroy(&sem_);
+        }
+
+        uint32_t Initiate() {
+            return req_id_++;
+        }
+
+        void Complete(uint32_t req_id) {
+            done_.insert(req_id);
+        }
+
+        void Post() {
+            sem_post(&sem_);
+        }
+
+        void Wait() {
+            waits_++;
+            ASSERT_EQ(0, sem_trywait(&sem_));
+        }
+
+        bool IsDone(uint32_t req_id, StoCResponse *response,
+                    uint64_t *timeout) {
+            return done_.find(req_id) != done_.end();
+        }
+
+        int PendingPosts() {
+            int value = 0;
+            sem_getvalue(&sem_, &value);
+            return value;
+        }
+
+        uint32_t waits_ = 0;
+
+    private:
+        sem_t sem_;
+        uint32_t req_id_ = 1;
+        std::set<uint32_t> done_;
+    };
+
+    class LogRecoveryTest {
+    };
+
+    TEST(LogRecoveryTest, AllReadsCompleteBeforeFirstWait) {
+        FakeLogClient client;
+        std::vector<uint32_t> reqs;
+        for (int i = 0; i < 4; i++) {
+            reqs.push_back(client.Initiate());
+        }
+        for (uint32_t req : reqs) {
+            client.Complete(req);
+            client.Post();
+        }
+        std::vector<uint32_t> arrived;
+        WaitForReads(&client, reqs, [&](uint32_t index) {
+            arrived.push_back(index);
+        });
+        ASSERT_EQ(4, arrived.size());
+        for (uint32_t i = 0; i < arrived.size(); i++) {
+            ASSERT_EQ(i, arrived[i]);
+        }
+        ASSERT_EQ(4, client.waits_);
+        ASSERT_EQ(0, client.PendingPosts());
+    }
+
+    TEST(LogRecoveryTest, BackToBackRecoveriesOnOneClient) {
+        FakeLogClient client;
+        for (int round = 0; round < 3; round++) {
+            std::vector<uint32_t> reqs;
+            for (int i = 0; i < 3 + round; i++) {
+                reqs.push_back(client.Initiate());
+            }
+            // All reads complete before their posts reach the semaphore.
+            for (uint32_t req : reqs) {
+                client.Complete(req);
+            }
+            for (uint32_t i = 0; i < reqs.size(); i++) {
+                client.Post();
+            }
+            uint32_t waits = client.waits_;
+            std::vector<uint32_t> arrived;
+            WaitForReads(&client, reqs, [&](uint32_t index) {
+                arrived.push_back(index);
+            });
+            ASSERT_EQ(reqs.size(), arrived.size());
+            ASSERT_EQ(reqs.size(), client.waits_ - waits);
+            // Nothing is left for the next user of the client.
+            ASSERT_EQ(0, client.PendingPosts());
+        }
+    }
+
+}  // namespace leveldb
+
+nova::NovaConfig *nova::NovaConfig::config;
+nova::NovaGlobalVariables nova::NovaGlobalVariables::global;
+std::atomic<nova::Servers *> leveldb::StorageSelector::available_stoc_servers;
+std::atomic_int_fast32_t leveldb::StorageSelector::stoc_for_compaction_seq_id;
+std::atomic_int_fast32_t leveldb::StoCBlockClient::rdma_worker_seq_id_;
+
+int main(int argc, char **argv) { return leveldb::test::RunAllTests(); }
@@ -11,8 +11,10 @@
 #include <unistd.h>
 #include <sys/syscall.h>
 #include "leveldb/cache.h"
+#include "leveldb/filter_policy.h"
 
 #include "leveldb/write_batch.h"
+#include "port/port.h"
 #include "db/filename.h"
 #include "ltc/stoc_file_client_impl.h"
 #include "util/env_posix.h"
@@ -29,6 +31,91 @@
 
 
 namespace leveldb {
+    namespace {
+        // memtable_type is pool/static_partition with an optional ":inline"
+        // suffix that selects the inline skiplist representation.
+        void SetMemTableType(const std::string &memtable_type, leveldb::Options *options) {
+            std::string type = memtable_type;
+            options->memtable_representation = leveldb::MemTableRepresentation::kMemTableSkipList;
+            size_t sep = type.find(':');
+            if (sep != std::string::npos) {
+                std::string representation = type.substr(sep + 1);
+                NOVA_ASSERT(representation == "inline") << memtable_type;
+                options->memtable_representation = leveldb::MemTableRepresentation::kMemTableInlineSkipList;
+                type = type.substr(0, sep);
+            }
+            if (type == "pool") {
+                options->memtable_type = leveldb::MemTableType::kMemTablePool;
+            } else {
+                options->memtable_type = leveldb::MemTableType::kStaticPartition;
+            }
+        }
+
+        const leveldb::FilterPolicy *NewFilterPolicy() {
+            if (nova::NovaConfig::config->filter_policy == "blocked_bloom") {
+                return leveldb::NewBlockedBloomFilterPolicy(10);
+            }
+            return leveldb::NewBloomFilterPolicy(10);
+        }
+
+        void SetTableFormat(leveldb::Options *options) {
+            options->partition_index_and_filters =
+                    nova::NovaConfig::config->partition_index_and_filters;
+            options->metadata_partition_size =
+                    nova::NovaConfig::config->metadata_partition_size;
+            options->pin_l0_metadata_partitions =
+                    nova::NovaConfig::config->pin_l0_metadata_partitions;
+            options->data_block_hash_index =
+                    nova::NovaConfig::config->data_block_hash_index;
+        }
+
+        void SetReadahead(leveldb::Options *options) {
+            options->readahead_max_blocks =
+                    nova::NovaConfig::config->readahead_max_blocks;
+            options->compaction_readahead_blocks =
+                    nova::NovaConfig::config->compaction_readahead_blocks;
+        }
+
+        leveldb::CompressionType ParseCompressionType(const std::string &name) {
+            if (name == "snappy") {
+                return leveldb::kSnappyCompression;
+            }
+            if (name == "lz4") {
+                return leveldb::kLZ4Compression;
+            }
+            if (name == "zstd") {
+                return leveldb::kZstdCompression;
+            }
+            NOVA_ASSERT(name == "none") << name;
+            return leveldb::kNoCompression;
+        }
+
+        // compression_per_level is a comma separated list of
+        // none/snappy/lz4/zstd. Entry i applies to level i and the last entry
+        // to all deeper levels.
+        void SetCompression(leveldb::Env *env, leveldb::Options *options) {
+            std::string policy = nova::NovaConfig::config->compression_per_level;
+            std::vector<std::string> types = nova::SplitByDelimiter(&policy, ",");
+            options->compression = leveldb::kNoCompression;
+            options->compression_per_level.clear();
+            for (const auto &type : types) {
+                options->compression_per_level.push_back(ParseCompressionType(type));
+            }
+            if (!options->compression_per_level.empty()) {
+                options->compression = options->compression_per_level[0];
+            }
+            options->zstd_compression_level = nova::NovaConfig::config->zstd_compression_level;
+            const std::string &path = nova::NovaConfig::config->zstd_dictionary_path;
+            if (!path.empty()) {
+                std::string dictionary;
+                leveldb::Status s = leveldb::ReadFileToString(env, path, &dictionary);
+                NOVA_ASSERT(s.ok()) << fmt::format("zstd dictionary {}: {}", path, s.ToString());
+                options->zstd_dictionary = std::make_shared<leveldb::port::ZstdDictionary>(
+                        dictionary, options->zstd_compression_level);
+            }
+        }
+    }
+
     leveldb::Options
     BuildDBOptions(int cfg_id, int db_index, leveldb::Cache *cache,
                    leveldb::MemTablePool *memtable_pool,
@@ -63,23 +150,25 @@ namespace leveldb {
         options.max_open_files = 100000;
         options.enable_lookup_index = nova::NovaConfig::config->enable_lookup_index;
         options.enable_range_index = nova::NovaConfig::config->enable_range_index;
+        options.enable_parallel_l0_probe = nova::NovaConfig::config->enable_parallel_l0_probe;
+        options.enable_memtable_hash_index = nova::NovaConfig::config->enable_memtable_hash_index;
+        options.log_group_commit_max_bytes = nova::NovaConfig::config->log_group_commit_max_bytes;
+        options.log_group_commit_max_delay_us = nova::NovaConfig::config->log_group_commit_max_delay_us;
         options.num_recovery_thread = nova::NovaConfig::config->number_of_recovery_threads;
         options.num_compaction_threads = bg_flush_memtable_threads.size();
         options.max_stoc_file_size = std::max(options.write_buffer_size, options.max_file_size) +
                                      LEVELDB_TABLE_PADDING_SIZE_MB * 1024 * 1024;
         options.env = env;
         options.create_if_missing = true;
-        options.compression = leveldb::kNoCompression;
-        options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+        SetCompression(env, &options);
+        options.filter_policy = NewFilterPolicy();
+        SetTableFormat(&options);
+        SetReadahead(&options);
         options.bg_compaction_threads = bg_compaction_threads;
         options.bg_flush_memtable_threads = bg_flush_memtable_threads;
         options.enable_tracing = false;
         options.comparator = new YCSBKeyComparator();
-        if (nova::NovaConfig::config->memtable_type == "pool") {
-            options.memtable_type = leveldb::MemTableType::kMemTablePool;
-        } else {
-            options.memtable_type = leveldb::MemTableType::kStaticPartition;
-        }
+        SetMemTableType(nova::NovaConfig::config->memtable_type, &options);
         options.enable_subranges = nova::NovaConfig::config->enable_subrange;
         options.subrange_reorg_sampling_ratio = 1.0;
         options.reorg_thread = reorg_thread;
@@ -140,16 +229,14 @@ namespace leveldb {
                                      LEVELDB_TABLE_PADDING_SIZE_MB * 1024 * 1024;
         options.env = env;
         options.create_if_missing = true;
-        options.compression = leveldb::kNoCompression;
-        leveldb::InternalFilterPolicy *filter = new leveldb::InternalFilterPolicy(leveldb::NewBloomFilterPolicy(10));
+        SetCompression(env, &options);
+        leveldb::InternalFilterPolicy *filter = new leveldb::InternalFilterPolicy(NewFilterPolicy());
         options.filter_policy = filter;
+        SetTableFormat(&options);
+        SetReadahead(&options);
         options.enable_tracing = false;
         options.comparator = new YCSBKeyComparator();
-        if (nova::NovaConfig::config->memtable_type == "pool") {
-            options.memtable_type = leveldb::MemTableType::kMemTablePool;
-        } else {
-            options.memtable_type = leveldb::MemTableType::kStaticPartition;
-        }
+        SetMemTableType(nova::NovaConfig::config->memtable_type, &options);
         options.enable_subranges = nova::NovaConfig::config->enable_subrange;
         options.subrange_reorg_sampling_ratio = 1.0;
         options.enable_flush_multiple_memtables = nova::NovaConfig::config->enable_flush_multiple_memtables;
@@ -184,6 +184,8 @@ namespace leveldb {
             response->stoc_queue_depth = nova::NovaGlobalVariables::global.stoc_queue_depth;
             response->stoc_pending_write_bytes = nova::NovaGlobalVariables::global.stoc_pending_disk_writes;
             response->stoc_pending_read_bytes = nova::NovaGlobalVariables::global.stoc_pending_disk_reads;
+            response->stoc_table_cache_lookups = nova::NovaGlobalVariables::global.stoc_table_cache_lookups;
+            response->stoc_table_cache_hits = nova::NovaGlobalVariables::global.stoc_table_cache_hits;
             IncrementReqId();
             NOVA_LOG(rdmaio::DEBUG)
                 << fmt::format("Wake up local read stats");
@@ -285,6 +287,8 @@ namespace leveldb {
         response->stoc_queue_depth = stored_response->stoc_queue_depth;
         response->stoc_pending_read_bytes = stored_response->stoc_pending_read_bytes;
         response->stoc_pending_write_bytes = stored_response->stoc_pending_write_bytes;
+        response->stoc_table_cache_lookups = stored_response->stoc_table_cache_lookups;
+        response->stoc_table_cache_hits = stored_response->stoc_table_cache_hits;
         response->is_ready_to_process_requests = stored_response->is_ready_to_process_requests;
         delete it->second;
         req_response.erase(req_id);
@@ -410,6 +414,23 @@ namespace leveldb {
     uint32_t StoCBlockClient::InitiateReadDataBlock(
             const leveldb::StoCBlockHandle &block_handle, uint64_t offset, uint32_t size, char *result,
             uint32_t result_size, std::string filename, bool is_foreground_reads) {
+        return ReadDataBlock(block_handle, offset, size, result, result_size,
+                             filename, is_foreground_reads, nullptr);
+    }
+
+    uint32_t StoCBlockClient::InitiateAsyncReadDataBlock(
+            const leveldb::StoCBlockHandle &block_handle, uint64_t offset, uint32_t size, char *result,
+            uint32_t result_size, bool is_foreground_reads,
+            const StoCCallback &callback) {
+        NOVA_ASSERT(callback);
+        return ReadDataBlock(block_handle, offset, size, result, result_size,
+                             "", is_foreground_reads, callback);
+    }
+
+    uint32_t StoCBlockClient::ReadDataBlock(
+            const leveldb::StoCBlockHandle &block_handle, uint64_t offset, uint32_t size, char *result,
+            uint32_t result_size, std::string filename, bool is_foreground_reads,
+            const StoCCallback &callback) {
         NOVA_ASSERT(size <= result_size)
             << fmt::format("{} {} {} {}", block_handle.DebugString(), filename,
                            size, result_size);
@@ -427,13 +448,20 @@ namespace leveldb {
             stoc_file_manager_->ReadDataBlock(converted_handle,
                                               converted_handle.offset,
                                               converted_handle.size,
-                                              result, &output);
+                                              result, &output,
+                                              is_foreground_reads
+                                              ? Cache::kHighPriority
+                                              : Cache::kLowPriority);
 //            RDMA_ASSERT(output.size() == converted_handle.size);
             NOVA_LOG(rdmaio::DEBUG)
                 << fmt::format("Wake up local read");
-            sem_post(&sem_);
             uint32_t reqid = req_id_;
             IncrementReqId();
+            if (callback) {
+                callback();
+            } else {
+                sem_post(&sem_);
+            }
             return reqid;
         }
 
@@ -446,7 +474,82 @@ namespace leveldb {
         task.result = result;
         task.write_size = result_size;
         task.filename = filename;
-        task.sem = &sem_;
+        if (callback) {
+            task.callback = callback;
+        } else {
+            task.sem = &sem_;
+        }
+        task.is_foreground_reads = is_foreground_reads;
+        AddAsyncTask(task);
+
+        uint32_t reqid = req_id_;
+        IncrementReqId();
+        return reqid;
+    }
+
+    uint32_t StoCBlockClient::InitiateReadDataBlocks(
+            const std::vector<leveldb::StoCBlockHandle> &block_handles,
+            char *result, uint32_t result_size, bool is_foreground_reads) {
+        return ReadDataBlocks(block_handles, result, result_size,
+                              is_foreground_reads, nullptr);
+    }
+
+    uint32_t StoCBlockClient::InitiateAsyncReadDataBlocks(
+            const std::vector<leveldb::StoCBlockHandle> &block_handles,
+            char *result, uint32_t result_size, bool is_foreground_reads,
+            const StoCCallback &callback) {
+        NOVA_ASSERT(callback);
+        return ReadDataBlocks(block_handles, result, result_size,
+                              is_foreground_reads, callback);
+    }
+
+    uint32_t StoCBlockClient::ReadDataBlocks(
+            const std::vector<leveldb::StoCBlockHandle> &block_handles,
+            char *result, uint32_t result_size, bool is_foreground_reads,
+            const StoCCallback &callback) {
+        NOVA_ASSERT(!block_handles.empty());
+        uint32_t size = 0;
+        for (const auto &handle : block_handles) {
+            NOVA_ASSERT(handle.server_id == block_handles[0].server_id);
+            size += handle.size;
+        }
+        NOVA_ASSERT(size <= result_size) << fmt::format("{} {}", size, result_size);
+        if (block_handles[0].server_id == nova::NovaConfig::config->my_server_id) {
+            uint32_t offset = 0;
+            for (const auto &handle : block_handles) {
+                Slice output;
+                stoc_file_manager_->ReadDataBlock(handle, handle.offset,
+                                                  handle.size,
+                                                  result + offset, &output,
+                                                  is_foreground_reads
+                                                  ? Cache::kHighPriority
+                                                  : Cache::kLowPriority);
+                offset += handle.size;
+            }
+            NOVA_LOG(rdmaio::DEBUG)
+                << fmt::format("Wake up local read");
+            uint32_t reqid = req_id_;
+            IncrementReqId();
+            if (callback) {
+                callback();
+            } else {
+                sem_post(&sem_);
+            }
+            return reqid;
+        }
+
+        RDMARequestTask task = {};
+        task.type = RDMAClientRequestType::RDMA_CLIENT_REQ_READ_BLOCKS;
+        task.server_id = block_handles[0].server_id;
+        task.stoc_block_handles = block_handles;
+        task.size = size;
+        task.result = result;
+        task.write_size = result_size;
+        if (callback) {
+            task.callback = callback;
+        } else {
+            task.sem = &sem_;
+        }
         task.is_foreground_reads = is_foreground_reads;
         AddAsyncTask(task);
 
@@ -601,12 +704,13 @@ namespace leveldb {
         uint32_t msg_size = 1;
         send_buf[0] = StoCRequestType::STOC_READ_BLOCKS;
         msg_size += EncodeBool(send_buf + msg_size, is_foreground_reads);
+        msg_size += EncodeFixed64(send_buf + msg_size, (uint64_t) result);
+        msg_size += EncodeStr(send_buf + msg_size, filename);
+        msg_size += EncodeFixed32(send_buf + msg_size, 1);
         msg_size += EncodeFixed32(send_buf + msg_size,
                                   block_handle.stoc_file_id);
         msg_size += EncodeFixed64(send_buf + msg_size, offset);
         msg_size += EncodeFixed32(send_buf + msg_size, size);
-        msg_size += EncodeFixed64(send_buf + msg_size, (uint64_t) result);
-        msg_size += EncodeStr(send_buf + msg_size, filename);
         rdma_broker_->PostSend(send_buf, msg_size, block_handle.server_id,
                                req_id);
         request_context_[req_id] = context;
@@ -622,6 +726,50 @@ namespace leveldb {
         return req_id;
     }
 
+    uint32_t StoCRDMAClient::InitiateReadDataBlocks(
+            const std::vector<leveldb::StoCBlockHandle> &block_handles,
+            char *result, uint32_t result_size, bool is_foreground_reads) {
+        NOVA_ASSERT(!block_handles.empty());
+        uint32_t server_id = block_handles[0].server_id;
+        NOVA_ASSERT(server_id != nova::NovaConfig::config->my_server_id);
+        uint32_t size = 0;
+        for (const auto &handle : block_handles) {
+            size += handle.size;
+        }
+        NOVA_ASSERT(size <= result_size);
+        uint32_t req_id = current_req_id_;
+        StoCRequestContext context = {};
+        context.req_type = StoCRequestType::STOC_READ_BLOCKS;
+        context.backing_mem = result;
+        context.size = size;
+        context.done = false;
+
+        char *send_buf = rdma_broker_->GetSendBuf(server_id);
+        uint32_t msg_size = 1;
+        send_buf[0] = StoCRequestType::STOC_READ_BLOCKS;
+        msg_size += EncodeBool(send_buf + msg_size, is_foreground_reads);
+        msg_size += EncodeFixed64(send_buf + msg_size, (uint64_t) result);
+        msg_size += EncodeStr(send_buf + msg_size, "");
+        msg_size += EncodeFixed32(send_buf + msg_size, block_handles.size());
+        for (const auto &handle : block_handles) {
+            NOVA_ASSERT(handle.server_id == server_id);
+            msg_size += EncodeFixed32(send_buf + msg_size,
+                                      handle.stoc_file_id);
+            msg_size += EncodeFixed64(send_buf + msg_size, handle.offset);
+            msg_size += EncodeFixed32(send_buf + msg_size, handle.size);
+        }
+        NOVA_ASSERT(msg_size <= nova::NovaConfig::config->max_msg_size);
+        rdma_broker_->PostSend(send_buf, msg_size, server_id, req_id);
+        request_context_[req_id] = context;
+        IncrementReqId();
+        NOVA_LOG(DEBUG)
+            << fmt::format(
+                    "stocclient[{}]: Read {} blocks server:{} size:{} backing_mem:{} req:{}",
+                    stoc_client_id_, block_handles.size(), server_id, size,
+                    (uint64_t) result, req_id);
+        return req_id;
+    }
+
     uint32_t
     StoCRDMAClient::InitiateIsReadyForProcessingRequests(uint32_t stoc_id) {
         NOVA_ASSERT(stoc_id != nova::NovaConfig::config->my_server_id);
@@ -791,6 +939,8 @@ namespace leveldb {
                 response->stoc_queue_depth = context_it->second.stoc_queue_depth;
                 response->stoc_pending_read_bytes = context_it->second.stoc_pending_read_bytes;
                 response->stoc_pending_write_bytes = context_it->second.stoc_pending_write_bytes;
+                response->stoc_table_cache_lookups = context_it->second.stoc_table_cache_lookups;
+                response->stoc_table_cache_hits = context_it->second.stoc_table_cache_hits;
                 response->is_ready_to_process_requests = context_it->second.is_ready_for_requests;
             }
             request_context_.erase(req_id);
@@ -939,7 +1089,9 @@ namespace leveldb {
                             msg_size += StoCBlockHandle::HandleSize();
                             rids += fmt::format("{},", rh.stoc_file_id);
                         }
-                        NOVA_ASSERT(stoc_block_handles == 1);
+                        // No handles means the StoC failed to persist the
+                        // file.
+                        NOVA_ASSERT(stoc_block_handles <= 1);
                         context.done = true;
                         NOVA_LOG(DEBUG) << fmt::format(
                                     "stocclient[{}]: Persist StoC file received handles:{} rids:{} req:{}",
@@ -954,6 +1106,10 @@ namespace leveldb {
                                 buf + 9);
                         context.stoc_pending_write_bytes = leveldb::DecodeFixed64(
                                 buf + 17);
+                        context.stoc_table_cache_lookups = leveldb::DecodeFixed64(
+                                buf + 25);
+                        context.stoc_table_cache_hits = leveldb::DecodeFixed64(
+                                buf + 33);
                         context.done = true;
                         processed = true;
                     } else if (buf[0] ==
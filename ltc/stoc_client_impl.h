@@ -61,6 +61,31 @@ namespace leveldb {
                               std::string filename,
                               bool is_foreground_reads) override;
 
+        uint32_t
+        InitiateReadDataBlocks(const std::vector<StoCBlockHandle> &block_handles,
+                               char *result,
+                               uint32_t result_size,
+                               bool is_foreground_reads) override;
+
+        // Asynchronous flavors of the reads above. They do not post sem_.
+        // Instead, "callback" runs on the RDMA thread once the read
+        // completes. A read served by the local StoC runs it before
+        // returning. The caller must not block on Wait() for these reads.
+        uint32_t
+        InitiateAsyncReadDataBlock(const StoCBlockHandle &block_handle,
+                                   uint64_t offset, uint32_t size,
+                                   char *result,
+                                   uint32_t result_size,
+                                   bool is_foreground_reads,
+                                   const StoCCallback &callback);
+
+        uint32_t
+        InitiateAsyncReadDataBlocks(const std::vector<StoCBlockHandle> &block_handles,
+                                    char *result,
+                                    uint32_t result_size,
+                                    bool is_foreground_reads,
+                                    const StoCCallback &callback);
+
         uint32_t
         InitiateInstallFileNameStoCFileMapping(uint32_t stoc_id,
                                                const std::unordered_map<std::string, uint32_t> &fn_stocfnid) override;
@@ -115,6 +140,10 @@ namespace leveldb {
 
         std::vector<nova::RDMAMsgHandler *> rdma_msg_handlers_;
 
+        StocPersistentFileManager *stoc_file_manager() const {
+            return stoc_file_manager_;
+        }
+
         sem_t Wait() {
             NOVA_ASSERT(sem_wait(&sem_) == 0);
         }
@@ -129,6 +158,18 @@ namespace leveldb {
 
         void AddAsyncTask(const RDMARequestTask &task);
 
+        // Post sem_ if "callback" is empty. Otherwise, invoke it.
+        uint32_t
+        ReadDataBlock(const StoCBlockHandle &block_handle,
+                      uint64_t offset, uint32_t size, char *result,
+                      uint32_t result_size, std::string filename,
+                      bool is_foreground_reads, const StoCCallback &callback);
+
+        uint32_t
+        ReadDataBlocks(const std::vector<StoCBlockHandle> &block_handles,
+                       char *result, uint32_t result_size,
+                       bool is_foreground_reads, const StoCCallback &callback);
+
         StocPersistentFileManager *stoc_file_manager_;
         uint32_t current_rdma_msg_handler_id_ = 0;
         uint32_t req_id_ = 1;
@@ -179,6 +220,12 @@ namespace leveldb {
                               std::string filename,
                               bool is_foreground_reads) override;
 
+        uint32_t
+        InitiateReadDataBlocks(const std::vector<StoCBlockHandle> &block_handles,
+                               char *result,
+                               uint32_t result_size,
+                               bool is_foreground_reads) override;
+
         uint32_t
         InitiateReadInMemoryLogFile(char *local_buf, uint32_t stoc_id,
                                     uint64_t remote_offset,
@@ -5,15 +5,18 @@
 //
 
 #include <semaphore.h>
+#include <memory>
 #include <leveldb/table.h>
 #include <table/block.h>
 #include <table/block_builder.h>
+#include <table/filter_block.h>
 #include <util/crc32c.h>
 
 #include "stoc_file_client_impl.h"
 #include "storage_selector.h"
 #include "db/filename.h"
 #include "common/nova_config.h"
+#include "util/erasure_coding.h"
 
 namespace leveldb {
     StoCWritableFileClient::StoCWritableFileClient(Env *env,
@@ -60,10 +63,9 @@ namespace leveldb {
                         "Free remote memory file tid:{} fn:{} size:{}",
                         thread_id_, fname_debug_only_, allocated_size_);
         }
-        if (parity_block_backing_mem_) {
-            uint32_t scid = mem_manager_->slabclassid(thread_id_,
-                                                      parity_block_size_);
-            mem_manager_->FreeItem(thread_id_, parity_block_backing_mem_, scid);
+        for (char *parity_block_backing_mem : parity_block_backing_mems_) {
+            uint32_t scid = mem_manager_->slabclassid(0, parity_block_size_);
+            mem_manager_->FreeItem(0, parity_block_backing_mem, scid);
             NOVA_LOG(rdmaio::DEBUG) << fmt::format(
                         "Free parity memory file tid:{} fn:{} size:{}",
                         thread_id_, fname_debug_only_, parity_block_size_);
@@ -257,7 +259,7 @@ namespace leveldb {
         } else {
             num_stocs_to_select = nblocks_in_group_.size();
             if (nova::NovaConfig::config->use_parity_for_sstable_data_blocks) {
-                num_stocs_to_select += 1;
+                num_stocs_to_select += nova::NovaConfig::config->number_of_parity_fragments;
             }
             num_stocs_to_select = std::max(num_stocs_to_select,
                                            nova::NovaConfig::config->number_of_sstable_metadata_replicas);
@@ -327,41 +329,53 @@ namespace leveldb {
             }
         }
         if (nova::NovaConfig::config->use_parity_for_sstable_data_blocks) {
-            NOVA_ASSERT(group_id < stocs_to_store_fragments_.size());
-            // figure out max size.
-            // allocate memory.
-            // do xor.
+            uint32_t nparity = nova::NovaConfig::config->number_of_parity_fragments;
+            NOVA_ASSERT(group_id + nparity <= stocs_to_store_fragments_.size());
             for (const auto &data_fragment : data_fragments) {
                 if (data_fragment.size() > parity_block_size_) {
                     parity_block_size_ = data_fragment.size();
                 }
             }
-            auto scid = mem_manager_->slabclassid(0, parity_block_size_);
-            parity_block_backing_mem_ = mem_manager_->ItemAlloc(0, scid);
-            for (int i = 0; i < parity_block_size_; i++) {
-                uint8_t byte = 0;
-                for (const auto &data_fragment : data_fragments) {
-                    if (data_fragment.size() <= parity_block_size_) {
-                        byte ^= (uint8_t) backing_mem_[data_fragment.offset() + i];
-                    }
+            // Encode over fragments zero-padded to the size of the largest one.
+            std::vector<std::string> padded_fragments(data_fragments.size());
+            std::vector<const char *> data(data_fragments.size());
+            for (int i = 0; i < data_fragments.size(); i++) {
+                data[i] = backing_mem_ + data_fragments[i].offset();
+                if (data_fragments[i].size() < parity_block_size_) {
+                    padded_fragments[i].assign(data[i], data_fragments[i].size());
+                    padded_fragments[i].resize(parity_block_size_, 0);
+                    data[i] = padded_fragments[i].data();
                 }
-                parity_block_backing_mem_[i] = byte;
-            }
-            uint32_t remote_stoc_id = stocs_to_store_fragments_[group_id];
-            uint32_t stoc_file_id = 0;
-            uint32_t req_id = client->InitiateAppendBlock(
-                    remote_stoc_id, thread_id_, &stoc_file_id,
-                    parity_block_backing_mem_,
-                    dbname_, file_number_, 0,
-                    parity_block_size_, FileInternalType::kFileParity);
-            NOVA_LOG(rdmaio::DEBUG)
-                << fmt::format(
-                        "t[{}]: Initiated WRITE parity blocks {} s:{} req:{} db:{} fn:{} replica:{}",
-                        thread_id_, parity_block_size_, remote_stoc_id, req_id,
-                        dbname_, file_number_, 0);
-            parity_persist_status_.remote_server_id = remote_stoc_id;
-            parity_persist_status_.WRITE_req_id = req_id;
-            parity_persist_status_.result_handle = {};
+            }
+            auto scid = mem_manager_->slabclassid(0, parity_block_size_);
+            for (int parity_id = 0; parity_id < nparity; parity_id++) {
+                char *buf = mem_manager_->ItemAlloc(0, scid);
+                NOVA_ASSERT(buf) << "Running out of memory " << parity_block_size_;
+                parity_block_backing_mems_.push_back(buf);
+            }
+            std::unique_ptr<ErasureCoder> coder(NewErasureCoder(data.size(), nparity));
+            coder->Encode(data.data(), parity_block_backing_mems_.data(),
+                          parity_block_size_);
+            for (int parity_id = 0; parity_id < nparity; parity_id++) {
+                uint32_t remote_stoc_id = stocs_to_store_fragments_[group_id + parity_id];
+                uint32_t stoc_file_id = 0;
+                uint32_t req_id = client->InitiateAppendBlock(
+                        remote_stoc_id, thread_id_, &stoc_file_id,
+                        parity_block_backing_mems_[parity_id],
+                        dbname_, file_number_, parity_id,
+                        parity_block_size_, FileInternalType::kFileParity);
+                NOVA_LOG(rdmaio::DEBUG)
+                    << fmt::format(
+                            "t[{}]: Initiated WRITE {} parity blocks {} s:{} req:{} db:{} fn:{} replica:{}",
+                            thread_id_, coder->Name(), parity_block_size_,
+                            remote_stoc_id, req_id, dbname_, file_number_,
+                            parity_id);
+                PersistStatus status = {};
+                status.remote_server_id = remote_stoc_id;
+                status.WRITE_req_id = req_id;
+                status.result_handle = {};
+                parity_persist_statuses_.push_back(status);
+            }
         }
 
         NOVA_ASSERT(group_id == nblocks_in_group_.size()) << fmt::format(
@@ -376,14 +390,18 @@ namespace leveldb {
         delete it;
     }
 
-    StoCBlockHandle StoCWritableFileClient::parity_block_handle() {
-        return parity_persist_status_.result_handle;
+    std::vector<StoCBlockHandle> StoCWritableFileClient::parity_block_handles() {
+        std::vector<StoCBlockHandle> handles;
+        for (const auto &status : parity_persist_statuses_) {
+            handles.push_back(status.result_handle);
+        }
+        return handles;
     }
 
     void StoCWritableFileClient::Validate(const std::vector<leveldb::FileReplicaMetaData> &replicas,
-                                          const StoCBlockHandle &parity_block_handle) {
+                                          const std::vector<StoCBlockHandle> &parity_block_handles) {
         StorageSelector selector(rand_seed_);
-        selector.ValidateReplicas(replicas, parity_block_handle);
+        selector.ValidateReplicas(replicas, parity_block_handles);
     }
 
     std::vector<leveldb::FileReplicaMetaData>
@@ -409,7 +427,7 @@ namespace leveldb {
         for (int i = 0; i < nblocks_in_group_.size() * data_replica_status_.size(); i++) {
             client->Wait();
         }
-        if (nova::NovaConfig::config->use_parity_for_sstable_data_blocks) {
+        for (int i = 0; i < parity_persist_statuses_.size(); i++) {
             client->Wait();
         }
     }
@@ -425,19 +443,20 @@ namespace leveldb {
                 StoCResponse response = {};
                 NOVA_ASSERT(client->IsDone(req_id, &response, nullptr));
                 NOVA_ASSERT(response.stoc_block_handles.size() == 1)
-                    << fmt::format("{} {}", req_id,
+                    << fmt::format("StoC failed to persist {} {}", req_id,
                                    response.stoc_block_handles.size());
                 status.persist_statuses[i].result_handle = response.stoc_block_handles[0];
             }
         }
 
-        if (nova::NovaConfig::config->use_parity_for_sstable_data_blocks) {
-            uint32_t req_id = parity_persist_status_.WRITE_req_id;
+        for (auto &parity_persist_status : parity_persist_statuses_) {
+            uint32_t req_id = parity_persist_status.WRITE_req_id;
             StoCResponse response = {};
             NOVA_ASSERT(client->IsDone(req_id, &response, nullptr));
             NOVA_ASSERT(response.stoc_block_handles.size() == 1)
-                << fmt::format("{} {}", req_id, response.stoc_block_handles.size());
-            parity_persist_status_.result_handle = response.stoc_block_handles[0];
+                << fmt::format("StoC failed to persist {} {}", req_id,
+                               response.stoc_block_handles.size());
+            parity_persist_status.result_handle = response.stoc_block_handles[0];
         }
 
         struct MetaBlockStatus {
@@ -475,7 +494,7 @@ namespace leveldb {
             StoCResponse response = {};
             NOVA_ASSERT(client->IsDone(metablock_replica_status[replica_id].req_id, &response, nullptr));
             NOVA_ASSERT(response.stoc_block_handles.size() == 1)
-                << fmt::format("{} {}",
+                << fmt::format("StoC failed to persist {} {}",
                                metablock_replica_status[replica_id].req_id,
                                response.stoc_block_handles.size());
             meta_block_handles_[replica_id] = response.stoc_block_handles[0];
@@ -503,6 +522,21 @@ namespace leveldb {
         NOVA_ASSERT(s.ok()) << fmt::format("footer", s.ToString());
         Options opt(options_);
         BlockBuilder index_block_builder(&opt);
+        // Partitions of the index and the filter block. See
+        // Options::partition_index_and_filters.
+        struct MetadataPartition {
+            std::string index_contents;
+            std::string filter_contents;
+            std::string last_key;
+            uint64_t first_block_offset = 0;
+            uint64_t last_block_offset = 0;
+            uint64_t filter_base = 0;
+        };
+        const bool partitioned = options_.partition_index_and_filters &&
+                                 options_.filter_policy != nullptr;
+        std::vector<MetadataPartition> partitions;
+        BlockBuilder partition_builder(&opt);
+        MetadataPartition partition;
         Iterator *it = index_block_->NewIterator(options_.comparator);
         it->SeekToFirst();
         uint32_t data_replica_id = replica_id;
@@ -534,8 +568,24 @@ namespace leveldb {
             // Does not include crc.
             index_handle.size = handle.size();
             index_handle.EncodeHandle(handle_buf);
-            index_block_builder.Add(key, Slice(handle_buf,
-                                               StoCBlockHandle::HandleSize()));
+            if (partitioned) {
+                if (partition_builder.empty()) {
+                    partition.first_block_offset = handle.offset();
+                }
+                partition.last_block_offset = handle.offset();
+                partition_builder.Add(key, Slice(handle_buf,
+                                                 StoCBlockHandle::HandleSize()));
+                if (partition_builder.CurrentSizeEstimate() >=
+                    options_.metadata_partition_size) {
+                    partition.last_key = key.ToString();
+                    partition.index_contents = partition_builder.Finish().ToString();
+                    partition_builder.Reset();
+                    partitions.push_back(partition);
+                }
+            } else {
+                index_block_builder.Add(key, Slice(handle_buf,
+                                                   StoCBlockHandle::HandleSize()));
+            }
             it->Next();
             n++;
             if (n == nblocks_in_group_[group_id]) {
@@ -558,9 +608,49 @@ namespace leveldb {
         NOVA_ASSERT(n == 0)
             << fmt::format("Contain {} data blocks. Read {} data blocks",
                            num_data_blocks_, n);
+        if (partitioned && !partition_builder.empty()) {
+            it->SeekToLast();
+            partition.last_key = it->key().ToString();
+            partition.index_contents = partition_builder.Finish().ToString();
+            partitions.push_back(partition);
+        }
+        delete it;
+        // The range tombstone block, if any, sits between the filter block and
+        // the metaindex block.
+        uint64_t filter_block_end_offset = footer.metaindex_handle().offset();
+        bool has_range_tombstones = false;
+        Slice range_tombstone_contents;
+        {
+            const char *metaindex_buf =
+                    backing_mem_ + footer.metaindex_handle().offset();
+            StoCBlockHandle metaindex_handle = {};
+            metaindex_handle.offset = footer.metaindex_handle().offset();
+            metaindex_handle.size = footer.metaindex_handle().size();
+            BlockContents metaindex_contents;
+            s = Table::ReadBlock(metaindex_buf,
+                                 Slice(metaindex_buf, metaindex_handle.size),
+                                 ReadOptions(), metaindex_handle,
+                                 &metaindex_contents);
+            NOVA_ASSERT(s.ok()) << s.ToString();
+            Block metaindex(metaindex_contents, file_number_,
+                            metaindex_handle.offset);
+            Iterator *meta_it = metaindex.NewIterator(BytewiseComparator());
+            meta_it->Seek(kRangeTombstoneBlockName);
+            if (meta_it->Valid() &&
+                meta_it->key() == Slice(kRangeTombstoneBlockName)) {
+                Slice v = meta_it->value();
+                BlockHandle handle;
+                NOVA_ASSERT(handle.DecodeFrom(&v).ok());
+                filter_block_end_offset = handle.offset();
+                has_range_tombstones = true;
+                range_tombstone_contents = Slice(backing_mem_ + handle.offset(),
+                                                 handle.size());
+            }
+            delete meta_it;
+        }
         // Rewrite index handle after filter block.
         uint32_t filter_block_size =
-                footer.metaindex_handle().offset() - filter_block_start_offset -
+                filter_block_end_offset - filter_block_start_offset -
                 kBlockTrailerSize;
         uint64_t new_file_size = filter_block_size + kBlockTrailerSize;
         // point to start of filter block.
@@ -568,6 +658,20 @@ namespace leveldb {
 
         uint64_t metablock_size =
                 used_size_ - rewrite_start_offset + METABLOCK_SIZE_PADDING;
+        if (partitioned) {
+            FilterBlockReader filter(options_.filter_policy,
+                                     Slice(backing_mem_ + filter_block_start_offset,
+                                           filter_block_size));
+            for (auto &p : partitions) {
+                filter.EncodePartition(p.first_block_offset,
+                                       p.last_block_offset, &p.filter_contents,
+                                       &p.filter_base);
+                metablock_size += p.filter_contents.size() +
+                                  p.index_contents.size() + p.last_key.size() +
+                                  2 * kBlockTrailerSize +
+                                  2 * BlockHandle::kMaxEncodedLength + 15;
+            }
+        }
         uint32_t scid = mem_manager_->slabclassid(0, metablock_size);
         char *backing_mem = mem_manager_->ItemAlloc(0, scid);
         *allocated_mem = backing_mem;
@@ -575,23 +679,73 @@ namespace leveldb {
 
         uint64_t allocated_size = metablock_size;
         uint64_t used_size = 0;
-        // Copy filter block.
-        memcpy(backing_mem, backing_mem_ + rewrite_start_offset, new_file_size);
-
         BlockHandle new_filter_handle = {};
         new_filter_handle.set_offset(0);
-        new_filter_handle.set_size(filter_block_size);
+        BlockBuilder top_level_index_builder(&opt);
+        if (partitioned) {
+            // Filter partitions, index partitions, and then the top-level
+            // index in place of the index block.
+            new_file_size = 0;
+            std::vector<PartitionHandle> handles(partitions.size());
+            for (uint32_t i = 0; i < partitions.size(); i++) {
+                uint32_t size = WriteRawBlock(partitions[i].filter_contents,
+                                              kNoCompression, new_file_size,
+                                              backing_mem, allocated_size,
+                                              &used_size);
+                handles[i].id = i;
+                handles[i].filter_base = partitions[i].filter_base;
+                handles[i].filter_handle.set_offset(new_file_size);
+                handles[i].filter_handle.set_size(size - kBlockTrailerSize);
+                new_file_size += size;
+            }
+            new_filter_handle.set_size(new_file_size);
+            for (uint32_t i = 0; i < partitions.size(); i++) {
+                uint32_t size = WriteRawBlock(partitions[i].index_contents,
+                                              kNoCompression, new_file_size,
+                                              backing_mem, allocated_size,
+                                              &used_size);
+                handles[i].index_handle.set_offset(new_file_size);
+                handles[i].index_handle.set_size(size - kBlockTrailerSize);
+                new_file_size += size;
+                std::string handle_encoding;
+                handles[i].EncodeTo(&handle_encoding);
+                top_level_index_builder.Add(partitions[i].last_key,
+                                            handle_encoding);
+            }
+            filter_block_size = new_filter_handle.size();
+        } else {
+            // Copy filter block.
+            memcpy(backing_mem, backing_mem_ + rewrite_start_offset,
+                   new_file_size);
+            new_filter_handle.set_size(filter_block_size);
+        }
+        BlockHandle new_range_tombstone_handle = {};
+        if (has_range_tombstones) {
+            uint32_t size = WriteRawBlock(range_tombstone_contents,
+                                          kNoCompression, new_file_size,
+                                          backing_mem, allocated_size,
+                                          &used_size);
+            new_range_tombstone_handle.set_offset(new_file_size);
+            new_range_tombstone_handle.set_size(size - kBlockTrailerSize);
+            new_file_size += size;
+        }
         BlockHandle new_metaindex_handle = {};
         BlockHandle new_idx_handle = {};
         {
             // rewrite meta index block.
             BlockBuilder meta_index_block(&options_);
             // Add mapping from "filter.Name" to location of filter data
-            std::string key = "filter.";
+            std::string key = partitioned ? kPartitionedFilterPrefix : "filter.";
             key.append(options_.filter_policy->Name());
             std::string handle_encoding;
             new_filter_handle.EncodeTo(&handle_encoding);
             meta_index_block.Add(key, handle_encoding);
+            if (has_range_tombstones) {
+                handle_encoding.clear();
+                new_range_tombstone_handle.EncodeTo(&handle_encoding);
+                meta_index_block.Add(kRangeTombstoneBlockName,
+                                     handle_encoding);
+            }
             uint32_t size = WriteBlock(&meta_index_block,
                                        new_file_size, backing_mem,
                                        allocated_size, &used_size);
@@ -601,7 +755,8 @@ namespace leveldb {
         }
         //Rewrite index block.
         {
-            uint32_t size = WriteBlock(&index_block_builder,
+            uint32_t size = WriteBlock(partitioned ? &top_level_index_builder
+                                                   : &index_block_builder,
                                        new_file_size, backing_mem,
                                        allocated_size, &used_size);
             new_idx_handle.set_offset(new_file_size);
@@ -668,30 +823,13 @@ namespace leveldb {
         //    block_data: uint8[n]
         //    type: uint8
         //    crc: uint32
+        //
+        // Only the index and meta index blocks are written here. They are
+        // stored uncompressed since they are parsed in place from backing_mem
+        // and read once per table open. Data blocks are compressed by the
+        // TableBuilder.
         Slice raw = block->Finish();
-
-        Slice block_contents;
-        CompressionType type = options_.compression;
-        std::string compressed;
-        switch (type) {
-            case kNoCompression:
-                block_contents = raw;
-                break;
-            case kSnappyCompression: {
-                if (port::Snappy_Compress(raw.data(), raw.size(),
-                                          &compressed) &&
-                    compressed.size() < raw.size() - (raw.size() / 8u)) {
-                    block_contents = compressed;
-                } else {
-                    // Snappy not supported, or compressed less than 12.5%, so just
-                    // store uncompressed form
-                    block_contents = raw;
-                    type = kNoCompression;
-                }
-                break;
-            }
-        }
-        uint32_t size = WriteRawBlock(block_contents, type, offset, backing_mem,
+        uint32_t size = WriteRawBlock(raw, kNoCompression, offset, backing_mem,
                                       allocated_size, used_size);
         block->Reset();
         return size;
@@ -772,6 +910,14 @@ namespace leveldb {
         // StoC handle. Read it.
         char *ptr = nullptr;
         uint64_t local_offset = 0;
+        if (!prefetch_all_ && IsDegradedRead(block_handle)) {
+            int fragment_id = FragmentId(block_handle);
+            const StoCBlockHandle &fragment = meta_->block_replica_handles[0].data_block_group_handles[fragment_id];
+            Status s = ReconstructRange(read_options.stoc_client, fragment_id,
+                                        offset - fragment.offset, n, scratch);
+            *result = Slice(scratch, n);
+            return s;
+        }
         if (prefetch_all_) {
             NOVA_ASSERT(backing_mem_table_);
             uint64_t id =
@@ -813,6 +959,141 @@ namespace leveldb {
         return Status::OK();
     }
 
+    bool StoCRandomAccessFileClientImpl::InitiateRead(
+            const leveldb::ReadOptions &read_options,
+            const leveldb::StoCBlockHandle &block_handle, uint64_t offset,
+            size_t n, char *backing_mem, char *scratch) {
+        NOVA_ASSERT(scratch);
+        if (!IsRemoteRead(block_handle)) {
+            // Served locally.
+            Slice result;
+            NOVA_ASSERT(Read(read_options, block_handle, offset, n, &result,
+                             scratch).ok());
+            if (result.data() != scratch) {
+                memcpy(scratch, result.data(), n);
+            }
+            return false;
+        }
+        NOVA_ASSERT(n < MAX_BLOCK_SIZE);
+        NOVA_ASSERT(backing_mem);
+        auto stoc_client = reinterpret_cast<leveldb::StoCBlockClient *>(read_options.stoc_client);
+        uint32_t req_id = stoc_client->InitiateReadDataBlock(
+                block_handle, offset, n, backing_mem, n, "", true);
+        NOVA_LOG(rdmaio::DEBUG)
+            << fmt::format("t[{}]: CCRead req:{} initiated db:{} fn:{} s:{}",
+                           read_options.thread_id,
+                           req_id, dbid_, file_number_, n);
+        return true;
+    }
+
+    void StoCRandomAccessFileClientImpl::InitiateAsyncRead(
+            const leveldb::ReadOptions &read_options,
+            const leveldb::StoCBlockHandle &block_handle, uint64_t offset,
+            size_t n, char *backing_mem, bool is_foreground_reads,
+            const std::function<void()> &callback) {
+        NOVA_ASSERT(IsRemoteRead(block_handle));
+        NOVA_ASSERT(n < MAX_BLOCK_SIZE);
+        NOVA_ASSERT(backing_mem);
+        auto stoc_client = reinterpret_cast<leveldb::StoCBlockClient *>(read_options.stoc_client);
+        uint32_t req_id = stoc_client->InitiateAsyncReadDataBlock(
+                block_handle, offset, n, backing_mem, n, is_foreground_reads,
+                callback);
+        NOVA_LOG(rdmaio::DEBUG)
+            << fmt::format("t[{}]: CCRead req:{} async db:{} fn:{} s:{}",
+                           read_options.thread_id,
+                           req_id, dbid_, file_number_, n);
+    }
+
+    bool StoCRandomAccessFileClientImpl::IsRemoteRead(
+            const leveldb::StoCBlockHandle &block_handle) {
+        return block_handle.stoc_file_id != 0 && !prefetch_all_ &&
+               block_handle.server_id != nova::NovaConfig::config->my_server_id &&
+               !IsDegradedRead(block_handle);
+    }
+
+    bool StoCRandomAccessFileClientImpl::IsDegradedRead(
+            const leveldb::StoCBlockHandle &block_handle) {
+        if (block_handle.stoc_file_id == 0 || meta_->parity_block_handles.empty()) {
+            return false;
+        }
+        auto servers = leveldb::StorageSelector::available_stoc_servers.load();
+        return servers->server_ids.find(block_handle.server_id) == servers->server_ids.end();
+    }
+
+    int StoCRandomAccessFileClientImpl::FragmentId(
+            const leveldb::StoCBlockHandle &block_handle) {
+        const auto &fragments = meta_->block_replica_handles[0].data_block_group_handles;
+        for (int i = 0; i < fragments.size(); i++) {
+            if (fragments[i].server_id == block_handle.server_id &&
+                fragments[i].stoc_file_id == block_handle.stoc_file_id) {
+                return i;
+            }
+        }
+        NOVA_ASSERT(false) << fmt::format("No fragment for {} in {}", block_handle.DebugString(),
+                                          meta_->DebugString());
+        return -1;
+    }
+
+    Status StoCRandomAccessFileClientImpl::ReconstructRange(
+            leveldb::StoCClient *client, uint32_t fragment_id,
+            uint64_t relative_offset, uint32_t n, char *scratch) {
+        auto stoc_client = reinterpret_cast<leveldb::StoCBlockClient *>(client);
+        std::vector<StoCBlockHandle> fragments = meta_->block_replica_handles[0].data_block_group_handles;
+        uint32_t k = fragments.size();
+        uint32_t m = meta_->parity_block_handles.size();
+        fragments.insert(fragments.end(), meta_->parity_block_handles.begin(),
+                         meta_->parity_block_handles.end());
+        // Read the same range from the first k surviving fragments.
+        auto servers = leveldb::StorageSelector::available_stoc_servers.load();
+        std::vector<bool> available(k + m, false);
+        uint32_t nsources = 0;
+        for (int i = 0; i < k + m && nsources < k; i++) {
+            if (i != fragment_id &&
+                servers->server_ids.find(fragments[i].server_id) != servers->server_ids.end()) {
+                available[i] = true;
+                nsources++;
+            }
+        }
+        if (nsources < k) {
+            return Status::IOError(fmt::format("fn:{} lost more than {} fragments", file_number_, m));
+        }
+        uint32_t scid = mem_manager_->slabclassid(thread_id_, n);
+        std::vector<char *> bufs(k + m, nullptr);
+        uint32_t nreads = 0;
+        for (int i = 0; i < k + m; i++) {
+            if (!available[i] && i >= k) {
+                continue;
+            }
+            bufs[i] = mem_manager_->ItemAlloc(thread_id_, scid);
+            NOVA_ASSERT(bufs[i]) << "Running out of memory";
+            // Data fragments are zero-padded to the size of the parity fragments.
+            memset(bufs[i], 0, n);
+            const StoCBlockHandle &handle = fragments[i];
+            if (!available[i] || relative_offset >= handle.size) {
+                continue;
+            }
+            uint32_t len = std::min((uint64_t) n, handle.size - relative_offset);
+            stoc_client->InitiateReadDataBlock(handle, handle.offset + relative_offset, len, bufs[i], len, "",
+                                               !prefetch_all_);
+            nreads++;
+        }
+        for (int i = 0; i < nreads; i++) {
+            stoc_client->Wait();
+        }
+        std::unique_ptr<ErasureCoder> coder(NewErasureCoder(k, m));
+        NOVA_ASSERT(coder->Decode(bufs.data(), available, n));
+        memcpy(scratch, bufs[fragment_id], n);
+        for (char *buf : bufs) {
+            if (buf) {
+                mem_manager_->FreeItem(thread_id_, buf, scid);
+            }
+        }
+        NOVA_LOG(rdmaio::DEBUG)
+            << fmt::format("Reconstructed fn:{} fragment:{} off:{} size:{} from {} fragments",
+                           file_number_, fragment_id, relative_offset, n, nreads);
+        return Status::OK();
+    }
+
     StoCRandomAccessFileClientImpl::~StoCRandomAccessFileClientImpl() {
         if (prefetch_all_) {
             NOVA_LOG(rdmaio::DEBUG) << fmt::format("close file {}", filename);
@@ -843,19 +1124,26 @@ namespace leveldb {
         uint64_t offset = 0;
         uint32_t reqs[meta_->block_replica_handles[0].data_block_group_handles.size()];
         auto stoc_block_client = reinterpret_cast<leveldb::StoCBlockClient *>(stoc_client);
+        std::vector<int> degraded_fragments;
+        uint32_t nreads = 0;
         for (int i = 0; i <
                         meta_->block_replica_handles[0].data_block_group_handles.size(); i++) {
             const StoCBlockHandle &handle = meta_->block_replica_handles[0].data_block_group_handles[i];
             NOVA_ASSERT(offset + handle.size <= meta_->file_size);
             uint64_t id =
                     (((uint64_t) handle.server_id) << 32) | handle.stoc_file_id;
-            reqs[i] = stoc_block_client->InitiateReadDataBlock(handle,
-                                                               handle.offset,
-                                                               handle.size,
-                                                               backing_mem_table_ +
-                                                               offset,
-                                                               handle.size,
-                                                               "", false);
+            if (IsDegradedRead(handle)) {
+                degraded_fragments.push_back(i);
+            } else {
+                reqs[i] = stoc_block_client->InitiateReadDataBlock(handle,
+                                                                   handle.offset,
+                                                                   handle.size,
+                                                                   backing_mem_table_ +
+                                                                   offset,
+                                                                   handle.size,
+                                                                   "", false);
+                nreads++;
+            }
             DataBlockStoCFileLocalBuf buf = {};
             buf.offset = handle.offset;
             buf.size = handle.size;
@@ -864,9 +1152,20 @@ namespace leveldb {
             offset += handle.size;
         }
         // Wait for all reads to complete.
-        for (int i = 0; i < meta_->block_replica_handles[0].data_block_group_handles.size(); i++) {
+        for (int i = 0; i < nreads; i++) {
             stoc_block_client->Wait();
         }
+        // Reconstruct the fragments on unavailable StoCs once the other reads are drained.
+        for (int fragment_id : degraded_fragments) {
+            const StoCBlockHandle &handle = meta_->block_replica_handles[0].data_block_group_handles[fragment_id];
+            const DataBlockStoCFileLocalBuf &buf = stoc_local_offset_[
+                    (((uint64_t) handle.server_id) << 32) | handle.stoc_file_id];
+            Status s = ReconstructRange(stoc_client, fragment_id, 0, handle.size,
+                                        backing_mem_table_ + buf.local_offset);
+            if (!s.ok()) {
+                return s;
+            }
+        }
         offset = 0;
         for (int i = 0; i <
                         meta_->block_replica_handles[0].data_block_group_handles.size(); i++) {
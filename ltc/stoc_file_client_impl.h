@@ -77,9 +77,10 @@ namespace leveldb {
 
         std::vector<leveldb::FileReplicaMetaData> replicas();
 
-        StoCBlockHandle parity_block_handle();
+        std::vector<StoCBlockHandle> parity_block_handles();
 
-        void Validate(const std::vector<leveldb::FileReplicaMetaData>& replicas, const StoCBlockHandle& parity_block_handle);
+        void Validate(const std::vector<leveldb::FileReplicaMetaData>& replicas,
+                      const std::vector<StoCBlockHandle>& parity_block_handles);
 
     private:
         struct PersistStatus {
@@ -123,10 +124,11 @@ namespace leveldb {
         const uint64_t allocated_size_;
         uint64_t used_size_ = 0;
         std::vector<int> nblocks_in_group_;
-        char *parity_block_backing_mem_ = nullptr;
+        // One buffer per parity fragment.
+        std::vector<char *> parity_block_backing_mems_;
         uint64_t parity_block_size_ = 0;
 
-        PersistStatus parity_persist_status_;
+        std::vector<PersistStatus> parity_persist_statuses_;
 
         struct FileReplicaPersistStatus {
             std::vector<PersistStatus> persist_statuses;
@@ -164,9 +166,38 @@ namespace leveldb {
              uint64_t offset, size_t n,
              Slice *result, char *scratch) override;
 
+        bool
+        InitiateRead(const ReadOptions &read_options,
+                     const StoCBlockHandle &block_handle,
+                     uint64_t offset, size_t n, char *backing_mem,
+                     char *scratch) override;
+
+        void
+        InitiateAsyncRead(const ReadOptions &read_options,
+                          const StoCBlockHandle &block_handle,
+                          uint64_t offset, size_t n, char *backing_mem,
+                          bool is_foreground_reads,
+                          const std::function<void()> &callback) override;
+
+        bool IsRemoteRead(const StoCBlockHandle &block_handle) override;
+
         Status ReadAll(StoCClient *stoc_client);
 
+        // True if the data fragment of the block is on an unavailable StoC and
+        // must be reconstructed from the parity fragments.
+        bool IsDegradedRead(const StoCBlockHandle &block_handle);
+
+        // Reconstruct bytes [fragment offset + relative_offset, +n) of data
+        // fragment "fragment_id" into "scratch" by reading the same range from
+        // the surviving data and parity fragments.
+        Status ReconstructRange(StoCClient *stoc_client,
+                                uint32_t fragment_id,
+                                uint64_t relative_offset, uint32_t n,
+                                char *scratch);
+
     private:
+        int FragmentId(const StoCBlockHandle &block_handle);
+
         struct DataBlockStoCFileLocalBuf {
             uint64_t offset;
             uint32_t size;
@@ -27,7 +27,7 @@ namespace leveldb {
 
     void StorageSelector::ValidateReplicas(
             const std::vector<leveldb::FileReplicaMetaData> &replicas,
-            const leveldb::StoCBlockHandle &parity_block_handle) {
+            const std::vector<leveldb::StoCBlockHandle> &parity_block_handles) {
         // Make sure all replicas are placed on a different StoC.
         {
             // Validate metadata blocks.
@@ -119,11 +119,12 @@ namespace leveldb {
                     NOVA_ASSERT(replica0handle.server_id == replicaihandle.server_id) << ReplicaDebugString(replicas);
                 }
             }
-            // Verify parity block is stored on a different server.
-            if (parity_block_handle.stoc_file_id != 0) {
+            // Verify each parity block is stored on a different server.
+            for (const auto &parity_block_handle : parity_block_handles) {
                 NOVA_ASSERT(used_replicas.find(parity_block_handle.server_id) == used_replicas.end())
                     << fmt::format("Replicas:{} Parity:{}", ReplicaDebugString(replicas),
                                    parity_block_handle.DebugString());
+                used_replicas.insert(parity_block_handle.server_id);
             }
         }
     }
@@ -12,6 +12,7 @@
 #include "common/nova_client_sock.h"
 
 #include <sys/types.h>
+#include <sys/eventfd.h>
 #include <sys/signalfd.h>
 #include <sys/epoll.h>
 #include <cerrno>
@@ -32,6 +33,8 @@
 
 #include <event.h>
 #include <leveldb/write_batch.h>
+#include "db/write_batch_internal.h"
+#include "table/format.h"
 #include <ltc/storage_selector.h>
 
 namespace nova {
@@ -88,13 +91,18 @@ namespace nova {
 
         NICClientReqWorker *worker = (NICClientReqWorker *) conn->worker;
 
-        if (conn->state == ConnState::READ) {
+        if (conn->pipeline != nullptr) {
+            state = pipelined_event_handler(fd, which, conn);
+        } else if (conn->state == ConnState::READ) {
             if (worker->stats.nreqs % 100 == 0) {
                 gettimeofday(&worker->start, nullptr);
                 worker->read_start = worker->start;
             }
             state = socket_read_handler(fd, which, conn);
-            if (state == COMPLETE) {
+            if (conn->pipeline != nullptr) {
+                // The client uses the binary protocol.
+                state = pipelined_event_handler(fd, which, conn);
+            } else if (state == COMPLETE) {
                 if (worker->stats.nreqs % 99 == 0 &&
                     worker->stats.nreqs > 0) {
                     timeval now{};
@@ -128,8 +136,23 @@ namespace nova {
         }
 
         if (state == CLOSED) {
-            NOVA_ASSERT(event_del(&conn->event) == 0) << fd;
-            close(fd);
+            close_connection(fd, conn);
+        }
+    }
+
+    void close_connection(int fd, Connection *conn) {
+        NOVA_ASSERT(event_del(&conn->event) == 0) << fd;
+        close(fd);
+        if (conn->pipeline != nullptr) {
+            auto pipeline = (PipelinedConnection *) conn->pipeline;
+            conn->pipeline = nullptr;
+            if (pipeline->pending > 0) {
+                // The last pending response frees it.
+                pipeline->closed = true;
+                return;
+            }
+            free(pipeline->request_buf);
+            delete pipeline;
         }
     }
 
@@ -158,21 +181,7 @@ namespace nova {
         conn->response_ind = 0;
     }
 
-    bool
-    process_socket_get(int fd, Connection *conn, char *request_buf,
-                       uint32_t server_cfg_id) {
-        // Stats.
-        NICClientReqWorker *worker = (NICClientReqWorker *) conn->worker;
-        worker->stats.ngets++;
-        uint64_t int_key = 0;
-        uint32_t nkey = str_to_int(request_buf, &int_key) - 1;
-        uint64_t hv = keyhash(request_buf, nkey);
-        worker->stats.nget_hits++;
-
-        leveldb::Slice key(request_buf, nkey);
-        LTCFragment *frag = NovaConfig::home_fragment(hv, server_cfg_id);
-        NOVA_ASSERT(frag) << fmt::format("cfg:{} key:{}", server_cfg_id, hv);
-
+    void wait_until_ready(LTCFragment *frag) {
         if (!frag->is_ready_) {
             frag->is_ready_mutex_.Lock();
             while (!frag->is_ready_) {
@@ -180,22 +189,159 @@ namespace nova {
             }
             frag->is_ready_mutex_.Unlock();
         }
+    }
 
-        leveldb::DB *db = reinterpret_cast<leveldb::DB *>(frag->db);
-        NOVA_ASSERT(db);
-        std::string value;
+    leveldb::ReadOptions
+    get_options(NICClientReqWorker *worker, uint64_t hv,
+                uint32_t server_cfg_id) {
         leveldb::ReadOptions read_options;
-        read_options.hash = int_key;
+        read_options.hash = hv;
         read_options.stoc_client = worker->stoc_client_;
         read_options.mem_manager = worker->mem_manager_;
         read_options.thread_id = worker->thread_id_;
         read_options.rdma_backing_mem = worker->rdma_backing_mem;
         read_options.rdma_backing_mem_size = worker->rdma_backing_mem_size;
         read_options.cfg_id = server_cfg_id;
+        return read_options;
+    }
 
-        leveldb::Status s = db->Get(read_options, key, &value);
+    void
+    serve_get(NICClientReqWorker *worker, const leveldb::Slice &key,
+              uint32_t server_cfg_id, std::string *value) {
+        // Stats.
+        worker->stats.ngets++;
+        uint64_t hv = keyhash(key.data(), key.size());
+        worker->stats.nget_hits++;
+
+        LTCFragment *frag = NovaConfig::home_fragment(hv, server_cfg_id);
+        NOVA_ASSERT(frag) << fmt::format("cfg:{} key:{}", server_cfg_id, hv);
+        wait_until_ready(frag);
+
+        leveldb::DB *db = reinterpret_cast<leveldb::DB *>(frag->db);
+        NOVA_ASSERT(db);
+        leveldb::ReadOptions read_options = get_options(worker, hv,
+                                                        server_cfg_id);
+        leveldb::Status s = db->Get(read_options, key, value);
         NOVA_ASSERT(s.ok())
             << fmt::format("k:{} status:{}", key.ToString(), s.ToString());
+    }
+
+    // Groups the keys by their home fragments and looks up each group with
+    // a single MultiGet.
+    void serve_multi_get(NICClientReqWorker *worker,
+                         const std::vector<leveldb::Slice> &keys,
+                         uint32_t server_cfg_id,
+                         std::vector<std::string> *values,
+                         std::vector<leveldb::Status> *statuses) {
+        worker->stats.ngets += keys.size();
+        values->resize(keys.size());
+        statuses->resize(keys.size());
+        std::map<LTCFragment *, std::vector<uint32_t>> frag_keys;
+        for (uint32_t i = 0; i < keys.size(); i++) {
+            uint64_t hv = keyhash(keys[i].data(), keys[i].size());
+            LTCFragment *frag = NovaConfig::home_fragment(hv, server_cfg_id);
+            NOVA_ASSERT(frag) << fmt::format("cfg:{} key:{}", server_cfg_id, hv);
+            frag_keys[frag].push_back(i);
+        }
+
+        // MultiGet hashes each key itself.
+        leveldb::ReadOptions read_options = get_options(worker, 0,
+                                                        server_cfg_id);
+        for (auto &it : frag_keys) {
+            LTCFragment *frag = it.first;
+            wait_until_ready(frag);
+            leveldb::DB *db = reinterpret_cast<leveldb::DB *>(frag->db);
+            NOVA_ASSERT(db);
+
+            std::vector<leveldb::Slice> db_keys;
+            for (uint32_t i : it.second) {
+                db_keys.push_back(keys[i]);
+            }
+            std::vector<std::string> db_values;
+            std::vector<leveldb::Status> db_statuses;
+            db->MultiGet(read_options, db_keys, &db_values, &db_statuses);
+            for (uint32_t j = 0; j < it.second.size(); j++) {
+                uint32_t i = it.second[j];
+                (*values)[i].swap(db_values[j]);
+                (*statuses)[i] = db_statuses[j];
+                if (db_statuses[j].ok()) {
+                    worker->stats.nget_hits++;
+                }
+            }
+        }
+    }
+
+    char key_status(const leveldb::Status &status) {
+        if (status.ok()) {
+            return BinaryKeyStatus::BINARY_KEY_FOUND;
+        }
+        if (status.IsNotFound()) {
+            return BinaryKeyStatus::BINARY_KEY_NOT_FOUND;
+        }
+        return BinaryKeyStatus::BINARY_KEY_ERROR;
+    }
+
+    bool
+    process_socket_multi_get(int fd, Connection *conn, char *request_buf,
+                             uint32_t server_cfg_id) {
+        NICClientReqWorker *worker = (NICClientReqWorker *) conn->worker;
+        char *buf = request_buf;
+        uint64_t nkeys = 0;
+        buf += str_to_int(buf, &nkeys);
+        std::vector<leveldb::Slice> keys;
+        for (uint64_t i = 0; i < nkeys; i++) {
+            uint64_t int_key = 0;
+            uint32_t nkey = str_to_int(buf, &int_key) - 1;
+            keys.emplace_back(buf, nkey);
+            buf += nkey + 1;
+        }
+        std::vector<std::string> values;
+        std::vector<leveldb::Status> statuses;
+        serve_multi_get(worker, keys, server_cfg_id, &values, &statuses);
+
+        // cfg id, followed by a slot per key: status, value size, value.
+        // A value that does not fit in the response is answered with an
+        // error. The response is truncated once not even that fits.
+        conn->response_buf = worker->buf;
+        char *response_buf = conn->response_buf;
+        // Keep one byte for the terminator.
+        char *limit = conn->response_buf + NovaConfig::config->max_msg_size - 1;
+        const uint64_t error_slot_size = 1 + nint_to_str(0) + 1;
+        response_buf += int_to_str(response_buf, server_cfg_id);
+        for (size_t i = 0; i < keys.size(); i++) {
+            uint64_t remaining = limit - response_buf;
+            uint64_t value_size = values[i].size();
+            char status = key_status(statuses[i]);
+            if (1 + nint_to_str(value_size) + 1 + value_size >= remaining) {
+                value_size = 0;
+                status = BinaryKeyStatus::BINARY_KEY_ERROR;
+            }
+            if (error_slot_size >= remaining) {
+                break;
+            }
+            response_buf[0] = status;
+            response_buf += 1;
+            response_buf += int_to_str(response_buf, value_size);
+            memcpy(response_buf, values[i].data(), value_size);
+            response_buf += value_size;
+        }
+        response_buf[0] = MSG_TERMINATER_CHAR;
+        response_buf += 1;
+        conn->response_size = response_buf - conn->response_buf;
+        NOVA_ASSERT(conn->response_size <
+                    NovaConfig::config->max_msg_size);
+        return true;
+    }
+
+    bool
+    process_socket_get(int fd, Connection *conn, char *request_buf,
+                       uint32_t server_cfg_id) {
+        NICClientReqWorker *worker = (NICClientReqWorker *) conn->worker;
+        uint64_t int_key = 0;
+        uint32_t nkey = str_to_int(request_buf, &int_key) - 1;
+        leveldb::Slice key(request_buf, nkey);
+        std::string value;
+        serve_get(worker, key, server_cfg_id, &value);
 
         conn->response_buf = worker->buf;
         uint32_t response_size = 0;
@@ -435,11 +581,526 @@ namespace nova {
         return true;
     }
 
+    namespace {
+        // An LTC waits at most this long for the part of a scan that another
+        // LTC serves. The scan is then truncated.
+        const int kRemoteScanTimeoutMs = 1000;
+
+        // A part of a scan over consecutive fragments owned by one LTC.
+        struct SubScan {
+            uint32_t ltc_server_id = 0;
+            std::string startkey;
+            uint32_t first_dbid = 0;
+            uint32_t last_dbid = 0;
+            // The key end of the last fragment.
+            uint64_t end = 0;
+            uint32_t req_id = 0;
+            // The records of a part served by another LTC once they arrive.
+            bool received = false;
+            std::string records;
+        };
+
+        uint64_t
+        scan_local_fragments(const leveldb::ReadOptions &read_options,
+                             Configuration *cfg, const SubScan &subscan,
+                             uint64_t nrecords, void *arg,
+                             void (*handle_record)(void *,
+                                                   const leveldb::Slice &,
+                                                   const leveldb::Slice &)) {
+            uint64_t read_records = 0;
+            for (uint32_t dbid = subscan.first_dbid;
+                 dbid <= subscan.last_dbid && read_records < nrecords; dbid++) {
+                LTCFragment *frag = cfg->fragments[dbid];
+                wait_until_ready(frag);
+                leveldb::DB *db = reinterpret_cast<leveldb::DB *>(frag->db);
+                leveldb::Iterator *iterator = db->NewIterator(read_options);
+                iterator->Seek(subscan.startkey);
+                while (iterator->Valid() && read_records < nrecords) {
+                    (*handle_record)(arg, iterator->key(), iterator->value());
+                    read_records++;
+                    iterator->Next();
+                }
+                delete iterator;
+            }
+            return read_records;
+        }
+
+        struct ScanResponse {
+            char *response_buf;
+            uint64_t scan_size;
+        };
+
+        void AppendScanRecord(void *arg, const leveldb::Slice &key,
+                              const leveldb::Slice &value) {
+            ScanResponse *response = reinterpret_cast<ScanResponse *>(arg);
+            char *response_buf = response->response_buf + response->scan_size;
+            response->scan_size += nint_to_str(key.size()) + 1;
+            response->scan_size += key.size();
+            response->scan_size += nint_to_str(value.size()) + 1;
+            response->scan_size += value.size();
+
+            response_buf += int_to_str(response_buf, key.size());
+            memcpy(response_buf, key.data(), key.size());
+            response_buf += key.size();
+            response_buf += int_to_str(response_buf, value.size());
+            memcpy(response_buf, value.data(), value.size());
+        }
+
+        void AppendBinaryScanRecord(void *arg, const leveldb::Slice &key,
+                                    const leveldb::Slice &value) {
+            std::string *response = reinterpret_cast<std::string *>(arg);
+            leveldb::PutVarint32(response, key.size());
+            response->append(key.data(), key.size());
+            leveldb::PutVarint32(response, value.size());
+            response->append(value.data(), value.size());
+        }
+    }
+
+    // Scans at most "nrecords" records starting from "startkey" across the
+    // consecutive fragments served by this LTC and calls
+    // (*handle_record)(arg, key, value) for each record. A non-zero "end"
+    // marks a part of a scan forwarded by another LTC. It stops at the
+    // fragment that starts at "end". Returns false without scanning if this
+    // LTC does not serve the home fragment of "startkey".
+    bool
+    serve_scan(NICClientReqWorker *worker, const leveldb::Slice &startkey,
+               uint64_t nrecords, uint32_t server_cfg_id, void *arg,
+               void (*handle_record)(void *, const leveldb::Slice &,
+                                     const leveldb::Slice &),
+               uint64_t end = 0) {
+        worker->stats.nscans++;
+        uint64_t hv = keyhash(startkey.data(), startkey.size());
+        auto cfg = NovaConfig::config->cfgs[server_cfg_id];
+        LTCFragment *frag = NovaConfig::home_fragment(hv, server_cfg_id);
+        NOVA_ASSERT(frag) << fmt::format("cfg:{} key:{}", server_cfg_id, hv);
+        if (frag->ltc_server_id != NovaConfig::config->my_server_id) {
+            return false;
+        }
+
+        SubScan local;
+        local.ltc_server_id = frag->ltc_server_id;
+        local.startkey = startkey.ToString();
+        local.first_dbid = frag->dbid;
+        local.last_dbid = frag->dbid;
+        while (local.last_dbid + 1 < cfg->fragments.size()) {
+            LTCFragment *next = cfg->fragments[local.last_dbid + 1];
+            if (next->range.key_start !=
+                cfg->fragments[local.last_dbid]->range.key_end ||
+                next->ltc_server_id != NovaConfig::config->my_server_id ||
+                (end != 0 && next->range.key_start >= end)) {
+                break;
+            }
+            local.last_dbid++;
+        }
+        scan_local_fragments(get_options(worker, hv, server_cfg_id), cfg,
+                             local, nrecords, arg, handle_record);
+        return true;
+    }
+
+    // A connection to another LTC that serves the parts of the scans of
+    // this worker. It never blocks the worker. It connects and sends on the
+    // worker's event loop and its responses are read there too.
+    struct LTCSock {
+        NICClientReqWorker *worker = nullptr;
+        uint32_t server_id = 0;
+        NovaClientSock sock;
+        bool connected = false;
+        // The bytes received into sock.recv_buf().
+        uint32_t recv_ind = 0;
+        // The requests not yet written to the socket.
+        std::string pending;
+        struct event event;
+        // Armed while connecting or while "pending" is not empty.
+        struct event write_event;
+    };
+
+    // A binary scan that may span the fragments of other LTCs. It proceeds
+    // in waves. A wave covers the fragments that would hold the remaining
+    // records if the keys were dense. It sends the parts owned by other
+    // LTCs to them and gathers all parts in fragment order. The local parts
+    // are scanned when their turn comes. The scan waits for a remote part
+    // on the event loop.
+    struct AsyncScan {
+        NICClientReqWorker *worker = nullptr;
+        uint32_t server_cfg_id = 0;
+        leveldb::ReadOptions read_options;
+        std::string startkey;
+        uint64_t nrecords = 0;
+        uint32_t home_dbid = 0;
+        uint32_t pivot_db_id = 0;
+        uint64_t pivot_key = 0;
+        bool consecutive = true;
+        uint64_t read_records = 0;
+        std::vector<SubScan> subscans;
+        // The next part to gather.
+        uint32_t next_subscan = 0;
+        // Fires if a remote part does not arrive in time.
+        struct event timer;
+        // The records in the binary response format.
+        std::string records;
+        std::function<void(std::string *, bool)> done;
+    };
+
+    namespace {
+        void ltc_sock_handler(int fd, short which, void *arg);
+
+        void ltc_sock_write_handler(int fd, short which, void *arg);
+
+        // Returns nullptr if the connect to the LTC failed right away.
+        LTCSock *ltc_sock(NICClientReqWorker *worker, uint32_t server_id) {
+            auto it = worker->ltc_socks.find(server_id);
+            if (it != worker->ltc_socks.end()) {
+                return it->second;
+            }
+            auto ltc = new LTCSock;
+            ltc->worker = worker;
+            ltc->server_id = server_id;
+            if (!ltc->sock.ConnectNonBlocking(
+                    NovaConfig::config->servers[server_id])) {
+                delete ltc;
+                return nullptr;
+            }
+            memset(&ltc->event, 0, sizeof(struct event));
+            NOVA_ASSERT(event_assign(&ltc->event, worker->base,
+                                     ltc->sock.sockfd(), EV_READ | EV_PERSIST,
+                                     ltc_sock_handler, ltc) == 0);
+            NOVA_ASSERT(event_add(&ltc->event, 0) == 0);
+            memset(&ltc->write_event, 0, sizeof(struct event));
+            NOVA_ASSERT(event_assign(&ltc->write_event, worker->base,
+                                     ltc->sock.sockfd(), EV_WRITE | EV_PERSIST,
+                                     ltc_sock_write_handler, ltc) == 0);
+            NOVA_ASSERT(event_add(&ltc->write_event, 0) == 0);
+            worker->ltc_socks[server_id] = ltc;
+            return ltc;
+        }
+
+        void drop_ltc_sock(LTCSock *ltc) {
+            NOVA_ASSERT(event_del(&ltc->event) == 0);
+            NOVA_ASSERT(event_del(&ltc->write_event) == 0);
+            ltc->worker->ltc_socks.erase(ltc->server_id);
+            delete ltc;
+        }
+
+        // Writes the pending requests until the socket would block. Returns
+        // false if the connection failed.
+        bool flush_ltc_sock(LTCSock *ltc) {
+            uint32_t written = 0;
+            while (written < ltc->pending.size()) {
+                ssize_t n = send(ltc->sock.sockfd(),
+                                 ltc->pending.data() + written,
+                                 ltc->pending.size() - written,
+                                 MSG_DONTWAIT | MSG_NOSIGNAL);
+                if (n < 0) {
+                    if (errno == EWOULDBLOCK || errno == EAGAIN) {
+                        break;
+                    }
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return false;
+                }
+                written += n;
+            }
+            ltc->pending.erase(0, written);
+            if (ltc->pending.empty()) {
+                NOVA_ASSERT(event_del(&ltc->write_event) == 0);
+            } else {
+                NOVA_ASSERT(event_add(&ltc->write_event, 0) == 0);
+            }
+            return true;
+        }
+
+        // Queues a request on the connection. It is written once the
+        // connection is established and the socket has room for it.
+        bool send_ltc_sock(LTCSock *ltc, uint32_t size) {
+            ltc->pending.append(ltc->sock.send_buf(), size);
+            if (!ltc->connected) {
+                return true;
+            }
+            return flush_ltc_sock(ltc);
+        }
+
+        void ltc_sock_write_handler(int fd, short which, void *arg) {
+            auto ltc = (LTCSock *) arg;
+            if (!ltc->connected) {
+                int error = 0;
+                socklen_t len = sizeof(error);
+                if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) != 0) {
+                    error = errno;
+                }
+                if (error != 0) {
+                    // The scans waiting for this LTC time out.
+                    NOVA_LOG(rdmaio::WARNING) << fmt::format(
+                                "memstore[{}]: failed to connect to LTC-{}: {}",
+                                ltc->worker->thread_id_, ltc->server_id,
+                                strerror(error));
+                    drop_ltc_sock(ltc);
+                    return;
+                }
+                ltc->connected = true;
+            }
+            if (!flush_ltc_sock(ltc)) {
+                NOVA_LOG(rdmaio::WARNING) << fmt::format(
+                            "memstore[{}]: failed to send scans to LTC-{}: {}",
+                            ltc->worker->thread_id_, ltc->server_id,
+                            strerror(errno));
+                drop_ltc_sock(ltc);
+            }
+        }
+
+        void finish_scan(AsyncScan *scan, bool truncated) {
+            NICClientReqWorker *worker = scan->worker;
+            NOVA_ASSERT(event_del(&scan->timer) == 0);
+            // Late responses of the parts in flight are dropped.
+            for (const auto &subscan : scan->subscans) {
+                if (subscan.ltc_server_id != NovaConfig::config->my_server_id &&
+                    !subscan.received) {
+                    worker->ltc_scans.erase(subscan.req_id);
+                }
+            }
+            scan->done(&scan->records, truncated);
+            delete scan;
+        }
+
+        // Plans the next wave and sends its remote parts. Returns false if
+        // the scan is complete.
+        bool next_scan_wave(AsyncScan *scan) {
+            NICClientReqWorker *worker = scan->worker;
+            auto cfg = NovaConfig::config->cfgs[scan->server_cfg_id];
+            if (scan->read_records >= scan->nrecords || !scan->consecutive ||
+                scan->pivot_db_id >= cfg->fragments.size()) {
+                return false;
+            }
+            uint64_t remaining = scan->nrecords - scan->read_records;
+            uint64_t wave_end = scan->pivot_key + remaining;
+            scan->subscans.clear();
+            scan->next_subscan = 0;
+            while (scan->pivot_db_id < cfg->fragments.size()) {
+                LTCFragment *next = cfg->fragments[scan->pivot_db_id];
+                if (next->range.key_start != scan->pivot_key &&
+                    scan->pivot_db_id != scan->home_dbid) {
+                    scan->consecutive = false;
+                    break;
+                }
+                if (!scan->subscans.empty() &&
+                    next->range.key_start >= wave_end) {
+                    break;
+                }
+                if (scan->subscans.empty() ||
+                    scan->subscans.back().ltc_server_id !=
+                    next->ltc_server_id) {
+                    scan->subscans.emplace_back();
+                    SubScan &subscan = scan->subscans.back();
+                    subscan.ltc_server_id = next->ltc_server_id;
+                    subscan.first_dbid = scan->pivot_db_id;
+                    if (scan->pivot_db_id == scan->home_dbid) {
+                        subscan.startkey = scan->startkey;
+                    } else {
+                        char buf[32];
+                        uint32_t len = int_to_str(buf, next->range.key_start);
+                        subscan.startkey.assign(buf, len - 1);
+                    }
+                }
+                scan->subscans.back().last_dbid = scan->pivot_db_id;
+                scan->subscans.back().end = next->range.key_end;
+                scan->pivot_key = next->range.key_end;
+                scan->pivot_db_id++;
+            }
+
+            for (auto &subscan : scan->subscans) {
+                if (subscan.ltc_server_id == NovaConfig::config->my_server_id) {
+                    continue;
+                }
+                subscan.req_id = worker->ltc_req_id++;
+                LTCSock *ltc = ltc_sock(worker, subscan.ltc_server_id);
+                if (!ltc) {
+                    // The part never arrives and the scan times out.
+                    continue;
+                }
+                uint32_t size = ltc->sock.EncodeBinaryScan(
+                        subscan.req_id, scan->server_cfg_id, subscan.startkey,
+                        remaining, subscan.end);
+                if (!send_ltc_sock(ltc, size)) {
+                    NOVA_LOG(rdmaio::WARNING) << fmt::format(
+                                "memstore[{}]: failed to send scans to LTC-{}: {}",
+                                worker->thread_id_, ltc->server_id,
+                                strerror(errno));
+                    drop_ltc_sock(ltc);
+                    continue;
+                }
+                worker->ltc_scans[subscan.req_id] = scan;
+            }
+            return !scan->subscans.empty();
+        }
+
+        // Gathers the parts in fragment order until a remote part has not
+        // arrived yet or the scan is complete.
+        void advance_scan(AsyncScan *scan) {
+            auto cfg = NovaConfig::config->cfgs[scan->server_cfg_id];
+            while (true) {
+                while (scan->next_subscan < scan->subscans.size()) {
+                    const SubScan &subscan =
+                            scan->subscans[scan->next_subscan];
+                    uint64_t remaining = scan->nrecords - scan->read_records;
+                    if (subscan.ltc_server_id ==
+                        NovaConfig::config->my_server_id) {
+                        scan->read_records += scan_local_fragments(
+                                scan->read_options, cfg, subscan, remaining,
+                                &scan->records, &AppendBinaryScanRecord);
+                    } else if (!subscan.received) {
+                        struct timeval timeout = {
+                                kRemoteScanTimeoutMs / 1000,
+                                (kRemoteScanTimeoutMs % 1000) * 1000};
+                        NOVA_ASSERT(event_add(&scan->timer, &timeout) == 0);
+                        return;
+                    } else {
+                        const char *ptr = subscan.records.data();
+                        const char *limit = ptr + subscan.records.size();
+                        uint64_t nrecords = 0;
+                        while (ptr < limit && nrecords < remaining) {
+                            uint32_t nkey = 0;
+                            uint32_t nval = 0;
+                            ptr = leveldb::GetVarint32Ptr(ptr, limit, &nkey);
+                            NOVA_ASSERT(ptr && ptr + nkey <= limit);
+                            ptr += nkey;
+                            ptr = leveldb::GetVarint32Ptr(ptr, limit, &nval);
+                            NOVA_ASSERT(ptr && ptr + nval <= limit);
+                            ptr += nval;
+                            nrecords++;
+                        }
+                        scan->records.append(subscan.records.data(),
+                                             ptr - subscan.records.data());
+                        scan->read_records += nrecords;
+                    }
+                    scan->next_subscan++;
+                }
+                if (!next_scan_wave(scan)) {
+                    finish_scan(scan, false);
+                    return;
+                }
+            }
+        }
+
+        void scan_timeout_handler(int fd, short which, void *arg) {
+            auto scan = (AsyncScan *) arg;
+            const SubScan &subscan = scan->subscans[scan->next_subscan];
+            NOVA_LOG(rdmaio::WARNING) << fmt::format(
+                        "memstore[{}]: LTC-{} did not serve scan from {}",
+                        scan->worker->thread_id_, subscan.ltc_server_id,
+                        subscan.startkey);
+            finish_scan(scan, true);
+        }
+
+        void receive_sub_scan(AsyncScan *scan, const BinaryMsgHeader &header,
+                              const char *body) {
+            if (header.type != BinaryResponseType::BINARY_OK) {
+                // The records after the missing part cannot follow in order.
+                finish_scan(scan, true);
+                return;
+            }
+            for (auto &subscan : scan->subscans) {
+                if (subscan.ltc_server_id !=
+                    NovaConfig::config->my_server_id &&
+                    subscan.req_id == header.req_id) {
+                    subscan.received = true;
+                    subscan.records.assign(body, header.body_size);
+                    break;
+                }
+            }
+            if (scan->subscans[scan->next_subscan].received) {
+                NOVA_ASSERT(event_del(&scan->timer) == 0);
+                advance_scan(scan);
+            }
+        }
+
+        void ltc_sock_handler(int fd, short which, void *arg) {
+            auto ltc = (LTCSock *) arg;
+            NICClientReqWorker *worker = ltc->worker;
+            char *buf = ltc->sock.recv_buf();
+            bool closed = false;
+            while (ltc->recv_ind < NovaConfig::config->max_msg_size) {
+                int count = recv(fd, buf + ltc->recv_ind,
+                                 NovaConfig::config->max_msg_size -
+                                 ltc->recv_ind, MSG_DONTWAIT);
+                if (count <= 0) {
+                    closed = count == 0 ||
+                             (errno != EWOULDBLOCK && errno != EAGAIN);
+                    break;
+                }
+                ltc->recv_ind += count;
+            }
+
+            uint32_t consumed = 0;
+            BinaryMsgHeader header;
+            while (DecodeBinaryMsgHeader(buf + consumed,
+                                         ltc->recv_ind - consumed, &header)) {
+                uint32_t size = NOVA_BINARY_MSG_HEADER_SIZE + header.body_size;
+                NOVA_ASSERT(size < NovaConfig::config->max_msg_size);
+                if (ltc->recv_ind - consumed < size) {
+                    break;
+                }
+                auto it = worker->ltc_scans.find(header.req_id);
+                if (it != worker->ltc_scans.end()) {
+                    AsyncScan *scan = it->second;
+                    worker->ltc_scans.erase(it);
+                    receive_sub_scan(scan, header,
+                                     buf + consumed +
+                                     NOVA_BINARY_MSG_HEADER_SIZE);
+                }
+                consumed += size;
+            }
+            memmove(buf, buf + consumed, ltc->recv_ind - consumed);
+            ltc->recv_ind -= consumed;
+
+            if (closed) {
+                // The scans waiting for this LTC time out.
+                NOVA_LOG(rdmaio::WARNING) << fmt::format(
+                            "memstore[{}]: LTC-{} closed the scan connection",
+                            worker->thread_id_, ltc->server_id);
+                drop_ltc_sock(ltc);
+            }
+        }
+    }
+
+    // Same as serve_scan but the scan continues into the consecutive
+    // fragments of other LTCs. "done" runs with the records once the scan
+    // completes, either before serve_scan_async returns or later on the
+    // event loop. The scan is truncated if another LTC does not serve its
+    // part. The records are then an ordered prefix of the result.
+    void serve_scan_async(NICClientReqWorker *worker,
+                          const leveldb::Slice &startkey, uint64_t nrecords,
+                          uint32_t server_cfg_id,
+                          const std::function<void(std::string *,
+                                                   bool)> &done) {
+        worker->stats.nscans++;
+        uint64_t hv = keyhash(startkey.data(), startkey.size());
+        LTCFragment *frag = NovaConfig::home_fragment(hv, server_cfg_id);
+        NOVA_ASSERT(frag) << fmt::format("cfg:{} key:{}", server_cfg_id, hv);
+
+        auto scan = new AsyncScan;
+        scan->worker = worker;
+        scan->server_cfg_id = server_cfg_id;
+        scan->read_options = get_options(worker, hv, server_cfg_id);
+        scan->startkey = startkey.ToString();
+        scan->nrecords = nrecords;
+        scan->home_dbid = frag->dbid;
+        scan->pivot_db_id = frag->dbid;
+        scan->pivot_key = hv;
+        scan->done = done;
+        memset(&scan->timer, 0, sizeof(struct event));
+        NOVA_ASSERT(evtimer_assign(&scan->timer, worker->base,
+                                   scan_timeout_handler, scan) == 0);
+        if (!next_scan_wave(scan)) {
+            finish_scan(scan, false);
+            return;
+        }
+        advance_scan(scan);
+    }
+
     bool
     process_socket_scan(int fd, Connection *conn, char *request_buf,
                         uint32_t server_cfg_id) {
         NICClientReqWorker *worker = (NICClientReqWorker *) conn->worker;
-        worker->stats.nscans++;
         char *startkey;
         uint64_t key = 0;
         char *buf = request_buf;
@@ -452,108 +1113,14 @@ namespace nova {
         NOVA_LOG(DEBUG)
             << fmt::format("memstore[{}]: scan fd:{} key:{} nkey:{} nrecords:{}", worker->thread_id_, fd, skey,
                            nkey, nrecords);
-        uint64_t hv = keyhash(startkey, nkey);
-        auto cfg = NovaConfig::config->cfgs[server_cfg_id];
-        LTCFragment *frag = NovaConfig::home_fragment(hv, server_cfg_id);
-        NOVA_ASSERT(frag) << fmt::format("cfg:{} key:{}", server_cfg_id, hv);
-
-        leveldb::ReadOptions read_options;
-        read_options.stoc_client = worker->stoc_client_;
-        read_options.mem_manager = worker->mem_manager_;
-        read_options.thread_id = worker->thread_id_;
-        read_options.rdma_backing_mem = worker->rdma_backing_mem;
-        read_options.rdma_backing_mem_size = worker->rdma_backing_mem_size;
-        read_options.cfg_id = server_cfg_id;
-        int pivot_db_id = frag->dbid;
-        int read_records = 0;
-        uint64_t prior_last_key = -1;
-        uint64_t scan_size = 0;
 
         conn->response_buf = worker->buf;
-        char *response_buf = conn->response_buf;
-        uint32_t cfg_size = int_to_str(response_buf, server_cfg_id);
-        response_buf += cfg_size;
-        scan_size += cfg_size;
-
-        while (read_records < nrecords && pivot_db_id < cfg->fragments.size()) {
-            frag = cfg->fragments[pivot_db_id];
-            if (prior_last_key != -1 && prior_last_key != frag->range.key_start) {
-                break;
-            }
-            if (frag->ltc_server_id != NovaConfig::config->my_server_id) {
-                break;
-            }
-
-            if (!frag->is_ready_) {
-                frag->is_ready_mutex_.Lock();
-                while (!frag->is_ready_) {
-                    frag->is_ready_signal_.Wait();
-                }
-                frag->is_ready_mutex_.Unlock();
-            }
-
-            leveldb::DB *db = reinterpret_cast<leveldb::DB *>(frag->db);
-//            if (frag->range.key_end - frag->range.key_start == 1) {
-//                // A range contains a single key. Perform get instead of scan.
-//                std::string value;
-//                leveldb::ReadOptions read_options;
-//                read_options.hash = frag->range.key_start;
-//                read_options.stoc_client = worker->stoc_client_;
-//                read_options.mem_manager = worker->mem_manager_;
-//                read_options.thread_id = worker->thread_id_;
-//                read_options.rdma_backing_mem = worker->rdma_backing_mem;
-//                read_options.rdma_backing_mem_size = worker->rdma_backing_mem_size;
-//                read_options.cfg_id = server_cfg_id;
-//                uint32_t len = nova::nint_to_str(frag->range.key_start) + 1;
-//                char keybuf[len];
-//                nova::int_to_str(keybuf, frag->range.key_start);
-//                leveldb::Slice key(keybuf, len - 1);
-//                leveldb::Status s = db->Get(read_options, key, &value);
-//                NOVA_ASSERT(s.ok())
-//                    << fmt::format("k:{} status:{}", key.ToString(), s.ToString());
-//
-//                scan_size += nint_to_str(key.size()) + 1;
-//                scan_size += key.size();
-//                scan_size += nint_to_str(value.size()) + 1;
-//                scan_size += value.size();
-//
-//                response_buf += int_to_str(response_buf, key.size());
-//                memcpy(response_buf, key.data(), key.size());
-//                response_buf += key.size();
-//                response_buf += int_to_str(response_buf, value.size());
-//                memcpy(response_buf, value.data(), value.size());
-//                response_buf += value.size();
-//                read_records++;
-//
-//                prior_last_key = frag->range.key_end;
-//                pivot_db_id += 1;
-//                continue;
-//            }
-            leveldb::Iterator *iterator = db->NewIterator(read_options);
-            iterator->Seek(startkey);
-            while (iterator->Valid() && read_records < nrecords) {
-                leveldb::Slice key = iterator->key();
-                leveldb::Slice value = iterator->value();
-                scan_size += nint_to_str(key.size()) + 1;
-                scan_size += key.size();
-                scan_size += nint_to_str(value.size()) + 1;
-                scan_size += value.size();
-
-                response_buf += int_to_str(response_buf, key.size());
-                memcpy(response_buf, key.data(), key.size());
-                response_buf += key.size();
-                response_buf += int_to_str(response_buf, value.size());
-                memcpy(response_buf, value.data(), value.size());
-                response_buf += value.size();
-                read_records++;
-//                NOVA_LOG(rdmaio::INFO) << fmt::format("Getting key {}", key.ToString());
-                iterator->Next();
-            }
-//            NOVA_LOG(rdmaio::INFO) << fmt::format("Go to next range partition {}", pivot_db_id + 1);
-            delete iterator;
-            prior_last_key = frag->range.key_end;
-            pivot_db_id += 1;
-        }
+        ScanResponse response = {};
+        response.response_buf = conn->response_buf;
+        response.scan_size = int_to_str(conn->response_buf, server_cfg_id);
+        serve_scan(worker, leveldb::Slice(startkey, nkey), nrecords,
+                   server_cfg_id, &response, &AppendScanRecord);
+        uint64_t scan_size = response.scan_size;
 
         NOVA_LOG(rdmaio::DEBUG) << fmt::format("Scan size:{}", scan_size);
 
@@ -566,24 +1133,10 @@ namespace nova {
 
     std::atomic_int_fast32_t total_writes;
 
-    bool process_socket_put(int fd, Connection *conn, char *request_buf, uint32_t server_cfg_id) {
-        // Stats.
-        NICClientReqWorker *worker = (NICClientReqWorker *) conn->worker;
-        worker->stats.nputs++;
-        char *buf = request_buf;
-        char *ckey;
-        uint64_t key = 0;
-        ckey = buf;
-        int nkey = str_to_int(buf, &key) - 1;
-        buf += nkey + 1;
-        uint64_t nval;
-        buf += str_to_int(buf, &nval);
-        char *val = buf;
-        uint64_t hv = keyhash(ckey, nkey);
+    leveldb::WriteOptions
+    put_options(NICClientReqWorker *worker, uint32_t server_cfg_id,
+                uint32_t nputs) {
         // I'm the home.
-        leveldb::Slice dbkey(ckey, nkey);
-        leveldb::Slice dbval(val, nval);
-
         worker->ResetReplicateState();
         worker->replicate_log_record_states[0].cfgid = server_cfg_id;
         leveldb::WriteOptions option;
@@ -591,28 +1144,141 @@ namespace nova {
         option.local_write = false;
         option.thread_id = worker->thread_id_;
         option.rand_seed = &worker->rand_seed;
-        option.hash = key;
-        option.total_writes = total_writes.fetch_add(1, std::memory_order_relaxed) + 1;
+        option.total_writes = total_writes.fetch_add(nputs, std::memory_order_relaxed) + nputs;
         option.replicate_log_record_states = worker->replicate_log_record_states;
         option.rdma_backing_mem = worker->rdma_backing_mem;
         option.rdma_backing_mem_size = worker->rdma_backing_mem_size;
         option.is_loading_db = false;
+        return option;
+    }
+
+    leveldb::DB *
+    home_db(uint64_t hv, uint32_t server_cfg_id) {
         LTCFragment *frag = NovaConfig::home_fragment(hv, server_cfg_id);
         NOVA_ASSERT(frag) << fmt::format("cfg:{} key:{}", server_cfg_id, hv);
+        wait_until_ready(frag);
 
-        if (!frag->is_ready_) {
-            frag->is_ready_mutex_.Lock();
-            while (!frag->is_ready_) {
-                frag->is_ready_signal_.Wait();
+        leveldb::DB *db = reinterpret_cast<leveldb::DB *>(frag->db);
+        NOVA_ASSERT(db) << fmt::format("cfg:{} key:{}", server_cfg_id, hv);
+        return db;
+    }
+
+    // A GET whose lookup reads the remote data blocks with
+    // ReadDataBlockAsync. See leveldb::ReadOptions::deferred_block_reads.
+    struct AsyncGet {
+        NICClientReqWorker *worker;
+        std::string key;
+        uint64_t hv;
+        uint32_t server_cfg_id;
+        leveldb::DeferredBlockReads block_reads;
+        std::string value;
+        std::function<void(std::string *)> done;
+    };
+
+    void resume_get(AsyncGet *get) {
+        NICClientReqWorker *worker = get->worker;
+        leveldb::DB *db = home_db(get->hv, get->server_cfg_id);
+        leveldb::ReadOptions read_options = get_options(worker, get->hv,
+                                                        get->server_cfg_id);
+        read_options.deferred_block_reads = &get->block_reads;
+        leveldb::Status s;
+        while (true) {
+            s = db->Get(read_options, get->key, &get->value);
+            get->block_reads.block = nullptr;
+            if (!s.IsIncomplete()) {
+                break;
             }
-            frag->is_ready_mutex_.Unlock();
+            const leveldb::StoCBlockHandle &handle = get->block_reads.pending;
+            uint32_t size = handle.size + leveldb::kBlockTrailerSize;
+            uint32_t scid = worker->mem_manager_->slabclassid(
+                    worker->thread_id_, size);
+            char *buf = worker->mem_manager_->ItemAlloc(worker->thread_id_,
+                                                        scid);
+            if (buf != nullptr) {
+                // Resume the lookup with the block once it is read. The
+                // lookup parses the block in place.
+                worker->ReadDataBlockAsync(
+                        handle, handle.offset, size, buf,
+                        [worker, get, buf, size, scid]() {
+                            NOVA_ASSERT(nova::IsRDMAWRITEComplete(buf, size));
+                            get->block_reads.block = buf;
+                            resume_get(get);
+                            worker->mem_manager_->FreeItem(worker->thread_id_,
+                                                           buf, scid);
+                        });
+                return;
+            }
+            // Out of RDMA memory. The lookup reads the block and waits for
+            // it instead.
         }
+        NOVA_ASSERT(s.ok())
+            << fmt::format("k:{} status:{}", get->key, s.ToString());
+        get->done(&get->value);
+        delete get;
+    }
 
-        leveldb::DB *db = reinterpret_cast<leveldb::DB *>(frag->db);
-        NOVA_ASSERT(db) << fmt::format("cfg:{} key:{}", server_cfg_id, hv);
+    // Same as serve_get but does not block the event loop on remote data
+    // blocks. "done" runs with the value once the lookup completes, either
+    // before serve_get_async returns or later on the event loop.
+    void serve_get_async(NICClientReqWorker *worker, const leveldb::Slice &key,
+                         uint32_t server_cfg_id,
+                         const std::function<void(std::string *)> &done) {
+        worker->stats.ngets++;
+        worker->stats.nget_hits++;
+        auto get = new AsyncGet;
+        get->worker = worker;
+        get->key = key.ToString();
+        get->hv = keyhash(key.data(), key.size());
+        get->server_cfg_id = server_cfg_id;
+        get->done = done;
+        resume_get(get);
+    }
 
+    void serve_put(NICClientReqWorker *worker, const leveldb::Slice &dbkey,
+                   const leveldb::Slice &dbval, uint32_t server_cfg_id) {
+        // Stats.
+        worker->stats.nputs++;
+        uint64_t hv = keyhash(dbkey.data(), dbkey.size());
+        leveldb::WriteOptions option = put_options(worker, server_cfg_id, 1);
+        option.hash = hv;
+        leveldb::DB *db = home_db(hv, server_cfg_id);
         leveldb::Status status = db->Put(option, dbkey, dbval);
         NOVA_ASSERT(status.ok()) << status.ToString();
+    }
+
+    // Groups the records by their home fragments and writes each group as a
+    // single batch.
+    void serve_multi_put(NICClientReqWorker *worker,
+                         const std::vector<leveldb::Slice> &keys,
+                         const std::vector<leveldb::Slice> &values,
+                         uint32_t server_cfg_id) {
+        worker->stats.nputs += keys.size();
+        std::map<leveldb::DB *, leveldb::WriteBatch> batches;
+        for (int i = 0; i < keys.size(); i++) {
+            uint64_t hv = keyhash(keys[i].data(), keys[i].size());
+            batches[home_db(hv, server_cfg_id)].Put(keys[i], values[i]);
+        }
+        for (auto &batch : batches) {
+            leveldb::WriteOptions option = put_options(worker, server_cfg_id,
+                                                       leveldb::WriteBatchInternal::Count(&batch.second));
+            leveldb::Status status = batch.first->Write(option, &batch.second);
+            NOVA_ASSERT(status.ok()) << status.ToString();
+        }
+    }
+
+    bool process_socket_put(int fd, Connection *conn, char *request_buf, uint32_t server_cfg_id) {
+        NICClientReqWorker *worker = (NICClientReqWorker *) conn->worker;
+        char *buf = request_buf;
+        char *ckey;
+        uint64_t key = 0;
+        ckey = buf;
+        int nkey = str_to_int(buf, &key) - 1;
+        buf += nkey + 1;
+        uint64_t nval;
+        buf += str_to_int(buf, &nval);
+        char *val = buf;
+        serve_put(worker, leveldb::Slice(ckey, nkey), leveldb::Slice(val, nval),
+                  server_cfg_id);
 
         char *response_buf = worker->buf;
         uint32_t response_size = 0;
@@ -626,6 +1292,360 @@ namespace nova {
         return true;
     }
 
+    bool process_socket_multi_put(int fd, Connection *conn, char *request_buf,
+                                  uint32_t server_cfg_id) {
+        NICClientReqWorker *worker = (NICClientReqWorker *) conn->worker;
+        char *buf = request_buf;
+        uint64_t nrecords = 0;
+        buf += str_to_int(buf, &nrecords);
+        std::vector<leveldb::Slice> keys;
+        std::vector<leveldb::Slice> values;
+        for (int i = 0; i < nrecords; i++) {
+            char *ckey = buf;
+            uint64_t key = 0;
+            int nkey = str_to_int(buf, &key) - 1;
+            buf += nkey + 1;
+            uint64_t nval;
+            buf += str_to_int(buf, &nval);
+            keys.emplace_back(ckey, nkey);
+            values.emplace_back(buf, nval);
+            buf += nval;
+        }
+        serve_multi_put(worker, keys, values, server_cfg_id);
+
+        char *response_buf = worker->buf;
+        uint32_t response_size = 0;
+        uint32_t cfg_size = int_to_str(response_buf, server_cfg_id);
+        response_buf += cfg_size;
+        response_size += cfg_size;
+        response_buf[0] = MSG_TERMINATER_CHAR;
+        response_size += 1;
+        conn->response_buf = worker->buf;
+        conn->response_size = response_size;
+        return true;
+    }
+
+    void serve_binary_get(Connection *conn, const char *body,
+                          const char *limit, BinaryMsgHeader response) {
+        auto worker = (NICClientReqWorker *) conn->worker;
+        auto pipeline = (PipelinedConnection *) conn->pipeline;
+        uint32_t nkey = 0;
+        body = leveldb::GetVarint32Ptr(body, limit, &nkey);
+        NOVA_ASSERT(body && body + nkey <= limit);
+        leveldb::Slice key(body, nkey);
+
+        pipeline->pending++;
+        serve_get_async(
+                worker, key, response.cfg_id,
+                [conn, pipeline, response](std::string *value) mutable {
+                    pipeline->segments.emplace_back(
+                            NOVA_BINARY_MSG_HEADER_SIZE, '\0');
+                    std::string &header = pipeline->segments.back();
+                    pipeline->iovs.push_back(
+                            {&header[0], NOVA_BINARY_MSG_HEADER_SIZE});
+                    pipeline->segments.emplace_back();
+                    std::string &value_size = pipeline->segments.back();
+                    leveldb::PutVarint32(&value_size, value->size());
+                    pipeline->iovs.push_back(
+                            {&value_size[0], value_size.size()});
+                    response.body_size = value_size.size() + value->size();
+                    if (!value->empty()) {
+                        // The value is written directly from the string it
+                        // is read into.
+                        pipeline->segments.emplace_back();
+                        std::string &slot = pipeline->segments.back();
+                        slot.swap(*value);
+                        pipeline->iovs.push_back({&slot[0], slot.size()});
+                    }
+                    EncodeBinaryMsgHeader(&header[0], response);
+                    complete_binary_request(conn, pipeline);
+                });
+    }
+
+    void serve_binary_scan(Connection *conn, const char *body,
+                           const char *limit, BinaryMsgHeader response) {
+        auto worker = (NICClientReqWorker *) conn->worker;
+        auto pipeline = (PipelinedConnection *) conn->pipeline;
+        uint32_t nkey = 0;
+        uint32_t nrecords = 0;
+        uint64_t end = 0;
+        body = leveldb::GetVarint32Ptr(body, limit, &nkey);
+        NOVA_ASSERT(body && body + nkey <= limit);
+        leveldb::Slice key(body, nkey);
+        body += nkey;
+        body = leveldb::GetVarint32Ptr(body, limit, &nrecords);
+        NOVA_ASSERT(body);
+        if (body < limit) {
+            NOVA_ASSERT(leveldb::GetVarint64Ptr(body, limit, &end));
+        }
+
+        auto done = [conn, pipeline, response](std::string *records,
+                                               bool truncated) mutable {
+            pipeline->segments.emplace_back(NOVA_BINARY_MSG_HEADER_SIZE, '\0');
+            std::string &header = pipeline->segments.back();
+            pipeline->iovs.push_back({&header[0], NOVA_BINARY_MSG_HEADER_SIZE});
+            if (!records->empty()) {
+                pipeline->segments.emplace_back();
+                std::string &slot = pipeline->segments.back();
+                slot.swap(*records);
+                pipeline->iovs.push_back({&slot[0], slot.size()});
+                response.body_size = slot.size();
+            }
+            if (truncated) {
+                response.type = BinaryResponseType::BINARY_SCAN_TRUNCATED;
+            }
+            EncodeBinaryMsgHeader(&header[0], response);
+            complete_binary_request(conn, pipeline);
+        };
+        pipeline->pending++;
+        if (end != 0) {
+            // A part forwarded by another LTC.
+            std::string records;
+            bool served = serve_scan(worker, key, nrecords, response.cfg_id,
+                                     &records, &AppendBinaryScanRecord, end);
+            if (!served) {
+                // The fragment moved away from this LTC. The forwarding LTC
+                // truncates the scan instead of skipping the fragment.
+                NOVA_LOG(rdmaio::WARNING) << fmt::format(
+                            "memstore[{}]: scan part from {} is not local",
+                            worker->thread_id_, key.ToString());
+            }
+            done(&records, !served);
+            return;
+        }
+        serve_scan_async(worker, key, nrecords, response.cfg_id, done);
+    }
+
+    void
+    process_binary_request(Connection *conn, const char *msg,
+                           const BinaryMsgHeader &request) {
+        auto worker = (NICClientReqWorker *) conn->worker;
+        auto pipeline = (PipelinedConnection *) conn->pipeline;
+        const char *body = msg + NOVA_BINARY_MSG_HEADER_SIZE;
+        const char *limit = body + request.body_size;
+        uint32_t server_cfg_id = NovaConfig::config->current_cfg_id;
+
+        BinaryMsgHeader response;
+        response.type = BinaryResponseType::BINARY_OK;
+        response.req_id = request.req_id;
+        response.cfg_id = server_cfg_id;
+        if (request.type == RequestType::GET &&
+            request.cfg_id == server_cfg_id) {
+            // The response is appended once the lookup completes.
+            serve_binary_get(conn, body, limit, response);
+            return;
+        }
+        if (request.type == RequestType::REQ_SCAN &&
+            request.cfg_id == server_cfg_id) {
+            // The response is appended once the scan completes.
+            serve_binary_scan(conn, body, limit, response);
+            return;
+        }
+        pipeline->segments.emplace_back(NOVA_BINARY_MSG_HEADER_SIZE, '\0');
+        std::string &header = pipeline->segments.back();
+        pipeline->iovs.push_back({&header[0], NOVA_BINARY_MSG_HEADER_SIZE});
+
+        if (request.cfg_id != server_cfg_id) {
+            response.type = BinaryResponseType::BINARY_CFG_MISMATCH;
+            EncodeBinaryMsgHeader(&header[0], response);
+            return;
+        }
+
+        if (request.type == RequestType::MULTI_PUT) {
+            uint32_t nrecords = 0;
+            body = leveldb::GetVarint32Ptr(body, limit, &nrecords);
+            NOVA_ASSERT(body);
+            std::vector<leveldb::Slice> keys;
+            std::vector<leveldb::Slice> values;
+            for (int i = 0; i < nrecords; i++) {
+                leveldb::Slice input(body, limit - body);
+                leveldb::Slice key;
+                leveldb::Slice value;
+                NOVA_ASSERT(leveldb::GetLengthPrefixedSlice(&input, &key));
+                NOVA_ASSERT(leveldb::GetLengthPrefixedSlice(&input, &value));
+                keys.push_back(key);
+                values.push_back(value);
+                body = input.data();
+            }
+            serve_multi_put(worker, keys, values, server_cfg_id);
+            EncodeBinaryMsgHeader(&header[0], response);
+            return;
+        }
+
+        if (request.type == RequestType::MULTI_GET) {
+            uint32_t nkeys = 0;
+            body = leveldb::GetVarint32Ptr(body, limit, &nkeys);
+            NOVA_ASSERT(body);
+            std::vector<leveldb::Slice> keys;
+            for (uint32_t i = 0; i < nkeys; i++) {
+                leveldb::Slice input(body, limit - body);
+                leveldb::Slice key;
+                NOVA_ASSERT(leveldb::GetLengthPrefixedSlice(&input, &key));
+                keys.push_back(key);
+                body = input.data();
+            }
+            std::vector<std::string> values;
+            std::vector<leveldb::Status> statuses;
+            serve_multi_get(worker, keys, server_cfg_id, &values, &statuses);
+            // Each slot is written directly from the string it is read into.
+            for (size_t i = 0; i < keys.size(); i++) {
+                pipeline->segments.emplace_back();
+                std::string &slot = pipeline->segments.back();
+                slot.push_back(key_status(statuses[i]));
+                leveldb::PutVarint32(&slot, values[i].size());
+                pipeline->iovs.push_back({&slot[0], slot.size()});
+                response.body_size += slot.size();
+                if (!values[i].empty()) {
+                    pipeline->segments.emplace_back();
+                    std::string &value = pipeline->segments.back();
+                    value.swap(values[i]);
+                    pipeline->iovs.push_back({&value[0], value.size()});
+                    response.body_size += value.size();
+                }
+            }
+            EncodeBinaryMsgHeader(&header[0], response);
+            return;
+        }
+
+        uint32_t nkey = 0;
+        body = leveldb::GetVarint32Ptr(body, limit, &nkey);
+        NOVA_ASSERT(body && body + nkey <= limit) << request.type;
+        leveldb::Slice key(body, nkey);
+        body += nkey;
+
+        if (request.type == RequestType::PUT) {
+            uint32_t nval = 0;
+            body = leveldb::GetVarint32Ptr(body, limit, &nval);
+            NOVA_ASSERT(body && body + nval <= limit);
+            serve_put(worker, key, leveldb::Slice(body, nval), server_cfg_id);
+        } else {
+            NOVA_ASSERT(false) << request.type;
+        }
+        EncodeBinaryMsgHeader(&header[0], response);
+    }
+
+    SocketState pipelined_socket_write_handler(int fd, Connection *conn) {
+        auto worker = (NICClientReqWorker *) conn->worker;
+        auto pipeline = (PipelinedConnection *) conn->pipeline;
+        while (pipeline->iov_ind < pipeline->iovs.size()) {
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = &pipeline->iovs[pipeline->iov_ind];
+            msg.msg_iovlen = std::min((size_t) IOV_MAX,
+                                      pipeline->iovs.size() -
+                                      pipeline->iov_ind);
+            ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+            if (n <= 0) {
+                if (errno == EWOULDBLOCK || errno == EAGAIN) {
+                    worker->stats.nwritesagain++;
+                    conn->UpdateEventFlags(EV_WRITE | EV_PERSIST);
+                    return INCOMPLETE;
+                }
+                return CLOSED;
+            }
+            worker->stats.nwrites++;
+            // Skip the bytes that are written.
+            while (n > 0) {
+                struct iovec &iov = pipeline->iovs[pipeline->iov_ind];
+                if (n >= iov.iov_len) {
+                    n -= iov.iov_len;
+                    pipeline->iov_ind++;
+                } else {
+                    iov.iov_base = (char *) iov.iov_base + n;
+                    iov.iov_len -= n;
+                    n = 0;
+                }
+            }
+        }
+        pipeline->iovs.clear();
+        pipeline->segments.clear();
+        pipeline->iov_ind = 0;
+        conn->UpdateEventFlags(EV_READ | EV_PERSIST);
+        return COMPLETE;
+    }
+
+    void complete_binary_request(Connection *conn,
+                                 PipelinedConnection *pipeline) {
+        NOVA_ASSERT(pipeline->pending > 0);
+        pipeline->pending--;
+        if (pipeline->closed) {
+            if (pipeline->pending == 0) {
+                free(pipeline->request_buf);
+                delete pipeline;
+            }
+            return;
+        }
+        if (pipeline->dispatching || (conn->event_flags & EV_WRITE) > 0) {
+            // pipelined_event_handler writes the response.
+            return;
+        }
+        if (pipelined_socket_write_handler(conn->fd, conn) == CLOSED) {
+            close_connection(conn->fd, conn);
+        }
+    }
+
+    SocketState pipelined_event_handler(int fd, short which, Connection *conn) {
+        auto worker = (NICClientReqWorker *) conn->worker;
+        auto pipeline = (PipelinedConnection *) conn->pipeline;
+        if (!pipeline->iovs.empty()) {
+            // Flush the responses first.
+            SocketState state = pipelined_socket_write_handler(fd, conn);
+            if (state != COMPLETE) {
+                return state;
+            }
+        }
+        if ((which & EV_READ) > 0) {
+            // Read as many requests as possible.
+            while (pipeline->req_ind < NovaConfig::config->max_msg_size) {
+                int count = read(fd, pipeline->request_buf + pipeline->req_ind,
+                                 NovaConfig::config->max_msg_size -
+                                 pipeline->req_ind);
+                worker->stats.nreads++;
+                if (count <= 0) {
+                    if (count < 0 &&
+                        (errno == EWOULDBLOCK || errno == EAGAIN)) {
+                        worker->stats.nreadsagain++;
+                        break;
+                    }
+                    return CLOSED;
+                }
+                pipeline->req_ind += count;
+            }
+        }
+
+        // Serve all complete requests.
+        uint32_t consumed = 0;
+        BinaryMsgHeader request;
+        pipeline->dispatching = true;
+        while (consumed < pipeline->req_ind) {
+            const char *msg = pipeline->request_buf + consumed;
+            uint32_t size = pipeline->req_ind - consumed;
+            NOVA_ASSERT(msg[0] == NOVA_BINARY_MSG_MAGIC) << fd;
+            if (!DecodeBinaryMsgHeader(msg, size, &request)) {
+                break;
+            }
+            NOVA_ASSERT(NOVA_BINARY_MSG_HEADER_SIZE + request.body_size <
+                        NovaConfig::config->max_msg_size);
+            if (size < NOVA_BINARY_MSG_HEADER_SIZE + request.body_size) {
+                break;
+            }
+            process_binary_request(conn, msg, request);
+            consumed += NOVA_BINARY_MSG_HEADER_SIZE + request.body_size;
+            worker->stats.nreqs++;
+            worker->stats.nresponses++;
+        }
+        pipeline->dispatching = false;
+        // Keep the partial request.
+        memmove(pipeline->request_buf, pipeline->request_buf + consumed,
+                pipeline->req_ind - consumed);
+        pipeline->req_ind -= consumed;
+
+        if (pipeline->iovs.empty()) {
+            return INCOMPLETE;
+        }
+        return pipelined_socket_write_handler(fd, conn);
+    }
+
     bool process_socket_request_handler(int fd, Connection *conn) {
         auto worker = (NICClientReqWorker *) conn->worker;
         char *request_buf = worker->request_buf;
@@ -633,7 +1653,9 @@ namespace nova {
         request_buf++;
         uint32_t server_cfg_id = NovaConfig::config->current_cfg_id;
         if (msg_type == RequestType::GET || msg_type == RequestType::REQ_SCAN ||
-            msg_type == RequestType::PUT) {
+            msg_type == RequestType::PUT ||
+            msg_type == RequestType::MULTI_PUT ||
+            msg_type == RequestType::MULTI_GET) {
             uint64_t client_cfg_id = 0;
             request_buf += str_to_int(request_buf, &client_cfg_id);
             if (client_cfg_id != server_cfg_id) {
@@ -652,6 +1674,12 @@ namespace nova {
             return process_socket_scan(fd, conn, request_buf, server_cfg_id);
         } else if (msg_type == RequestType::PUT) {
             return process_socket_put(fd, conn, request_buf, server_cfg_id);
+        } else if (msg_type == RequestType::MULTI_GET) {
+            return process_socket_multi_get(fd, conn, request_buf,
+                                            server_cfg_id);
+        } else if (msg_type == RequestType::MULTI_PUT) {
+            return process_socket_multi_put(fd, conn, request_buf,
+                                            server_cfg_id);
         } else if (msg_type == RequestType::REINITIALIZE_QP) {
             return process_reintialize_qps(fd, conn);
         } else if (msg_type == RequestType::CLOSE_STOC_FILES) {
@@ -691,6 +1719,20 @@ namespace nova {
                 buf += count;
             }
         }
+        if (worker->request_buf[0] == NOVA_BINARY_MSG_MAGIC) {
+            // Switch the connection to the pipelined binary protocol.
+            auto pipeline = new PipelinedConnection;
+            pipeline->request_buf = (char *) malloc(
+                    NovaConfig::config->max_msg_size);
+            NOVA_ASSERT(pipeline->request_buf != NULL);
+            memcpy(pipeline->request_buf, worker->request_buf,
+                   worker->req_ind);
+            pipeline->req_ind = worker->req_ind;
+            conn->pipeline = pipeline;
+            worker->request_buf[0] = '~';
+            worker->req_ind = 0;
+            return INCOMPLETE;
+        }
         while (!complete) {
             int count = read(fd, buf, 1);
             worker->stats.nreads++;
@@ -809,6 +1851,50 @@ namespace nova {
         new_conn_mutex.unlock();
     }
 
+    void continuation_handler(int fd, short which, void *arg) {
+        NICClientReqWorker *worker = (NICClientReqWorker *) arg;
+        uint64_t n;
+        while (read(fd, &n, sizeof(n)) == sizeof(n)) {
+        }
+        worker->RunContinuations();
+    }
+
+    uint32_t NICClientReqWorker::ReadDataBlockAsync(
+            const leveldb::StoCBlockHandle &block_handle, uint64_t offset,
+            uint32_t size, char *result,
+            const std::function<void()> &continuation) {
+        stats.nasync_stoc_reads++;
+        // A local read completes before returning. Defer its continuation
+        // as well so that the caller never runs it re-entrantly.
+        return stoc_client_->InitiateAsyncReadDataBlock(
+                block_handle, offset, size, result, size, true,
+                [this, continuation]() {
+                    AddContinuation(continuation);
+                });
+    }
+
+    void NICClientReqWorker::AddContinuation(
+            const std::function<void()> &continuation) {
+        continuation_mutex_.lock();
+        bool wakeup = continuations_.empty();
+        continuations_.push_back(continuation);
+        continuation_mutex_.unlock();
+        if (wakeup) {
+            uint64_t n = 1;
+            NOVA_ASSERT(write(continuation_fd_, &n, sizeof(n)) == sizeof(n));
+        }
+    }
+
+    void NICClientReqWorker::RunContinuations() {
+        std::vector<std::function<void()>> continuations;
+        continuation_mutex_.lock();
+        continuations.swap(continuations_);
+        continuation_mutex_.unlock();
+        for (const auto &continuation : continuations) {
+            continuation();
+        }
+    }
+
     void NICClientReqWorker::Start() {
         NOVA_LOG(DEBUG) << "memstore[" << thread_id_ << "]: "
                         << "starting mem worker";
@@ -858,6 +1944,17 @@ namespace nova {
                                  new_conn_handler, (void *) this) == 0);
             NOVA_ASSERT(event_add(&new_conn_timer_event, &tv) == 0);
         }
+        /* Event for the continuations of asynchronous StoC reads */
+        {
+            continuation_fd_ = eventfd(0, EFD_NONBLOCK);
+            NOVA_ASSERT(continuation_fd_ >= 0) << strerror(errno);
+            memset(&continuation_event_, 0, sizeof(struct event));
+            NOVA_ASSERT(
+                    event_assign(&continuation_event_, base, continuation_fd_,
+                                 EV_READ | EV_PERSIST, continuation_handler,
+                                 (void *) this) == 0);
+            NOVA_ASSERT(event_add(&continuation_event_, 0) == 0);
+        }
         /* Timer event for stats */
 //        {
 //            struct timeval tv;
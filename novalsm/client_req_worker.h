@@ -13,6 +13,10 @@
 #include <thread>
 #include <atomic>
 #include <chrono>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <sys/uio.h>
 
 #include "rdma/rdma_msg_callback.h"
 #include "rdma/nova_rdma_broker.h"
@@ -26,8 +30,18 @@
 
 namespace nova {
 
+    struct LTCSock;
+
+    struct AsyncScan;
+
     void event_handler(int fd, short which, void *arg);
 
+    void continuation_handler(int fd, short which, void *arg);
+
+    SocketState pipelined_event_handler(int fd, short which, Connection *conn);
+
+    void close_connection(int fd, Connection *conn);
+
     struct Stats {
         uint64_t nreqs = 0;
         uint64_t nresponses = 0;
@@ -63,6 +77,8 @@ namespace nova {
 
         uint64_t nreqs_to_poll_rdma = 0;
 
+        uint64_t nasync_stoc_reads = 0;
+
         Stats diff(const Stats &other) {
             Stats diff{};
             diff.nreqs = nreqs - other.nreqs;
@@ -91,6 +107,32 @@ namespace nova {
         }
     };
 
+    // State of a connection that uses the binary protocol. A client may
+    // pipeline many requests on the connection without waiting for their
+    // responses. Each response carries the id of its request. A GET that
+    // reads a remote data block or a scan that waits for another LTC
+    // completes on a later event loop iteration, so its response may follow
+    // the responses of later requests.
+    struct PipelinedConnection {
+        char *request_buf = nullptr;
+        uint32_t req_ind = 0;
+        // Memory of the responses that are not written yet. A deque never
+        // moves its elements so iovecs may point into them.
+        std::deque<std::string> segments;
+        std::vector<struct iovec> iovs;
+        uint32_t iov_ind = 0;
+        // Number of requests that wait for asynchronous reads.
+        uint32_t pending = 0;
+        // Set while pipelined_event_handler serves the requests it read.
+        bool dispatching = false;
+        // Set if the connection is closed while requests are pending. The
+        // last pending request frees the connection state.
+        bool closed = false;
+    };
+
+    void complete_binary_request(Connection *conn,
+                                 PipelinedConnection *pipeline);
+
     struct DBAsyncWorkers {
         std::vector<RDMAMsgHandler *> workers;
     };
@@ -118,6 +160,20 @@ namespace nova {
 
         void Start();
 
+        // Read a block from a StoC without blocking the event loop.
+        // "continuation" runs on this worker's event loop once the block is
+        // in "result". Many reads may be in flight at the same time.
+        uint32_t ReadDataBlockAsync(const leveldb::StoCBlockHandle &block_handle,
+                                    uint64_t offset, uint32_t size,
+                                    char *result,
+                                    const std::function<void()> &continuation);
+
+        // Thread-safe. Run "continuation" on this worker's event loop.
+        void AddContinuation(const std::function<void()> &continuation);
+
+        // Run the continuations of completed asynchronous reads.
+        void RunContinuations();
+
         void ResetReplicateState() {
             for (int i = 0; i < nova::NovaConfig::config->servers.size(); i++) {
                 replicate_log_record_states[i].cfgid = 0;
@@ -158,6 +214,21 @@ namespace nova {
         char *request_buf = nullptr;
         char *buf = nullptr;
         uint32_t req_ind = 0;
+
+        // Connections to the other LTCs that serve the parts of a scan
+        // beyond this LTC's fragments. Keyed by server id.
+        std::unordered_map<uint32_t, LTCSock *> ltc_socks;
+        uint32_t ltc_req_id = 0;
+        // The scans that wait for the part with the request id.
+        std::unordered_map<uint32_t, AsyncScan *> ltc_scans;
+
+    private:
+        // RDMA threads append continuations and wake up the event loop
+        // through continuation_fd_.
+        std::mutex continuation_mutex_;
+        std::vector<std::function<void()>> continuations_;
+        int continuation_fd_ = -1;
+        struct event continuation_event_;
     };
 }
 
@@ -25,6 +25,15 @@ namespace nova {
         store->Start();
     }
 
+    leveldb::Cache *NewBlockCache(uint64_t size) {
+        if (NovaConfig::config->block_cache_type == "clock") {
+            return leveldb::NewClockCache(size);
+        }
+        NOVA_ASSERT(NovaConfig::config->block_cache_type == "lru")
+            << NovaConfig::config->block_cache_type;
+        return leveldb::NewLRUCache(size);
+    }
+
     LoadThread::LoadThread(std::vector<nova::RDMAMsgHandler *> &async_workers, nova::NovaMemManager *mem_manager,
                            std::set<uint32_t> &assigned_dbids, uint32_t tid) : async_workers_(async_workers),
                                                                                mem_manager_(mem_manager),
@@ -272,6 +281,13 @@ namespace nova {
             value.clear();
             dbs_[i]->GetProperty("leveldb.approximate-memory-usage", &value);
             NOVA_LOG(INFO) << "\n" << "leveldb memory usage " << value;
+            value.clear();
+            if (dbs_[i]->GetProperty("leveldb.lookup-index", &value)) {
+                NOVA_LOG(INFO) << "lookup index " << value;
+            }
+            value.clear();
+            dbs_[i]->GetProperty("leveldb.recovery-stats", &value);
+            NOVA_LOG(INFO) << "recovery " << value;
         }
     }
 
@@ -312,12 +328,13 @@ namespace nova {
             uint64_t cache_size =
                     (uint64_t) (NovaConfig::config->block_cache_mb) *
                     1024 * 1024;
-            block_cache = leveldb::NewLRUCache(cache_size);
+            block_cache = NewBlockCache(cache_size);
 
             NOVA_LOG(INFO)
-                << fmt::format("Block cache size {}. Configured size {} MB",
+                << fmt::format("Block cache size {}. Configured size {} MB type {}",
                                block_cache->TotalCapacity(),
-                               NovaConfig::config->block_cache_mb);
+                               NovaConfig::config->block_cache_mb,
+                               NovaConfig::config->block_cache_type);
         }
         leveldb::MemTablePool *pool = new leveldb::MemTablePool;
         pool->num_available_memtables_ = NovaConfig::config->num_memtables;
@@ -328,9 +345,20 @@ namespace nova {
         leveldb::PosixEnv *env = new leveldb::PosixEnv;
         env->set_env_option(env_option);
 
+        leveldb::StoCIOEngine *stoc_io_engine = nullptr;
+        if (NovaConfig::config->stoc_io_queue_depth > 0) {
+            stoc_io_engine = new leveldb::StoCIOEngine(NovaConfig::config->stoc_io_queue_depth);
+        }
+        leveldb::Cache *stoc_block_cache = nullptr;
+        if (NovaConfig::config->stoc_block_cache_mb > 0) {
+            stoc_block_cache = NewBlockCache(NovaConfig::config->stoc_block_cache_mb * 1024 * 1024);
+        }
         leveldb::StocPersistentFileManager *stoc_file_manager = new leveldb::StocPersistentFileManager(env, mem_manager,
                                                                                                        NovaConfig::config->stoc_files_path,
-                                                                                                       NovaConfig::config->max_stoc_file_size);
+                                                                                                       NovaConfig::config->max_stoc_file_size,
+                                                                                                       stoc_io_engine,
+                                                                                                       NovaConfig::config->enable_stoc_direct_io,
+                                                                                                       stoc_block_cache);
         std::vector<nova::RDMAMsgCallback *> rdma_threads;
         for (int db_index = 0; db_index < cfg->fragments.size(); db_index++) {
             if (NovaConfig::config->cfgs[0]->fragments[db_index]->ltc_server_id != NovaConfig::config->my_server_id) {
@@ -548,6 +576,11 @@ namespace nova {
                                                                mem_env);
         storage_options.comparator = new leveldb::InternalKeyComparator(
                 user_comparator);
+        leveldb::StoCTableCache *stoc_table_cache = nullptr;
+        if (NovaConfig::config->stoc_table_cache_mb > 0) {
+            stoc_table_cache = new leveldb::StoCTableCache(storage_options,
+                                                           NovaConfig::config->stoc_table_cache_mb * 1024 * 1024);
+        }
         for (int i = 0; i < NovaConfig::config->num_storage_workers; i++) {
             auto client = new leveldb::StoCBlockClient(i, stoc_file_manager);
             client->rdma_msg_handlers_ = bg_rdma_msg_handlers;
@@ -558,7 +591,8 @@ namespace nova {
                     storage_options,
                     client,
                     mem_manager,
-                    i, mem_env);
+                    i, mem_env,
+                    stoc_table_cache);
             bg_storage_workers.push_back(worker);
         }
         for (int i = 0; i < NovaConfig::config->num_storage_workers; i++) {
@@ -571,7 +605,8 @@ namespace nova {
                     storage_options,
                     client,
                     mem_manager,
-                    i, mem_env);
+                    i, mem_env,
+                    stoc_table_cache);
             fg_storage_workers.push_back(worker);
         }
         for (int i = 0; i < NovaConfig::config->num_compaction_workers; i++) {
@@ -584,7 +619,8 @@ namespace nova {
                     storage_options,
                     client,
                     mem_manager,
-                    i, mem_env);
+                    i, mem_env,
+                    stoc_table_cache);
             compaction_storage_workers.push_back(worker);
         }
 
@@ -593,6 +629,7 @@ namespace nova {
             rdma_servers[i]->fg_storage_workers_ = fg_storage_workers;
             rdma_servers[i]->bg_storage_workers_ = bg_storage_workers;
             rdma_servers[i]->compaction_storage_workers_ = compaction_storage_workers;
+            rdma_servers[i]->stoc_table_cache_ = stoc_table_cache;
         }
 
         for (int i = 0; i < dbs_.size(); i++) {
@@ -59,13 +59,44 @@ DEFINE_uint32(ltc_num_stocs_scatter_data_blocks, 0,
               "Number of StoCs to scatter data blocks of an SSTable.");
 
 DEFINE_uint64(block_cache_mb, 0, "block cache size in mb");
+DEFINE_string(block_cache_type, "lru",
+              "lru/clock. clock is a sharded CLOCK cache with frequency-based admission that keeps scans from flushing hot blocks.");
+DEFINE_uint64(stoc_block_cache_mb, 0,
+              "Size of the cache of SSTable blocks read by StoC in MB.");
 DEFINE_uint64(row_cache_mb, 0, "row cache size in mb. Not supported");
+DEFINE_string(filter_policy, "bloom",
+              "bloom/blocked_bloom. blocked_bloom keeps the probes of a key in one cache line and checks them with AVX2.");
+DEFINE_bool(partition_index_and_filters, false,
+            "Write the index and filter blocks of SSTables in partitions that are loaded on demand through the block cache.");
+DEFINE_uint32(metadata_partition_size, 4096,
+              "Size of an index partition in bytes.");
+DEFINE_bool(pin_l0_metadata_partitions, false,
+            "Keep the index and filter partitions of L0 SSTables in memory.");
+DEFINE_uint32(readahead_max_blocks, 16,
+              "Maximum number of data blocks that a scan reads ahead from a remote StoC. 0 disables readahead.");
+DEFINE_uint32(compaction_readahead_blocks, 32,
+              "Number of data blocks that a compaction reads ahead from a remote StoC. 0 disables readahead.");
+DEFINE_bool(data_block_hash_index, false,
+            "Append a hash index from user keys to restart points to data blocks. Gets use it to skip the binary search within a block.");
+DEFINE_uint32(log_group_commit_max_bytes, 0,
+              "Replicate the log records of concurrent writers to the same memtable in batches of up to this many bytes. 0 disables group commit.");
+DEFINE_uint64(log_group_commit_max_delay_us, 0,
+              "How long the leader of a log record batch waits for more writers.");
+DEFINE_string(compression_per_level, "none",
+              "Comma separated compression of SSTable data blocks per level: none/snappy/lz4/zstd. The last entry applies to all deeper levels, e.g., none,none,lz4,zstd.");
+DEFINE_int32(zstd_compression_level, 3, "Compression level of zstd.");
+DEFINE_string(zstd_dictionary_path, "",
+              "Path to a zstd dictionary trained on sample blocks with zstd --train. Empty means no dictionary.");
 
 DEFINE_uint32(num_memtables, 0, "Number of memtables.");
 DEFINE_uint32(num_memtable_partitions, 0,
               "Number of memtable partitions. One active memtable per partition.");
 DEFINE_bool(enable_lookup_index, false, "Enable lookup index.");
 DEFINE_bool(enable_range_index, false, "Enable range index.");
+DEFINE_bool(enable_parallel_l0_probe, false,
+            "Probe the data blocks of L0 SSTables concurrently for a get.");
+DEFINE_bool(enable_memtable_hash_index, false,
+            "Index the latest entry of each key in a memtable with a hash directory.");
 
 DEFINE_uint32(l0_start_compaction_mb, 0,
               "Level-0 size to start compaction in MB.");
@@ -77,6 +108,12 @@ DEFINE_uint64(sstable_size_mb, 0, "sstable size in mb");
 DEFINE_uint32(cc_log_buf_size, 0,
               "log buffer size. Not supported. Same as memtable size.");
 DEFINE_uint32(max_stoc_file_size_mb, 0, "Max StoC file size in MB");
+DEFINE_uint32(stoc_io_queue_depth, 0,
+              "Max in-flight writes of the StoC io_uring engine. 0 persists StoC files synchronously.");
+DEFINE_uint64(stoc_table_cache_mb, 0,
+              "Size of the table cache shared by StoC-side compactions in MB. 0 opens the input tables of each compaction from scratch.");
+DEFINE_bool(enable_stoc_direct_io, false,
+            "Write 4KB-aligned ranges of StoC files with O_DIRECT. Requires stoc_io_queue_depth > 0.");
 DEFINE_bool(use_local_disk, false,
             "Enable LTC to write data to its local disk.");
 DEFINE_string(scatter_policy, "random",
@@ -84,7 +121,7 @@ DEFINE_string(scatter_policy, "random",
 DEFINE_string(log_record_mode, "none",
               "Policy for LogC to replicate log records, i.e., none/rdma");
 DEFINE_uint32(num_log_replicas, 0, "Number of replicas for a log record.");
-DEFINE_string(memtable_type, "", "Memtable type, i.e., pool/static_partition");
+DEFINE_string(memtable_type, "", "Memtable type, i.e., pool/static_partition. Append :inline to store integer keys inline in cache-line sized skiplist nodes, e.g., static_partition:inline");
 
 DEFINE_bool(recover_dbs, false, "Enable recovery");
 DEFINE_uint32(num_recovery_threads, 32, "Number of recovery threads");
@@ -115,6 +152,8 @@ DEFINE_uint32(major_compaction_max_tables_in_a_set, 15,
 DEFINE_uint32(num_sstable_replicas, 1, "Number of replicas for SSTables.");
 DEFINE_uint32(num_sstable_metadata_replicas, 1, "Number of replicas for meta blocks of SSTables.");
 DEFINE_bool(use_parity_for_sstable_data_blocks, false, "");
+DEFINE_uint32(num_parity_fragments, 1,
+              "Number of parity fragments per SSTable when parity is enabled. 1 uses XOR parity. >1 uses Reed-Solomon.");
 DEFINE_uint32(num_manifest_replicas, 1, "Number of replicas for manifest file.");
 
 DEFINE_int32(fail_stoc_id, -1, "The StoC to fail.");
@@ -202,6 +241,20 @@ int main(int argc, char *argv[]) {
     NovaConfig::config->rdma_doorbell_batch_size = FLAGS_rdma_doorbell_batch_size;
 
     NovaConfig::config->block_cache_mb = FLAGS_block_cache_mb;
+    NovaConfig::config->block_cache_type = FLAGS_block_cache_type;
+    NovaConfig::config->stoc_block_cache_mb = FLAGS_stoc_block_cache_mb;
+    NovaConfig::config->filter_policy = FLAGS_filter_policy;
+    NovaConfig::config->partition_index_and_filters = FLAGS_partition_index_and_filters;
+    NovaConfig::config->metadata_partition_size = FLAGS_metadata_partition_size;
+    NovaConfig::config->pin_l0_metadata_partitions = FLAGS_pin_l0_metadata_partitions;
+    NovaConfig::config->data_block_hash_index = FLAGS_data_block_hash_index;
+    NovaConfig::config->readahead_max_blocks = FLAGS_readahead_max_blocks;
+    NovaConfig::config->compaction_readahead_blocks = FLAGS_compaction_readahead_blocks;
+    NovaConfig::config->log_group_commit_max_bytes = FLAGS_log_group_commit_max_bytes;
+    NovaConfig::config->log_group_commit_max_delay_us = FLAGS_log_group_commit_max_delay_us;
+    NovaConfig::config->compression_per_level = FLAGS_compression_per_level;
+    NovaConfig::config->zstd_compression_level = FLAGS_zstd_compression_level;
+    NovaConfig::config->zstd_dictionary_path = FLAGS_zstd_dictionary_path;
     NovaConfig::config->memtable_size_mb = FLAGS_memtable_size_mb;
 
     NovaConfig::config->db_path = FLAGS_db_path;
@@ -218,6 +271,7 @@ int main(int argc, char *argv[]) {
     NovaConfig::config->number_of_sstable_metadata_replicas = FLAGS_num_sstable_metadata_replicas;
     NovaConfig::config->number_of_manifest_replicas = FLAGS_num_manifest_replicas;
     NovaConfig::config->use_parity_for_sstable_data_blocks = FLAGS_use_parity_for_sstable_data_blocks;
+    NovaConfig::config->number_of_parity_fragments = FLAGS_num_parity_fragments;
 
     NovaConfig::config->servers = convert_hosts(FLAGS_all_servers);
     NovaConfig::config->my_server_id = FLAGS_server_id;
@@ -234,6 +288,9 @@ int main(int argc, char *argv[]) {
     NovaConfig::config->num_stocs_scatter_data_blocks = FLAGS_ltc_num_stocs_scatter_data_blocks;
     NovaConfig::config->max_stoc_file_size = FLAGS_max_stoc_file_size_mb * 1024;
     NovaConfig::config->manifest_file_size = NovaConfig::config->max_stoc_file_size;
+    NovaConfig::config->stoc_io_queue_depth = FLAGS_stoc_io_queue_depth;
+    NovaConfig::config->enable_stoc_direct_io = FLAGS_enable_stoc_direct_io;
+    NovaConfig::config->stoc_table_cache_mb = FLAGS_stoc_table_cache_mb;
     NovaConfig::config->sstable_size = FLAGS_sstable_size_mb * 1024 * 1024;
     NovaConfig::config->use_local_disk = FLAGS_use_local_disk;
     NovaConfig::config->num_tinyranges_per_subrange = FLAGS_num_tinyranges_per_subrange;
@@ -256,6 +313,8 @@ int main(int argc, char *argv[]) {
 
     NovaConfig::config->enable_lookup_index = FLAGS_enable_lookup_index;
     NovaConfig::config->enable_range_index = FLAGS_enable_range_index;
+    NovaConfig::config->enable_parallel_l0_probe = FLAGS_enable_parallel_l0_probe;
+    NovaConfig::config->enable_memtable_hash_index = FLAGS_enable_memtable_hash_index;
     NovaConfig::config->subrange_sampling_ratio = FLAGS_sampling_ratio;
     NovaConfig::config->zipfian_dist_file_path = FLAGS_zipfian_dist_ref_counts;
     NovaConfig::config->ReadZipfianDist();
@@ -314,8 +373,10 @@ int main(int argc, char *argv[]) {
     if (NovaConfig::config->use_parity_for_sstable_data_blocks) {
         NOVA_ASSERT(NovaConfig::config->number_of_sstable_data_replicas == 1);
         NOVA_ASSERT(NovaConfig::config->num_stocs_scatter_data_blocks > 1);
+        NOVA_ASSERT(NovaConfig::config->number_of_parity_fragments >= 1);
         NOVA_ASSERT(NovaConfig::config->num_stocs_scatter_data_blocks +
-                    NovaConfig::config->number_of_sstable_metadata_replicas + 1 <=
+                    NovaConfig::config->number_of_sstable_metadata_replicas +
+                    NovaConfig::config->number_of_parity_fragments <=
                     NovaConfig::config->cfgs[0]->stoc_servers.size());
     }
     for (int i = 0; i < NovaConfig::config->cfgs.size(); i++) {
@@ -40,6 +40,9 @@ namespace nova {
                             << fmt::format("Wake up request: {}", it->req_id);
                         NOVA_ASSERT(sem_post(it->sem) == 0);
                     }
+                    if (it->callback) {
+                        it->callback();
+                    }
                     it = pending_reqs_.erase(it);
                 } else {
                     it++;
@@ -83,6 +86,7 @@ namespace nova {
             }
             RequestCtx ctx = {};
             ctx.sem = task.sem;
+            ctx.callback = task.callback;
             ctx.response = task.response;
             bool failed = false;
             switch (task.type) {
@@ -140,6 +144,12 @@ namespace nova {
                             task.result, task.write_size, task.filename,
                             task.is_foreground_reads);
                     break;
+                case leveldb::RDMA_CLIENT_REQ_READ_BLOCKS:
+                    ctx.req_id = stoc_client_->InitiateReadDataBlocks(
+                            task.stoc_block_handles,
+                            task.result, task.write_size,
+                            task.is_foreground_reads);
+                    break;
                 case leveldb::RDMA_CLIENT_REQ_QUERY_LOG_FILES:
                     ctx.req_id = stoc_client_->InitiateQueryLogFile(
                             task.server_id,
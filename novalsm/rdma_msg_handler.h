@@ -81,6 +81,7 @@ namespace nova {
         struct RequestCtx {
             uint32_t req_id = 0;
             sem_t *sem = nullptr;
+            leveldb::StoCCallback callback;
             leveldb::StoCResponse *response = nullptr;
         };
 
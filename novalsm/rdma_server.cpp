@@ -148,7 +148,11 @@ namespace nova {
                                        NovaGlobalVariables::global.stoc_pending_disk_reads);
                 leveldb::EncodeFixed64(sendbuf + 17,
                                        NovaGlobalVariables::global.stoc_pending_disk_writes);
-                rdma_broker_->PostSend(sendbuf, 13, task.remote_server_id,
+                leveldb::EncodeFixed64(sendbuf + 25,
+                                       NovaGlobalVariables::global.stoc_table_cache_lookups);
+                leveldb::EncodeFixed64(sendbuf + 33,
+                                       NovaGlobalVariables::global.stoc_table_cache_hits);
+                rdma_broker_->PostSend(sendbuf, 41, task.remote_server_id,
                                        task.stoc_req_id);
             } else if (task.request_type ==
                        leveldb::StoCRequestType::STOC_READ_BLOCKS) {
@@ -166,6 +170,7 @@ namespace nova {
                 leveldb::EncodeFixed64(sendbuf + 1, wr_id);
                 leveldb::EncodeFixed32(sendbuf + 9, task.stoc_block_handle.size);
                 leveldb::EncodeFixed64(sendbuf + 13, (uint64_t) (task.rdma_buf));
+                leveldb::EncodeFixed64(sendbuf + 21, (uint64_t) (task.block_cache_handle));
             } else if (task.request_type ==
                        leveldb::StoCRequestType::STOC_PERSIST) {
                 char *sendbuf = rdma_broker_->GetSendBuf(task.remote_server_id);
@@ -259,9 +264,16 @@ namespace nova {
                         uint64_t allocated_buf_int = leveldb::DecodeFixed64(
                                 buf + 13);
                         char *allocated_buf = (char *) (allocated_buf_int);
-                        uint32_t scid = mem_manager_->slabclassid(thread_id_,
-                                                                  size);
-                        mem_manager_->FreeItem(thread_id_, allocated_buf, scid);
+                        auto block_cache_handle = (leveldb::Cache::Handle *) (leveldb::DecodeFixed64(
+                                buf + 21));
+                        if (block_cache_handle) {
+                            // Unpin the cached block.
+                            stoc_file_manager_->ReleaseDataBlock(block_cache_handle);
+                        } else {
+                            uint32_t scid = mem_manager_->slabclassid(thread_id_,
+                                                                      size);
+                            mem_manager_->FreeItem(thread_id_, allocated_buf, scid);
+                        }
                         processed = true;
                         NOVA_LOG(DEBUG) << fmt::format(
                                     "rdma-server[{}]: imm:{} type:{} allocated buf:{} size:{} wr:{}.",
@@ -350,6 +362,9 @@ namespace nova {
                         leveldb::FileType type;
                         NOVA_ASSERT(leveldb::ParseFileName(sstable_id, &type));
                         if (type == leveldb::FileType::kTableFile) {
+                            if (stoc_table_cache_) {
+                                stoc_table_cache_->Evict(sstable_id);
+                            }
                             stoc_file_manager_->DeleteSSTable(
                                     sstable_id + "-meta");
                         }
@@ -361,33 +376,51 @@ namespace nova {
                 } else if (buf[0] ==
                            leveldb::StoCRequestType::STOC_READ_BLOCKS) {
                     uint32_t msg_size = 1;
-                    uint32_t stoc_file_id = 0;
-                    uint64_t offset = 0;
                     uint32_t size = 0;
                     uint64_t ltc_mr_offset = 0;
                     bool is_foreground_read = leveldb::DecodeBool(buf + msg_size);
                     msg_size += 1;
-                    stoc_file_id = leveldb::DecodeFixed32(buf + msg_size);
-                    msg_size += 4;
-                    offset = leveldb::DecodeFixed64(buf + msg_size);
-                    msg_size += 8;
-                    size = leveldb::DecodeFixed32(buf + msg_size);
-                    msg_size += 4;
                     ltc_mr_offset = leveldb::DecodeFixed64(buf + msg_size);
                     msg_size += 8;
                     std::string filename;
-                    leveldb::DecodeStr(buf + msg_size, &filename);
+                    msg_size += leveldb::DecodeStr(buf + msg_size, &filename);
+                    uint32_t nblocks = leveldb::DecodeFixed32(buf + msg_size);
+                    msg_size += 4;
+                    std::vector<leveldb::StoCBlockHandle> handles;
+                    for (int i = 0; i < nblocks; i++) {
+                        leveldb::StoCBlockHandle handle = {};
+                        handle.server_id = nova::NovaConfig::config->my_server_id;
+                        handle.stoc_file_id = leveldb::DecodeFixed32(buf + msg_size);
+                        msg_size += 4;
+                        handle.offset = leveldb::DecodeFixed64(buf + msg_size);
+                        msg_size += 8;
+                        handle.size = leveldb::DecodeFixed32(buf + msg_size);
+                        msg_size += 4;
+                        size += handle.size;
+                        handles.push_back(handle);
+                    }
+                    NOVA_ASSERT(nblocks > 0);
+                    uint32_t stoc_file_id = handles[0].stoc_file_id;
+                    uint64_t offset = handles[0].offset;
                     NOVA_LOG(DEBUG) << fmt::format(
-                                "rdma-server{}: Read blocks of StoC file {} offset:{} size:{} ltc_mr_offset:{} file:{}",
-                                thread_id_, stoc_file_id, offset, size, ltc_mr_offset, filename);
+                                "rdma-server{}: Read {} blocks of StoC file {} offset:{} size:{} ltc_mr_offset:{} file:{}",
+                                thread_id_, nblocks, stoc_file_id, offset, size, ltc_mr_offset, filename);
 
                     if (!filename.empty()) {
+                        NOVA_ASSERT(nblocks == 1);
                         stoc_file_id = stoc_file_manager_->OpenStoCFile(thread_id_, filename)->file_id();
+                        handles[0].stoc_file_id = stoc_file_id;
                     }
 
-                    uint32_t scid = mem_manager_->slabclassid(thread_id_, size);
-                    char *rdma_buf = mem_manager_->ItemAlloc(thread_id_, scid);
-                    NOVA_ASSERT(rdma_buf);
+                    // A single block may be served from the block cache
+                    // without a copy. The storage worker allocates the buffer
+                    // if it is not cached.
+                    char *rdma_buf = nullptr;
+                    if (nblocks > 1 || !stoc_file_manager_->block_cache()) {
+                        uint32_t scid = mem_manager_->slabclassid(thread_id_, size);
+                        rdma_buf = mem_manager_->ItemAlloc(thread_id_, scid);
+                        NOVA_ASSERT(rdma_buf);
+                    }
 
                     StorageTask task = {};
                     task.stoc_req_id = stoc_req_id;
@@ -402,6 +435,8 @@ namespace nova {
                     task.stoc_block_handle.stoc_file_id = stoc_file_id;
                     task.stoc_block_handle.offset = offset;
                     task.stoc_block_handle.size = size;
+                    task.read_block_handles = handles;
+                    task.is_foreground_read = is_foreground_read;
 
                     if (is_foreground_read) {
                         AddFGStorageTask(task);
@@ -35,10 +35,14 @@ namespace nova {
         uint32_t remote_server_id = 0;
         uint32_t stoc_file_id = 0;
 
-        // Read request
+        // Read request. The blocks are read into consecutive ranges of
+        // rdma_buf. stoc_block_handle.size is the total size. rdma_buf is
+        // nullptr if a single block may be served from the block cache.
         leveldb::StoCBlockHandle stoc_block_handle = {};
+        std::vector<leveldb::StoCBlockHandle> read_block_handles;
         char *rdma_buf = nullptr;
         uint64_t ltc_mr_offset = 0;
+        bool is_foreground_read = true;
         leveldb::FileInternalType internal_type;
 
         // Persist request
@@ -65,6 +69,9 @@ namespace nova {
         uint32_t size = 0;
         uint64_t ltc_mr_offset = 0;
         leveldb::StoCBlockHandle stoc_block_handle = {};
+        // Pins rdma_buf in the StoC block cache until the RDMA WRITE
+        // completes. rdma_buf is allocated from the mem manager if nullptr.
+        leveldb::Cache::Handle *block_cache_handle = nullptr;
         // Persist result.
         std::vector<leveldb::StoCBlockHandle> stoc_block_handles = {};
         leveldb::CompactionState *compaction_state = nullptr;
@@ -121,6 +128,8 @@ namespace nova {
 
         std::vector<StorageWorker *> fg_storage_workers_;
         std::vector<StorageWorker *> bg_storage_workers_;
+        // Evicted upon STOC_DELETE_TABLES. May be nullptr.
+        leveldb::StoCTableCache *stoc_table_cache_ = nullptr;
         std::vector<StorageWorker *> compaction_storage_workers_;
         RDMAWriteHandler *rdma_write_handler_ = nullptr;
 
@@ -30,6 +30,12 @@
 #if HAVE_SNAPPY
 #include <snappy.h>
 #endif  // HAVE_SNAPPY
+#if HAVE_LZ4
+#include <lz4.h>
+#endif  // HAVE_LZ4
+#if HAVE_ZSTD
+#include <zstd.h>
+#endif  // HAVE_ZSTD
 
 #include <cassert>
 #include <condition_variable>  // NOLINT
@@ -168,6 +174,157 @@ namespace leveldb {
 #endif  // HAVE_SNAPPY
         }
 
+        // Append the LZ4 compression of "input[0,length-1]" to *output.
+        // Returns false if LZ4 is not supported by this port.
+        inline bool LZ4_Compress(const char *input, size_t length,
+                                 std::string *output) {
+#if HAVE_LZ4
+            size_t base = output->size();
+            int bound = LZ4_compressBound(static_cast<int>(length));
+            output->resize(base + bound);
+            int outlen = LZ4_compress_default(input, &(*output)[base],
+                                              static_cast<int>(length),
+                                              bound);
+            if (outlen <= 0) {
+                output->resize(base);
+                return false;
+            }
+            output->resize(base + outlen);
+            return true;
+#else
+            // Silence compiler warnings about unused arguments.
+            (void) input;
+            (void) length;
+            (void) output;
+            return false;
+#endif  // HAVE_LZ4
+        }
+
+        // Uncompress the LZ4 block "input[0,length-1]" into
+        // "output[0,output_length-1]". Returns false unless it uncompresses
+        // to exactly output_length bytes.
+        inline bool LZ4_Uncompress(const char *input, size_t length,
+                                   char *output, size_t output_length) {
+#if HAVE_LZ4
+            int n = LZ4_decompress_safe(input, output, static_cast<int>(length),
+                                        static_cast<int>(output_length));
+            return n >= 0 && static_cast<size_t>(n) == output_length;
+#else
+            // Silence compiler warnings about unused arguments.
+            (void) input;
+            (void) length;
+            (void) output;
+            (void) output_length;
+            return false;
+#endif  // HAVE_LZ4
+        }
+
+        // A Zstd dictionary digested once, for compression at "level" and
+        // for decompression. Digesting a raw dictionary costs more than
+        // compressing a small block, so it must not happen per block.
+        class ZstdDictionary {
+        public:
+            ZstdDictionary(const std::string &raw, int level) {
+#if HAVE_ZSTD
+                cdict_ = ZSTD_createCDict(raw.data(), raw.size(), level);
+                ddict_ = ZSTD_createDDict(raw.data(), raw.size());
+#else
+                // Silence compiler warnings about unused arguments.
+                (void) raw;
+                (void) level;
+#endif  // HAVE_ZSTD
+            }
+
+            ~ZstdDictionary() {
+#if HAVE_ZSTD
+                ZSTD_freeCDict(cdict_);
+                ZSTD_freeDDict(ddict_);
+#endif  // HAVE_ZSTD
+            }
+
+            ZstdDictionary(const ZstdDictionary &) = delete;
+
+            ZstdDictionary &operator=(const ZstdDictionary &) = delete;
+
+#if HAVE_ZSTD
+            const ZSTD_CDict *cdict() const { return cdict_; }
+
+            const ZSTD_DDict *ddict() const { return ddict_; }
+
+        private:
+            ZSTD_CDict *cdict_ = nullptr;
+            ZSTD_DDict *ddict_ = nullptr;
+#endif  // HAVE_ZSTD
+        };
+
+        // Append the Zstd compression of "input[0,length-1]" to *output.
+        // "dict" is used when it is not nullptr and then determines the
+        // compression level instead of "level". Returns false if Zstd is not
+        // supported by this port.
+        inline bool Zstd_Compress(int level, const ZstdDictionary *dict,
+                                  const char *input, size_t length,
+                                  std::string *output) {
+#if HAVE_ZSTD
+            // Contexts are expensive to create. Reuse one per thread.
+            static thread_local ZSTD_CCtx *cctx = ZSTD_createCCtx();
+            size_t base = output->size();
+            size_t bound = ZSTD_compressBound(length);
+            output->resize(base + bound);
+            size_t outlen;
+            if (dict != nullptr) {
+                outlen = ZSTD_compress_usingCDict(cctx, &(*output)[base],
+                                                  bound, input, length,
+                                                  dict->cdict());
+            } else {
+                outlen = ZSTD_compressCCtx(cctx, &(*output)[base], bound,
+                                           input, length, level);
+            }
+            if (ZSTD_isError(outlen)) {
+                output->resize(base);
+                return false;
+            }
+            output->resize(base + outlen);
+            return true;
+#else
+            // Silence compiler warnings about unused arguments.
+            (void) level;
+            (void) dict;
+            (void) input;
+            (void) length;
+            (void) output;
+            return false;
+#endif  // HAVE_ZSTD
+        }
+
+        // Uncompress the Zstd frame "input[0,length-1]" into
+        // "output[0,output_length-1]" with "dict", which may be nullptr.
+        // Returns false unless it uncompresses to exactly output_length
+        // bytes.
+        inline bool Zstd_Uncompress(const ZstdDictionary *dict,
+                                    const char *input, size_t length,
+                                    char *output, size_t output_length) {
+#if HAVE_ZSTD
+            static thread_local ZSTD_DCtx *dctx = ZSTD_createDCtx();
+            size_t n;
+            if (dict != nullptr) {
+                n = ZSTD_decompress_usingDDict(dctx, output, output_length,
+                                               input, length, dict->ddict());
+            } else {
+                n = ZSTD_decompressDCtx(dctx, output, output_length, input,
+                                        length);
+            }
+            return !ZSTD_isError(n) && n == output_length;
+#else
+            // Silence compiler warnings about unused arguments.
+            (void) dict;
+            (void) input;
+            (void) length;
+            (void) output;
+            (void) output_length;
+            return false;
+#endif  // HAVE_ZSTD
+        }
+
         inline bool
         GetHeapProfile(void (*func)(void *, const char *, int), void *arg) {
             // Silence compiler warnings about unused arguments.
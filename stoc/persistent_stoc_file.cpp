@@ -3,6 +3,10 @@
 // Created by Haoyu Huang on 1/29/20.
 // Copyright (c) 2020 University of Southern California. All rights reserved.
 //
+#include <fcntl.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <set>
 #include <fmt/core.h>
 #include "leveldb/cache.h"
 #include "db/filename.h"
@@ -65,13 +69,31 @@ namespace leveldb {
                                            std::string filename,
                                            MemManager *mem_manager,
                                            uint32_t thread_id,
-                                           uint32_t file_size) :
+                                           uint32_t file_size,
+                                           StoCIOEngine *io_engine,
+                                           bool direct_io) :
             file_id_(file_id), env_(env), stoc_file_name_(filename),
-            mem_manager_(mem_manager), thread_id_(thread_id) {
+            mem_manager_(mem_manager), thread_id_(thread_id),
+            io_engine_(io_engine) {
         EnvFileMetadata meta;
         meta.level = 0;
         Status s = env_->NewReadWriteFile(filename, meta, &file_);
         NOVA_ASSERT(s.ok()) << s.ToString();
+        if (io_engine_) {
+            // The engine writes at explicit offsets through its own fds.
+            write_fd_ = ::open(filename.c_str(), O_WRONLY | O_CLOEXEC);
+            NOVA_ASSERT(write_fd_ >= 0)
+                << fmt::format("{} {}", filename, strerror(errno));
+            if (direct_io) {
+                direct_fd_ = ::open(filename.c_str(),
+                                    O_WRONLY | O_CLOEXEC | O_DIRECT);
+                if (direct_fd_ < 0) {
+                    NOVA_LOG(rdmaio::DEBUG)
+                        << fmt::format("O_DIRECT is not supported for {}: {}",
+                                       filename, strerror(errno));
+                }
+            }
+        }
 
         uint32_t scid = mem_manager_->slabclassid(thread_id,
                                                   file_size);
@@ -115,6 +137,7 @@ namespace leveldb {
             NOVA_LOG(rdmaio::DEBUG) << fmt::format(
                         "Delete  Stoc File {}.", stoc_file_name_);
             NOVA_ASSERT(file_);
+            CloseIOEngineFds();
             Status s = file_->Close();
             NOVA_ASSERT(s.ok()) << fmt::format("{}", s.ToString());
             delete file_;
@@ -210,19 +233,7 @@ namespace leveldb {
         return (uint64_t) (backing_mem_) + off;
     }
 
-    uint64_t
-    StoCPersistentFile::Persist(uint32_t given_file_id_for_assertion) {
-        NOVA_ASSERT(given_file_id_for_assertion == file_id_)
-            << fmt::format("{} {}", given_file_id_for_assertion, file_id_);
-
-        uint64_t persisted_bytes = 0;
-        mutex_.lock();
-        if (allocated_bufs_.empty()) {
-            Seal();
-            mutex_.unlock();
-            return persisted_bytes;
-        }
-
+    void StoCPersistentFile::TakeWrittenBufs(std::vector<BatchWrite> *writes) {
         // sequential IOs to disk.
         auto buf = allocated_bufs_.begin();
         while (buf != allocated_bufs_.end()) {
@@ -262,22 +273,62 @@ namespace leveldb {
                 s.persisted = false;
             }
 
-            BlockHandle mem_handle = {};
-            mem_handle.set_offset(buf->offset);
-            mem_handle.set_size(buf->size);
-            persisting_cnt += 1;
-            current_disk_offset_ += buf->size;
-
             BatchWrite bw = {};
             bw.mem_handle.set_offset(buf->offset);
             bw.mem_handle.set_size(buf->size);
+            bw.disk_offset = current_disk_offset_;
             bw.sstable = buf->filename;
             bw.internal_type = buf->internal_type;
-            written_mem_blocks_.push_back(bw);
+            writes->push_back(bw);
+            persisting_cnt += 1;
+            current_disk_offset_ += buf->size;
             buf = allocated_bufs_.erase(buf);
         }
-
         NOVA_ASSERT(current_disk_offset_ <= file_size_);
+    }
+
+    void StoCPersistentFile::MarkPersisted(const std::vector<BatchWrite> &writes,
+                                           uint32_t begin, uint32_t end) {
+        for (uint32_t j = begin; j < end; j++) {
+            if (writes[j].internal_type == FileInternalType::kFileMetadata) {
+                NOVA_ASSERT(file_meta_block_offset_.find(writes[j].sstable) != file_meta_block_offset_.end());
+                file_meta_block_offset_[writes[j].sstable].persisted = true;
+            } else if (writes[j].internal_type == FileInternalType::kFileParity) {
+                NOVA_ASSERT(file_parity_block_offset_.find(writes[j].sstable) != file_parity_block_offset_.end());
+                file_parity_block_offset_[writes[j].sstable].persisted = true;
+            } else {
+                NOVA_ASSERT(file_block_offset_.find(writes[j].sstable) != file_block_offset_.end());
+                file_block_offset_[writes[j].sstable].persisted = true;
+            }
+            persisting_cnt -= 1;
+        }
+    }
+
+    uint64_t
+    StoCPersistentFile::Persist(uint32_t given_file_id_for_assertion) {
+        NOVA_ASSERT(given_file_id_for_assertion == file_id_)
+            << fmt::format("{} {}", given_file_id_for_assertion, file_id_);
+
+        uint64_t persisted_bytes = 0;
+        if (io_engine_) {
+            sem_t done;
+            sem_init(&done, 0, 0);
+            Persist(given_file_id_for_assertion, [&](uint64_t bytes) {
+                persisted_bytes = bytes;
+                sem_post(&done);
+            });
+            sem_wait(&done);
+            sem_destroy(&done);
+            return persisted_bytes;
+        }
+
+        mutex_.lock();
+        if (allocated_bufs_.empty()) {
+            Seal();
+            mutex_.unlock();
+            return persisted_bytes;
+        }
+        TakeWrittenBufs(&written_mem_blocks_);
         mutex_.unlock();
 
         persist_mutex_.lock();
@@ -324,19 +375,7 @@ namespace leveldb {
             nova::NovaGlobalVariables::global.stoc_pending_disk_writes -= size;
 
             mutex_.lock();
-            for (int j = persisted_i; j < i; j++) {
-                if (writes[j].internal_type == FileInternalType::kFileMetadata) {
-                    NOVA_ASSERT(file_meta_block_offset_.find(writes[j].sstable) != file_meta_block_offset_.end());
-                    file_meta_block_offset_[writes[j].sstable].persisted = true;
-                } else if (writes[j].internal_type == FileInternalType::kFileParity) {
-                    NOVA_ASSERT(file_parity_block_offset_.find(writes[j].sstable) != file_parity_block_offset_.end());
-                    file_parity_block_offset_[writes[j].sstable].persisted = true;
-                } else {
-                    NOVA_ASSERT(file_block_offset_.find(writes[j].sstable) != file_block_offset_.end());
-                    file_block_offset_[writes[j].sstable].persisted = true;
-                }
-                persisting_cnt -= 1;
-            }
+            MarkPersisted(writes, persisted_i, i);
             mutex_.unlock();
             persisted_i = i;
             offset = writes[i].mem_handle.offset();
@@ -358,19 +397,7 @@ namespace leveldb {
         nova::NovaGlobalVariables::global.stoc_pending_disk_writes -= size;
 
         mutex_.lock();
-        for (int j = persisted_i; j < writes.size(); j++) {
-            if (writes[j].internal_type == FileInternalType::kFileMetadata) {
-                NOVA_ASSERT(file_meta_block_offset_.find(writes[j].sstable) != file_meta_block_offset_.end());
-                file_meta_block_offset_[writes[j].sstable].persisted = true;
-            } else if (writes[j].internal_type == FileInternalType::kFileParity) {
-                NOVA_ASSERT(file_parity_block_offset_.find(writes[j].sstable) != file_parity_block_offset_.end());
-                file_parity_block_offset_[writes[j].sstable].persisted = true;
-            } else {
-                NOVA_ASSERT(file_block_offset_.find(writes[j].sstable) != file_block_offset_.end());
-                file_block_offset_[writes[j].sstable].persisted = true;
-            }
-            persisting_cnt -= 1;
-        }
+        MarkPersisted(writes, persisted_i, writes.size());
         mutex_.unlock();
 
         mutex_.lock();
@@ -382,6 +409,135 @@ namespace leveldb {
         return persisted_bytes;
     }
 
+    void
+    StoCPersistentFile::Persist(uint32_t given_file_id_for_assertion,
+                                std::function<void(uint64_t)> done) {
+        NOVA_ASSERT(given_file_id_for_assertion == file_id_)
+            << fmt::format("{} {}", given_file_id_for_assertion, file_id_);
+        NOVA_ASSERT(io_engine_);
+
+        std::vector<BatchWrite> writes;
+        std::vector<StoCIOEngine::Write> ios;
+        uint64_t persisted_bytes = 0;
+        mutex_.lock();
+        TakeWrittenBufs(&writes);
+        for (const auto &write : writes) {
+            const char *data = backing_mem_ + write.mem_handle.offset();
+            uint64_t size = write.mem_handle.size();
+            persisted_bytes += size;
+            if (!ios.empty() && ios.back().data + ios.back().size == data &&
+                ios.back().offset + ios.back().size == write.disk_offset) {
+                ios.back().size += size;
+                continue;
+            }
+            StoCIOEngine::Write io = {};
+            io.data = data;
+            io.size = size;
+            io.offset = write.disk_offset;
+            ios.push_back(io);
+        }
+        for (auto &io : ios) {
+            // O_DIRECT requires the buffer, offset, and size to be aligned.
+            bool aligned = ((uint64_t) io.data | io.offset | io.size) % 4096 == 0;
+            io.fd = (direct_fd_ >= 0 && aligned) ? direct_fd_ : write_fd_;
+        }
+        nova::NovaGlobalVariables::global.stoc_queue_depth += 1;
+        nova::NovaGlobalVariables::global.stoc_pending_disk_writes += persisted_bytes;
+        nova::NovaGlobalVariables::global.total_disk_writes += persisted_bytes;
+
+        // Submit while holding mutex_ so that the requests of this file
+        // complete in the order they took their blocks. A request that found
+        // no blocks completes after the one that took them.
+        io_engine_->Submit(std::move(ios),
+                           [this, writes, persisted_bytes, done](const Status &s) {
+                               NOVA_ASSERT(s.ok()) << fmt::format("{}", s.ToString());
+                               nova::NovaGlobalVariables::global.stoc_queue_depth -= 1;
+                               nova::NovaGlobalVariables::global.stoc_pending_disk_writes -= persisted_bytes;
+                               mutex_.lock();
+                               MarkPersisted(writes, 0, writes.size());
+                               Seal();
+                               mutex_.unlock();
+                               done(persisted_bytes);
+                           });
+        mutex_.unlock();
+    }
+
+    uint64_t
+    StoCPersistentFile::WriteWithoutSync(uint32_t given_file_id_for_assertion,
+                                         std::vector<BatchWrite> *writes) {
+        NOVA_ASSERT(given_file_id_for_assertion == file_id_)
+            << fmt::format("{} {}", given_file_id_for_assertion, file_id_);
+        NOVA_ASSERT(!io_engine_);
+
+        mutex_.lock();
+        TakeWrittenBufs(&written_mem_blocks_);
+        mutex_.unlock();
+
+        // persist_mutex_ orders the appends with concurrent Persist calls.
+        persist_mutex_.lock();
+        mutex_.lock();
+        writes->insert(writes->end(), written_mem_blocks_.begin(),
+                       written_mem_blocks_.end());
+        written_mem_blocks_.clear();
+        mutex_.unlock();
+
+        // Coalesce contiguous memory ranges and write the whole batch with
+        // one vectored write.
+        std::vector<Slice> ranges;
+        uint64_t persisted_bytes = 0;
+        uint32_t i = 0;
+        while (i < writes->size()) {
+            uint64_t offset = (*writes)[i].mem_handle.offset();
+            uint64_t size = (*writes)[i].mem_handle.size();
+            i++;
+            while (i < writes->size() &&
+                   offset + size == (*writes)[i].mem_handle.offset()) {
+                size += (*writes)[i].mem_handle.size();
+                i++;
+            }
+            ranges.emplace_back(backing_mem_ + offset, size);
+            persisted_bytes += size;
+        }
+        if (!ranges.empty()) {
+            nova::NovaGlobalVariables::global.stoc_queue_depth += 1;
+            nova::NovaGlobalVariables::global.stoc_pending_disk_writes += persisted_bytes;
+            nova::NovaGlobalVariables::global.total_disk_writes += persisted_bytes;
+
+            Status s = file_->AppendV(ranges.data(), ranges.size());
+            NOVA_ASSERT(s.ok()) << fmt::format("{}", s.ToString());
+
+            nova::NovaGlobalVariables::global.stoc_queue_depth -= 1;
+            nova::NovaGlobalVariables::global.stoc_pending_disk_writes -= persisted_bytes;
+        }
+        persist_mutex_.unlock();
+        return persisted_bytes;
+    }
+
+    void StoCPersistentFile::MarkSynced(const std::vector<BatchWrite> &writes) {
+        mutex_.lock();
+        MarkPersisted(writes, 0, writes.size());
+        Seal();
+        mutex_.unlock();
+    }
+
+    Status StoCPersistentFile::SyncFiles(
+            const std::vector<StoCPersistentFile *> &files) {
+        std::set<StoCPersistentFile *> synced_files;
+        for (auto file : files) {
+            if (!synced_files.insert(file).second) {
+                continue;
+            }
+            Status s = file->file_->Sync();
+            if (!s.ok()) {
+                NOVA_LOG(rdmaio::WARNING)
+                    << fmt::format("Failed to sync {}: {}",
+                                   file->stoc_file_name_, s.ToString());
+                return s;
+            }
+        }
+        return Status::OK();
+    }
+
     bool
     StoCPersistentFile::DeleteSSTable(uint32_t given_fileid_for_assertion,
                                       const std::string &filename) {
@@ -438,6 +594,7 @@ namespace leveldb {
         }
         NOVA_LOG(rdmaio::DEBUG) << fmt::format("Delete SSTable {} from Stoc File {}.", filename, stoc_file_name_);
         NOVA_ASSERT(file_);
+        CloseIOEngineFds();
         Status s = file_->Close();
         NOVA_ASSERT(s.ok()) << fmt::format("{}", s.ToString());
         delete file_;
@@ -455,6 +612,7 @@ namespace leveldb {
         Seal();
 
         NOVA_ASSERT(file_);
+        CloseIOEngineFds();
         Status s = file_->Close();
         NOVA_ASSERT(s.ok()) << fmt::format("{}", s.ToString());
         delete file_;
@@ -462,6 +620,17 @@ namespace leveldb {
         mutex_.unlock();
     }
 
+    void StoCPersistentFile::CloseIOEngineFds() {
+        if (write_fd_ >= 0) {
+            ::close(write_fd_);
+            write_fd_ = -1;
+        }
+        if (direct_fd_ >= 0) {
+            ::close(direct_fd_);
+            direct_fd_ = -1;
+        }
+    }
+
     void StoCPersistentFile::ForceSeal() {
         mutex_.lock();
         NOVA_ASSERT(allocated_bufs_.empty());
@@ -540,9 +709,21 @@ namespace leveldb {
         return handle;
     }
 
-    static void DeleteCachedBlock(const Slice &key, void *value) {
-        char *block = reinterpret_cast<char *>(value);
-        delete block;
+    namespace {
+        // A cached block. It lives in the RDMA-registered memory of the mem
+        // manager so that it can be written to an LTC without a copy.
+        struct CachedBlock {
+            MemManager *mem_manager;
+            uint64_t key;
+            uint32_t scid;
+            char *buf;
+        };
+
+        void DeleteCachedBlock(const Slice &key, void *value) {
+            CachedBlock *block = reinterpret_cast<CachedBlock *>(value);
+            block->mem_manager->FreeItem(block->key, block->buf, block->scid);
+            delete block;
+        }
     }
 
     bool StocPersistentFileManager::ReadDataBlockForReplication(
@@ -579,34 +760,108 @@ namespace leveldb {
             return true;
         }
 
-        char cache_key_buffer[StoCBlockHandle::HandleSize()];
-        stoc_block_handle.EncodeHandle(cache_key_buffer);
+        // Replication reads each block once.
+        return ReadCachedBlock(stoc_file, offset, size, scratch, result,
+                               Cache::kLowPriority).ok();
+    }
+
+    Status StocPersistentFileManager::ReadCachedBlock(
+            StoCPersistentFile *stoc_file, uint64_t offset, uint32_t size,
+            char *scratch, Slice *result, Cache::Priority priority) {
+        Slice block;
+        Status s;
+        Cache::Handle *cache_handle = PinBlock(stoc_file, offset, size,
+                                               priority, &block, &s);
+        if (cache_handle == nullptr) {
+            if (!s.ok()) {
+                return s;
+            }
+            return stoc_file->Read(offset, size, scratch, result);
+        }
+        memcpy(scratch, block.data(), size);
+        *result = Slice(scratch, size);
+        block_cache_->Release(cache_handle);
+        return s;
+    }
+
+    Cache::Handle *StocPersistentFileManager::PinBlock(
+            StoCPersistentFile *stoc_file, uint64_t offset, uint32_t size,
+            Cache::Priority priority, Slice *block, Status *s) {
+        // StoC file ids are never reused.
+        char cache_key_buffer[16];
+        EncodeFixed32(cache_key_buffer, stoc_file->file_id());
+        EncodeFixed64(cache_key_buffer + 4, offset);
+        EncodeFixed32(cache_key_buffer + 12, size);
         Slice key(cache_key_buffer, sizeof(cache_key_buffer));
-        auto cache_handle = block_cache_->Lookup(key);
+        Cache::Handle *cache_handle = block_cache_->Lookup(key);
         if (cache_handle != nullptr) {
-            auto block = reinterpret_cast<char *>(block_cache_->Value(
+            auto cached = reinterpret_cast<CachedBlock *>(block_cache_->Value(
                     cache_handle));
-            memcpy(scratch, block, stoc_block_handle.size);
-        } else {
-            stoc_file->Read(offset, size, scratch, result);
-            char *block = new char[size];
-            memcpy(block, scratch, size);
-            cache_handle = block_cache_->Insert(key, block,
-                                                size,
-                                                &DeleteCachedBlock);
+            *block = Slice(cached->buf, size);
+            return cache_handle;
+        }
+
+        // Read the block straight into cache memory.
+        uint64_t mem_key = stoc_file->file_id();
+        uint32_t scid = mem_manager_->slabclassid(mem_key, size);
+        char *buf = mem_manager_->ItemAlloc(mem_key, scid);
+        if (buf == nullptr) {
+            return nullptr;
+        }
+        Slice result;
+        *s = stoc_file->Read(offset, size, buf, &result);
+        if (!s->ok() || result.size() != size) {
+            mem_manager_->FreeItem(mem_key, buf, scid);
+            return nullptr;
+        }
+        if (result.data() != buf) {
+            memcpy(buf, result.data(), size);
+        }
+        CachedBlock *cached = new CachedBlock;
+        cached->mem_manager = mem_manager_;
+        cached->key = mem_key;
+        cached->scid = scid;
+        cached->buf = buf;
+        *block = Slice(buf, size);
+        // The handle is valid even if the cache does not admit the block.
+        return block_cache_->Insert(key, cached, size, &DeleteCachedBlock,
+                                    priority);
+    }
+
+    Cache::Handle *StocPersistentFileManager::PinDataBlock(
+            const StoCBlockHandle &stoc_block_handle, uint64_t offset,
+            uint32_t size, Cache::Priority priority, Slice *block) {
+        if (!block_cache_) {
+            return nullptr;
         }
-        block_cache_->Release(cache_handle);
-        return true;
+        StoCPersistentFile *stoc_file = FindStoCFile(stoc_block_handle.stoc_file_id);
+        NOVA_ASSERT(stoc_file) << stoc_block_handle.stoc_file_id;
+        leveldb::FileType type;
+        NOVA_ASSERT(ParseFileName(stoc_file->stoc_file_name_, &type));
+        if (type != leveldb::FileType::kTableFile || !stoc_file->sealed()) {
+            return nullptr;
+        }
+        Status s;
+        Cache::Handle *cache_handle = PinBlock(stoc_file, offset, size,
+                                               priority, block, &s);
+        NOVA_ASSERT(s.ok()) << s.ToString();
+        return cache_handle;
+    }
+
+    void StocPersistentFileManager::ReleaseDataBlock(Cache::Handle *handle) {
+        block_cache_->Release(handle);
     }
 
     void StocPersistentFileManager::ReadDataBlock(
             const leveldb::StoCBlockHandle &stoc_block_handle, uint64_t offset, uint32_t size, char *scratch,
-            Slice *result) {
+            Slice *result, Cache::Priority priority) {
         StoCPersistentFile *stoc_file = FindStoCFile(stoc_block_handle.stoc_file_id);
         NOVA_ASSERT(stoc_file) << stoc_block_handle.stoc_file_id;
-        if (!block_cache_) {
-            leveldb::FileType type;
-            NOVA_ASSERT(ParseFileName(stoc_file->stoc_file_name_, &type));
+        leveldb::FileType type;
+        NOVA_ASSERT(ParseFileName(stoc_file->stoc_file_name_, &type));
+        // Only the blocks of sealed SSTables are immutable.
+        if (!block_cache_ || type != leveldb::FileType::kTableFile ||
+            !stoc_file->sealed()) {
             NOVA_LOG(rdmaio::DEBUG)
                 << fmt::format("Read {} from stoc file {} offset:{} size:{}",
                                stoc_block_handle.DebugString(), stoc_file->file_id(), offset, size);
@@ -627,24 +882,9 @@ namespace leveldb {
             }
             return;
         }
-
-        char cache_key_buffer[StoCBlockHandle::HandleSize()];
-        stoc_block_handle.EncodeHandle(cache_key_buffer);
-        Slice key(cache_key_buffer, sizeof(cache_key_buffer));
-        auto cache_handle = block_cache_->Lookup(key);
-        if (cache_handle != nullptr) {
-            auto block = reinterpret_cast<char *>(block_cache_->Value(
-                    cache_handle));
-            memcpy(scratch, block, stoc_block_handle.size);
-        } else {
-            stoc_file->Read(offset, size, scratch, result);
-            char *block = new char[size];
-            memcpy(block, scratch, size);
-            cache_handle = block_cache_->Insert(key, block,
-                                                size,
-                                                &DeleteCachedBlock);
-        }
-        block_cache_->Release(cache_handle);
+        Status s = ReadCachedBlock(stoc_file, offset, size, scratch, result,
+                                   priority);
+        NOVA_ASSERT(s.ok()) << s.ToString();
     }
 
     void StocPersistentFileManager::OpenStoCFiles(
@@ -659,7 +899,7 @@ namespace leveldb {
                     fileid, env_,
                     fn,
                     mem_manager_,
-                    0, stoc_file_size_);
+                    0, stoc_file_size_, io_engine_, direct_io_);
             stoc_file->ForceSeal();
             NOVA_ASSERT(stoc_files_[fileid] == nullptr)
                 << fmt::format("{} {} {}", fileid, it.first,
@@ -708,7 +948,9 @@ namespace leveldb {
                                                                filename,
                                                                mem_manager_,
                                                                thread_id,
-                                                               file_size);
+                                                               file_size,
+                                                               io_engine_,
+                                                               direct_io_);
         mutex_.lock();
         NOVA_ASSERT(stoc_files_[id] == nullptr);
         stoc_files_[id] = stoc_file;
@@ -747,9 +989,14 @@ namespace leveldb {
             leveldb::Env *env,
             leveldb::MemManager *mem_manager,
             const std::string &stoc_file_path,
-            uint32_t stoc_file_size) :
+            uint32_t stoc_file_size,
+            StoCIOEngine *io_engine,
+            bool direct_io,
+            Cache *block_cache) :
             env_(env), mem_manager_(mem_manager),
             stoc_file_path_(stoc_file_path),
-            stoc_file_size_(stoc_file_size) {
+            stoc_file_size_(stoc_file_size),
+            io_engine_(io_engine), direct_io_(direct_io),
+            block_cache_(block_cache) {
     }
 }
\ No newline at end of file
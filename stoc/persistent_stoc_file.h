@@ -7,21 +7,35 @@
 #ifndef LEVELDB_PERSISTENT_STOC_FILE_H
 #define LEVELDB_PERSISTENT_STOC_FILE_H
 
+#include <functional>
 #include <string>
 #include <list>
 #include <unordered_map>
 
+#include "leveldb/cache.h"
 #include "leveldb/env.h"
 #include "table/format.h"
+#include "stoc/stoc_io_engine.h"
 
 namespace leveldb {
 
     // Persistent StoC file.
     class StoCPersistentFile {
     public:
+        struct BatchWrite {
+            BlockHandle mem_handle = {};
+            uint64_t disk_offset = 0;
+            std::string sstable;
+            FileInternalType internal_type;
+        };
+
+        // Written blocks are persisted through "io_engine" when it is not
+        // nullptr. "direct_io" writes 4KB-aligned ranges with O_DIRECT.
         StoCPersistentFile(uint32_t file_id, Env *env, std::string filename,
                            MemManager *mem_manager,
-                           uint32_t thread_id, uint32_t file_size);
+                           uint32_t thread_id, uint32_t file_size,
+                           StoCIOEngine *io_engine = nullptr,
+                           bool direct_io = false);
 
         Status
         Read(uint64_t offset, uint32_t size, char *scratch, Slice *result);
@@ -31,6 +45,24 @@ namespace leveldb {
 
         uint64_t Persist(uint32_t given_file_id_for_assertion);
 
+        // Persist the written blocks without blocking. "done" is called with
+        // the persisted bytes on the engine thread once they are durable.
+        // Calls on the same file complete in order.
+        // REQUIRES: The file has an io engine.
+        void Persist(uint32_t given_file_id_for_assertion,
+                     std::function<void(uint64_t)> done);
+
+        // Group commit. Write the blocks written to memory without syncing
+        // them and return the number of bytes written. The caller syncs the
+        // files with SyncFiles and then calls MarkSynced with "writes".
+        uint64_t WriteWithoutSync(uint32_t given_file_id_for_assertion,
+                                  std::vector<BatchWrite> *writes);
+
+        void MarkSynced(const std::vector<BatchWrite> &writes);
+
+        // Sync each distinct file once. Returns the first failure.
+        static Status SyncFiles(const std::vector<StoCPersistentFile *> &files);
+
         uint64_t AllocateBuf(const std::string &filename,
                              uint32_t size, FileInternalType internal_type);
 
@@ -72,11 +104,17 @@ namespace leveldb {
             bool persisted = false;
         };
 
-        struct BatchWrite {
-            BlockHandle mem_handle = {};
-            std::string sstable;
-            FileInternalType internal_type;
-        };
+        // Assign disk offsets to the blocks written to memory and move them
+        // to "writes".
+        // REQUIRES: mutex_ is held.
+        void TakeWrittenBufs(std::vector<BatchWrite> *writes);
+
+        // REQUIRES: mutex_ is held.
+        void MarkPersisted(const std::vector<BatchWrite> &writes,
+                           uint32_t begin, uint32_t end);
+
+        void CloseIOEngineFds();
+
 
         Env *env_ = nullptr;
         ReadWriteFile *file_ = nullptr;
@@ -107,6 +145,10 @@ namespace leveldb {
         std::vector<BatchWrite> written_mem_blocks_;
         std::mutex persist_mutex_;
 
+        StoCIOEngine *io_engine_ = nullptr;
+        int write_fd_ = -1;
+        int direct_fd_ = -1;
+
     };
 
     class StocPersistentFileManager {
@@ -114,13 +156,39 @@ namespace leveldb {
         StocPersistentFileManager(Env *env,
                                   MemManager *mem_manager,
                                   const std::string &stoc_file_path,
-                                  uint32_t stoc_file_size);
+                                  uint32_t stoc_file_size,
+                                  StoCIOEngine *io_engine = nullptr,
+                                  bool direct_io = false,
+                                  Cache *block_cache = nullptr);
+
+        // nullptr if StoC files are persisted synchronously.
+        StoCIOEngine *io_engine() const {
+            return io_engine_;
+        }
 
         StoCPersistentFile *FindStoCFile(uint32_t stoc_file_id);
 
+        // Blocks of sealed SSTables are served from the block cache if any.
+        // Background reads insert them with a low priority.
         void
         ReadDataBlock(const StoCBlockHandle &stoc_block_handle, uint64_t offset,
-                      uint32_t size, char *scratch, Slice *result);
+                      uint32_t size, char *scratch, Slice *result,
+                      Cache::Priority priority = Cache::kHighPriority);
+
+        // Pin a block of a sealed SSTable in the block cache. The block lives
+        // in RDMA-registered memory, so it can be written to an LTC without a
+        // copy. A miss reads the block straight into cache memory. Returns
+        // nullptr if the block is not cacheable. Otherwise, the caller must
+        // call ReleaseDataBlock once it no longer uses "block".
+        Cache::Handle *
+        PinDataBlock(const StoCBlockHandle &stoc_block_handle, uint64_t offset,
+                     uint32_t size, Cache::Priority priority, Slice *block);
+
+        void ReleaseDataBlock(Cache::Handle *handle);
+
+        Cache *block_cache() const {
+            return block_cache_;
+        }
 
         bool
         ReadDataBlockForReplication(const StoCBlockHandle &stoc_block_handle,
@@ -137,10 +205,22 @@ namespace leveldb {
 
         std::unordered_map<std::string, leveldb::StoCPersistentFile *> fn_stoc_file_map_;
     private:
+        Status ReadCachedBlock(StoCPersistentFile *stoc_file, uint64_t offset,
+                               uint32_t size, char *scratch, Slice *result,
+                               Cache::Priority priority);
+
+        // Returns nullptr if the block could not be cached. "s" is set if
+        // the read failed.
+        Cache::Handle *PinBlock(StoCPersistentFile *stoc_file, uint64_t offset,
+                                uint32_t size, Cache::Priority priority,
+                                Slice *block, Status *s);
+
         Env *env_ = nullptr;
         MemManager *mem_manager_ = nullptr;
         uint32_t stoc_file_size_ = 0;
         std::string stoc_file_path_;
+        StoCIOEngine *io_engine_ = nullptr;
+        bool direct_io_ = false;
         // 0 is reserved so that read knows to fetch the block from a local file.
         // 1-1000 is reserved for manifest file.
         uint32_t current_manifest_file_stoc_file_id_ = 1;
@@ -0,0 +1,283 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "stoc_io_engine.h"
+
+#include <deque>
+#include <set>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <fmt/core.h>
+
+#include "common/nova_console_logging.h"
+
+namespace leveldb {
+
+    namespace {
+        Status IOError(const std::string &context, int error_number) {
+            return Status::IOError(context, strerror(error_number));
+        }
+    }
+
+    StoCIOEngine::StoCIOEngine(uint32_t queue_depth)
+            : queue_depth_(queue_depth) {
+        NOVA_ASSERT(queue_depth_ > 0);
+        if (!SetupRing(queue_depth_)) {
+            NOVA_LOG(rdmaio::INFO)
+                << fmt::format("io_uring is not available: {}. StoC files are persisted with pwrite.",
+                               strerror(errno));
+        }
+        thread_ = std::thread(&StoCIOEngine::Run, this);
+    }
+
+    StoCIOEngine::~StoCIOEngine() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            shutting_down_ = true;
+        }
+        cv_.notify_one();
+        thread_.join();
+        if (ring_fd_ < 0) {
+            return;
+        }
+        munmap(sqes_, sqes_size_);
+        if (cq_ring_ != sq_ring_) {
+            munmap(cq_ring_, cq_ring_size_);
+        }
+        munmap(sq_ring_, sq_ring_size_);
+        close(ring_fd_);
+    }
+
+    bool StoCIOEngine::SetupRing(uint32_t entries) {
+        io_uring_params p = {};
+        int fd = (int) syscall(__NR_io_uring_setup, entries, &p);
+        if (fd < 0) {
+            return false;
+        }
+        sq_ring_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+            cq_ring_size_ = sq_ring_size_;
+        }
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+
+        void *sq = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sq == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        void *cq = sq;
+        if (!single_mmap) {
+            cq = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cq == MAP_FAILED) {
+                munmap(sq, sq_ring_size_);
+                close(fd);
+                return false;
+            }
+        }
+        void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            if (cq != sq) {
+                munmap(cq, cq_ring_size_);
+            }
+            munmap(sq, sq_ring_size_);
+            close(fd);
+            return false;
+        }
+
+        char *sq_base = reinterpret_cast<char *>(sq);
+        char *cq_base = reinterpret_cast<char *>(cq);
+        sq_ring_ = sq;
+        cq_ring_ = cq;
+        sqes_ = reinterpret_cast<io_uring_sqe *>(sqes);
+        sq_head_ = reinterpret_cast<unsigned *>(sq_base + p.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned *>(sq_base + p.sq_off.tail);
+        sq_mask_ = reinterpret_cast<unsigned *>(sq_base + p.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned *>(sq_base + p.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned *>(cq_base + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(cq_base + p.cq_off.tail);
+        cq_mask_ = reinterpret_cast<unsigned *>(cq_base + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe *>(cq_base + p.cq_off.cqes);
+        ring_fd_ = fd;
+        NOVA_LOG(rdmaio::INFO)
+            << fmt::format("StoC io_uring engine with {} entries", p.sq_entries);
+        return true;
+    }
+
+    void StoCIOEngine::Submit(std::vector<Write> writes,
+                              std::function<void(const Status &)> done) {
+        Request request;
+        request.writes = std::move(writes);
+        request.done = std::move(done);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(std::move(request));
+        }
+        cv_.notify_one();
+    }
+
+    void StoCIOEngine::Run() {
+        while (true) {
+            std::list<Request> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] {
+                    return !queue_.empty() || shutting_down_;
+                });
+                if (queue_.empty()) {
+                    return;
+                }
+                batch.swap(queue_);
+            }
+
+            std::vector<Op> writes;
+            std::set<int> fds;
+            for (const auto &request : batch) {
+                for (const auto &write : request.writes) {
+                    if (write.size == 0) {
+                        continue;
+                    }
+                    Op op = {};
+                    op.fd = write.fd;
+                    op.iov.iov_base = const_cast<char *>(write.data);
+                    op.iov.iov_len = write.size;
+                    op.offset = write.offset;
+                    writes.push_back(op);
+                    fds.insert(write.fd);
+                }
+            }
+            Status s = RunOps(&writes);
+            if (s.ok()) {
+                // One fdatasync per file covers all requests of the batch.
+                std::vector<Op> syncs;
+                for (int fd : fds) {
+                    Op op = {};
+                    op.fd = fd;
+                    syncs.push_back(op);
+                }
+                s = RunOps(&syncs);
+            }
+            for (const auto &request : batch) {
+                request.done(s);
+            }
+        }
+    }
+
+    void StoCIOEngine::PrepareOp(const Op &op, uint64_t user_data) {
+        unsigned tail = *sq_tail_;
+        unsigned index = tail & *sq_mask_;
+        io_uring_sqe *sqe = &sqes_[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->fd = op.fd;
+        sqe->user_data = user_data;
+        if (op.iov.iov_len > 0) {
+            sqe->opcode = IORING_OP_WRITEV;
+            sqe->addr = reinterpret_cast<uint64_t>(&op.iov);
+            sqe->len = 1;
+            sqe->off = op.offset;
+        } else {
+            sqe->opcode = IORING_OP_FSYNC;
+            sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+        }
+        sq_array_[index] = index;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    Status StoCIOEngine::RunOps(std::vector<Op> *ops) {
+        if (ring_fd_ < 0) {
+            return RunOpsSync(ops);
+        }
+        Status s;
+        std::deque<uint32_t> ready;
+        for (uint32_t i = 0; i < ops->size(); i++) {
+            ready.push_back(i);
+        }
+        uint32_t inflight = 0;
+        while ((s.ok() && !ready.empty()) || inflight > 0) {
+            while (s.ok() && !ready.empty() && inflight < queue_depth_) {
+                PrepareOp((*ops)[ready.front()], ready.front());
+                ready.pop_front();
+                inflight++;
+            }
+            // Submit the entries the kernel has not consumed yet.
+            unsigned to_submit = *sq_tail_ -
+                                 __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+            int ret = (int) syscall(__NR_io_uring_enter, ring_fd_, to_submit,
+                                    1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (ret < 0 && errno != EINTR && errno != EAGAIN &&
+                errno != EBUSY) {
+                NOVA_ASSERT(false) << fmt::format("io_uring_enter: {}",
+                                                  strerror(errno));
+            }
+
+            unsigned head = *cq_head_;
+            while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+                const io_uring_cqe &cqe = cqes_[head & *cq_mask_];
+                Op &op = (*ops)[cqe.user_data];
+                inflight--;
+                if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+                    ready.push_back(cqe.user_data);
+                } else if (cqe.res < 0) {
+                    s = IOError(fmt::format("StoC fd {}", op.fd), -cqe.res);
+                } else if (op.iov.iov_len > 0 && cqe.res == 0) {
+                    // A write that makes no progress would be resubmitted
+                    // forever.
+                    s = Status::IOError(fmt::format("StoC fd {}", op.fd),
+                                        "zero-byte write");
+                } else if (op.iov.iov_len > 0 &&
+                           (uint64_t) cqe.res < op.iov.iov_len) {
+                    // Short write. Issue the remainder.
+                    op.iov.iov_base = reinterpret_cast<char *>(op.iov.iov_base) +
+                                      cqe.res;
+                    op.iov.iov_len -= cqe.res;
+                    op.offset += cqe.res;
+                    ready.push_back(cqe.user_data);
+                }
+                head++;
+            }
+            __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        }
+        return s;
+    }
+
+    Status StoCIOEngine::RunOpsSync(std::vector<Op> *ops) {
+        for (auto &op : *ops) {
+            if (op.iov.iov_len == 0) {
+                if (fdatasync(op.fd) != 0) {
+                    return IOError(fmt::format("StoC fd {}", op.fd), errno);
+                }
+                continue;
+            }
+            const char *data = reinterpret_cast<const char *>(op.iov.iov_base);
+            size_t size = op.iov.iov_len;
+            uint64_t offset = op.offset;
+            while (size > 0) {
+                ssize_t n = pwrite(op.fd, data, size, offset);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return IOError(fmt::format("StoC fd {}", op.fd), errno);
+                }
+                if (n == 0) {
+                    return Status::IOError(fmt::format("StoC fd {}", op.fd),
+                                           "zero-byte write");
+                }
+                data += n;
+                size -= n;
+                offset += n;
+            }
+        }
+        return Status::OK();
+    }
+}
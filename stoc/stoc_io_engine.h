@@ -0,0 +1,99 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+// An asynchronous write engine for StoC files.
+// A single engine thread drains all submitted requests as one batch. It issues
+// their writes with io_uring, up to queue_depth in flight, and then one
+// fdatasync per distinct file. Concurrent persist requests therefore share the
+// same sync. It falls back to pwrite/fdatasync when io_uring is unavailable.
+
+#ifndef LEVELDB_STOC_IO_ENGINE_H
+#define LEVELDB_STOC_IO_ENGINE_H
+
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/uio.h>
+
+#include "leveldb/status.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace leveldb {
+
+    class StoCIOEngine {
+    public:
+        struct Write {
+            int fd = -1;
+            const char *data = nullptr;
+            uint64_t size = 0;
+            uint64_t offset = 0;
+        };
+
+        explicit StoCIOEngine(uint32_t queue_depth);
+
+        ~StoCIOEngine();
+
+        // Write all ranges and fdatasync their files. "done" is called on the
+        // engine thread once they are durable. Requests complete in
+        // submission order. "done" must not wait for a later request.
+        void Submit(std::vector<Write> writes,
+                    std::function<void(const Status &)> done);
+
+        bool uses_io_uring() const { return ring_fd_ >= 0; }
+
+    private:
+        struct Request {
+            std::vector<Write> writes;
+            std::function<void(const Status &)> done;
+        };
+
+        struct Op {
+            // Write when iov.iov_len > 0. fdatasync otherwise.
+            int fd;
+            iovec iov;
+            uint64_t offset;
+        };
+
+        void Run();
+
+        // Execute the ops concurrently and wait for all of them.
+        Status RunOps(std::vector<Op> *ops);
+
+        Status RunOpsSync(std::vector<Op> *ops);
+
+        bool SetupRing(uint32_t entries);
+
+        void PrepareOp(const Op &op, uint64_t user_data);
+
+        const uint32_t queue_depth_;
+
+        int ring_fd_ = -1;
+        void *sq_ring_ = nullptr;
+        void *cq_ring_ = nullptr;
+        size_t sq_ring_size_ = 0;
+        size_t cq_ring_size_ = 0;
+        io_uring_sqe *sqes_ = nullptr;
+        size_t sqes_size_ = 0;
+        unsigned *sq_head_ = nullptr;
+        unsigned *sq_tail_ = nullptr;
+        unsigned *sq_mask_ = nullptr;
+        unsigned *sq_array_ = nullptr;
+        unsigned *cq_head_ = nullptr;
+        unsigned *cq_tail_ = nullptr;
+        unsigned *cq_mask_ = nullptr;
+        io_uring_cqe *cqes_ = nullptr;
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::list<Request> queue_;
+        bool shutting_down_ = false;
+        std::thread thread_;
+    };
+}
+
+#endif //LEVELDB_STOC_IO_ENGINE_H
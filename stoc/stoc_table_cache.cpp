@@ -0,0 +1,60 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "stoc_table_cache.h"
+
+#include <stdlib.h>
+#include <fmt/core.h>
+
+#include "db/filename.h"
+#include "common/nova_console_logging.h"
+
+namespace leveldb {
+
+    StoCTableCache::StoCTableCache(const Options &options,
+                                   uint64_t capacity_bytes)
+            : options_(options), cache_(NewLRUCache(capacity_bytes)) {
+    }
+
+    StoCTableCache::~StoCTableCache() {
+        for (auto &it : table_caches_) {
+            delete it.second;
+        }
+        delete cache_;
+    }
+
+    TableCache *StoCTableCache::table_cache(const std::string &dbname) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = table_caches_.find(dbname);
+        if (it != table_caches_.end()) {
+            return it->second;
+        }
+        TableCache *table_cache = new TableCache(dbname, options_, cache_);
+        table_caches_[dbname] = table_cache;
+        return table_cache;
+    }
+
+    void StoCTableCache::Evict(const std::string &filename) {
+        // TableFileName is dbname/<number>-<replica id>.<suffix>.
+        size_t pos = filename.rfind('/');
+        if (pos == std::string::npos) {
+            return;
+        }
+        std::string dbname = filename.substr(0, pos);
+        uint64_t file_number = strtoull(filename.c_str() + pos + 1, nullptr,
+                                        10);
+        TableCache *table_cache = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = table_caches_.find(dbname);
+            if (it == table_caches_.end()) {
+                return;
+            }
+            table_cache = it->second;
+        }
+        table_cache->Evict(file_number, false);
+        NOVA_LOG(rdmaio::DEBUG)
+            << fmt::format("Evict {} from the StoC table cache", filename);
+    }
+}
@@ -0,0 +1,45 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+// A size-bounded cache of the SSTables opened by StoC-side compactions.
+// It is shared by all storage workers so that the input tables of a
+// compaction stay parsed for later compactions, e.g., the other subranges of
+// the same offloaded compaction. Tables are keyed by database name and file
+// number and charged by file size.
+
+#ifndef LEVELDB_STOC_TABLE_CACHE_H
+#define LEVELDB_STOC_TABLE_CACHE_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "db/table_cache.h"
+#include "leveldb/cache.h"
+#include "leveldb/options.h"
+
+namespace leveldb {
+
+    class StoCTableCache {
+    public:
+        StoCTableCache(const Options &options, uint64_t capacity_bytes);
+
+        ~StoCTableCache();
+
+        // Return the table cache of the database. It lives as long as this
+        // object.
+        TableCache *table_cache(const std::string &dbname);
+
+        // Drop the cached tables of an SSTable, e.g., when the LTC deletes it.
+        // "filename" is a name returned by TableFileName.
+        void Evict(const std::string &filename);
+
+    private:
+        const Options options_;
+        Cache *cache_ = nullptr;
+        std::mutex mutex_;
+        std::unordered_map<std::string, TableCache *> table_caches_;
+    };
+}
+
+#endif //LEVELDB_STOC_TABLE_CACHE_H
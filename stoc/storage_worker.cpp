@@ -18,6 +18,12 @@
 #include "db/version_set.h"
 
 namespace nova {
+    struct StorageWorker::PersistCompletion {
+        StorageTask task;
+        ServerCompleteTask ct;
+        uint64_t persisted_bytes = 0;
+    };
+
     StorageWorker::StorageWorker(
             leveldb::StocPersistentFileManager *stoc_file_manager,
             std::vector<RDMAServerImpl *> &rdma_servers,
@@ -25,12 +31,14 @@ namespace nova {
             const leveldb::Options &options,
             leveldb::StoCClient *client,
             leveldb::MemManager *mem_manager,
-            uint64_t thread_id, leveldb::Env *env)
+            uint64_t thread_id, leveldb::Env *env,
+            leveldb::StoCTableCache *table_cache)
             : stoc_file_manager_(
             stoc_file_manager), rdma_servers_(rdma_servers), user_comparator_(
             user_comparator), options_(options), icmp_(user_comparator),
               client_(client),
-              mem_manager_(mem_manager), thread_id_(thread_id), env_(env) {
+              mem_manager_(mem_manager), thread_id_(thread_id), env_(env),
+              table_cache_(table_cache) {
         stat_tasks_ = 0;
         stat_read_bytes_ = 0;
         stat_write_bytes_ = 0;
@@ -114,6 +122,120 @@ namespace nova {
         return replication_results;
     }
 
+    ServerCompleteTask StorageWorker::NewCompleteTask(const StorageTask &task) {
+        ServerCompleteTask ct = {};
+        ct.remote_server_id = task.remote_server_id;
+        ct.stoc_req_id = task.stoc_req_id;
+        ct.request_type = task.request_type;
+        ct.rdma_buf = task.rdma_buf;
+        ct.ltc_mr_offset = task.ltc_mr_offset;
+        ct.stoc_block_handle = task.stoc_block_handle;
+        return ct;
+    }
+
+    void StorageWorker::GroupCommitPersists(
+            std::vector<StorageTask> *tasks,
+            std::map<uint32_t, std::vector<ServerCompleteTask>> *t_tasks) {
+        if (stoc_file_manager_->io_engine()) {
+            // The io engine already shares syncs across pending requests.
+            return;
+        }
+        std::vector<StorageTask> persists;
+        std::vector<StorageTask> others;
+        for (auto &task : *tasks) {
+            if (task.request_type == leveldb::StoCRequestType::STOC_PERSIST) {
+                persists.push_back(task);
+            } else {
+                others.push_back(task);
+            }
+        }
+        if (persists.size() < 2) {
+            return;
+        }
+
+        // Write all SSTables first and then sync each device once.
+        std::vector<std::vector<leveldb::StoCPersistentFile::BatchWrite>> writes(
+                persists.size());
+        std::vector<leveldb::StoCPersistentFile *> written_files;
+        for (int i = 0; i < persists.size(); i++) {
+            NOVA_ASSERT(persists[i].persist_pairs.size() == 1);
+            const auto &pair = persists[i].persist_pairs[0];
+            leveldb::StoCPersistentFile *stoc_file = stoc_file_manager_->FindStoCFile(
+                    pair.stoc_file_id);
+            uint64_t written_bytes = stoc_file->WriteWithoutSync(
+                    pair.stoc_file_id, &writes[i]);
+            stat_write_bytes_ += written_bytes;
+            if (written_bytes > 0) {
+                written_files.push_back(stoc_file);
+            }
+        }
+        leveldb::Status s = leveldb::StoCPersistentFile::SyncFiles(
+                written_files);
+        if (s.ok()) {
+            for (int i = 0; i < persists.size(); i++) {
+                const auto &pair = persists[i].persist_pairs[0];
+                stoc_file_manager_->FindStoCFile(pair.stoc_file_id)->MarkSynced(
+                        writes[i]);
+            }
+        }
+        for (auto &task : persists) {
+            stat_tasks_ += 1;
+            ServerCompleteTask ct = NewCompleteTask(task);
+            // A failed sync fails every persist in the group. The response
+            // then carries no block handles.
+            if (s.ok()) {
+                CompletePersist(task, &ct);
+            }
+            (*t_tasks)[task.rdma_server_thread_id].push_back(ct);
+        }
+        NOVA_LOG(DEBUG) << fmt::format(
+                    "storage[{}]: Group committed {} persist requests on {} files",
+                    thread_id_, persists.size(), written_files.size());
+        tasks->swap(others);
+    }
+
+    void StorageWorker::PersistAsync(const StorageTask &task,
+                                     const ServerCompleteTask &ct) {
+        const auto &pair = task.persist_pairs[0];
+        leveldb::StoCPersistentFile *stoc_file = stoc_file_manager_->FindStoCFile(
+                pair.stoc_file_id);
+        stoc_file->Persist(pair.stoc_file_id,
+                           [this, task, ct](uint64_t persisted_bytes) {
+                               PersistCompletion completion = {};
+                               completion.task = task;
+                               completion.ct = ct;
+                               completion.persisted_bytes = persisted_bytes;
+                               mutex_.lock();
+                               persisted_.push_back(completion);
+                               mutex_.unlock();
+                               sem_post(&sem_);
+                           });
+    }
+
+    void StorageWorker::CompletePersist(const StorageTask &task,
+                                        ServerCompleteTask *ct) {
+        leveldb::FileType type = leveldb::FileType::kCurrentFile;
+        for (auto &pair : task.persist_pairs) {
+            leveldb::StoCPersistentFile *stoc_file = stoc_file_manager_->FindStoCFile(
+                    pair.stoc_file_id);
+            NOVA_LOG(DEBUG) << fmt::format(
+                        "Persisting stoc file {} for sstable {}",
+                        pair.stoc_file_id, pair.sstable_name);
+
+            leveldb::BlockHandle h = stoc_file->Handle(pair.sstable_name, task.internal_type);
+            leveldb::StoCBlockHandle rh = {};
+            rh.server_id = NovaConfig::config->my_server_id;
+            rh.stoc_file_id = pair.stoc_file_id;
+            rh.offset = h.offset();
+            rh.size = h.size();
+            ct->stoc_block_handles.push_back(rh);
+            NOVA_ASSERT(leveldb::ParseFileName(pair.sstable_name, &type));
+            if (type == leveldb::FileType::kTableFile) {
+                stoc_file->ForceSeal();
+            }
+        }
+    }
+
     void StorageWorker::Start() {
         NOVA_LOG(DEBUG) << "CC server worker started";
 
@@ -123,6 +245,7 @@ namespace nova {
             sem_wait(&sem_);
 
             std::vector<StorageTask> tasks;
+            std::list<PersistCompletion> persisted;
             mutex_.lock();
 
             while (!queue_.empty()) {
@@ -130,68 +253,100 @@ namespace nova {
                 tasks.push_back(task);
                 queue_.pop_front();
             }
+            persisted.swap(persisted_);
             mutex_.unlock();
 
-            if (tasks.empty()) {
+            if (tasks.empty() && persisted.empty()) {
                 continue;
             }
 
             std::map<uint32_t, std::vector<ServerCompleteTask>> t_tasks;
+            for (auto &completion : persisted) {
+                stat_write_bytes_ += completion.persisted_bytes;
+                CompletePersist(completion.task, &completion.ct);
+                t_tasks[completion.task.rdma_server_thread_id].push_back(
+                        completion.ct);
+            }
+            GroupCommitPersists(&tasks, &t_tasks);
             for (auto &task : tasks) {
                 stat_tasks_ += 1;
-                ServerCompleteTask ct = {};
-                ct.remote_server_id = task.remote_server_id;
-                ct.stoc_req_id = task.stoc_req_id;
-                ct.request_type = task.request_type;
-                ct.rdma_buf = task.rdma_buf;
-                ct.ltc_mr_offset = task.ltc_mr_offset;
-                ct.stoc_block_handle = task.stoc_block_handle;
+                ServerCompleteTask ct = NewCompleteTask(task);
 
                 if (task.request_type ==
                     leveldb::StoCRequestType::STOC_READ_BLOCKS) {
-                    leveldb::Slice result;
-                    stoc_file_manager_->ReadDataBlock(task.stoc_block_handle,
-                                                      task.stoc_block_handle.offset,
-                                                      task.stoc_block_handle.size,
-                                                      task.rdma_buf, &result);
-                    ct.size = result.size();
-                    NOVA_ASSERT(result.size() <= task.stoc_block_handle.size);
+                    leveldb::Cache::Priority priority = task.is_foreground_read
+                                                        ? leveldb::Cache::kHighPriority
+                                                        : leveldb::Cache::kLowPriority;
+                    if (task.rdma_buf == nullptr) {
+                        // Write the cached block to the LTC directly.
+                        const auto &handle = task.read_block_handles[0];
+                        leveldb::Slice block;
+                        ct.block_cache_handle = stoc_file_manager_->PinDataBlock(
+                                handle, handle.offset, handle.size, priority,
+                                &block);
+                        if (ct.block_cache_handle) {
+                            ct.rdma_buf = const_cast<char *>(block.data());
+                            ct.size = block.size();
+                            stat_read_bytes_ += task.stoc_block_handle.size;
+                            t_tasks[task.rdma_server_thread_id].push_back(ct);
+                            continue;
+                        }
+                        uint32_t scid = mem_manager_->slabclassid(
+                                task.rdma_server_thread_id, handle.size);
+                        task.rdma_buf = mem_manager_->ItemAlloc(
+                                task.rdma_server_thread_id, scid);
+                        NOVA_ASSERT(task.rdma_buf);
+                        ct.rdma_buf = task.rdma_buf;
+                    }
+                    // Coalesced blocks are read into consecutive ranges of
+                    // the buffer.
+                    uint32_t offset = 0;
+                    for (int i = 0; i < task.read_block_handles.size(); i++) {
+                        const auto &handle = task.read_block_handles[i];
+                        leveldb::Slice result;
+                        stoc_file_manager_->ReadDataBlock(handle,
+                                                          handle.offset,
+                                                          handle.size,
+                                                          task.rdma_buf + offset,
+                                                          &result,
+                                                          priority);
+                        NOVA_ASSERT(result.size() <= handle.size);
+                        NOVA_ASSERT(i == task.read_block_handles.size() - 1 ||
+                                    result.size() == handle.size);
+                        ct.size = offset + result.size();
+                        offset += handle.size;
+                    }
                     stat_read_bytes_ += task.stoc_block_handle.size;
                 } else if (task.request_type ==
                            leveldb::StoCRequestType::STOC_PERSIST) {
                     NOVA_ASSERT(task.persist_pairs.size() == 1);
-                    leveldb::FileType type = leveldb::FileType::kCurrentFile;
+                    if (stoc_file_manager_->io_engine()) {
+                        PersistAsync(task, ct);
+                        continue;
+                    }
                     for (auto &pair : task.persist_pairs) {
                         leveldb::StoCPersistentFile *stoc_file = stoc_file_manager_->FindStoCFile(
                                 pair.stoc_file_id);
                         uint64_t persisted_bytes = stoc_file->Persist(
                                 pair.stoc_file_id);
                         stat_write_bytes_ += persisted_bytes;
-                        NOVA_LOG(DEBUG) << fmt::format(
-                                    "Persisting stoc file {} for sstable {}",
-                                    pair.stoc_file_id, pair.sstable_name);
-
-                        leveldb::BlockHandle h = stoc_file->Handle(pair.sstable_name, task.internal_type);
-                        leveldb::StoCBlockHandle rh = {};
-                        rh.server_id = NovaConfig::config->my_server_id;
-                        rh.stoc_file_id = pair.stoc_file_id;
-                        rh.offset = h.offset();
-                        rh.size = h.size();
-                        ct.stoc_block_handles.push_back(rh);
-                        NOVA_ASSERT(leveldb::ParseFileName(pair.sstable_name, &type));
-                        if (type == leveldb::FileType::kTableFile) {
-                            stoc_file->ForceSeal();
-                        }
                     }
+                    CompletePersist(task, &ct);
                 } else if (task.request_type ==
                            leveldb::StoCRequestType::STOC_REPLICATE_SSTABLES) {
                     ct.replication_results = ReplicateSSTables(task.dbname, task.replication_pairs);
                 } else if (task.request_type ==
                            leveldb::StoCRequestType::STOC_COMPACTION) {
-                    leveldb::TableCache table_cache(
-                            task.compaction_request->dbname, options_, 0,
-                            nullptr);
-                    leveldb::VersionFileMap version_files(&table_cache);
+                    leveldb::TableCache *table_cache = nullptr;
+                    if (table_cache_) {
+                        table_cache = table_cache_->table_cache(
+                                task.compaction_request->dbname);
+                    } else {
+                        table_cache = new leveldb::TableCache(
+                                task.compaction_request->dbname, options_, 0,
+                                nullptr);
+                    }
+                    leveldb::VersionFileMap version_files(table_cache);
                     leveldb::Compaction *compaction = new leveldb::Compaction(
                             &version_files, &icmp_, &options_,
                             task.compaction_request->source_level,
@@ -216,6 +371,9 @@ namespace nova {
                     leveldb::CompactionState *state = new leveldb::CompactionState(
                             compaction, &srs,
                             task.compaction_request->smallest_snapshot);
+                    state->bottommost = task.compaction_request->bottommost;
+                    state->range_tombstones = task.compaction_request->range_tombstones;
+                    state->obsolete_range_tombstones = task.compaction_request->obsolete_range_tombstones;
                     std::function<uint64_t(void)> fn_generator = []() {
                         uint32_t fn = storage_file_number_seq.fetch_add(1);
                         uint64_t stocid = nova::NovaConfig::config->my_server_id + 1;
@@ -225,7 +383,14 @@ namespace nova {
                         std::vector<const leveldb::FileMetaData *> files;
                         for (int which = 0; which < 2; which++) {
                             for (int i = 0; i < compaction->num_input_files(which); i++) {
-                                files.push_back(compaction->input(which, i));
+                                const leveldb::FileMetaData *meta = compaction->input(which, i);
+                                // Metadata of tables opened by an earlier compaction is already local.
+                                if (table_cache_ && env_->FileExists(
+                                        leveldb::TableFileName(task.compaction_request->dbname, meta->number,
+                                                               leveldb::FileInternalType::kFileData, 0))) {
+                                    continue;
+                                }
+                                files.push_back(meta);
                             }
                         }
                         FetchMetadataFilesInParallel(files,
@@ -237,16 +402,19 @@ namespace nova {
                     leveldb::CompactionJob job(fn_generator, env_,
                                                task.compaction_request->dbname,
                                                user_comparator_,
-                                               options_, this, &table_cache);
+                                               options_, this, table_cache);
                     NOVA_LOG(rdmaio::DEBUG)
                         << fmt::format("storage[{}]: {}", thread_id_, compaction->DebugString(user_comparator_));
-                    auto it = compaction->MakeInputIterator(&table_cache, this);
+                    auto it = compaction->MakeInputIterator(table_cache, this);
                     leveldb::CompactionStats stats = state->BuildStats();
                     job.CompactTables(state, it, &stats, true,
                                       leveldb::CompactInputType::kCompactInputSSTables,
                                       leveldb::CompactOutputType::kCompactOutputSSTables);
                     ct.compaction_state = state;
                     ct.compaction_request = task.compaction_request;
+                    if (!table_cache_) {
+                        delete table_cache;
+                    }
                 } else {
                     NOVA_ASSERT(false);
                 }
@@ -16,6 +16,7 @@
 #include "common/nova_mem_manager.h"
 #include "log/stoc_log_manager.h"
 #include "stoc/persistent_stoc_file.h"
+#include "stoc/stoc_table_cache.h"
 #include "novalsm/rdma_server.h"
 
 namespace nova {
@@ -35,7 +36,8 @@ namespace nova {
                       leveldb::StoCClient *client,
                       leveldb::MemManager *mem_manager,
                       uint64_t thread_id,
-                      leveldb::Env *env);
+                      leveldb::Env *env,
+                      leveldb::StoCTableCache *table_cache = nullptr);
 
         void AddTask(const StorageTask &task);
 
@@ -79,6 +81,24 @@ namespace nova {
         uint64_t stat_read_bytes_ = 0;
         uint64_t stat_write_bytes_ = 0;
     private:
+        struct PersistCompletion;
+
+        // Persist through the io engine. The response is sent once the
+        // engine hands the completion back to this worker.
+        void PersistAsync(const StorageTask &task,
+                          const ServerCompleteTask &ct);
+
+        static ServerCompleteTask NewCompleteTask(const StorageTask &task);
+
+        // Persist all STOC_PERSIST tasks of a drained batch with one sync per
+        // device and remove them from "tasks". No-op for a single task.
+        void GroupCommitPersists(
+                std::vector<StorageTask> *tasks,
+                std::map<uint32_t, std::vector<ServerCompleteTask>> *t_tasks);
+
+        // Fill the StoC block handles of a persisted request.
+        void CompletePersist(const StorageTask &task, ServerCompleteTask *ct);
+
         leveldb::StocPersistentFileManager *stoc_file_manager_;
         std::vector<RDMAServerImpl *> rdma_servers_;
 
@@ -90,11 +110,15 @@ namespace nova {
 
         leveldb::StoCClient *client_;
         leveldb::MemManager *mem_manager_;
+        // Shared by the storage workers. nullptr if each compaction opens
+        // its input tables with a private table cache.
+        leveldb::StoCTableCache *table_cache_ = nullptr;
         uint64_t thread_id_;
         unsigned int rand_seed_ = 0;
 
         std::mutex mutex_;
         std::list<StorageTask> queue_;
+        std::list<PersistCompletion> persisted_;
         sem_t sem_;
     };
 }
@@ -13,6 +13,7 @@
 #include "leveldb/comparator.h"
 #include "table/format.h"
 #include "util/coding.h"
+#include "util/hash.h"
 #include "util/logging.h"
 #include "db/dbformat.h"
 #include "common/nova_common.h"
@@ -20,8 +21,7 @@
 namespace leveldb {
 
     inline uint32_t Block::NumRestarts() const {
-        assert(size_ >= sizeof(uint32_t));
-        return DecodeFixed32(data_ + size_ - sizeof(uint32_t));
+        return num_restarts_;
     }
 
     Block::Block(const BlockContents &contents, uint64_t file_number,
@@ -31,19 +31,39 @@ namespace leveldb {
               data_(contents.data.data()),
               size_(contents.data.size()),
               owned_(contents.heap_allocated), adhoc_(adhoc) {
-        if (size_ < sizeof(uint32_t)) {
+        if (!ParseFooter()) {
             size_ = 0;  // Error marker
-        } else {
-            size_t max_restarts_allowed =
-                    (size_ - sizeof(uint32_t)) / sizeof(uint32_t);
-            if (NumRestarts() > max_restarts_allowed) {
-                // The size is too small for NumRestarts()
-                size_ = 0;
-            } else {
-                restart_offset_ =
-                        size_ - (1 + NumRestarts()) * sizeof(uint32_t);
+        }
+    }
+
+    bool Block::ParseFooter() {
+        if (size_ < sizeof(uint32_t)) {
+            return false;
+        }
+        uint32_t footer = DecodeFixed32(data_ + size_ - sizeof(uint32_t));
+        size_t restarts_end = size_ - sizeof(uint32_t);
+        num_restarts_ = footer & ~kBlockHashIndexFlag;
+        if (footer & kBlockHashIndexFlag) {
+            if (restarts_end < sizeof(uint16_t)) {
+                return false;
+            }
+            restarts_end -= sizeof(uint16_t);
+            const uint8_t *p = reinterpret_cast<const uint8_t *>(data_) +
+                               restarts_end;
+            num_hash_buckets_ = p[0] | (static_cast<uint32_t>(p[1]) << 8);
+            if (num_hash_buckets_ == 0 || restarts_end < num_hash_buckets_) {
+                return false;
             }
+            restarts_end -= num_hash_buckets_;
+            hash_buckets_ = reinterpret_cast<const uint8_t *>(data_) +
+                            restarts_end;
+        }
+        if (num_restarts_ > restarts_end / sizeof(uint32_t)) {
+            // The size is too small for NumRestarts()
+            return false;
         }
+        restart_offset_ = restarts_end - num_restarts_ * sizeof(uint32_t);
+        return true;
     }
 
     Block::~Block() {
@@ -94,6 +114,8 @@ namespace leveldb {
         const char *const data_;       // underlying block contents
         uint32_t const restarts_;      // Offset of restart array (list of fixed32)
         uint32_t const num_restarts_;  // Number of uint32_t entries in restart array
+        const uint8_t *const hash_buckets_;  // nullptr without a hash index
+        uint32_t const num_hash_buckets_;
 
         // current_ is offset in data_ of current entry.  >= restarts_ if !Valid
         uint32_t current_;
@@ -129,11 +151,14 @@ namespace leveldb {
 
     public:
         Iter(const Comparator *comparator, const char *data, uint32_t restarts,
-             uint32_t num_restarts)
+             uint32_t num_restarts, const uint8_t *hash_buckets,
+             uint32_t num_hash_buckets)
                 : comparator_(comparator),
                   data_(data),
                   restarts_(restarts),
                   num_restarts_(num_restarts),
+                  hash_buckets_(hash_buckets),
+                  num_hash_buckets_(num_hash_buckets),
                   current_(restarts_),
                   restart_index_(num_restarts_) {
             assert(num_restarts_ > 0);
@@ -242,6 +267,38 @@ namespace leveldb {
             }
         }
 
+        void SeekForGet(const Slice &target) override {
+            if (hash_buckets_ == nullptr) {
+                Seek(target);
+                return;
+            }
+            Slice user_key = ExtractUserKey(target);
+            uint8_t entry = hash_buckets_[
+                    Hash(user_key.data(), user_key.size(), 0) %
+                    num_hash_buckets_];
+            if (entry == kBlockHashNoEntry) {
+                // The block does not contain the user key.
+                seeked_ = true;
+                current_ = restarts_;
+                restart_index_ = num_restarts_;
+                key_.clear();
+                value_.clear();
+                return;
+            }
+            if (entry == kBlockHashCollision || entry >= num_restarts_) {
+                Seek(target);
+                return;
+            }
+            seeked_ = true;
+            // All entries before the restart point have smaller user keys.
+            SeekToRestartPoint(entry);
+            while (ParseNextKey()) {
+                if (Compare(key_, target) >= 0) {
+                    return;
+                }
+            }
+        }
+
         void SeekToFirst() override {
             seeked_ = true;
             SeekToRestartPoint(0);
@@ -304,7 +361,8 @@ namespace leveldb {
         if (num_restarts == 0) {
             return NewEmptyIterator();
         } else {
-            return new Iter(comparator, data_, restart_offset_, num_restarts);
+            return new Iter(comparator, data_, restart_offset_, num_restarts,
+                            hash_buckets_, num_hash_buckets_);
         }
     }
 
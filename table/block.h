@@ -41,12 +41,19 @@ namespace leveldb {
 
         uint32_t NumRestarts() const;
 
+        // Parse the hash index and the restart array. Returns false if the
+        // block is corrupted.
+        bool ParseFooter();
+
         const uint64_t file_number_;
         const uint64_t block_id_;
 
         const char *data_;
         size_t size_;
         uint32_t restart_offset_;  // Offset in data_ of restart array
+        uint32_t num_restarts_ = 0;
+        const uint8_t *hash_buckets_ = nullptr;  // nullptr without a hash index
+        uint32_t num_hash_buckets_ = 0;
         bool owned_;               // Block owns data_[]
         bool adhoc_;
     };
@@ -25,6 +25,15 @@
 //     restarts: uint32[num_restarts]
 //     num_restarts: uint32
 // restarts[i] contains the offset within the block of the ith restart point.
+//
+// A block built with a hash index appends it after the restart array:
+//     buckets: uint8[num_buckets]
+//     num_buckets: uint16
+//     num_restarts | kBlockHashIndexFlag: uint32
+// A bucket holds the restart index of the user keys hashed to it,
+// kBlockHashNoEntry if there is none, or kBlockHashCollision if they are in
+// different restart intervals. Blocks with more than kBlockHashMaxRestarts
+// restarts are written without the index.
 
 #include "table/block_builder.h"
 
@@ -33,13 +42,17 @@
 #include <algorithm>
 
 #include "leveldb/comparator.h"
+#include "db/dbformat.h"
 #include "leveldb/options.h"
+#include "table/format.h"
 #include "util/coding.h"
+#include "util/hash.h"
 
 namespace leveldb {
 
-    BlockBuilder::BlockBuilder(const Options *options)
-            : options_(options), restarts_(), counter_(0), finished_(false) {
+    BlockBuilder::BlockBuilder(const Options *options, bool hash_index)
+            : options_(options), hash_index_(hash_index), restarts_(),
+              counter_(0), finished_(false) {
         assert(options->block_restart_interval >= 1);
         restarts_.push_back(0);  // First restart point is at offset 0
     }
@@ -51,12 +64,19 @@ namespace leveldb {
         counter_ = 0;
         finished_ = false;
         last_key_.clear();
+        hash_entries_.clear();
     }
 
     size_t BlockBuilder::CurrentSizeEstimate() const {
-        return (buffer_.size() +                       // Raw data buffer
-                restarts_.size() * sizeof(uint32_t) +  // Restart array
-                sizeof(uint32_t));                     // Restart array length
+        size_t estimate = buffer_.size() +                      // Raw data buffer
+                          restarts_.size() * sizeof(uint32_t) +  // Restart array
+                          sizeof(uint32_t);                      // Restart array length
+        if (hash_index_) {
+            estimate += hash_entries_.size() /
+                        options_->data_block_hash_index_util_ratio +
+                        sizeof(uint16_t);
+        }
+        return estimate;
     }
 
     Slice BlockBuilder::Finish() {
@@ -64,11 +84,38 @@ namespace leveldb {
         for (size_t i = 0; i < restarts_.size(); i++) {
             PutFixed32(&buffer_, restarts_[i]);
         }
-        PutFixed32(&buffer_, restarts_.size());
+        if (hash_index_ && !hash_entries_.empty() &&
+            restarts_.size() <= kBlockHashMaxRestarts) {
+            AppendHashIndex();
+        } else {
+            PutFixed32(&buffer_, restarts_.size());
+        }
         finished_ = true;
         return Slice(buffer_);
     }
 
+    void BlockBuilder::AppendHashIndex() {
+        uint32_t num_buckets = static_cast<uint32_t>(
+                hash_entries_.size() /
+                options_->data_block_hash_index_util_ratio);
+        num_buckets = std::max(num_buckets, 1u);
+        num_buckets = std::min(num_buckets, 0xffffu);
+        std::string buckets(num_buckets, static_cast<char>(kBlockHashNoEntry));
+        for (const auto &entry : hash_entries_) {
+            uint8_t &bucket = reinterpret_cast<uint8_t &>(
+                    buckets[entry.first % num_buckets]);
+            if (bucket == kBlockHashNoEntry) {
+                bucket = entry.second;
+            } else if (bucket != entry.second) {
+                bucket = kBlockHashCollision;
+            }
+        }
+        buffer_.append(buckets);
+        buffer_.push_back(static_cast<char>(num_buckets & 0xff));
+        buffer_.push_back(static_cast<char>(num_buckets >> 8));
+        PutFixed32(&buffer_, restarts_.size() | kBlockHashIndexFlag);
+    }
+
     void BlockBuilder::Add(const Slice &key, const Slice &value) {
         Slice last_key_piece(last_key_);
         assert(!finished_);
@@ -104,6 +151,17 @@ namespace leveldb {
         last_key_.append(key.data() + shared, non_shared);
         assert(Slice(last_key_) == key);
         counter_++;
+
+        if (hash_index_ && restarts_.size() <= kBlockHashMaxRestarts) {
+            Slice user_key = ExtractUserKey(key);
+            uint8_t restart_index = restarts_.size() - 1;
+            uint32_t h = Hash(user_key.data(), user_key.size(), 0);
+            // The versions of a user key are adjacent.
+            if (hash_entries_.empty() || hash_entries_.back().first != h ||
+                hash_entries_.back().second != restart_index) {
+                hash_entries_.emplace_back(h, restart_index);
+            }
+        }
     }
 
 }  // namespace leveldb
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 
+#include <utility>
 #include <vector>
 
 #include "leveldb/slice.h"
@@ -17,7 +18,9 @@ namespace leveldb {
 
     class BlockBuilder {
     public:
-        explicit BlockBuilder(const Options *options);
+        // If "hash_index" is true, the block ends with a hash index from the
+        // user keys of its internal keys to their restart points.
+        explicit BlockBuilder(const Options *options, bool hash_index = false);
 
         BlockBuilder(const BlockBuilder &) = delete;
 
@@ -43,7 +46,12 @@ namespace leveldb {
         bool empty() const { return buffer_.empty(); }
 
     private:
+        void AppendHashIndex();
+
         const Options *options_;
+        const bool hash_index_;
+        // Hash of the user key and restart index of each entry.
+        std::vector<std::pair<uint32_t, uint8_t>> hash_entries_;
         std::string buffer_;              // Destination buffer
         std::vector<uint32_t> restarts_;  // Restart points
         int counter_;                     // Number of entries emitted since restart
@@ -0,0 +1,193 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "table/block_readahead.h"
+
+#include <algorithm>
+
+#include "common/nova_common.h"
+#include "leveldb/table.h"
+#include "table/format.h"
+
+namespace leveldb {
+
+    namespace {
+        const uint32_t kInitialReadaheadBlocks = 2;
+
+        bool SameBlock(const StoCBlockHandle &a, const StoCBlockHandle &b) {
+            return a.server_id == b.server_id &&
+                   a.stoc_file_id == b.stoc_file_id &&
+                   a.offset == b.offset && a.size == b.size;
+        }
+
+        // Returns true if "b" immediately follows "a" in the same StoC file.
+        bool IsNextBlock(const StoCBlockHandle &a, const StoCBlockHandle &b) {
+            return a.server_id == b.server_id &&
+                   a.stoc_file_id == b.stoc_file_id &&
+                   b.offset == a.offset + a.size + kBlockTrailerSize;
+        }
+    }
+
+    BlockReadahead::BlockReadahead(Table *table, BlockReadContext context,
+                                   const ReadOptions &options,
+                                   uint32_t fixed_blocks, uint32_t max_blocks)
+            : table_(table), context_(context), options_(options),
+              fixed_blocks_(fixed_blocks), max_blocks_(max_blocks) {
+        file_ = reinterpret_cast<StoCRandomAccessFileClient *>(table->file());
+        index_ = table_->NewIndexIterator(context_, options_);
+    }
+
+    BlockReadahead::~BlockReadahead() {
+        Drain();
+        delete index_;
+    }
+
+    Iterator *BlockReadahead::Read(const StoCBlockHandle &handle) {
+        if (slots_.empty()) {
+            return nullptr;
+        }
+        Slot *slot = slots_.front();
+        if (!SameBlock(slot->handle, handle)) {
+            Drain();
+            return nullptr;
+        }
+        slots_.pop_front();
+        Iterator *iter = slot->cached;
+        if (iter == nullptr) {
+            Wait(slot);
+            uint32_t n = handle.size + kBlockTrailerSize;
+            NOVA_ASSERT(nova::IsRDMAWRITEComplete(slot->backing_mem, n));
+            // Parse the block in place. The RDMA buffer is freed with the
+            // iterator. Compactions do not fill the cache. See
+            // Table::DataBlockReader.
+            iter = table_->NewDataBlock(options_, handle,
+                                        Slice(slot->backing_mem, n),
+                                        Cache::kLowPriority);
+            iter->RegisterCleanup(&BlockReadahead::FreeSlot, slot, nullptr);
+        } else {
+            Free(slot);
+        }
+        last_ = handle;
+        has_last_ = true;
+        hits_ += 1;
+        if (fixed_blocks_ == 0 && hits_ >= window_ && window_ < max_blocks_) {
+            window_ = std::min(window_ * 2, max_blocks_);
+            hits_ = 0;
+        }
+        Fill();
+        return iter;
+    }
+
+    void BlockReadahead::Prefetch(const StoCBlockHandle &handle,
+                                  Iterator *block) {
+        bool sequential = has_last_ && IsNextBlock(last_, handle);
+        last_ = handle;
+        has_last_ = true;
+        hits_ = 0;
+        window_ = 0;
+        if (!file_->IsRemoteRead(handle)) {
+            return;
+        }
+        if (fixed_blocks_ > 0) {
+            window_ = fixed_blocks_;
+        } else if (sequential) {
+            window_ = std::min(kInitialReadaheadBlocks, max_blocks_);
+        } else {
+            return;
+        }
+        // Position the index at the block after "handle". The index entry of
+        // a block is the first entry whose key is at least the first key of
+        // the block.
+        block->SeekToFirst();
+        if (!block->Valid()) {
+            window_ = 0;
+            return;
+        }
+        index_->Seek(block->key());
+        if (!index_->Valid()) {
+            window_ = 0;
+            return;
+        }
+        StoCBlockHandle index_handle = {};
+        index_handle.DecodeHandle(index_->value().data());
+        table_->ResolveDataBlockHandle(&index_handle);
+        if (!SameBlock(index_handle, handle)) {
+            window_ = 0;
+            return;
+        }
+        index_->Next();
+        Fill();
+    }
+
+    void BlockReadahead::Fill() {
+        while (window_ > 0 && slots_.size() < window_ && index_->Valid()) {
+            StoCBlockHandle handle = {};
+            handle.DecodeHandle(index_->value().data());
+            table_->ResolveDataBlockHandle(&handle);
+            if (!file_->IsRemoteRead(handle)) {
+                // E.g., a degraded read. Read it when the iterator reaches it.
+                window_ = 0;
+                return;
+            }
+            Slot *slot = new Slot;
+            slot->handle = handle;
+            slot->mem_manager = options_.mem_manager;
+            slot->thread_id = options_.thread_id;
+            slot->cached = table_->CachedDataBlock(handle);
+            if (slot->cached == nullptr) {
+                uint32_t n = handle.size + kBlockTrailerSize;
+                slot->scid = options_.mem_manager->slabclassid(
+                        options_.thread_id, n);
+                slot->backing_mem = options_.mem_manager->ItemAlloc(
+                        options_.thread_id, slot->scid);
+                if (slot->backing_mem == nullptr) {
+                    // Out of RDMA memory. Try again after the iterator
+                    // consumes a block.
+                    delete slot;
+                    return;
+                }
+                sem_init(&slot->done, 0, 0);
+                file_->InitiateAsyncRead(
+                        options_, handle, handle.offset, n, slot->backing_mem,
+                        context_.caller != AccessCaller::kCompaction,
+                        [slot]() {
+                            sem_post(&slot->done);
+                        });
+            }
+            slots_.push_back(slot);
+            index_->Next();
+        }
+    }
+
+    void BlockReadahead::Drain() {
+        for (Slot *slot : slots_) {
+            if (slot->cached != nullptr) {
+                delete slot->cached;
+            } else {
+                Wait(slot);
+            }
+            Free(slot);
+        }
+        slots_.clear();
+        window_ = 0;
+        hits_ = 0;
+    }
+
+    void BlockReadahead::Wait(Slot *slot) {
+        sem_wait(&slot->done);
+    }
+
+    void BlockReadahead::Free(Slot *slot) {
+        if (slot->backing_mem != nullptr) {
+            sem_destroy(&slot->done);
+            slot->mem_manager->FreeItem(slot->thread_id, slot->backing_mem,
+                                        slot->scid);
+        }
+        delete slot;
+    }
+
+    void BlockReadahead::FreeSlot(void *arg1, void *arg2) {
+        Free(reinterpret_cast<Slot *>(arg1));
+    }
+}
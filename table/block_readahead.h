@@ -0,0 +1,93 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+// Readahead of the data blocks of an SSTable on a remote StoC. A table
+// iterator reads a data block only once it moves into it, so each block
+// boundary of a scan waits for a round trip to the StoC. BlockReadahead
+// detects consecutive block reads and reads the following blocks into a ring
+// of RDMA buffers while the iterator consumes the current block.
+
+#ifndef LEVELDB_BLOCK_READAHEAD_H
+#define LEVELDB_BLOCK_READAHEAD_H
+
+#include <deque>
+#include <semaphore.h>
+
+#include "leveldb/db_profiler.h"
+#include "leveldb/db_types.h"
+#include "leveldb/options.h"
+
+namespace leveldb {
+
+    class Iterator;
+
+    class StoCRandomAccessFileClient;
+
+    class Table;
+
+    class BlockReadahead {
+    public:
+        // Reads ahead "fixed_blocks" blocks from the first block if it is
+        // positive. Otherwise, the window starts at two blocks once the
+        // iterator reads two consecutive blocks and doubles up to
+        // "max_blocks" as the iterator consumes it.
+        BlockReadahead(Table *table, BlockReadContext context,
+                       const ReadOptions &options, uint32_t fixed_blocks,
+                       uint32_t max_blocks);
+
+        ~BlockReadahead();
+
+        // Returns an iterator over the data block "handle" if it was read
+        // ahead. Otherwise, returns nullptr and discards the blocks read
+        // ahead since the iterator moved elsewhere.
+        Iterator *Read(const StoCBlockHandle &handle);
+
+        // The iterator has read the data block "handle" into "block". Read
+        // ahead the blocks after it if the reads are sequential.
+        void Prefetch(const StoCBlockHandle &handle, Iterator *block);
+
+    private:
+        struct Slot {
+            StoCBlockHandle handle = {};
+            // Set if the block was in the block cache.
+            Iterator *cached = nullptr;
+            char *backing_mem = nullptr;
+            uint32_t scid = 0;
+            MemManager *mem_manager = nullptr;
+            uint64_t thread_id = 0;
+            // Posted once the read of "backing_mem" completes.
+            sem_t done;
+        };
+
+        // Issue reads until the ring holds window_ blocks.
+        void Fill();
+
+        // Wait for the pending reads and discard all blocks read ahead.
+        void Drain();
+
+        void Wait(Slot *slot);
+
+        static void Free(Slot *slot);
+
+        // Iterator cleanup. Frees the slot whose block an iterator parsed in
+        // place.
+        static void FreeSlot(void *arg1, void *arg2);
+
+        Table *table_;
+        StoCRandomAccessFileClient *file_;
+        const BlockReadContext context_;
+        ReadOptions options_;
+        const uint32_t fixed_blocks_;
+        const uint32_t max_blocks_;
+        // Positioned at the block after the last block in slots_.
+        Iterator *index_ = nullptr;
+        StoCBlockHandle last_ = {};
+        bool has_last_ = false;
+        // 0 if not reading ahead.
+        uint32_t window_ = 0;
+        uint32_t hits_ = 0;
+        std::deque<Slot *> slots_;
+    };
+}
+
+#endif //LEVELDB_BLOCK_READAHEAD_H
@@ -0,0 +1,235 @@
+// Copyright (c) 2011 The LevelDB Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file. See the AUTHORS file for names of contributors.
+
+#include "table/block.h"
+
+#include <string>
+#include <vector>
+
+#include "common/nova_common.h"
+#include "common/nova_config.h"
+#include "db/dbformat.h"
+#include "leveldb/comparator.h"
+#include "leveldb/options.h"
+#include "table/block_builder.h"
+#include "ltc/storage_selector.h"
+#include "table/format.h"
+#include "util/coding.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+    static std::string IKey(const std::string &user_key, SequenceNumber seq) {
+        return InternalKey(user_key, seq, kTypeValue).Encode().ToString();
+    }
+
+    static std::string SeekKey(const std::string &user_key) {
+        return InternalKey(user_key, kMaxSequenceNumber,
+                           kValueTypeForSeek).Encode().ToString();
+    }
+
+    static std::string UserKey(int i) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "key%06d", i);
+        return buf;
+    }
+
+    class BlockTest {
+    public:
+        BlockTest() : icmp_(BytewiseComparator()) {
+            options_.comparator = &icmp_;
+        }
+
+        ~BlockTest() { delete block_; }
+
+        // Build a block of the user keys UserKey(i) for even i in
+        // [0, 2 * num_keys), each with "versions" versions.
+        void Build(int num_keys, bool hash_index, int versions = 1) {
+            BlockBuilder builder(&options_, hash_index);
+            for (int i = 0; i < 2 * num_keys; i += 2) {
+                for (int v = versions; v > 0; v--) {
+                    builder.Add(IKey(UserKey(i), v), Value(i, v));
+                }
+            }
+            contents_ = builder.Finish().ToString();
+            delete block_;
+            BlockContents contents;
+            contents.data = Slice(contents_);
+            contents.cachable = false;
+            contents.heap_allocated = false;
+            block_ = new Block(contents, 0, 0);
+        }
+
+        static std::string Value(int i, int version) {
+            return "v" + std::to_string(i) + "." + std::to_string(version);
+        }
+
+        bool HasHashIndex() const {
+            uint32_t footer = DecodeFixed32(
+                    contents_.data() + contents_.size() - sizeof(uint32_t));
+            return (footer & kBlockHashIndexFlag) != 0;
+        }
+
+        // Buckets of the hash index. See block_builder.cc for the layout.
+        std::string Buckets() const {
+            size_t end = contents_.size() - sizeof(uint32_t) - sizeof(uint16_t);
+            const uint8_t *p = reinterpret_cast<const uint8_t *>(
+                    contents_.data() + end);
+            uint32_t num_buckets = p[0] | (static_cast<uint32_t>(p[1]) << 8);
+            return contents_.substr(end - num_buckets, num_buckets);
+        }
+
+        // Check that a point lookup finds the newest version of every key and
+        // that it returns the same entry as a Seek.
+        void CheckGets(int num_keys, int versions = 1) {
+            Iterator *get_iter = block_->NewIterator(&icmp_);
+            Iterator *seek_iter = block_->NewIterator(&icmp_);
+            for (int i = 0; i < 2 * num_keys; i += 2) {
+                std::string target = SeekKey(UserKey(i));
+                get_iter->SeekForGet(target);
+                ASSERT_TRUE(get_iter->Valid()) << UserKey(i);
+                ASSERT_EQ(IKey(UserKey(i), versions),
+                          get_iter->key().ToString());
+                ASSERT_EQ(Value(i, versions), get_iter->value().ToString());
+                seek_iter->Seek(target);
+                ASSERT_TRUE(seek_iter->Valid());
+                ASSERT_EQ(seek_iter->key().ToString(),
+                          get_iter->key().ToString());
+            }
+            delete get_iter;
+            delete seek_iter;
+        }
+
+        // Look up the odd user keys, which are not in the block. Return the
+        // number of lookups that became !Valid() without a search.
+        int CheckMissingKeys(int num_keys) {
+            Iterator *iter = block_->NewIterator(&icmp_);
+            int invalid = 0;
+            for (int i = -1; i < 2 * num_keys + 1; i += 2) {
+                iter->SeekForGet(SeekKey(UserKey(i)));
+                if (!iter->Valid()) {
+                    invalid++;
+                    continue;
+                }
+                // A bucket shared with another key may position the iterator
+                // at a different user key, which the caller skips.
+                ASSERT_NE(UserKey(i),
+                          ExtractUserKey(iter->key()).ToString());
+            }
+            delete iter;
+            return invalid;
+        }
+
+        InternalKeyComparator icmp_;
+        Options options_;
+        std::string contents_;
+        Block *block_ = nullptr;
+    };
+
+    TEST(BlockTest, HashIndexHits) {
+        const int kKeys = 200;
+        Build(kKeys, true);
+        ASSERT_TRUE(HasHashIndex());
+        std::string buckets = Buckets();
+        ASSERT_GE(buckets.size(), kKeys);
+        int hits = 0;
+        for (char c : buckets) {
+            uint8_t bucket = static_cast<uint8_t>(c);
+            if (bucket != kBlockHashNoEntry && bucket != kBlockHashCollision) {
+                hits++;
+            }
+        }
+        ASSERT_GT(hits, 0);
+        CheckGets(kKeys);
+    }
+
+    TEST(BlockTest, HashIndexMissingKeys) {
+        const int kKeys = 50;
+        // Many more buckets than keys, so most missing keys hit an empty
+        // bucket.
+        options_.data_block_hash_index_util_ratio = 0.01;
+        Build(kKeys, true);
+        ASSERT_TRUE(HasHashIndex());
+        ASSERT_GT(CheckMissingKeys(kKeys), kKeys / 2);
+        CheckGets(kKeys);
+    }
+
+    TEST(BlockTest, HashIndexCollisionsFallBackToSearch) {
+        const int kKeys = 100;
+        // All keys share one bucket and span several restart intervals.
+        options_.data_block_hash_index_util_ratio = 1000;
+        Build(kKeys, true);
+        ASSERT_TRUE(HasHashIndex());
+        ASSERT_EQ(1, Buckets().size());
+        ASSERT_EQ(kBlockHashCollision, static_cast<uint8_t>(Buckets()[0]));
+        CheckGets(kKeys);
+        // Only the key past the last entry is not found by the search.
+        ASSERT_EQ(1, CheckMissingKeys(kKeys));
+    }
+
+    TEST(BlockTest, VersionsAcrossRestartIntervals) {
+        const int kKeys = 20;
+        const int kVersions = 5;
+        // Every version of a key starts its own restart interval, so a user
+        // key spans several intervals and its bucket is a collision.
+        options_.block_restart_interval = 1;
+        Build(kKeys, true, kVersions);
+        ASSERT_TRUE(HasHashIndex());
+        CheckGets(kKeys, kVersions);
+
+        // A lookup at an older snapshot finds the older version.
+        Iterator *iter = block_->NewIterator(&icmp_);
+        iter->SeekForGet(InternalKey(UserKey(4), 3,
+                                     kValueTypeForSeek).Encode());
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(IKey(UserKey(4), 3), iter->key().ToString());
+        delete iter;
+    }
+
+    TEST(BlockTest, WithoutHashIndex) {
+        const int kKeys = 200;
+        Build(kKeys, false);
+        ASSERT_TRUE(!HasHashIndex());
+        CheckGets(kKeys);
+        CheckMissingKeys(kKeys);
+
+        // The block is the same as one built before the hash index existed:
+        // the footer is the plain number of restarts.
+        uint32_t footer = DecodeFixed32(
+                contents_.data() + contents_.size() - sizeof(uint32_t));
+        ASSERT_EQ((kKeys + options_.block_restart_interval - 1) /
+                  options_.block_restart_interval, footer);
+    }
+
+    TEST(BlockTest, TooManyRestartsForHashIndex) {
+        const int kKeys = kBlockHashMaxRestarts + 10;
+        options_.block_restart_interval = 1;
+        Build(kKeys, true);
+        ASSERT_TRUE(!HasHashIndex());
+        CheckGets(kKeys);
+    }
+
+    TEST(BlockTest, IterateBlockWithHashIndex) {
+        const int kKeys = 100;
+        Build(kKeys, true);
+        Iterator *iter = block_->NewIterator(&icmp_);
+        int i = 0;
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+            ASSERT_EQ(IKey(UserKey(i), 1), iter->key().ToString());
+            i += 2;
+        }
+        ASSERT_EQ(2 * kKeys, i);
+        iter->SeekToLast();
+        ASSERT_TRUE(iter->Valid());
+        ASSERT_EQ(IKey(UserKey(2 * kKeys - 2), 1), iter->key().ToString());
+        delete iter;
+    }
+
+}  // namespace leveldb
+
+nova::NovaConfig *nova::NovaConfig::config;
+nova::NovaGlobalVariables nova::NovaGlobalVariables::global;
+std::atomic<nova::Servers *> leveldb::StorageSelector::available_stoc_servers;
+
+int main(int argc, char **argv) { return leveldb::test::RunAllTests(); }
@@ -6,6 +6,8 @@
 #include <fmt/core.h>
 #include "table/filter_block.h"
 
+#include <algorithm>
+
 #include "leveldb/filter_policy.h"
 #include "util/coding.h"
 
@@ -102,17 +104,54 @@ namespace leveldb {
 
     bool
     FilterBlockReader::KeyMayMatch(uint64_t block_offset, const Slice &key) {
+        Slice filter;
+        if (!GetFilter(block_offset, &filter)) {
+            return true;
+        }
+        return policy_->KeyMayMatch(key, filter);
+    }
+
+    bool FilterBlockReader::GetFilter(uint64_t block_offset,
+                                      Slice *filter) const {
         uint64_t index = block_offset / kFilterBase;
         if (index >= filter_offsets_.size()) {
-            return true;
+            return false;
         }
+        *filter = FilterAt(index);
+        return true;
+    }
+
+    Slice FilterBlockReader::FilterAt(uint64_t index) const {
         uint32_t start = filter_offsets_[index];
         uint32_t end = filter_size_;
         if (index + 1 < filter_offsets_.size()) {
             end = filter_offsets_[index + 1];
         }
-        Slice filter = Slice(data_ + start, end - start);
-        return policy_->KeyMayMatch(key, filter);
+        return Slice(data_ + start, end - start);
+    }
+
+    void FilterBlockReader::EncodePartition(uint64_t first_block_offset,
+                                            uint64_t last_block_offset,
+                                            std::string *dst,
+                                            uint64_t *base) const {
+        const uint64_t first = first_block_offset / kFilterBase;
+        const uint64_t end = std::min(last_block_offset / kFilterBase + 1,
+                                      static_cast<uint64_t>(filter_offsets_.size()));
+        *base = first * kFilterBase;
+        const size_t start = dst->size();
+        std::vector<uint32_t> offsets;
+        for (uint64_t index = first; index < end; index++) {
+            offsets.push_back(dst->size() - start);
+            Slice filter = FilterAt(index);
+            dst->append(filter.data(), filter.size());
+        }
+        const uint32_t filter_size = dst->size() - start;
+        for (uint32_t offset : offsets) {
+            PutFixed32(dst, offset);
+        }
+        PutFixed32(dst, offsets.size());
+        PutFixed32(dst, filter_size);
+        dst->push_back(kFilterBaseLg);
     }
 
     std::string FilterBlockReader::DebugString(uint64_t block_offset,
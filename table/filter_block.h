@@ -60,11 +60,24 @@ namespace leveldb {
 
         bool KeyMayMatch(uint64_t block_offset, const Slice &key);
 
+        // Sets "*filter" to the filter of the data block at "block_offset".
+        // Returns false if the data block has no filter.
+        bool GetFilter(uint64_t block_offset, Slice *filter) const;
+
+        // Append a filter block that holds the filters of the data blocks in
+        // [first_block_offset, last_block_offset] to *dst. The filter of the
+        // data block at offset o is found at o - *base in the new block.
+        void EncodePartition(uint64_t first_block_offset,
+                             uint64_t last_block_offset, std::string *dst,
+                             uint64_t *base) const;
+
         uint64_t size() const {return size_;}
 
         std::string DebugString(uint64_t block_offset, const Slice &key);
 
     private:
+        Slice FilterAt(uint64_t index) const;
+
         const FilterPolicy *policy_;
         const char *data_;    // Pointer to filter data (at block-start)
         size_t base_lg_;      // Encoding parameter (see kFilterBaseLg in .ltc file)
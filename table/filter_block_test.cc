@@ -121,6 +121,29 @@ namespace leveldb {
         ASSERT_TRUE(!reader.KeyMayMatch(9000, "bar"));
     }
 
+    TEST(FilterBlockTest, Partition) {
+        FilterBlockBuilder builder(policy_);
+        builder.StartBlock(0);
+        builder.AddKey("foo");
+        builder.StartBlock(3100);
+        builder.AddKey("box");
+        builder.StartBlock(9000);
+        builder.AddKey("hello");
+        Slice block = builder.Finish();
+        FilterBlockReader reader(policy_, block);
+
+        std::string partition;
+        uint64_t base = 0;
+        reader.EncodePartition(3100, 9000, &partition, &base);
+        ASSERT_EQ(2048, base);
+        FilterBlockReader partition_reader(policy_, partition);
+        ASSERT_TRUE(partition_reader.KeyMayMatch(3100 - base, "box"));
+        ASSERT_TRUE(!partition_reader.KeyMayMatch(3100 - base, "foo"));
+        ASSERT_TRUE(!partition_reader.KeyMayMatch(4100 - base, "box"));
+        ASSERT_TRUE(partition_reader.KeyMayMatch(9000 - base, "hello"));
+        ASSERT_TRUE(!partition_reader.KeyMayMatch(9000 - base, "box"));
+    }
+
 }  // namespace leveldb
 
 int main(int argc, char **argv) { return leveldb::test::RunAllTests(); }
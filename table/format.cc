@@ -5,6 +5,8 @@
 #include <fmt/core.h>
 #include "table/format.h"
 
+#include <algorithm>
+
 #include "leveldb/env.h"
 #include "port/port.h"
 #include "table/block.h"
@@ -64,4 +66,115 @@ namespace leveldb {
         }
         return result;
     }
+
+    void PartitionHandle::EncodeTo(std::string *dst) const {
+        PutVarint32(dst, id);
+        index_handle.EncodeTo(dst);
+        filter_handle.EncodeTo(dst);
+        PutVarint64(dst, filter_base);
+    }
+
+    Status PartitionHandle::DecodeFrom(Slice *input) {
+        Status s;
+        if (!GetVarint32(input, &id)) {
+            return Status::Corruption("bad partition handle");
+        }
+        s = index_handle.DecodeFrom(input);
+        if (s.ok()) {
+            s = filter_handle.DecodeFrom(input);
+        }
+        if (s.ok() && !GetVarint64(input, &filter_base)) {
+            s = Status::Corruption("bad partition handle");
+        }
+        return s;
+    }
+
+    CompressionType CompressionTypeForLevel(const Options &options,
+                                            int level) {
+        if (level < 0 || options.compression_per_level.empty()) {
+            return options.compression;
+        }
+        size_t index = std::min(static_cast<size_t>(level),
+                                options.compression_per_level.size() - 1);
+        return options.compression_per_level[index];
+    }
+
+    CompressionType CompressBlock(const Options &options, CompressionType type,
+                                  const Slice &raw, std::string *compressed,
+                                  Slice *block_contents) {
+        bool success = false;
+        compressed->clear();
+        switch (type) {
+            case kNoCompression:
+                break;
+            case kSnappyCompression:
+                success = port::Snappy_Compress(raw.data(), raw.size(),
+                                                compressed);
+                break;
+            case kLZ4Compression:
+                PutVarint32(compressed, static_cast<uint32_t>(raw.size()));
+                success = port::LZ4_Compress(raw.data(), raw.size(),
+                                             compressed);
+                break;
+            case kZstdCompression:
+                PutVarint32(compressed, static_cast<uint32_t>(raw.size()));
+                success = port::Zstd_Compress(options.zstd_compression_level,
+                                              options.zstd_dictionary.get(),
+                                              raw.data(), raw.size(),
+                                              compressed);
+                break;
+        }
+        if (success && compressed->size() < raw.size() - (raw.size() / 8u)) {
+            *block_contents = *compressed;
+            return type;
+        }
+        // Not supported, or compressed less than 12.5%, so just store
+        // uncompressed form.
+        *block_contents = raw;
+        return kNoCompression;
+    }
+
+    bool GetUncompressedLength(CompressionType type, const char *data,
+                               size_t n, size_t *ulength) {
+        switch (type) {
+            case kSnappyCompression:
+                return port::Snappy_GetUncompressedLength(data, n, ulength);
+            case kLZ4Compression:
+            case kZstdCompression: {
+                uint32_t length = 0;
+                if (GetVarint32Ptr(data, data + n, &length) == nullptr) {
+                    return false;
+                }
+                *ulength = length;
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    bool UncompressBlock(CompressionType type,
+                         const port::ZstdDictionary *dict,
+                         const char *data, size_t n, char *output,
+                         size_t ulength) {
+        if (type == kSnappyCompression) {
+            return port::Snappy_Uncompress(data, n, output);
+        }
+        const char *limit = data + n;
+        uint32_t length = 0;
+        const char *payload = GetVarint32Ptr(data, limit, &length);
+        if (payload == nullptr || length != ulength) {
+            return false;
+        }
+        switch (type) {
+            case kLZ4Compression:
+                return port::LZ4_Uncompress(payload, limit - payload, output,
+                                            ulength);
+            case kZstdCompression:
+                return port::Zstd_Uncompress(dict, payload, limit - payload,
+                                             output, ulength);
+            default:
+                return false;
+        }
+    }
 }  // namespace leveldb
@@ -95,6 +95,29 @@ namespace leveldb {
         BlockHandle index_handle_;
     };
 
+// A table with partitioned index and filter blocks stores a top-level index
+// in place of the index block. Each entry is keyed by the last index key of a
+// partition and points to the partition's index block and filter block. The
+// metaindex maps kPartitionedFilterPrefix + filter policy name to the extent
+// of all filter partitions.
+    struct PartitionHandle {
+        uint32_t id = 0;
+        BlockHandle index_handle;
+        BlockHandle filter_handle;
+        // Data block offset of the first filter in the filter partition.
+        uint64_t filter_base = 0;
+
+        void EncodeTo(std::string *dst) const;
+
+        Status DecodeFrom(Slice *input);
+    };
+
+    static const char kPartitionedFilterPrefix[] = "partitionedfilter.";
+
+// The metaindex key of the block that stores the range tombstones of a table.
+// It is written after the filter block.
+    static const char kRangeTombstoneBlockName[] = "rangetombstones";
+
 // kTableMagicNumber was picked by running
 //    echo http://code.google.com/p/leveldb/ | sha1sum
 // and taking the leading 64 bits.
@@ -103,12 +126,47 @@ namespace leveldb {
 // 1-byte type + 32-bit crc
     static const size_t kBlockTrailerSize = 5;
 
+// A block with a hash index sets the top bit of its number of restarts. See
+// block_builder.cc.
+    static const uint32_t kBlockHashIndexFlag = 1u << 31;
+    static const uint8_t kBlockHashNoEntry = 255;
+    static const uint8_t kBlockHashCollision = 254;
+    // Restart indexes must fit in a bucket.
+    static const uint32_t kBlockHashMaxRestarts = 253;
+
     struct BlockContents {
         Slice data;           // Actual contents of data
         bool cachable;        // True iff data can be cached
         bool heap_allocated;  // True iff caller should delete[] data.data()
     };
 
+// Return the compression type of the SSTables written to "level". A negative
+// level, e.g., an unknown output level, uses options.compression.
+    CompressionType CompressionTypeForLevel(const Options &options, int level);
+
+// Compress "raw" with "type" and set *block_contents to the bytes to store.
+// "*compressed" backs *block_contents when the block is compressed. Returns
+// the type stored in the block trailer. It is kNoCompression if "type" is not
+// supported by this build or saves less than 12.5%.
+//
+// LZ4 and Zstd blocks are prefixed with their varint32 uncompressed length.
+    CompressionType CompressBlock(const Options &options, CompressionType type,
+                                  const Slice &raw, std::string *compressed,
+                                  Slice *block_contents);
+
+// Store the uncompressed length of the compressed block "data[0,n-1]" in
+// *ulength. Returns false if the block is corrupted or "type" is unknown.
+    bool GetUncompressedLength(CompressionType type, const char *data,
+                               size_t n, size_t *ulength);
+
+// Uncompress the block "data[0,n-1]" into the caller-supplied
+// "output[0,ulength-1]", where ulength is given by GetUncompressedLength.
+// "dict" is the Zstd dictionary the block was compressed with, if any.
+    bool UncompressBlock(CompressionType type,
+                         const port::ZstdDictionary *dict,
+                         const char *data, size_t n, char *output,
+                         size_t ulength);
+
 // Read the block identified by "handle" from "file".  On failure
 // return non-OK.  On success fill *result and return OK.
 
@@ -17,6 +17,7 @@
 #include "leveldb/filter_policy.h"
 #include "leveldb/options.h"
 #include "table/block.h"
+#include "table/block_readahead.h"
 #include "table/filter_block.h"
 #include "table/format.h"
 #include "table/two_level_iterator.h"
@@ -24,11 +25,63 @@
 
 namespace leveldb {
 
+    namespace {
+        // A filter partition and the memory that backs it.
+        struct FilterPartition {
+            FilterPartition(const FilterPolicy *policy,
+                            const BlockContents &contents)
+                    : data(contents.heap_allocated ? contents.data.data()
+                                                   : nullptr),
+                      reader(policy, contents.data) {}
+
+            ~FilterPartition() { delete[] data; }
+
+            const char *data;
+            FilterBlockReader reader;
+        };
+
+        void DeleteCachedFilterPartition(const Slice &key, void *value) {
+            delete reinterpret_cast<FilterPartition *>(value);
+        }
+
+        void DeleteCachedIndexPartition(const Slice &key, void *value) {
+            delete reinterpret_cast<Block *>(value);
+        }
+
+        Status ReadMetadataBlock(RandomAccessFile *file, const Options &options,
+                                 const BlockHandle &handle,
+                                 BlockContents *contents) {
+            ReadOptions opt;
+            if (options.paranoid_checks) {
+                opt.verify_checksums = true;
+            }
+            StoCBlockHandle h = {};
+            h.offset = handle.offset();
+            h.size = handle.size();
+            return Table::ReadBlock(file, opt, h, contents);
+        }
+    }
+
+    struct Table::Partition {
+        Block *index = nullptr;
+        FilterBlockReader *filter = nullptr;
+        // Subtracted from a data block offset to find its filter.
+        uint64_t filter_base = 0;
+        Cache::Handle *index_handle = nullptr;
+        Cache::Handle *filter_handle = nullptr;
+    };
+
     struct Table::Rep {
         ~Rep() {
             delete filter;
             delete[] filter_data;
             delete index_block;
+            for (auto partition : index_partitions) {
+                delete partition;
+            }
+            for (auto partition : filter_partitions) {
+                delete reinterpret_cast<FilterPartition *>(partition);
+            }
         }
 
         Options options;
@@ -45,7 +98,14 @@ namespace leveldb {
         std::unordered_map<uint64_t, uint64_t> stoc_file_data_relative_offset;
 
         BlockHandle metaindex_handle;  // Handle to metaindex_block: saved from footer
+        // The top-level index if the table is partitioned.
         Block *index_block;
+        bool partitioned = false;
+        // Pinned partitions indexed by PartitionHandle::id. Empty if the
+        // partitions are loaded through the block cache.
+        std::vector<Block *> index_partitions;
+        std::vector<void *> filter_partitions;
+        std::vector<RangeTombstone> range_tombstones;
     };
 
     Status Table::Open(const Options &options,
@@ -126,10 +186,6 @@ namespace leveldb {
     }
 
     void Table::ReadMeta(const Footer &footer) {
-        if (rep_->options.filter_policy == nullptr) {
-            return;  // Do not need any metadata
-        }
-
         // TODO(sanjay): Skip this if footer.metaindex_handle() size indicates
         // it is an empty block.
         ReadOptions opt;
@@ -146,11 +202,33 @@ namespace leveldb {
                                 footer.metaindex_handle().offset());
 
         Iterator *iter = meta->NewIterator(BytewiseComparator());
+        iter->Seek(kRangeTombstoneBlockName);
+        if (iter->Valid() && iter->key() == Slice(kRangeTombstoneBlockName)) {
+            ReadRangeTombstones(iter->value());
+        }
+        if (rep_->options.filter_policy == nullptr) {
+            delete iter;
+            delete meta;
+            return;
+        }
+
         std::string key = "filter.";
         key.append(rep_->options.filter_policy->Name());
         iter->Seek(key);
-        NOVA_ASSERT(iter->Valid() && iter->key() == Slice(key));
-        ReadFilter(iter->value());
+        if (iter->Valid() && iter->key() == Slice(key)) {
+            ReadFilter(iter->value());
+        } else {
+            key = kPartitionedFilterPrefix;
+            key.append(rep_->options.filter_policy->Name());
+            iter->Seek(key);
+            NOVA_ASSERT(iter->Valid() && iter->key() == Slice(key));
+            rep_->partitioned = true;
+            if (rep_->options.block_cache == nullptr ||
+                (rep_->options.pin_l0_metadata_partitions &&
+                 rep_->level == 0)) {
+                PinPartitions();
+            }
+        }
         delete iter;
         delete meta;
     }
@@ -177,6 +255,31 @@ namespace leveldb {
                                              block.data);
     }
 
+    void Table::ReadRangeTombstones(const Slice &handle_value) {
+        Slice v = handle_value;
+        BlockHandle handle;
+        NOVA_ASSERT(handle.DecodeFrom(&v).ok());
+        BlockContents contents;
+        NOVA_ASSERT(ReadMetadataBlock(rep_->file, rep_->options, handle,
+                                      &contents).ok());
+        Block block(contents, rep_->file_number, handle.offset());
+        Iterator *iter = block.NewIterator(rep_->options.comparator);
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+            ParsedInternalKey ikey;
+            NOVA_ASSERT(ParseInternalKey(iter->key(), &ikey));
+            RangeTombstone tombstone;
+            tombstone.start = ikey.user_key.ToString();
+            tombstone.end = iter->value().ToString();
+            tombstone.sequence = ikey.sequence;
+            rep_->range_tombstones.push_back(std::move(tombstone));
+        }
+        delete iter;
+    }
+
+    const std::vector<RangeTombstone> &Table::range_tombstones() const {
+        return rep_->range_tombstones;
+    }
+
     Table::~Table() { delete rep_; }
 
     static void DeleteBlock(void *arg, void *ignored) {
@@ -188,12 +291,161 @@ namespace leveldb {
         delete block;
     }
 
+    static void DeleteReadahead(void *arg, void *ignored) {
+        delete reinterpret_cast<BlockReadahead *>(arg);
+    }
+
     static void ReleaseBlock(void *arg, void *h) {
         Cache *cache = reinterpret_cast<Cache *>(arg);
         Cache::Handle *handle = reinterpret_cast<Cache::Handle *>(h);
         cache->Release(handle);
     }
 
+    void Table::PinPartitions() {
+        Iterator *iter = rep_->index_block->NewIterator(
+                rep_->options.comparator);
+        for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+            Slice input = iter->value();
+            PartitionHandle handle;
+            NOVA_ASSERT(handle.DecodeFrom(&input).ok());
+            NOVA_ASSERT(handle.id == rep_->index_partitions.size());
+            BlockContents contents;
+            NOVA_ASSERT(ReadMetadataBlock(rep_->file, rep_->options,
+                                          handle.index_handle,
+                                          &contents).ok());
+            rep_->index_partitions.push_back(
+                    new Block(contents, rep_->file_number,
+                              handle.index_handle.offset()));
+            NOVA_ASSERT(ReadMetadataBlock(rep_->file, rep_->options,
+                                          handle.filter_handle,
+                                          &contents).ok());
+            rep_->filter_partitions.push_back(
+                    new FilterPartition(rep_->options.filter_policy,
+                                        contents));
+        }
+        delete iter;
+    }
+
+    void Table::LoadPartition(const PartitionHandle &handle,
+                              Partition *partition) const {
+        partition->filter_base = handle.filter_base;
+        // Partitions are always pinned without a block cache.
+        if (!rep_->index_partitions.empty()) {
+            partition->index = rep_->index_partitions[handle.id];
+            partition->filter = &reinterpret_cast<FilterPartition *>(
+                    rep_->filter_partitions[handle.id])->reader;
+            return;
+        }
+        Cache *block_cache = rep_->options.block_cache;
+        NOVA_ASSERT(block_cache != nullptr);
+        char cache_key_buffer[16];
+        EncodeFixed64(cache_key_buffer, rep_->cache_id);
+        Slice key(cache_key_buffer, sizeof(cache_key_buffer));
+
+        EncodeFixed64(cache_key_buffer + 8, handle.index_handle.offset());
+        partition->index_handle = block_cache->Lookup(key);
+        if (partition->index_handle == nullptr) {
+            BlockContents contents;
+            NOVA_ASSERT(ReadMetadataBlock(rep_->file, rep_->options,
+                                          handle.index_handle,
+                                          &contents).ok());
+            Block *index = new Block(contents, rep_->file_number,
+                                     handle.index_handle.offset());
+            partition->index_handle = block_cache->Insert(
+                    key, index, index->size(), &DeleteCachedIndexPartition);
+        }
+        partition->index = reinterpret_cast<Block *>(
+                block_cache->Value(partition->index_handle));
+
+        EncodeFixed64(cache_key_buffer + 8, handle.filter_handle.offset());
+        partition->filter_handle = block_cache->Lookup(key);
+        if (partition->filter_handle == nullptr) {
+            BlockContents contents;
+            NOVA_ASSERT(ReadMetadataBlock(rep_->file, rep_->options,
+                                          handle.filter_handle,
+                                          &contents).ok());
+            FilterPartition *filter = new FilterPartition(
+                    rep_->options.filter_policy, contents);
+            partition->filter_handle = block_cache->Insert(
+                    key, filter, contents.data.size(),
+                    &DeleteCachedFilterPartition);
+        }
+        partition->filter = &reinterpret_cast<FilterPartition *>(
+                block_cache->Value(partition->filter_handle))->reader;
+    }
+
+    void Table::ReleasePartition(Partition *partition) const {
+        if (partition->index_handle != nullptr) {
+            rep_->options.block_cache->Release(partition->index_handle);
+        }
+        if (partition->filter_handle != nullptr) {
+            rep_->options.block_cache->Release(partition->filter_handle);
+        }
+        *partition = Partition();
+    }
+
+    bool Table::FindPartition(const Slice &k, Partition *partition) const {
+        if (!rep_->partitioned) {
+            partition->index = rep_->index_block;
+            partition->filter = rep_->filter;
+            return true;
+        }
+        bool found = false;
+        Iterator *iter = rep_->index_block->NewIterator(
+                rep_->options.comparator);
+        iter->Seek(k);
+        if (iter->Valid()) {
+            Slice input = iter->value();
+            PartitionHandle handle;
+            NOVA_ASSERT(handle.DecodeFrom(&input).ok());
+            LoadPartition(handle, partition);
+            found = true;
+        }
+        delete iter;
+        return found;
+    }
+
+    Iterator *
+    Table::IndexPartitionReader(void *arg, void *arg2,
+                                BlockReadContext context,
+                                const ReadOptions &options,
+                                const Slice &index_value,
+                                std::string *next_key) {
+        Table *table = reinterpret_cast<Table *>(arg);
+        Slice input = index_value;
+        PartitionHandle handle;
+        Status s = handle.DecodeFrom(&input);
+        if (!s.ok()) {
+            return NewErrorIterator(s);
+        }
+        Partition partition;
+        table->LoadPartition(handle, &partition);
+        Iterator *iter = partition.index->NewIterator(
+                table->rep_->options.comparator);
+        // Scans do not check filters.
+        Cache *block_cache = table->rep_->options.block_cache;
+        if (partition.filter_handle != nullptr) {
+            block_cache->Release(partition.filter_handle);
+        }
+        if (partition.index_handle != nullptr) {
+            iter->RegisterCleanup(&ReleaseBlock, block_cache,
+                                  partition.index_handle);
+        }
+        return iter;
+    }
+
+    Iterator *Table::NewIndexIterator(BlockReadContext context,
+                                      const ReadOptions &options) const {
+        Iterator *iter = rep_->index_block->NewIterator(
+                rep_->options.comparator);
+        if (!rep_->partitioned) {
+            return iter;
+        }
+        return NewTwoLevelIterator(iter, context, &Table::IndexPartitionReader,
+                                   const_cast<Table *>(this), nullptr,
+                                   options);
+    }
+
 // Convert an index iterator value (i.e., an encoded BlockHandle)
 // into an iterator over the contents of the corresponding block.
     Iterator *
@@ -202,6 +454,7 @@ namespace leveldb {
                            const Slice &index_value,
                            std::string *next_key) {
         Table *table = reinterpret_cast<Table *>(arg);
+        BlockReadahead *readahead = reinterpret_cast<BlockReadahead *>(arg2);
         Cache *block_cache = table->rep_->options.block_cache;
         Block *block = nullptr;
         Cache::Handle *cache_handle = nullptr;
@@ -209,12 +462,12 @@ namespace leveldb {
         Slice input = index_value;
         Status s;
         stoc_block_handle.DecodeHandle(input.data());
-        // One replica with one data fragment.
-        // Overwrite with latest server id and stoc file id.
-        if (table->rep_->meta->block_replica_handles.size() == 1 &&
-            table->rep_->meta->block_replica_handles[0].data_block_group_handles.size() == 1) {
-            stoc_block_handle.server_id = table->rep_->meta->block_replica_handles[0].data_block_group_handles[0].server_id;
-            stoc_block_handle.stoc_file_id = table->rep_->meta->block_replica_handles[0].data_block_group_handles[0].stoc_file_id;
+        table->ResolveDataBlockHandle(&stoc_block_handle);
+        if (readahead != nullptr) {
+            Iterator *iter = readahead->Read(stoc_block_handle);
+            if (iter != nullptr) {
+                return iter;
+            }
         }
 
         // We intentionally allow extra stuff in index_value so that we
@@ -233,27 +486,38 @@ namespace leveldb {
                         cache_handle));
                 cache_hit = true;
             } else {
-                s = table->ReadBlock(table->rep_->file, options,
-                                     stoc_block_handle,
-                                     &contents);
+                s = table->ReadDataBlock(options, stoc_block_handle,
+                                         &contents);
                 if (s.ok()) {
                     block = new Block(contents, table->rep_->file_number,
                                       stoc_block_handle.offset);
-                    if (contents.cachable && options.fill_cache) {
+                    // Compactions read each block once. Scans insert with a
+                    // low priority so that they do not flush the blocks of
+                    // point lookups.
+                    if (contents.cachable && options.fill_cache &&
+                        context.caller != AccessCaller::kCompaction) {
+                        Cache::Priority priority =
+                                context.caller == AccessCaller::kUserIterator
+                                ? Cache::kLowPriority : Cache::kHighPriority;
                         cache_handle = block_cache->Insert(key, block,
                                                            block->size(),
-                                                           &DeleteCachedBlock);
+                                                           &DeleteCachedBlock,
+                                                           priority);
                         insert = true;
                     }
                 }
             }
         } else {
-            s = table->ReadBlock(table->rep_->file, options, stoc_block_handle, &contents);
+            s = table->ReadDataBlock(options, stoc_block_handle, &contents);
             if (s.ok()) {
                 block = new Block(contents, table->rep_->file_number, stoc_block_handle.offset);
             }
         }
 
+        if (s.IsIncomplete()) {
+            // The caller reads the block. See ReadOptions::deferred_block_reads.
+            return NewErrorIterator(s);
+        }
         NOVA_ASSERT(s.ok())
             <<
             fmt::format(
@@ -278,20 +542,188 @@ namespace leveldb {
             table->db_profiler_->Trace(access);
         }
 
-        Iterator *iter;
-        if (block != nullptr) {
-            iter = block->NewIterator(table->rep_->options.comparator);
-            if (cache_handle == nullptr) {
-                iter->RegisterCleanup(&DeleteBlock, block, nullptr);
-            } else {
-                iter->RegisterCleanup(&ReleaseBlock, block_cache, cache_handle);
-            }
+        if (block == nullptr) {
+            return NewErrorIterator(s);
+        }
+        Iterator *iter = table->NewBlockIterator(block, cache_handle);
+        if (readahead != nullptr) {
+            readahead->Prefetch(stoc_block_handle, iter);
+        }
+        return iter;
+    }
+
+    void Table::ResolveDataBlockHandle(StoCBlockHandle *handle) const {
+        // One replica with one data fragment.
+        // Overwrite with latest server id and stoc file id.
+        if (rep_->meta->block_replica_handles.size() == 1 &&
+            rep_->meta->block_replica_handles[0].data_block_group_handles.size() == 1) {
+            handle->server_id = rep_->meta->block_replica_handles[0].data_block_group_handles[0].server_id;
+            handle->stoc_file_id = rep_->meta->block_replica_handles[0].data_block_group_handles[0].stoc_file_id;
+        }
+    }
+
+    Iterator *
+    Table::NewBlockIterator(Block *block, Cache::Handle *cache_handle) const {
+        Iterator *iter = block->NewIterator(rep_->options.comparator);
+        if (cache_handle == nullptr) {
+            iter->RegisterCleanup(&DeleteBlock, block, nullptr);
         } else {
-            iter = NewErrorIterator(s);
+            iter->RegisterCleanup(&ReleaseBlock, rep_->options.block_cache,
+                                  cache_handle);
         }
         return iter;
     }
 
+    RandomAccessFile *Table::file() const {
+        return rep_->file;
+    }
+
+    bool Table::PrepareGet(const Slice &k, StoCBlockHandle *handle) {
+        bool may_match = false;
+        Partition partition;
+        if (!FindPartition(k, &partition)) {
+            return false;
+        }
+        Iterator *iiter = partition.index->NewIterator(
+                rep_->options.comparator);
+        iiter->Seek(k);
+        if (iiter->Valid()) {
+            Slice handle_value = iiter->value();
+            NOVA_ASSERT(partition.filter != nullptr);
+            NOVA_ASSERT(StoCBlockHandle::DecodeHandle(&handle_value, handle));
+            may_match = partition.filter->KeyMayMatch(
+                    TranslateToDataBlockOffset(*handle) -
+                    partition.filter_base, k);
+            ResolveDataBlockHandle(handle);
+        }
+        delete iiter;
+        ReleasePartition(&partition);
+        return may_match;
+    }
+
+    bool Table::LocateGet(const Slice &k, StoCBlockHandle *handle,
+                          Slice *filter, bool *has_filter) {
+        bool located = false;
+        *has_filter = false;
+        Partition partition;
+        if (!FindPartition(k, &partition)) {
+            return false;
+        }
+        Iterator *iiter = partition.index->NewIterator(
+                rep_->options.comparator);
+        iiter->Seek(k);
+        if (iiter->Valid()) {
+            Slice handle_value = iiter->value();
+            NOVA_ASSERT(partition.filter != nullptr);
+            NOVA_ASSERT(StoCBlockHandle::DecodeHandle(&handle_value, handle));
+            uint64_t offset = TranslateToDataBlockOffset(*handle) -
+                              partition.filter_base;
+            if (partition.filter_handle != nullptr) {
+                // The filter does not outlive the cache handle. Check it now.
+                located = partition.filter->KeyMayMatch(offset, k);
+            } else {
+                *has_filter = partition.filter->GetFilter(offset, filter);
+                located = true;
+            }
+            ResolveDataBlockHandle(handle);
+        }
+        delete iiter;
+        ReleasePartition(&partition);
+        return located;
+    }
+
+    const FilterPolicy *Table::filter_policy() const {
+        return rep_->options.filter_policy;
+    }
+
+    Iterator *Table::CachedDataBlock(const StoCBlockHandle &handle) {
+        Cache *block_cache = rep_->options.block_cache;
+        if (block_cache == nullptr) {
+            return nullptr;
+        }
+        char cache_key_buffer[8 + StoCBlockHandle::HandleSize()];
+        EncodeFixed64(cache_key_buffer, rep_->cache_id);
+        handle.EncodeHandle(cache_key_buffer + 8);
+        Slice key(cache_key_buffer, sizeof(cache_key_buffer));
+        Cache::Handle *cache_handle = block_cache->Lookup(key);
+        if (cache_handle == nullptr) {
+            return nullptr;
+        }
+        Block *block = reinterpret_cast<Block *>(block_cache->Value(
+                cache_handle));
+        return NewBlockIterator(block, cache_handle);
+    }
+
+    Status Table::ReadDataBlock(const ReadOptions &options,
+                                const StoCBlockHandle &handle,
+                                BlockContents *contents) const {
+        DeferredBlockReads *deferred = options.deferred_block_reads;
+        auto file = reinterpret_cast<StoCRandomAccessFileClient *>(rep_->file);
+        if (deferred == nullptr || !file->IsRemoteRead(handle)) {
+            return ReadBlock(rep_->file, options, handle, contents,
+                             rep_->options.zstd_dictionary.get());
+        }
+        deferred->pending = handle;
+        return Status::Incomplete("data block read is deferred");
+    }
+
+    Iterator *
+    Table::NewDataBlock(const ReadOptions &options,
+                        const StoCBlockHandle &handle, char *buf,
+                        Cache::Priority priority) {
+        BlockContents contents;
+        Status s = ReadBlock(buf,
+                             Slice(buf, handle.size + kBlockTrailerSize),
+                             options, handle, &contents,
+                             rep_->options.zstd_dictionary.get());
+        if (!s.ok()) {
+            return NewErrorIterator(s);
+        }
+        return NewDataBlock(options, handle, contents, priority);
+    }
+
+    Iterator *
+    Table::NewDataBlock(const ReadOptions &options,
+                        const StoCBlockHandle &handle, const Slice &block,
+                        Cache::Priority priority) {
+        BlockContents contents;
+        Status s = ReadBlock(nullptr, block, options, handle, &contents,
+                             rep_->options.zstd_dictionary.get());
+        if (!s.ok()) {
+            return NewErrorIterator(s);
+        }
+        if (!contents.heap_allocated && rep_->options.block_cache != nullptr &&
+            options.fill_cache) {
+            // The block cache keeps its own copy.
+            char *buf = new char[contents.data.size()];
+            memcpy(buf, contents.data.data(), contents.data.size());
+            contents.data = Slice(buf, contents.data.size());
+            contents.heap_allocated = true;
+            contents.cachable = true;
+        }
+        return NewDataBlock(options, handle, contents, priority);
+    }
+
+    Iterator *
+    Table::NewDataBlock(const ReadOptions &options,
+                        const StoCBlockHandle &handle,
+                        const BlockContents &contents,
+                        Cache::Priority priority) {
+        Block *block = new Block(contents, rep_->file_number, handle.offset);
+        Cache *block_cache = rep_->options.block_cache;
+        Cache::Handle *cache_handle = nullptr;
+        if (block_cache != nullptr && contents.cachable &&
+            options.fill_cache) {
+            char cache_key_buffer[8 + StoCBlockHandle::HandleSize()];
+            EncodeFixed64(cache_key_buffer, rep_->cache_id);
+            handle.EncodeHandle(cache_key_buffer + 8);
+            Slice key(cache_key_buffer, sizeof(cache_key_buffer));
+            cache_handle = block_cache->Insert(key, block, block->size(),
+                                               &DeleteCachedBlock, priority);
+        }
+        return NewBlockIterator(block, cache_handle);
+    }
+
     Iterator *
     Table::NewIterator(AccessCaller caller, const ReadOptions &options) const {
         BlockReadContext context = {
@@ -313,11 +745,31 @@ namespace leveldb {
             db_profiler_->Trace(access);
         }
 
-        return NewTwoLevelIterator(
-                rep_->index_block->NewIterator(rep_->options.comparator),
+        // Read ahead the blocks of tables on remote StoCs.
+        BlockReadahead *readahead = nullptr;
+        if (options.stoc_client != nullptr && options.mem_manager != nullptr) {
+            if (caller == AccessCaller::kCompaction &&
+                rep_->options.compaction_readahead_blocks > 0) {
+                readahead = new BlockReadahead(
+                        const_cast<Table *>(this), context, options,
+                        rep_->options.compaction_readahead_blocks,
+                        rep_->options.compaction_readahead_blocks);
+            } else if (caller == AccessCaller::kUserIterator &&
+                       rep_->options.readahead_max_blocks > 0) {
+                readahead = new BlockReadahead(
+                        const_cast<Table *>(this), context, options, 0,
+                        rep_->options.readahead_max_blocks);
+            }
+        }
+        Iterator *iter = NewTwoLevelIterator(
+                NewIndexIterator(context, options),
                 context,
-                &Table::DataBlockReader, const_cast<Table *>(this), nullptr,
+                &Table::DataBlockReader, const_cast<Table *>(this), readahead,
                 options);
+        if (readahead != nullptr) {
+            iter->RegisterCleanup(&DeleteReadahead, readahead, nullptr);
+        }
+        return iter;
     }
 
     uint64_t Table::TranslateToDataBlockOffset(const leveldb::StoCBlockHandle &handle) {
@@ -351,11 +803,16 @@ namespace leveldb {
         }
 
         Status s;
-        Iterator *iiter = rep_->index_block->NewIterator(rep_->options.comparator);
+        Partition partition;
+        if (!FindPartition(k, &partition)) {
+            return s;
+        }
+        Iterator *iiter = partition.index->NewIterator(
+                rep_->options.comparator);
         iiter->Seek(k);
         if (iiter->Valid()) {
             Slice handle_value = iiter->value();
-            FilterBlockReader *filter = rep_->filter;
+            FilterBlockReader *filter = partition.filter;
             StoCBlockHandle handle;
             bool found = true;
             bool key_doest_not_exist = false;
@@ -370,11 +827,12 @@ namespace leveldb {
                         .block_id = 0,
                         .sstable_id = rep_->file_number,
                         .level = rep_->level,
-                        .size = rep_->filter->size()
+                        .size = filter->size()
                 };
                 db_profiler_->Trace(access);
             }
-            data_block_offset = TranslateToDataBlockOffset(handle);
+            data_block_offset = TranslateToDataBlockOffset(handle) -
+                                partition.filter_base;
             if (!filter->KeyMayMatch(data_block_offset, k)) {
                 found = false;
                 key_doest_not_exist = true;
@@ -388,7 +846,7 @@ namespace leveldb {
                 Iterator *block_iter = DataBlockReader(this, nullptr, context,
                                                        options,
                                                        iiter->value(), nullptr);
-                block_iter->Seek(k);
+                block_iter->SeekForGet(k);
                 if (block_iter->Valid()) {
                     if (handle_result) {
                         (*handle_result)(arg, block_iter->key(),
@@ -419,13 +877,15 @@ namespace leveldb {
             s = iiter->status();
         }
         delete iiter;
+        ReleasePartition(&partition);
         return s;
     }
 
     Status
     Table::ReadBlock(const char *buf, const Slice &contents,
                      const ReadOptions &options,
-                     const StoCBlockHandle &handle, BlockContents *result) {
+                     const StoCBlockHandle &handle, BlockContents *result,
+                     const port::ZstdDictionary *compression_dict) {
         size_t n = static_cast<size_t>(handle.size);
         Status s;
 
@@ -458,15 +918,19 @@ namespace leveldb {
 
                 // Ok
                 break;
-            case kSnappyCompression: {
+            case kSnappyCompression:
+            case kLZ4Compression:
+            case kZstdCompression: {
+                CompressionType ctype = static_cast<CompressionType>(type);
                 size_t ulength = 0;
-                if (!port::Snappy_GetUncompressedLength(data, n, &ulength)) {
+                if (!GetUncompressedLength(ctype, data, n, &ulength)) {
                     delete[] buf;
                     return Status::Corruption(
                             "corrupted compressed block contents");
                 }
                 char *ubuf = new char[ulength];
-                if (!port::Snappy_Uncompress(data, n, ubuf)) {
+                if (!UncompressBlock(ctype, compression_dict, data, n, ubuf,
+                                     ulength)) {
                     delete[] buf;
                     delete[] ubuf;
                     return Status::Corruption(
@@ -488,7 +952,8 @@ namespace leveldb {
     Status Table::ReadBlock(leveldb::RandomAccessFile *file,
                             const leveldb::ReadOptions &options,
                             const StoCBlockHandle &stoc_block_handle,
-                            leveldb::BlockContents *result) {
+                            leveldb::BlockContents *result,
+                            const port::ZstdDictionary *compression_dict) {
         result->data = Slice();
         result->cachable = false;
         result->heap_allocated = false;
@@ -508,12 +973,13 @@ namespace leveldb {
             delete[] buf;
             return Status::Corruption("truncated block read");
         }
-        return ReadBlock(buf, contents, options, stoc_block_handle, result);
+        return ReadBlock(buf, contents, options, stoc_block_handle, result,
+                         compression_dict);
     }
 
     uint64_t Table::ApproximateOffsetOf(const Slice &key) const {
-        Iterator *index_iter =
-                rep_->index_block->NewIterator(rep_->options.comparator);
+        BlockReadContext context = {};
+        Iterator *index_iter = NewIndexIterator(context, ReadOptions());
         index_iter->Seek(key);
         uint64_t result;
         if (index_iter->Valid()) {
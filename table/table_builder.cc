@@ -22,13 +22,16 @@
 namespace leveldb {
 
     struct TableBuilder::Rep {
-        Rep(const Options &opt, WritableFile *f)
+        Rep(const Options &opt, WritableFile *f, int level)
                 : options(opt),
+                  level(level),
+                  compression(CompressionTypeForLevel(opt, level)),
                   index_block_options(opt),
                   file(f),
                   offset(0),
-                  data_block(&options),
+                  data_block(&options, opt.data_block_hash_index),
                   index_block(&index_block_options),
+                  range_tombstone_block(&index_block_options),
                   num_entries(0),
                   num_data_blocks(0),
                   closed(false),
@@ -40,12 +43,17 @@ namespace leveldb {
         }
 
         Options options;
+        const int level;
+        CompressionType compression;  // Of the data blocks at "level".
         Options index_block_options;
         WritableFile *file;
         uint64_t offset;
         Status status;
         BlockBuilder data_block;
         BlockBuilder index_block;
+        // A copy of the range tombstones in the data blocks so that opening
+        // the table loads them without a scan.
+        BlockBuilder range_tombstone_block;
         std::string last_key;
         int64_t num_entries;
         uint64_t num_data_blocks;
@@ -67,8 +75,9 @@ namespace leveldb {
         std::string compressed_output;
     };
 
-    TableBuilder::TableBuilder(const Options &options, WritableFile *file)
-            : rep_(new Rep(options, file)) {
+    TableBuilder::TableBuilder(const Options &options, WritableFile *file,
+                               int level)
+            : rep_(new Rep(options, file, level)) {
         if (rep_->filter_block != nullptr) {
             rep_->filter_block->StartBlock(0);
         }
@@ -92,6 +101,7 @@ namespace leveldb {
         // Note that any live BlockBuilders point to rep_->options and therefore
         // will automatically pick up the updated options.
         rep_->options = options;
+        rep_->compression = CompressionTypeForLevel(options, rep_->level);
         rep_->index_block_options = options;
         rep_->index_block_options.block_restart_interval = 1;
         return Status::OK();
@@ -112,6 +122,10 @@ namespace leveldb {
             }
         }
 
+        if (ExtractValueType(key) == kTypeRangeDeletion) {
+            r->range_tombstone_block.Add(key, value);
+        }
+
         if (r->pending_index_entry) {
             assert(r->data_block.empty());
             r->options.comparator->FindShortestSeparator(&r->last_key, key);
@@ -163,27 +177,9 @@ namespace leveldb {
         Slice raw = block->Finish();
 
         Slice block_contents;
-        CompressionType type = r->options.compression;
-        // TODO(postrelease): Support more compression options: zlib?
-        switch (type) {
-            case kNoCompression:
-                block_contents = raw;
-                break;
-
-            case kSnappyCompression: {
-                std::string *compressed = &r->compressed_output;
-                if (port::Snappy_Compress(raw.data(), raw.size(), compressed) &&
-                    compressed->size() < raw.size() - (raw.size() / 8u)) {
-                    block_contents = *compressed;
-                } else {
-                    // Snappy not supported, or compressed less than 12.5%, so just
-                    // store uncompressed form
-                    block_contents = raw;
-                    type = kNoCompression;
-                }
-                break;
-            }
-        }
+        CompressionType type = CompressBlock(r->options, r->compression, raw,
+                                             &r->compressed_output,
+                                             &block_contents);
         WriteRawBlock(block_contents, type, handle);
         r->compressed_output.clear();
         block->Reset();
@@ -220,6 +216,8 @@ namespace leveldb {
         r->closed = true;
 
         BlockHandle filter_block_handle, metaindex_block_handle, index_block_handle;
+        BlockHandle range_tombstone_block_handle;
+        const bool has_range_tombstones = !r->range_tombstone_block.empty();
 
         // Write filter block
         if (ok() && r->filter_block != nullptr) {
@@ -231,6 +229,12 @@ namespace leveldb {
                                filter_block_handle.size());
         }
 
+        // Write range tombstone block
+        if (ok() && has_range_tombstones) {
+            WriteRawBlock(r->range_tombstone_block.Finish(), kNoCompression,
+                          &range_tombstone_block_handle);
+        }
+
         // Write metaindex block
         if (ok()) {
             BlockBuilder meta_index_block(&r->options);
@@ -242,6 +246,12 @@ namespace leveldb {
                 filter_block_handle.EncodeTo(&handle_encoding);
                 meta_index_block.Add(key, handle_encoding);
             }
+            if (has_range_tombstones) {
+                std::string handle_encoding;
+                range_tombstone_block_handle.EncodeTo(&handle_encoding);
+                meta_index_block.Add(kRangeTombstoneBlockName,
+                                     handle_encoding);
+            }
 
             // TODO(postrelease): Add stats and other meta blocks
             WriteBlock(&meta_index_block, &metaindex_block_handle);
@@ -57,6 +57,30 @@ namespace leveldb {
         return result;
     }
 
+    char *Arena::AllocateCacheLineAware(size_t bytes, size_t hot_bytes) {
+        const size_t align = 8;
+        uintptr_t ptr = reinterpret_cast<uintptr_t>(alloc_ptr_);
+        uintptr_t result = (ptr + align - 1) & ~(align - 1);
+        if (hot_bytes <= kCacheLineSize &&
+            (result & (kCacheLineSize - 1)) + hot_bytes > kCacheLineSize) {
+            result = (result + kCacheLineSize - 1) & ~(kCacheLineSize - 1);
+        }
+        size_t needed = bytes + (result - ptr);
+        if (alloc_ptr_ != nullptr && needed <= alloc_bytes_remaining_) {
+            alloc_ptr_ += needed;
+            alloc_bytes_remaining_ -= needed;
+            return reinterpret_cast<char *>(result);
+        }
+        // Leave room to move the allocation to the next cache line.
+        ptr = reinterpret_cast<uintptr_t>(
+                AllocateFallback(bytes + kCacheLineSize));
+        result = ptr;
+        if ((result & (kCacheLineSize - 1)) + hot_bytes > kCacheLineSize) {
+            result = (result + kCacheLineSize - 1) & ~(kCacheLineSize - 1);
+        }
+        return reinterpret_cast<char *>(result);
+    }
+
     char *Arena::AllocateNewBlock(size_t block_bytes) {
         char *result = new char[block_bytes];
         blocks_.push_back(result);
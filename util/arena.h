@@ -29,6 +29,12 @@ namespace leveldb {
         // Allocate memory with the normal alignment guarantees provided by malloc.
         char *AllocateAligned(size_t bytes);
 
+        // Same as AllocateAligned. In addition, the first "hot_bytes" bytes do
+        // not straddle a cache line if hot_bytes <= kCacheLineSize.
+        char *AllocateCacheLineAware(size_t bytes, size_t hot_bytes);
+
+        static const size_t kCacheLineSize = 64;
+
         // Returns an estimate of the total memory usage of data allocated
         // by the arena.
         size_t MemoryUsage() const {
@@ -4,6 +4,12 @@
 
 #include "leveldb/filter_policy.h"
 
+#include <string.h>
+#include <algorithm>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 #include "leveldb/slice.h"
 #include "util/hash.h"
 
@@ -14,6 +20,11 @@ namespace leveldb {
             return Hash(key.data(), key.size(), 0xbc9f1d34);
         }
 
+        // An independent hash that selects the bits within a block.
+        static uint32_t BlockBitsHash(const Slice &key) {
+            return Hash(key.data(), key.size(), 0x5c6bfb31);
+        }
+
         class BloomFilterPolicy : public FilterPolicy {
         public:
             explicit BloomFilterPolicy(int bits_per_key) : bits_per_key_(
@@ -60,6 +71,19 @@ namespace leveldb {
 
             bool KeyMayMatch(const Slice &key,
                              const Slice &bloom_filter) const override {
+                return Probe(BloomHash(key), bloom_filter);
+            }
+
+            void KeyMayMatchBatch(const Slice &key, const Slice *filters,
+                                  int n, bool *results) const override {
+                const uint32_t h = BloomHash(key);
+                for (int i = 0; i < n; i++) {
+                    results[i] = Probe(h, filters[i]);
+                }
+            }
+
+        private:
+            static bool Probe(uint32_t h, const Slice &bloom_filter) {
                 const size_t len = bloom_filter.size();
                 if (len < 2) return false;
 
@@ -75,7 +99,6 @@ namespace leveldb {
                     return true;
                 }
 
-                uint32_t h = BloomHash(key);
                 const uint32_t delta =
                         (h >> 17) | (h << 15);  // Rotate right 17 bits
                 for (size_t j = 0; j < k; j++) {
@@ -87,14 +110,176 @@ namespace leveldb {
                 return true;
             }
 
-        private:
             size_t bits_per_key_;
             size_t k_;
         };
+
+        // A split block Bloom filter. The filter is an array of 256-bit
+        // blocks, i.e., half a cache line, followed by one byte that records
+        // the number of probes. A key sets one bit in each of the eight 32-bit
+        // words of a single block. A probe therefore touches one cache line
+        // and checks all eight bits with a single AVX2 test when available.
+        class BlockedBloomFilterPolicy : public FilterPolicy {
+        public:
+            explicit BlockedBloomFilterPolicy(int bits_per_key)
+                    : bits_per_key_(bits_per_key) {
+            }
+
+            const char *
+            Name() const override { return "leveldb.BlockedBloomFilter"; }
+
+            void CreateFilter(const Slice *keys, int n,
+                              std::string *dst) const override {
+                size_t num_blocks =
+                        (n * bits_per_key_ + kBlockBits - 1) / kBlockBits;
+                if (num_blocks < 1) num_blocks = 1;
+
+                const size_t init_size = dst->size();
+                dst->resize(init_size + num_blocks * kBlockBytes, 0);
+                dst->push_back(static_cast<char>(kNumProbes));
+                char *array = &(*dst)[init_size];
+                for (int i = 0; i < n; i++) {
+                    char *block = array +
+                                  BlockIndex(BloomHash(keys[i]), num_blocks) *
+                                  kBlockBytes;
+                    uint32_t masks[kNumProbes];
+                    Masks(BlockBitsHash(keys[i]), masks);
+                    for (int j = 0; j < kNumProbes; j++) {
+                        uint32_t word = DecodeWord(block + j * 4) | masks[j];
+                        memcpy(block + j * 4, &word, sizeof(word));
+                    }
+                }
+            }
+
+            bool KeyMayMatch(const Slice &key,
+                             const Slice &filter) const override {
+                const char *block = nullptr;
+                if (!Locate(BloomHash(key), filter, &block)) {
+                    return true;
+                }
+                return block == nullptr ? false :
+                       Probe(BlockBitsHash(key), block);
+            }
+
+            // Hashes the key once, prefetches the block of every filter, and
+            // then probes them. The cache misses of all filters overlap.
+            void KeyMayMatchBatch(const Slice &key, const Slice *filters,
+                                  int n, bool *results) const override {
+                const uint32_t h = BloomHash(key);
+                const uint32_t bits_hash = BlockBitsHash(key);
+                const char *blocks[kBatchSize];
+                for (int start = 0; start < n; start += kBatchSize) {
+                    int end = std::min(n, start + kBatchSize);
+                    for (int i = start; i < end; i++) {
+                        const char *block = nullptr;
+                        results[i] = !Locate(h, filters[i], &block) ||
+                                     block != nullptr;
+                        blocks[i - start] = results[i] ? block : nullptr;
+                        if (blocks[i - start] != nullptr) {
+                            __builtin_prefetch(blocks[i - start]);
+                        }
+                    }
+                    for (int i = start; i < end; i++) {
+                        if (blocks[i - start] != nullptr) {
+                            results[i] = Probe(bits_hash, blocks[i - start]);
+                        }
+                    }
+                }
+            }
+
+        private:
+            static const int kNumProbes = 8;
+            static const size_t kBlockBytes = 32;
+            static const size_t kBlockBits = kBlockBytes * 8;
+            static const int kBatchSize = 64;
+
+            static uint32_t DecodeWord(const char *p) {
+                uint32_t word;
+                memcpy(&word, p, sizeof(word));
+                return word;
+            }
+
+            static size_t BlockIndex(uint32_t h, size_t num_blocks) {
+                // Maps h to [0, num_blocks) without a division.
+                return static_cast<size_t>(
+                        (static_cast<uint64_t>(h) * num_blocks) >> 32);
+            }
+
+            static void Masks(uint32_t h, uint32_t *masks) {
+                static const uint32_t kSalts[kNumProbes] = {
+                        0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                        0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+                for (int j = 0; j < kNumProbes; j++) {
+                    masks[j] = 1U << ((h * kSalts[j]) >> 27);
+                }
+            }
+
+            // Returns false if the filter uses an unknown encoding. Otherwise,
+            // sets *block to the block of the key, or nullptr if the filter is
+            // empty.
+            static bool Locate(uint32_t h, const Slice &filter,
+                               const char **block) {
+                const size_t len = filter.size();
+                *block = nullptr;
+                if (len < kBlockBytes + 1) {
+                    return true;
+                }
+                if (filter[len - 1] != kNumProbes ||
+                    (len - 1) % kBlockBytes != 0) {
+                    // Reserved for new encodings. Consider it a match.
+                    return false;
+                }
+                const size_t num_blocks = (len - 1) / kBlockBytes;
+                *block = filter.data() + BlockIndex(h, num_blocks) * kBlockBytes;
+                return true;
+            }
+
+            static bool ProbeScalar(uint32_t h, const char *block) {
+                uint32_t masks[kNumProbes];
+                Masks(h, masks);
+                for (int j = 0; j < kNumProbes; j++) {
+                    if ((DecodeWord(block + j * 4) & masks[j]) != masks[j]) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+#if defined(__x86_64__)
+            __attribute__((target("avx2")))
+            static bool ProbeAVX2(uint32_t h, const char *block) {
+                const __m256i salts = _mm256_setr_epi32(
+                        0x47b6137b, 0x44974d91, 0x8824ad5b, 0xa2b7289d,
+                        0x705495c7, 0x2df1424b, 0x9efc4947, 0x5c6bfb31);
+                __m256i shifts = _mm256_srli_epi32(
+                        _mm256_mullo_epi32(salts, _mm256_set1_epi32(h)), 27);
+                __m256i masks = _mm256_sllv_epi32(_mm256_set1_epi32(1), shifts);
+                __m256i words = _mm256_loadu_si256(
+                        reinterpret_cast<const __m256i *>(block));
+                // Whether all bits of masks are set in words.
+                return _mm256_testc_si256(words, masks) != 0;
+            }
+
+            static bool Probe(uint32_t h, const char *block) {
+                static const bool has_avx2 = __builtin_cpu_supports("avx2");
+                return has_avx2 ? ProbeAVX2(h, block) : ProbeScalar(h, block);
+            }
+#else
+            static bool Probe(uint32_t h, const char *block) {
+                return ProbeScalar(h, block);
+            }
+#endif
+
+            const size_t bits_per_key_;
+        };
     }  // namespace
 
     const FilterPolicy *NewBloomFilterPolicy(int bits_per_key) {
         return new BloomFilterPolicy(bits_per_key);
     }
 
+    const FilterPolicy *NewBlockedBloomFilterPolicy(int bits_per_key) {
+        return new BlockedBloomFilterPolicy(bits_per_key);
+    }
+
 }  // namespace leveldb
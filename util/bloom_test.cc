@@ -21,7 +21,8 @@ namespace leveldb {
 
     class BloomTest {
     public:
-        BloomTest() : policy_(NewBloomFilterPolicy(10)) {}
+        explicit BloomTest(const FilterPolicy *policy = NewBloomFilterPolicy(10))
+                : policy_(policy) {}
 
         ~BloomTest() { delete policy_; }
 
@@ -65,6 +66,10 @@ namespace leveldb {
             return policy_->KeyMayMatch(s, filter_);
         }
 
+        const std::string &filter() const { return filter_; }
+
+        const FilterPolicy *policy() const { return policy_; }
+
         double FalsePositiveRate() {
             char buffer[sizeof(int)];
             int result = 0;
@@ -154,6 +159,101 @@ namespace leveldb {
 
 // Different bits-per-byte
 
+    class BlockedBloomTest : public BloomTest {
+    public:
+        BlockedBloomTest() : BloomTest(NewBlockedBloomFilterPolicy(10)) {}
+    };
+
+    TEST(BlockedBloomTest, BlockedEmptyFilter) {
+        ASSERT_TRUE(!Matches("hello"));
+        ASSERT_TRUE(!Matches("world"));
+    }
+
+    TEST(BlockedBloomTest, BlockedSmall) {
+        Add("hello");
+        Add("world");
+        ASSERT_TRUE(Matches("hello"));
+        ASSERT_TRUE(Matches("world"));
+        ASSERT_TRUE(!Matches("x"));
+        ASSERT_TRUE(!Matches("foo"));
+    }
+
+    TEST(BlockedBloomTest, BlockedVaryingLengths) {
+        char buffer[sizeof(int)];
+        for (int length = 1; length <= 10000; length = NextLength(length)) {
+            Reset();
+            for (int i = 0; i < length; i++) {
+                Add(Key(i, buffer));
+            }
+            Build();
+
+            ASSERT_LE(FilterSize(), static_cast<size_t>((length * 10 / 8) + 40))
+                    << length;
+            for (int i = 0; i < length; i++) {
+                ASSERT_TRUE(Matches(Key(i, buffer)))
+                        << "Length " << length << "; key " << i;
+            }
+            double rate = FalsePositiveRate();
+            if (kVerbose >= 1) {
+                fprintf(stderr,
+                        "False positives: %5.2f%% @ length = %6d ; bytes = %6d\n",
+                        rate * 100.0, length, static_cast<int>(FilterSize()));
+            }
+            // All probes of a key fall into one block. It costs a bit of
+            // accuracy compared to the classic filter.
+            ASSERT_LE(rate, 0.03);
+        }
+    }
+
+    // Builds "num_filters" filters of "keys_per_filter" keys each with
+    // "policy". Filter i contains keys [i * keys_per_filter,
+    // (i + 1) * keys_per_filter).
+    static void BuildFilters(const FilterPolicy *policy, int num_filters,
+                             int keys_per_filter,
+                             std::vector<std::string> *filters) {
+        char buffer[sizeof(int)];
+        for (int i = 0; i < num_filters; i++) {
+            std::vector<std::string> keys;
+            for (int j = 0; j < keys_per_filter; j++) {
+                keys.push_back(Key(i * keys_per_filter + j, buffer).ToString());
+            }
+            std::vector<Slice> key_slices(keys.begin(), keys.end());
+            filters->emplace_back();
+            policy->CreateFilter(&key_slices[0], keys_per_filter,
+                                 &filters->back());
+        }
+    }
+
+    static void CheckBatchMatchesSingle(const FilterPolicy *policy) {
+        const int kNumFilters = 20;
+        const int kKeysPerFilter = 100;
+        std::vector<std::string> filters;
+        BuildFilters(policy, kNumFilters, kKeysPerFilter, &filters);
+        std::vector<Slice> filter_slices(filters.begin(), filters.end());
+        bool results[kNumFilters];
+        char buffer[sizeof(int)];
+        for (int k = 0; k < 2 * kNumFilters * kKeysPerFilter; k++) {
+            Slice key = Key(k, buffer);
+            policy->KeyMayMatchBatch(key, &filter_slices[0], kNumFilters,
+                                     results);
+            for (int i = 0; i < kNumFilters; i++) {
+                ASSERT_EQ(results[i],
+                          policy->KeyMayMatch(key, filter_slices[i]));
+                if (k / kKeysPerFilter == i) {
+                    ASSERT_TRUE(results[i]);
+                }
+            }
+        }
+    }
+
+    TEST(BloomTest, BatchMatchesSingle) {
+        CheckBatchMatchesSingle(policy());
+    }
+
+    TEST(BlockedBloomTest, BlockedBatchMatchesSingle) {
+        CheckBatchMatchesSingle(policy());
+    }
+
 }  // namespace leveldb
 
 nova::NovaGlobalVariables nova::NovaGlobalVariables::global;
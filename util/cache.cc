@@ -372,6 +372,8 @@ namespace leveldb {
             }
 
         public:
+            using Cache::Insert;
+
             explicit ShardedLRUCache(size_t capacity) : last_id_(0) {
                 const size_t per_shard =
                         (capacity + (kNumShards - 1)) / kNumShards;
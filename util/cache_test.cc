@@ -6,6 +6,7 @@
 
 #include <vector>
 #include "util/coding.h"
+#include "util/hash.h"
 #include "util/testharness.h"
 
 namespace leveldb {
@@ -27,6 +28,22 @@ namespace leveldb {
 
     static int DecodeValue(void *v) { return reinterpret_cast<uintptr_t>(v); }
 
+// Every test runs against each of these caches.
+    struct CacheFactory {
+        const char *name;
+
+        Cache *(*new_cache)(size_t capacity);
+    };
+
+    static const CacheFactory kCacheFactories[] = {
+            {"lru",   &NewLRUCache},
+            {"clock", &NewClockCache},
+    };
+
+    static const CacheFactory *cache_factory = &kCacheFactories[0];
+
+    static bool IsClockCache() { return cache_factory->new_cache == &NewClockCache; }
+
     class CacheTest {
     public:
         static void Deleter(const Slice &key, void *v) {
@@ -34,12 +51,16 @@ namespace leveldb {
             current_->deleted_values_.push_back(DecodeValue(v));
         }
 
-        static const int kCacheSize = 1000;
+        // The LRU cache splits its capacity over 256 shards. Every shard
+        // must hold a few heavy entries.
+        static const int kCacheSize = 100 * 256;
         std::vector<int> deleted_keys_;
         std::vector<int> deleted_values_;
         Cache *cache_;
 
-        CacheTest() : cache_(NewLRUCache(kCacheSize)) { current_ = this; }
+        CacheTest() : cache_(cache_factory->new_cache(kCacheSize)) {
+            current_ = this;
+        }
 
         ~CacheTest() { delete cache_; }
 
@@ -140,14 +161,20 @@ namespace leveldb {
     }
 
     TEST(CacheTest, EvictionPolicy) {
+        if (IsClockCache()) {
+            // The clock cache does not admit entries that are less frequent
+            // than the victim. See the ClockCache tests.
+            return;
+        }
         Insert(100, 101);
         Insert(200, 201);
         Insert(300, 301);
         Cache::Handle *h = cache_->Lookup(EncodeKey(300));
 
         // Frequently used entry must be kept around,
-        // as must things that are still in use.
-        for (int i = 0; i < kCacheSize + 100; i++) {
+        // as must things that are still in use. The capacity is split over
+        // many shards, so insert enough entries to overflow each of them.
+        for (int i = 0; i < 10 * kCacheSize; i++) {
             Insert(1000 + i, 2000 + i);
             ASSERT_EQ(2000 + i, Lookup(1000 + i));
             ASSERT_EQ(101, Lookup(100));
@@ -223,12 +250,132 @@ namespace leveldb {
 
     TEST(CacheTest, ZeroSizeCache) {
         delete cache_;
-        cache_ = NewLRUCache(0);
+        cache_ = cache_factory->new_cache(0);
 
         Insert(1, 100);
         ASSERT_EQ(-1, Lookup(1));
     }
 
+// The clock cache has 64 shards. Return "n" keys that fall into the shard of
+// key 0 so that a test controls which entries compete for its capacity.
+    static std::vector<int> KeysInOneShard(int n) {
+        std::vector<int> keys;
+        std::string first = EncodeKey(0);
+        uint32_t shard = Hash(first.data(), first.size(), 0) >> 26;
+        for (int k = 0; keys.size() < n; k++) {
+            std::string key = EncodeKey(k);
+            if (Hash(key.data(), key.size(), 0) >> 26 == shard) {
+                keys.push_back(k);
+            }
+        }
+        return keys;
+    }
+
+    class ClockCacheTest : public CacheTest {
+    public:
+        // Two entries of charge 1 per shard.
+        ClockCacheTest() {
+            delete cache_;
+            cache_ = NewClockCache(2 * 64);
+        }
+    };
+
+    TEST(ClockCacheTest, AdmissionRejectsInfrequentKey) {
+        std::vector<int> keys = KeysInOneShard(3);
+        Insert(keys[0], 100);
+        Insert(keys[1], 101);
+        for (int i = 0; i < 4; i++) {
+            ASSERT_EQ(100, Lookup(keys[0]));
+            ASSERT_EQ(101, Lookup(keys[1]));
+        }
+
+        // The new key was never looked up, so it is less frequent than any
+        // victim and is not cached. The returned handle is still usable.
+        Cache::Handle *h = InsertAndReturnHandle(keys[2], 102);
+        ASSERT_EQ(102, DecodeValue(cache_->Value(h)));
+        ASSERT_EQ(0, deleted_keys_.size());
+        cache_->Release(h);
+        ASSERT_EQ(1, deleted_keys_.size());
+        ASSERT_EQ(keys[2], deleted_keys_[0]);
+        ASSERT_EQ(100, Lookup(keys[0]));
+        ASSERT_EQ(101, Lookup(keys[1]));
+
+        // Once it is looked up more often than the cached keys, it is
+        // admitted and evicts one of them.
+        for (int i = 0; i < 10; i++) {
+            ASSERT_EQ(-1, Lookup(keys[2]));
+        }
+        Insert(keys[2], 103);
+        ASSERT_EQ(103, Lookup(keys[2]));
+        ASSERT_EQ(2, deleted_keys_.size());
+        ASSERT_TRUE(Lookup(keys[0]) == -1 || Lookup(keys[1]) == -1);
+    }
+
+    TEST(ClockCacheTest, LowPriorityNeedsHigherFrequency) {
+        std::vector<int> keys = KeysInOneShard(3);
+        Insert(keys[0], 100);
+        Insert(keys[1], 101);
+
+        // Equally frequent keys: a high-priority insert is admitted, a
+        // low-priority one is not.
+        Cache::Handle *h = cache_->Insert(EncodeKey(keys[2]), EncodeValue(102),
+                                          1, &CacheTest::Deleter,
+                                          Cache::kLowPriority);
+        cache_->Release(h);
+        ASSERT_EQ(1, deleted_keys_.size());
+        ASSERT_EQ(keys[2], deleted_keys_[0]);
+        ASSERT_EQ(100, Lookup(keys[0]));
+
+        Insert(keys[2], 103);
+        ASSERT_EQ(103, Lookup(keys[2]));
+    }
+
+    TEST(ClockCacheTest, PinnedEntriesAreNotEvicted) {
+        std::vector<int> keys = KeysInOneShard(4);
+        Cache::Handle *h0 = InsertAndReturnHandle(keys[0], 100);
+        Cache::Handle *h1 = InsertAndReturnHandle(keys[1], 101);
+
+        // Every entry of the shard is pinned, so the shard exceeds its
+        // capacity instead of evicting.
+        Cache::Handle *h2 = InsertAndReturnHandle(keys[2], 102);
+        ASSERT_EQ(0, deleted_keys_.size());
+        ASSERT_EQ(100, Lookup(keys[0]));
+        ASSERT_EQ(101, Lookup(keys[1]));
+        ASSERT_EQ(102, Lookup(keys[2]));
+
+        // Only the released entry can be the victim. Look up the new key
+        // first so that admission does not reject it.
+        cache_->Release(h0);
+        ASSERT_EQ(-1, Lookup(keys[3]));
+        ASSERT_EQ(-1, Lookup(keys[3]));
+        Insert(keys[3], 103);
+        ASSERT_EQ(1, deleted_keys_.size());
+        ASSERT_EQ(keys[0], deleted_keys_[0]);
+        ASSERT_EQ(-1, Lookup(keys[0]));
+        ASSERT_EQ(101, Lookup(keys[1]));
+        ASSERT_EQ(102, Lookup(keys[2]));
+        ASSERT_EQ(103, Lookup(keys[3]));
+
+        // Prune drops only the unpinned entries.
+        cache_->Prune();
+        ASSERT_EQ(101, DecodeValue(cache_->Value(h1)));
+        ASSERT_EQ(101, Lookup(keys[1]));
+        ASSERT_EQ(102, Lookup(keys[2]));
+        ASSERT_EQ(-1, Lookup(keys[3]));
+        cache_->Release(h1);
+        cache_->Release(h2);
+    }
+
 }  // namespace leveldb
 
-int main(int argc, char **argv) { return leveldb::test::RunAllTests(); }
+int main(int argc, char **argv) {
+    for (const auto &factory : leveldb::kCacheFactories) {
+        fprintf(stderr, "==== Cache %s\n", factory.name);
+        leveldb::cache_factory = &factory;
+        int ret = leveldb::test::RunAllTests();
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,541 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+// A sharded CLOCK cache with TinyLFU admission.
+//
+// Lookup and Release do not take the shard mutex exclusively. Lookup holds
+// the shard's reader lock to probe the hash table, then bumps the entry's
+// reference count and clock counter with atomic operations. Release only
+// decrements the reference count. Insert, Erase, and eviction take the writer
+// lock.
+//
+// Every entry has a clock counter in [0, kMaxClock]. A hit increments it.
+// The clock hand sweeps the ring of entries to find a victim. It skips entries
+// that are pinned by clients and decrements the counter of the others. The
+// first unpinned entry with a zero counter is the victim.
+//
+// A count-min sketch estimates the access frequency of recently looked-up
+// keys. When an insert must evict, the new entry is admitted only if its
+// frequency is at least that of the victim. A low-priority entry needs a
+// strictly higher frequency and starts with a zero clock counter. So a scan
+// that touches each block once can not flush frequently read blocks.
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "leveldb/cache.h"
+#include "port/port.h"
+#include "util/hash.h"
+#include "util/mutexlock.h"
+
+namespace leveldb {
+
+    namespace {
+
+        static const uint8_t kMaxClock = 3;
+
+        struct ClockHandle {
+            void *value;
+
+            void (*deleter)(const Slice &, void *value);
+
+            ClockHandle *next_hash;
+            // The ring of entries in the cache.
+            ClockHandle *next;
+            ClockHandle *prev;
+            size_t charge;
+            size_t key_length;
+            // References, including the cache reference when in_cache.
+            std::atomic<uint32_t> refs;
+            std::atomic<uint8_t> clock;
+            bool in_cache;
+            uint32_t hash;
+            char key_data[1];  // Beginning of key
+
+            Slice key() const {
+                return Slice(key_data, key_length);
+            }
+        };
+
+        class RWMutex {
+        public:
+            RWMutex() { pthread_rwlock_init(&mu_, nullptr); }
+
+            ~RWMutex() { pthread_rwlock_destroy(&mu_); }
+
+            void ReadLock() { pthread_rwlock_rdlock(&mu_); }
+
+            void WriteLock() { pthread_rwlock_wrlock(&mu_); }
+
+            void Unlock() { pthread_rwlock_unlock(&mu_); }
+
+        private:
+            pthread_rwlock_t mu_;
+        };
+
+        // A count-min sketch of 4 rows with 8-bit saturating counters. The
+        // counters are halved after a sample of accesses so that the
+        // frequencies favor recent accesses.
+        class FrequencySketch {
+        public:
+            FrequencySketch() = default;
+
+            ~FrequencySketch() { delete[] counters_; }
+
+            void SetCapacity(size_t expected_entries) {
+                width_ = 64;
+                while (width_ < expected_entries) {
+                    width_ *= 2;
+                }
+                delete[] counters_;
+                counters_ = new std::atomic<uint8_t>[width_ * kRows];
+                for (size_t i = 0; i < width_ * kRows; i++) {
+                    counters_[i].store(0, std::memory_order_relaxed);
+                }
+                sample_size_ = 10 * width_;
+                additions_ = 0;
+            }
+
+            void Increment(uint32_t hash) {
+                if (counters_ == nullptr) {
+                    return;
+                }
+                for (uint32_t row = 0; row < kRows; row++) {
+                    std::atomic<uint8_t> &counter = counters_[Index(hash, row)];
+                    uint8_t c = counter.load(std::memory_order_relaxed);
+                    if (c < kMaxCount) {
+                        counter.store(c + 1, std::memory_order_relaxed);
+                    }
+                }
+                if (additions_.fetch_add(1, std::memory_order_relaxed) + 1 ==
+                    sample_size_) {
+                    Age();
+                }
+            }
+
+            uint32_t Estimate(uint32_t hash) const {
+                if (counters_ == nullptr) {
+                    return 0;
+                }
+                uint32_t freq = kMaxCount;
+                for (uint32_t row = 0; row < kRows; row++) {
+                    freq = std::min(freq, (uint32_t) counters_[Index(hash,
+                                                                     row)].load(
+                            std::memory_order_relaxed));
+                }
+                return freq;
+            }
+
+        private:
+            static const uint32_t kRows = 4;
+            static const uint8_t kMaxCount = 15;
+
+            size_t Index(uint32_t hash, uint32_t row) const {
+                // Double hashing.
+                uint32_t h2 = ((hash >> 17) | (hash << 15)) | 1;
+                return row * width_ + ((hash + row * h2) & (width_ - 1));
+            }
+
+            void Age() {
+                for (size_t i = 0; i < width_ * kRows; i++) {
+                    uint8_t c = counters_[i].load(std::memory_order_relaxed);
+                    counters_[i].store(c >> 1, std::memory_order_relaxed);
+                }
+                additions_.store(0, std::memory_order_relaxed);
+            }
+
+            std::atomic<uint8_t> *counters_ = nullptr;
+            size_t width_ = 0;
+            size_t sample_size_ = 0;
+            std::atomic<size_t> additions_{0};
+        };
+
+        // A single shard of sharded cache.
+        class ClockCache {
+        public:
+            ClockCache() = default;
+
+            ~ClockCache();
+
+            // Separate from constructor so caller can easily make an array of
+            // ClockCache.
+            void SetCapacity(size_t capacity) {
+                capacity_ = capacity;
+                // Assume 4 KB blocks.
+                sketch_.SetCapacity(capacity / 4096);
+                Resize();
+            }
+
+            size_t GetCapacity() const {
+                return capacity_;
+            }
+
+            // Like Cache methods, but with an extra "hash" parameter.
+            Cache::Handle *Insert(const Slice &key, uint32_t hash, void *value,
+                                  size_t charge,
+                                  void (*deleter)(const Slice &key,
+                                                  void *value),
+                                  Cache::Priority priority);
+
+            Cache::Handle *Lookup(const Slice &key, uint32_t hash);
+
+            void Release(Cache::Handle *handle);
+
+            void Erase(const Slice &key, uint32_t hash);
+
+            void Prune();
+
+            size_t TotalCharge() const {
+                mutex_.ReadLock();
+                size_t usage = usage_;
+                mutex_.Unlock();
+                return usage;
+            }
+
+        private:
+            static void Unref(ClockHandle *e);
+
+            ClockHandle **FindPointer(const Slice &key, uint32_t hash);
+
+            void Resize();
+
+            void RingAppend(ClockHandle *e);
+
+            void RingRemove(ClockHandle *e);
+
+            // Advance the clock hand to an unpinned entry with a zero clock
+            // counter. Returns nullptr if all entries are pinned.
+            ClockHandle *FindVictim();
+
+            // Remove "e" from the hash table and the ring and drop the cache
+            // reference.
+            void Evict(ClockHandle *e);
+
+            size_t capacity_ = 0;
+            FrequencySketch sketch_;
+
+            // mutex_ protects the following state. Lookups hold it shared.
+            mutable RWMutex mutex_;
+            size_t usage_ = 0;
+            std::vector<ClockHandle *> buckets_;
+            size_t elems_ = 0;
+            ClockHandle *hand_ = nullptr;
+        };
+
+        ClockCache::~ClockCache() {
+            while (hand_ != nullptr) {
+                ClockHandle *e = hand_;
+                // Error if caller has an unreleased handle
+                assert(e->refs.load() == 1);
+                RingRemove(e);
+                e->in_cache = false;
+                Unref(e);
+            }
+        }
+
+        void ClockCache::Unref(ClockHandle *e) {
+            if (e->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                assert(!e->in_cache);
+                (*e->deleter)(e->key(), e->value);
+                free(e);
+            }
+        }
+
+        ClockHandle **
+        ClockCache::FindPointer(const Slice &key, uint32_t hash) {
+            ClockHandle **ptr = &buckets_[hash & (buckets_.size() - 1)];
+            while (*ptr != nullptr &&
+                   ((*ptr)->hash != hash || key != (*ptr)->key())) {
+                ptr = &(*ptr)->next_hash;
+            }
+            return ptr;
+        }
+
+        void ClockCache::Resize() {
+            size_t new_length = 16;
+            while (new_length < elems_) {
+                new_length *= 2;
+            }
+            std::vector<ClockHandle *> new_buckets(new_length, nullptr);
+            for (ClockHandle *h : buckets_) {
+                while (h != nullptr) {
+                    ClockHandle *next = h->next_hash;
+                    ClockHandle **ptr = &new_buckets[h->hash &
+                                                     (new_length - 1)];
+                    h->next_hash = *ptr;
+                    *ptr = h;
+                    h = next;
+                }
+            }
+            buckets_.swap(new_buckets);
+        }
+
+        void ClockCache::RingAppend(ClockHandle *e) {
+            // Insert right behind the hand so that "e" is swept last.
+            if (hand_ == nullptr) {
+                e->next = e;
+                e->prev = e;
+                hand_ = e;
+                return;
+            }
+            e->next = hand_;
+            e->prev = hand_->prev;
+            e->prev->next = e;
+            e->next->prev = e;
+        }
+
+        void ClockCache::RingRemove(ClockHandle *e) {
+            if (e->next == e) {
+                hand_ = nullptr;
+                return;
+            }
+            if (hand_ == e) {
+                hand_ = e->next;
+            }
+            e->next->prev = e->prev;
+            e->prev->next = e->next;
+        }
+
+        ClockHandle *ClockCache::FindVictim() {
+            // Each unpinned entry reaches zero within kMaxClock + 1 rounds.
+            size_t max_steps = (kMaxClock + 1) * elems_ + 1;
+            for (size_t step = 0; hand_ != nullptr && step < max_steps;
+                 step++) {
+                ClockHandle *e = hand_;
+                hand_ = e->next;
+                if (e->refs.load(std::memory_order_relaxed) > 1) {
+                    continue;
+                }
+                uint8_t clock = e->clock.load(std::memory_order_relaxed);
+                if (clock > 0) {
+                    e->clock.store(clock - 1, std::memory_order_relaxed);
+                    continue;
+                }
+                return e;
+            }
+            return nullptr;
+        }
+
+        void ClockCache::Evict(ClockHandle *e) {
+            ClockHandle **ptr = FindPointer(e->key(), e->hash);
+            assert(*ptr == e);
+            *ptr = e->next_hash;
+            elems_--;
+            RingRemove(e);
+            e->in_cache = false;
+            usage_ -= e->charge;
+            Unref(e);
+        }
+
+        Cache::Handle *ClockCache::Lookup(const Slice &key, uint32_t hash) {
+            sketch_.Increment(hash);
+            mutex_.ReadLock();
+            ClockHandle *e = *FindPointer(key, hash);
+            if (e != nullptr) {
+                // The cache holds a reference, so "e" stays alive.
+                e->refs.fetch_add(1, std::memory_order_relaxed);
+                uint8_t clock = e->clock.load(std::memory_order_relaxed);
+                if (clock < kMaxClock) {
+                    e->clock.store(clock + 1, std::memory_order_relaxed);
+                }
+            }
+            mutex_.Unlock();
+            return reinterpret_cast<Cache::Handle *>(e);
+        }
+
+        void ClockCache::Release(Cache::Handle *handle) {
+            Unref(reinterpret_cast<ClockHandle *>(handle));
+        }
+
+        Cache::Handle *
+        ClockCache::Insert(const Slice &key, uint32_t hash, void *value,
+                           size_t charge,
+                           void (*deleter)(const Slice &key, void *value),
+                           Cache::Priority priority) {
+            ClockHandle *e = reinterpret_cast<ClockHandle *>(malloc(
+                    sizeof(ClockHandle) - 1 + key.size()));
+            e->value = value;
+            e->deleter = deleter;
+            e->next_hash = nullptr;
+            e->next = nullptr;
+            e->prev = nullptr;
+            e->charge = charge;
+            e->key_length = key.size();
+            e->hash = hash;
+            e->in_cache = false;
+            e->refs.store(1, std::memory_order_relaxed);  // for the returned handle.
+            e->clock.store(priority == Cache::kHighPriority ? 1 : 0,
+                           std::memory_order_relaxed);
+            memcpy(e->key_data, key.data(), key.size());
+
+            if (capacity_ == 0) {
+                // don't cache. (capacity_==0 is supported and turns off caching.)
+                return reinterpret_cast<Cache::Handle *>(e);
+            }
+
+            mutex_.WriteLock();
+            ClockHandle *old = *FindPointer(key, hash);
+            if (old != nullptr) {
+                Evict(old);
+            } else if (usage_ + charge > capacity_) {
+                ClockHandle *victim = FindVictim();
+                if (victim != nullptr) {
+                    uint32_t freq = sketch_.Estimate(hash);
+                    uint32_t victim_freq = sketch_.Estimate(victim->hash);
+                    bool admit = priority == Cache::kHighPriority ?
+                                 freq >= victim_freq : freq > victim_freq;
+                    if (!admit) {
+                        mutex_.Unlock();
+                        return reinterpret_cast<Cache::Handle *>(e);
+                    }
+                    Evict(victim);
+                }
+            }
+            while (usage_ + charge > capacity_) {
+                ClockHandle *victim = FindVictim();
+                if (victim == nullptr) {
+                    break;
+                }
+                Evict(victim);
+            }
+
+            e->refs.fetch_add(1, std::memory_order_relaxed);  // for the cache's reference.
+            e->in_cache = true;
+            usage_ += charge;
+            ClockHandle **ptr = FindPointer(key, hash);
+            e->next_hash = *ptr;
+            *ptr = e;
+            elems_++;
+            if (elems_ > buckets_.size()) {
+                Resize();
+            }
+            RingAppend(e);
+            mutex_.Unlock();
+            return reinterpret_cast<Cache::Handle *>(e);
+        }
+
+        void ClockCache::Erase(const Slice &key, uint32_t hash) {
+            mutex_.WriteLock();
+            ClockHandle *e = *FindPointer(key, hash);
+            if (e != nullptr) {
+                Evict(e);
+            }
+            mutex_.Unlock();
+        }
+
+        void ClockCache::Prune() {
+            mutex_.WriteLock();
+            size_t n = elems_;
+            for (size_t i = 0; i < n && hand_ != nullptr; i++) {
+                ClockHandle *e = hand_;
+                hand_ = e->next;
+                if (e->refs.load(std::memory_order_relaxed) == 1) {
+                    Evict(e);
+                }
+            }
+            mutex_.Unlock();
+        }
+
+        static const int kNumShardBits = 6;
+        static const int kNumShards = 1 << kNumShardBits;
+
+        class ShardedClockCache : public Cache {
+        private:
+            ClockCache shard_[kNumShards];
+            port::Mutex id_mutex_;
+            uint64_t last_id_;
+
+            static inline uint32_t HashSlice(const Slice &s) {
+                return Hash(s.data(), s.size(), 0);
+            }
+
+            static uint32_t Shard(uint32_t hash) {
+                return hash >> (32 - kNumShardBits);
+            }
+
+        public:
+            explicit ShardedClockCache(size_t capacity) : last_id_(0) {
+                const size_t per_shard =
+                        (capacity + (kNumShards - 1)) / kNumShards;
+                for (int s = 0; s < kNumShards; s++) {
+                    shard_[s].SetCapacity(per_shard);
+                }
+            }
+
+            ~ShardedClockCache() override {}
+
+            Handle *Insert(const Slice &key, void *value, size_t charge,
+                           void (*deleter)(const Slice &key,
+                                           void *value)) override {
+                return Insert(key, value, charge, deleter, kHighPriority);
+            }
+
+            Handle *Insert(const Slice &key, void *value, size_t charge,
+                           void (*deleter)(const Slice &key,
+                                           void *value),
+                           Priority priority) override {
+                const uint32_t hash = HashSlice(key);
+                return shard_[Shard(hash)].Insert(key, hash, value, charge,
+                                                  deleter, priority);
+            }
+
+            Handle *Lookup(const Slice &key) override {
+                const uint32_t hash = HashSlice(key);
+                return shard_[Shard(hash)].Lookup(key, hash);
+            }
+
+            void Release(Handle *handle) override {
+                ClockHandle *h = reinterpret_cast<ClockHandle *>(handle);
+                shard_[Shard(h->hash)].Release(handle);
+            }
+
+            void Erase(const Slice &key) override {
+                const uint32_t hash = HashSlice(key);
+                shard_[Shard(hash)].Erase(key, hash);
+            }
+
+            void *Value(Handle *handle) override {
+                return reinterpret_cast<ClockHandle *>(handle)->value;
+            }
+
+            uint64_t NewId() override {
+                MutexLock l(&id_mutex_);
+                return ++(last_id_);
+            }
+
+            void Prune() override {
+                for (int s = 0; s < kNumShards; s++) {
+                    shard_[s].Prune();
+                }
+            }
+
+            size_t TotalCharge() const override {
+                size_t total = 0;
+                for (int s = 0; s < kNumShards; s++) {
+                    total += shard_[s].TotalCharge();
+                }
+                return total;
+            }
+
+            size_t TotalCapacity() const override {
+                size_t total = 0;
+                for (int s = 0; s < kNumShards; s++) {
+                    total += shard_[s].GetCapacity();
+                }
+                return total;
+            }
+        };
+
+    }  // end anonymous namespace
+
+    Cache *NewClockCache(size_t capacity) {
+        return new ShardedClockCache(capacity);
+    }
+
+}  // namespace leveldb
@@ -205,6 +205,47 @@ namespace leveldb {
         return WriteUnbuffered(write_data, write_size);
     }
 
+    Status PosixReadWriteFile::AppendV(const Slice *data, int n) {
+        std::vector<struct iovec> iovs;
+        iovs.reserve(n);
+        for (int i = 0; i < n; i++) {
+            if (data[i].empty()) {
+                continue;
+            }
+            struct iovec iov;
+            iov.iov_base = const_cast<char *>(data[i].data());
+            iov.iov_len = data[i].size();
+            iovs.push_back(iov);
+        }
+        size_t next = 0;
+        while (next < iovs.size()) {
+            int cnt = static_cast<int>(
+                    std::min<size_t>(iovs.size() - next, IOV_MAX));
+            ssize_t write_result = ::writev(fd_, &iovs[next], cnt);
+            if (write_result < 0) {
+                if (errno == EINTR) {
+                    continue;  // Retry
+                }
+                return PosixError(filename_, errno);
+            }
+            if (write_result == 0) {
+                return Status::IOError(filename_, "zero-byte write");
+            }
+            // Skip the fully written buffers and trim a partially written one.
+            size_t written = write_result;
+            while (written > 0 && written >= iovs[next].iov_len) {
+                written -= iovs[next].iov_len;
+                next++;
+            }
+            if (written > 0) {
+                iovs[next].iov_base =
+                        reinterpret_cast<char *>(iovs[next].iov_base) + written;
+                iovs[next].iov_len -= written;
+            }
+        }
+        return Status::OK();
+    }
+
     Status PosixReadWriteFile::Close() {
         Status status;
         const int close_result = ::close(fd_);
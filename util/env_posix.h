@@ -8,6 +8,7 @@
 #define LEVELDB_ENV_POSIX_H
 
 #include <dirent.h>
+#include <limits.h>
 #include <fcntl.h>
 #include <pthread.h>
 #include <sys/mman.h>
@@ -15,10 +16,12 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <list>
 
 #include <atomic>
+#include <algorithm>
 #include <cerrno>
 #include <cstddef>
 #include <cstdint>
@@ -32,6 +35,7 @@
 #include <thread>
 #include <type_traits>
 #include <utility>
+#include <vector>
 #include <map>
 
 #include "leveldb/env.h"
@@ -164,6 +168,8 @@ namespace leveldb {
 
         Status Append(const Slice &data) override;
 
+        Status AppendV(const Slice *data, int n) override;
+
         Status Close() override;
 
         Status Flush() override;
@@ -0,0 +1,385 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "util/erasure_coding.h"
+
+#include <string.h>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NOVA_EC_X86 1
+#endif
+
+#include "common/nova_common.h"
+
+namespace leveldb {
+    namespace {
+        // GF(2^8) with the polynomial x^8 + x^4 + x^3 + x^2 + 1.
+        const uint32_t kGFPolynomial = 0x11d;
+        // Bytes encoded per pass so that one chunk of every fragment stays in
+        // L1 while it is multiplied into all parity fragments.
+        const size_t kEncodeChunkSize = 8192;
+
+        struct GFTables {
+            GFTables() {
+                uint32_t x = 1;
+                for (int i = 0; i < 255; i++) {
+                    exp[i] = x;
+                    exp[i + 255] = x;
+                    log[x] = i;
+                    x <<= 1;
+                    if (x & 0x100) {
+                        x ^= kGFPolynomial;
+                    }
+                }
+                log[0] = 0;
+                for (int a = 0; a < 256; a++) {
+                    for (int b = 0; b < 256; b++) {
+                        mul[a][b] = (a == 0 || b == 0) ? 0 : exp[log[a] + log[b]];
+                    }
+                    // Split tables for the pshufb kernels: c * x = lo[x & 0xf] ^ hi[x >> 4].
+                    for (int n = 0; n < 16; n++) {
+                        lo[a][n] = mul[a][n];
+                        hi[a][n] = mul[a][n << 4];
+                    }
+                }
+            }
+
+            uint8_t Inverse(uint8_t a) const {
+                NOVA_ASSERT(a != 0);
+                return exp[255 - log[a]];
+            }
+
+            uint8_t exp[510];
+            uint8_t log[256];
+            uint8_t mul[256][256];
+            uint8_t lo[256][16];
+            uint8_t hi[256][16];
+        };
+
+        const GFTables &gf() {
+            static const GFTables tables;
+            return tables;
+        }
+
+        enum SimdLevel {
+            kScalar,
+            kAVX2,
+            kAVX512
+        };
+
+        SimdLevel DetectSimdLevel() {
+#if defined(NOVA_EC_X86)
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f") &&
+                __builtin_cpu_supports("avx512bw")) {
+                return kAVX512;
+            }
+            if (__builtin_cpu_supports("avx2")) {
+                return kAVX2;
+            }
+#endif
+            return kScalar;
+        }
+
+        SimdLevel simd_level() {
+            static const SimdLevel level = DetectSimdLevel();
+            return level;
+        }
+
+#if defined(NOVA_EC_X86)
+        // Each kernel processes the largest vector-aligned prefix and returns its
+        // length. The caller handles the tail.
+        __attribute__((target("avx2")))
+        size_t XorRegionAVX2(char *dst, const char *src, size_t n) {
+            size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                __m256i s = _mm256_loadu_si256((const __m256i *) (src + i));
+                __m256i d = _mm256_loadu_si256((const __m256i *) (dst + i));
+                _mm256_storeu_si256((__m256i *) (dst + i), _mm256_xor_si256(d, s));
+            }
+            return i;
+        }
+
+        __attribute__((target("avx512f,avx512bw")))
+        size_t XorRegionAVX512(char *dst, const char *src, size_t n) {
+            size_t i = 0;
+            for (; i + 64 <= n; i += 64) {
+                __m512i s = _mm512_loadu_si512((const void *) (src + i));
+                __m512i d = _mm512_loadu_si512((const void *) (dst + i));
+                _mm512_storeu_si512((void *) (dst + i), _mm512_xor_si512(d, s));
+            }
+            return i;
+        }
+
+        __attribute__((target("avx2")))
+        size_t GFMulXorRegionAVX2(char *dst, const char *src, uint8_t c, size_t n) {
+            const __m256i lo = _mm256_broadcastsi128_si256(
+                    _mm_loadu_si128((const __m128i *) gf().lo[c]));
+            const __m256i hi = _mm256_broadcastsi128_si256(
+                    _mm_loadu_si128((const __m128i *) gf().hi[c]));
+            const __m256i mask = _mm256_set1_epi8(0x0f);
+            size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                __m256i s = _mm256_loadu_si256((const __m256i *) (src + i));
+                __m256i l = _mm256_and_si256(s, mask);
+                __m256i h = _mm256_and_si256(_mm256_srli_epi64(s, 4), mask);
+                __m256i p = _mm256_xor_si256(_mm256_shuffle_epi8(lo, l),
+                                             _mm256_shuffle_epi8(hi, h));
+                __m256i d = _mm256_loadu_si256((const __m256i *) (dst + i));
+                _mm256_storeu_si256((__m256i *) (dst + i), _mm256_xor_si256(d, p));
+            }
+            return i;
+        }
+
+        __attribute__((target("avx512f,avx512bw")))
+        size_t GFMulXorRegionAVX512(char *dst, const char *src, uint8_t c, size_t n) {
+            const __m512i lo = _mm512_broadcast_i32x4(
+                    _mm_loadu_si128((const __m128i *) gf().lo[c]));
+            const __m512i hi = _mm512_broadcast_i32x4(
+                    _mm_loadu_si128((const __m128i *) gf().hi[c]));
+            const __m512i mask = _mm512_set1_epi8(0x0f);
+            size_t i = 0;
+            for (; i + 64 <= n; i += 64) {
+                __m512i s = _mm512_loadu_si512((const void *) (src + i));
+                __m512i l = _mm512_and_si512(s, mask);
+                __m512i h = _mm512_and_si512(_mm512_srli_epi64(s, 4), mask);
+                __m512i p = _mm512_xor_si512(_mm512_shuffle_epi8(lo, l),
+                                             _mm512_shuffle_epi8(hi, h));
+                __m512i d = _mm512_loadu_si512((const void *) (dst + i));
+                _mm512_storeu_si512((void *) (dst + i), _mm512_xor_si512(d, p));
+            }
+            return i;
+        }
+#endif
+
+        class XorCoder : public ErasureCoder {
+        public:
+            explicit XorCoder(int data_fragments)
+                    : ErasureCoder(data_fragments, 1) {}
+
+            const char *Name() const override { return "xor"; }
+
+            void Encode(const char *const *data, char *const *parity,
+                        size_t size) const override {
+                memcpy(parity[0], data[0], size);
+                for (int i = 1; i < data_fragments_; i++) {
+                    XorRegion(parity[0], data[i], size);
+                }
+            }
+
+            bool Decode(char *const *fragments, const std::vector<bool> &available,
+                        size_t size) const override {
+                int lost = -1;
+                for (int i = 0; i < data_fragments_ + 1; i++) {
+                    if (available[i]) {
+                        continue;
+                    }
+                    if (lost != -1) {
+                        return false;
+                    }
+                    lost = i;
+                }
+                if (lost == -1 || lost == data_fragments_) {
+                    // Nothing to rebuild.
+                    return true;
+                }
+                memcpy(fragments[lost], fragments[data_fragments_], size);
+                for (int i = 0; i < data_fragments_; i++) {
+                    if (i != lost) {
+                        XorRegion(fragments[lost], fragments[i], size);
+                    }
+                }
+                return true;
+            }
+        };
+
+        class ReedSolomonCoder : public ErasureCoder {
+        public:
+            ReedSolomonCoder(int data_fragments, int parity_fragments)
+                    : ErasureCoder(data_fragments, parity_fragments) {
+                // Systematic generator matrix: identity on top of a Cauchy
+                // matrix. Every k x k sub-matrix of it is invertible.
+                int k = data_fragments_;
+                int rows = data_fragments_ + parity_fragments_;
+                matrix_.resize(rows * k, 0);
+                for (int i = 0; i < k; i++) {
+                    matrix_[i * k + i] = 1;
+                }
+                for (int i = 0; i < parity_fragments_; i++) {
+                    for (int j = 0; j < k; j++) {
+                        uint8_t x = i;
+                        uint8_t y = parity_fragments_ + j;
+                        matrix_[(k + i) * k + j] = gf().Inverse(x ^ y);
+                    }
+                }
+            }
+
+            const char *Name() const override { return "reed-solomon"; }
+
+            void Encode(const char *const *data, char *const *parity,
+                        size_t size) const override {
+                int k = data_fragments_;
+                for (size_t off = 0; off < size; off += kEncodeChunkSize) {
+                    size_t len = std::min(kEncodeChunkSize, size - off);
+                    for (int i = 0; i < parity_fragments_; i++) {
+                        const uint8_t *coefs = &matrix_[(k + i) * k];
+                        memset(parity[i] + off, 0, len);
+                        for (int j = 0; j < k; j++) {
+                            GFMulXorRegion(parity[i] + off, data[j] + off,
+                                           coefs[j], len);
+                        }
+                    }
+                }
+            }
+
+            bool Decode(char *const *fragments, const std::vector<bool> &available,
+                        size_t size) const override {
+                int k = data_fragments_;
+                std::vector<int> lost;
+                for (int j = 0; j < k; j++) {
+                    if (!available[j]) {
+                        lost.push_back(j);
+                    }
+                }
+                if (lost.empty()) {
+                    return true;
+                }
+                // Use the first k available fragments.
+                std::vector<int> sources;
+                for (int i = 0; i < k + parity_fragments_ && sources.size() < k; i++) {
+                    if (available[i]) {
+                        sources.push_back(i);
+                    }
+                }
+                if (sources.size() < k) {
+                    return false;
+                }
+                std::vector<uint8_t> inverse;
+                Invert(sources, &inverse);
+                for (int j : lost) {
+                    const uint8_t *coefs = &inverse[j * k];
+                    memset(fragments[j], 0, size);
+                    for (int r = 0; r < k; r++) {
+                        GFMulXorRegion(fragments[j], fragments[sources[r]],
+                                       coefs[r], size);
+                    }
+                }
+                return true;
+            }
+
+        private:
+            // Invert the k x k sub-matrix formed by the rows in "sources" with
+            // Gauss-Jordan elimination.
+            void Invert(const std::vector<int> &sources,
+                        std::vector<uint8_t> *inverse) const {
+                int k = data_fragments_;
+                std::vector<uint8_t> m(k * k);
+                for (int r = 0; r < k; r++) {
+                    memcpy(&m[r * k], &matrix_[sources[r] * k], k);
+                }
+                inverse->assign(k * k, 0);
+                uint8_t *inv = inverse->data();
+                for (int i = 0; i < k; i++) {
+                    inv[i * k + i] = 1;
+                }
+                for (int col = 0; col < k; col++) {
+                    int pivot = col;
+                    while (pivot < k && m[pivot * k + col] == 0) {
+                        pivot++;
+                    }
+                    NOVA_ASSERT(pivot < k);
+                    if (pivot != col) {
+                        std::swap_ranges(&m[pivot * k], &m[pivot * k] + k, &m[col * k]);
+                        std::swap_ranges(&inv[pivot * k], &inv[pivot * k] + k, &inv[col * k]);
+                    }
+                    uint8_t scale = gf().Inverse(m[col * k + col]);
+                    for (int j = 0; j < k; j++) {
+                        m[col * k + j] = gf().mul[scale][m[col * k + j]];
+                        inv[col * k + j] = gf().mul[scale][inv[col * k + j]];
+                    }
+                    for (int r = 0; r < k; r++) {
+                        uint8_t factor = m[r * k + col];
+                        if (r == col || factor == 0) {
+                            continue;
+                        }
+                        for (int j = 0; j < k; j++) {
+                            m[r * k + j] ^= gf().mul[factor][m[col * k + j]];
+                            inv[r * k + j] ^= gf().mul[factor][inv[col * k + j]];
+                        }
+                    }
+                }
+            }
+
+            // (k + m) rows by k columns.
+            std::vector<uint8_t> matrix_;
+        };
+    }
+
+    void XorRegion(char *dst, const char *src, size_t n) {
+        size_t i = 0;
+#if defined(NOVA_EC_X86)
+        switch (simd_level()) {
+            case kAVX512:
+                i = XorRegionAVX512(dst, src, n);
+                break;
+            case kAVX2:
+                i = XorRegionAVX2(dst, src, n);
+                break;
+            case kScalar:
+                break;
+        }
+#endif
+        for (; i + 8 <= n; i += 8) {
+            uint64_t d;
+            uint64_t s;
+            memcpy(&d, dst + i, 8);
+            memcpy(&s, src + i, 8);
+            d ^= s;
+            memcpy(dst + i, &d, 8);
+        }
+        for (; i < n; i++) {
+            dst[i] ^= src[i];
+        }
+    }
+
+    void GFMulXorRegion(char *dst, const char *src, uint8_t c, size_t n) {
+        if (c == 0) {
+            return;
+        }
+        if (c == 1) {
+            XorRegion(dst, src, n);
+            return;
+        }
+        size_t i = 0;
+#if defined(NOVA_EC_X86)
+        switch (simd_level()) {
+            case kAVX512:
+                i = GFMulXorRegionAVX512(dst, src, c, n);
+                break;
+            case kAVX2:
+                i = GFMulXorRegionAVX2(dst, src, c, n);
+                break;
+            case kScalar:
+                break;
+        }
+#endif
+        const uint8_t *table = gf().mul[c];
+        for (; i < n; i++) {
+            dst[i] ^= table[(uint8_t) src[i]];
+        }
+    }
+
+    ErasureCoder *NewErasureCoder(int data_fragments, int parity_fragments) {
+        NOVA_ASSERT(data_fragments >= 1 && parity_fragments >= 1 &&
+                    data_fragments + parity_fragments <= 256)
+            << data_fragments << " " << parity_fragments;
+        if (parity_fragments == 1) {
+            return new XorCoder(data_fragments);
+        }
+        return new ReedSolomonCoder(data_fragments, parity_fragments);
+    }
+
+}  // namespace leveldb
@@ -0,0 +1,68 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+// Erasure coding for the data fragments of an SSTable.
+// A coder protects k data fragments of equal size with m parity fragments
+// and rebuilds any m lost fragments from the survivors. m=1 uses XOR parity.
+// m>1 uses a systematic Cauchy Reed-Solomon code over GF(2^8). The kernels
+// use AVX2/AVX-512 when the CPU supports them.
+
+#ifndef LEVELDB_ERASURE_CODING_H
+#define LEVELDB_ERASURE_CODING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace leveldb {
+
+    class ErasureCoder {
+    public:
+        ErasureCoder(int data_fragments, int parity_fragments)
+                : data_fragments_(data_fragments),
+                  parity_fragments_(parity_fragments) {}
+
+        virtual ~ErasureCoder() = default;
+
+        virtual const char *Name() const = 0;
+
+        // Compute the parity fragments.
+        // "data" holds k fragments and "parity" holds m output buffers. Every
+        // buffer is "size" bytes.
+        virtual void
+        Encode(const char *const *data, char *const *parity,
+               size_t size) const = 0;
+
+        // Rebuild the data fragments that are not available.
+        // "fragments" holds k data pointers followed by m parity pointers.
+        // "available[i]" is false when fragments[i] is lost. Lost data
+        // fragments must point to writable buffers of "size" bytes. Lost
+        // parity fragments are not rebuilt.
+        // Return false if fewer than k fragments are available.
+        virtual bool
+        Decode(char *const *fragments, const std::vector<bool> &available,
+               size_t size) const = 0;
+
+        int data_fragments() const { return data_fragments_; }
+
+        int parity_fragments() const { return parity_fragments_; }
+
+    protected:
+        const int data_fragments_;
+        const int parity_fragments_;
+    };
+
+    // Return a coder for k data fragments and m parity fragments.
+    // The caller owns the result.
+    // REQUIRES: k >= 1, m >= 1, k + m <= 256.
+    ErasureCoder *NewErasureCoder(int data_fragments, int parity_fragments);
+
+    // dst[i] ^= src[i] for i in [0, n).
+    void XorRegion(char *dst, const char *src, size_t n);
+
+    // dst[i] ^= c * src[i] in GF(2^8) for i in [0, n).
+    void GFMulXorRegion(char *dst, const char *src, uint8_t c, size_t n);
+
+}  // namespace leveldb
+
+#endif //LEVELDB_ERASURE_CODING_H
@@ -0,0 +1,173 @@
+//
+// Copyright (c) 2020 University of Southern California. All rights reserved.
+//
+
+#include "util/erasure_coding.h"
+
+#include <string>
+#include <vector>
+
+#include "common/nova_common.h"
+#include "util/random.h"
+#include "util/testharness.h"
+
+namespace leveldb {
+
+    // Multiply in GF(2^8) with the polynomial x^8 + x^4 + x^3 + x^2 + 1 bit
+    // by bit, independently of the tables of the coder.
+    static uint8_t GFMul(uint8_t a, uint8_t b) {
+        uint32_t x = a;
+        uint8_t result = 0;
+        while (b != 0) {
+            if (b & 1) {
+                result ^= x;
+            }
+            b >>= 1;
+            x <<= 1;
+            if (x & 0x100) {
+                x ^= 0x11d;
+            }
+        }
+        return result;
+    }
+
+    static std::string RandomBytes(Random *rnd, size_t size) {
+        std::string result(size, 0);
+        for (size_t i = 0; i < size; i++) {
+            result[i] = static_cast<char>(rnd->Uniform(256));
+        }
+        return result;
+    }
+
+    class ErasureCodingTest {
+    public:
+        // Encode k random fragments of "size" bytes. Then lose every
+        // combination of up to m of the k + m fragments, decode, and check
+        // that the data fragments are rebuilt.
+        void CheckAllLosses(int k, int m, size_t size) {
+            ErasureCoder *coder = NewErasureCoder(k, m);
+            ASSERT_EQ(k, coder->data_fragments());
+            ASSERT_EQ(m, coder->parity_fragments());
+
+            Random rnd(301 + k * 17 + m);
+            std::vector<std::string> data;
+            std::vector<std::string> parity(m, std::string(size, 0));
+            std::vector<const char *> data_ptrs;
+            std::vector<char *> parity_ptrs;
+            for (int i = 0; i < k; i++) {
+                data.push_back(RandomBytes(&rnd, size));
+                data_ptrs.push_back(data[i].data());
+            }
+            for (int i = 0; i < m; i++) {
+                parity_ptrs.push_back(&parity[i][0]);
+            }
+            coder->Encode(&data_ptrs[0], &parity_ptrs[0], size);
+
+            int n = k + m;
+            int checked = 0;
+            for (uint32_t lost = 0; lost < (1u << n); lost++) {
+                if (__builtin_popcount(lost) > m) {
+                    continue;
+                }
+                std::vector<std::string> fragments;
+                std::vector<bool> available;
+                for (int i = 0; i < n; i++) {
+                    bool is_lost = (lost & (1u << i)) != 0;
+                    available.push_back(!is_lost);
+                    if (is_lost) {
+                        // Garbage that Decode must overwrite.
+                        fragments.push_back(std::string(size, '\xab'));
+                    } else if (i < k) {
+                        fragments.push_back(data[i]);
+                    } else {
+                        fragments.push_back(parity[i - k]);
+                    }
+                }
+                std::vector<char *> fragment_ptrs;
+                for (int i = 0; i < n; i++) {
+                    fragment_ptrs.push_back(&fragments[i][0]);
+                }
+                ASSERT_TRUE(coder->Decode(&fragment_ptrs[0], available, size))
+                    << "k=" << k << " m=" << m << " lost=" << lost;
+                for (int i = 0; i < k; i++) {
+                    ASSERT_TRUE(fragments[i] == data[i])
+                        << "k=" << k << " m=" << m << " lost=" << lost
+                        << " fragment=" << i;
+                }
+                checked++;
+            }
+            ASSERT_GT(checked, 0);
+            delete coder;
+        }
+    };
+
+    TEST(ErasureCodingTest, XorParity) {
+        CheckAllLosses(1, 1, 100);
+        CheckAllLosses(4, 1, 4096);
+        CheckAllLosses(7, 1, 4099);
+    }
+
+    TEST(ErasureCodingTest, ReedSolomon) {
+        CheckAllLosses(1, 2, 100);
+        CheckAllLosses(2, 2, 33);
+        CheckAllLosses(3, 2, 4096);
+        CheckAllLosses(4, 3, 1000);
+        CheckAllLosses(6, 3, 8192 + 65);
+        CheckAllLosses(10, 4, 257);
+    }
+
+    TEST(ErasureCodingTest, EmptyFragments) {
+        CheckAllLosses(3, 2, 0);
+    }
+
+    TEST(ErasureCodingTest, TooManyLosses) {
+        const int k = 4;
+        const int m = 2;
+        const size_t size = 64;
+        ErasureCoder *coder = NewErasureCoder(k, m);
+        std::vector<std::string> fragments(k + m, std::string(size, 0));
+        std::vector<char *> fragment_ptrs;
+        for (auto &fragment : fragments) {
+            fragment_ptrs.push_back(&fragment[0]);
+        }
+        std::vector<bool> available(k + m, true);
+        available[0] = false;
+        available[2] = false;
+        available[5] = false;
+        ASSERT_TRUE(!coder->Decode(&fragment_ptrs[0], available, size));
+        delete coder;
+    }
+
+    TEST(ErasureCodingTest, Regions) {
+        Random rnd(17);
+        // Sizes around the vector widths exercise the SIMD kernels and the
+        // scalar tails.
+        const size_t sizes[] = {0, 1, 15, 31, 32, 33, 63, 64, 65, 200, 4097};
+        for (size_t size : sizes) {
+            std::string src = RandomBytes(&rnd, size);
+            std::string dst = RandomBytes(&rnd, size);
+            std::string expected = dst;
+            for (size_t i = 0; i < size; i++) {
+                expected[i] ^= src[i];
+            }
+            XorRegion(&dst[0], src.data(), size);
+            ASSERT_TRUE(dst == expected) << size;
+
+            for (int c = 0; c < 256; c += 51) {
+                expected = dst;
+                for (size_t i = 0; i < size; i++) {
+                    expected[i] ^= GFMul(static_cast<uint8_t>(c),
+                                         static_cast<uint8_t>(src[i]));
+                }
+                GFMulXorRegion(&dst[0], src.data(), static_cast<uint8_t>(c),
+                               size);
+                ASSERT_TRUE(dst == expected) << size << " c=" << c;
+            }
+        }
+    }
+
+}  // namespace leveldb
+
+nova::NovaGlobalVariables nova::NovaGlobalVariables::global;
+
+int main(int argc, char **argv) { return leveldb::test::RunAllTests(); }
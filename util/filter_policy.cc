@@ -4,8 +4,18 @@
 
 #include "leveldb/filter_policy.h"
 
+#include "leveldb/slice.h"
+
 namespace leveldb {
 
     FilterPolicy::~FilterPolicy() {}
 
+    void FilterPolicy::KeyMayMatchBatch(const Slice &key,
+                                        const Slice *filters, int n,
+                                        bool *results) const {
+        for (int i = 0; i < n; i++) {
+            results[i] = KeyMayMatch(key, filters[i]);
+        }
+    }
+
 }  // namespace leveldb
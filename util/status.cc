@@ -60,6 +60,9 @@ namespace leveldb {
                 case kIOError:
                     type = "IO error: ";
                     break;
+                case kIncomplete:
+                    type = "Incomplete: ";
+                    break;
                 default:
                     snprintf(tmp, sizeof(tmp),
                              "Unknown code(%d): ", static_cast<int>(code()));